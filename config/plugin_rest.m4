@@ -18,5 +18,6 @@ LIBS+=" $BOOST_SYSTEM_LIBS $BOOST_THREAD_LIBS $BOOST_REGEX_LIBS"
 AC_CONFIG_FILES([
 	src/xdpd/management/plugins/rest/Makefile
   src/xdpd/management/plugins/rest/server/Makefile
+  test/xdpd/unit/rest_server/Makefile
 ])
 
@@ -0,0 +1,34 @@
+#
+# checking for AF_XDP support (ioport_xdp)
+# XDP program attachment via BPF links is available since kernel 5.9
+#
+
+AC_MSG_CHECKING(whether kernel supports AF_XDP sockets)
+AC_COMPILE_IFELSE(
+	[AC_LANG_PROGRAM(
+		[
+			#include <sys/socket.h>
+			#include <linux/if_xdp.h>
+			#include <linux/bpf.h>
+		],
+		[
+			struct xdp_umem_reg reg;
+			union bpf_attr attr;
+			attr.link_create.attach_type = BPF_XDP;
+			reg.chunk_size = XDP_PACKET_HEADROOM;
+			(void)reg;
+			(void)attr;
+			return AF_XDP;
+		]
+	)],
+	[have_af_xdp="yes"],
+	[have_af_xdp="no"]
+)
+
+if test "$have_af_xdp" = "yes"; then
+	AC_MSG_RESULT(yes)
+	AC_DEFINE([HAVE_AF_XDP])
+else
+	AC_MSG_RESULT(no)
+	AC_MSG_WARN([kernel headers do not support AF_XDP sockets; AF_XDP ports (ioport_xdp) will not be available. Consider upgrading to at least kernel version 5.9.x])
+fi
@@ -16,6 +16,7 @@
 #include <sys/types.h>
 #include <string>
 #include <vector>
+#include <map>
 #include <algorithm>
 #include <rofl/common/utils/c_logger.h>
 #include <rofl/datapath/pipeline/physical_switch.h>
@@ -50,7 +51,7 @@ static bool bg_continue_execution = true;
  */
 int prepare_event_socket()
 {
-	int sock;
+	int sock, bufsize;
 	struct sockaddr_nl addr;
 
 	if ((sock = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE)) == -1){
@@ -64,6 +65,13 @@ int prepare_event_socket()
 		return -1;
 	}
 
+	//Make room for bursts of notifications, to avoid overruns (resyncs)
+	bufsize = NL_SOCKET_BUFFER_SIZE;
+	if(setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &bufsize, sizeof(bufsize)) < 0 &&
+		setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize)) < 0){
+		ROFL_WARN(DRIVER_NAME" [bg] WARNING: unable to set the NETLINK_ROUTE socket buffer size, errno(%d): %s\n", errno, strerror(errno));
+	}
+
 	memset(&addr, 0, sizeof(addr));
 	addr.nl_family = AF_NETLINK;
 	addr.nl_groups = RTMGRP_LINK;
@@ -77,95 +85,152 @@ int prepare_event_socket()
 }
 
 /*
-*  TODO: probably this belongs to iface_utils
+* Netlink link events. Events are parsed (RTM_NEWLINK/RTM_DELLINK payload) and
+* coalesced per interface until the socket is drained, so that bursts (e.g.
+* container veth churn) only touch the interfaces concerned, once.
 */
 
-static int read_netlink_socket(int fd, char *buf, int seq_num, int pid){
+//Coalesced link events of an interface
+typedef struct nl_link_event{
+	bool deleted;		//RTM_DELLINK received (or renamed)
+	bool present;		//Last event is an RTM_NEWLINK
+	unsigned int flags;	//ifi_flags of the last RTM_NEWLINK
+	bool has_hwaddr;
+	uint8_t hwaddr[6];
+}nl_link_event_t;
 
-	struct nlmsghdr *nlh;
-	int read_len = 0, msg_len = 0;
+//ifindex -> name of the kernel interfaces (to detect renames)
+static std::map<int, std::string> ifindex_names;
 
-	do {
-		/* Recieve response from the kernel */
-		if ((read_len = recv(fd, buf, MAX_NL_MESSAGE_HEADER - msg_len, 0)) < 0) {
-		    return -1;
-		}
+static void init_ifindex_names(void){
 
-		nlh = (struct nlmsghdr *) buf;
+	unsigned int i, max_ports, ifindex;
+	switch_port_t** ports;
 
-		/* Check if the header is valid */
-		if ((NLMSG_OK(nlh, (unsigned int)read_len) == 0)
-		    || (nlh->nlmsg_type == NLMSG_ERROR)) {
-		    return -1;
-		}
+	ifindex_names.clear();
 
-		/* Check if the its the last message */
-		if (nlh->nlmsg_type == NLMSG_DONE) {
-		    break;
-		} else {
-		/* Else move the pointer to buffer appropriately */
-		    buf += read_len;
-		    msg_len += read_len;
-		}
+	ports = physical_switch_get_physical_ports(&max_ports);
+	for(i=0;i<max_ports;i++){
+		if(ports[i] && (ifindex = if_nametoindex(ports[i]->name)) != 0)
+			ifindex_names[ifindex] = std::string(ports[i]->name);
+	}
+}
 
-		/* Check if its a multi part message */
-		if ((nlh->nlmsg_flags & NLM_F_MULTI) == 0) {
-		   /* return if its not */
-		    break;
-		}
-	} while ((nlh->nlmsg_seq != (unsigned int)seq_num) || (nlh->nlmsg_pid != (unsigned int)pid));
-	
-	return msg_len;
+static void parse_netlink_link_message(struct nlmsghdr *nlh, std::map<std::string, nl_link_event_t>& events){
+
+	int len;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	const char* name = NULL;
+	const uint8_t* hwaddr = NULL;
+	std::map<int, std::string>::iterator it;
+
+	ifi = (struct ifinfomsg *) NLMSG_DATA(nlh);
+
+	//Skip AF_BRIDGE (bridge port) notifications
+	if(ifi->ifi_family != AF_UNSPEC)
+		return;
+
+	len = IFLA_PAYLOAD(nlh);
+	for(rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)){
+		if(rta->rta_type == IFLA_IFNAME)
+			name = (const char*)RTA_DATA(rta);
+		else if(rta->rta_type == IFLA_ADDRESS && RTA_PAYLOAD(rta) == 6)
+			hwaddr = (const uint8_t*)RTA_DATA(rta);
+	}
+
+	if(!name || strnlen(name, IFNAMSIZ) == IFNAMSIZ)
+		return;
+
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME" [bg] Interface %s (%u) %s flags=0x%x change=0x%x\n", name, ifi->ifi_index, (nlh->nlmsg_type == RTM_NEWLINK)? "changed" : "deleted", ifi->ifi_flags, ifi->ifi_change);
+
+	nl_link_event_t& ev = events[std::string(name)];
+	it = ifindex_names.find(ifi->ifi_index);
+
+	if(nlh->nlmsg_type == RTM_DELLINK){
+		ev.deleted = true;
+		ev.present = false;
+		if(it != ifindex_names.end())
+			ifindex_names.erase(it);
+		return;
+	}
+
+	//Renamed; the port under the old name is gone
+	if(it != ifindex_names.end() && it->second.compare(name) != 0){
+		nl_link_event_t& old = events[it->second];
+		old.deleted = true;
+		old.present = false;
+	}
+	ifindex_names[ifi->ifi_index] = std::string(name);
+
+	ev.present = true;
+	ev.flags = ifi->ifi_flags;
+	ev.has_hwaddr = (hwaddr != NULL);
+	if(hwaddr)
+		memcpy(ev.hwaddr, hwaddr, sizeof(ev.hwaddr));
 }
 
 /**
  * @name read_netlink_message
- * @brief once we have received a NL message, this function reads the content and 
- * calls a function to update the port structure
+ * @brief drains the NL socket, coalescing the link events per interface,
+ * and updates the ports concerned. If notifications were lost (socket
+ * overrun), a full resync of the ports is performed instead
  * @param fd file descriptor where the message has been received
  */
 static rofl_result_t read_netlink_message(int fd){
-	
+
 	int len;
+	unsigned int i;
+	bool resync = false;
 	struct nlmsghdr *nlh;
-	char recv_buffer[MAX_NL_MESSAGE_HEADER];
-	nlh = (struct nlmsghdr *)recv_buffer;
-	
-	struct ifinfomsg *ifi;
-	char name[IFNAMSIZ];
+	char recv_buffer[NL_RECV_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+	std::map<std::string, nl_link_event_t> events;
+	rofl_result_t res = ROFL_SUCCESS;
 
-	len = read_netlink_socket(fd,(char*)nlh, 0, getpid());
-	if(len <= 0)
-		return ROFL_FAILURE; 
+	for(i=0;i<NL_MAX_BATCH;i++){
+		len = recv(fd, recv_buffer, sizeof(recv_buffer), MSG_TRUNC);
 
-	for (; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)) {
+		if(len < 0){
+			if(errno == EINTR)
+				continue;
+			if(errno == ENOBUFS){
+				//Kernel dropped notifications
+				ROFL_WARN(DRIVER_NAME" [bg] WARNING: netlink socket overrun; resynchronizing the list of physical interfaces\n");
+				resync = true;
+				continue;
+			}
+			break; //EAGAIN; drained
+		}
 
-	    if (nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK){
-				ifi = (struct ifinfomsg *) NLMSG_DATA(nlh);
-				
-				if(!if_indextoname(ifi->ifi_index, name))
-					continue; //Unable to map interface
-				
-				ROFL_DEBUG_VERBOSE(DRIVER_NAME" [bg] Interface changed status %s (%u) flags=0x%x change=0x%x\n",name, ifi->ifi_index, ifi->ifi_flags, ifi->ifi_change);
-				
-				//We are interested only in admin port status and link
-				unsigned int mask = IFF_UP|IFF_RUNNING;
-#ifdef IFF_LOWER_UP
-				mask |= IFF_LOWER_UP;
-#endif
-				//Kernel seems to send ifi_change = 0, when LINK changes
-				if (ifi->ifi_change & mask || !ifi->ifi_change) {
-					// HERE change the status to the port structure
-					if(update_port_status(name)!=ROFL_SUCCESS)
-						return ROFL_FAILURE;
-				}
-	    }else{
-		//Likely triggered by an addition of a port
-		return update_physical_ports();
-	    }
+		if(len > (int)sizeof(recv_buffer)){
+			resync = true;
+			continue;
+		}
+
+		for(nlh = (struct nlmsghdr *)recv_buffer; NLMSG_OK(nlh, (unsigned int)len); nlh = NLMSG_NEXT(nlh, len)){
+			if(nlh->nlmsg_type == RTM_NEWLINK || nlh->nlmsg_type == RTM_DELLINK)
+				parse_netlink_link_message(nlh, events);
+		}
 	}
-	
-	return ROFL_SUCCESS;
+
+	if(resync){
+		res = resync_physical_ports();
+		init_ifindex_names();
+		return res;
+	}
+
+	//Apply
+	for(std::map<std::string, nl_link_event_t>::iterator it = events.begin(); it != events.end(); ++it){
+		nl_link_event_t& ev = it->second;
+
+		if(ev.deleted && remove_physical_port(it->first.c_str()) != ROFL_SUCCESS)
+			res = ROFL_FAILURE;
+
+		if(ev.present && update_physical_port(it->first.c_str(), (ev.has_hwaddr)? ev.hwaddr : NULL, ev.flags) != ROFL_SUCCESS)
+			res = ROFL_FAILURE;
+	}
+
+	return res;
 }
 
 /**
@@ -192,6 +257,10 @@ int process_timeouts()
 #endif
 
 		//TIMERS FLOW ENTRIES
+		//Entries and their timers are owned by the pipeline, which keeps
+		//them in time slots; only the slots due (and the idle entries in
+		//them) are processed. The driver has no per-entry timer interface
+		//to schedule against, so every LSI is ticked each slot
 		for(i=0; i<max_switches; i++)
 		{
 
@@ -265,6 +334,10 @@ void* x86_background_tasks_routine(void* param)
 	if((events_socket=prepare_event_socket())<0){
 		exit(ROFL_FAILURE);
 	}
+
+	//Catch up with the changes between the discovery and the subscription
+	update_physical_ports();
+	init_ifindex_names();
 	
 	efd = epoll_create1(0);
 
@@ -307,6 +380,12 @@ void* x86_background_tasks_routine(void* param)
 		//Check for events
 		for(i=0;i<nfds;i++){
 
+			//Netlink overruns (ENOBUFS) are reported as EPOLLERR
+			if(event_list[i].data.fd == events_socket){
+				read_netlink_message(events_socket);
+				continue;
+			}
+
 			if( (event_list[i].events & EPOLLERR) || (event_list[i].events & EPOLLHUP)/*||(event_list[i].events & EPOLLIN)*/){
 				//error on this fd
 				//ROFL_ERR(DRIVER_NAME" Error in file descriptor\n");
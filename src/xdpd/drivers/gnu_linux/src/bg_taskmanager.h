@@ -9,7 +9,9 @@
 #include <rofl/datapath/pipeline/physical_switch.h>
 #include <rofl_datapath.h>
 
-#define MAX_NL_MESSAGE_HEADER 4096
+#define NL_RECV_BUFFER_SIZE 32768
+#define NL_SOCKET_BUFFER_SIZE (4*1024*1024)
+#define NL_MAX_BATCH 1024 /*max. netlink datagrams coalesced per wake up*/
 #define MAX_EPOLL_EVENTS 128
 
 /**
@@ -59,6 +59,13 @@
 //Number of output queues per interface
 #define IO_IFACE_NUM_QUEUES 8
 
+//Cache line size (used to pad structures shared among I/O threads)
+#define IO_CACHE_LINE_SIZE 64
+
+//Number of port counter shards; one per I/O thread plus one shared
+//(atomically updated) by non I/O threads
+#define IO_PORT_STATS_SHARDS (IO_RX_THREADS+IO_TX_THREADS+1)
+
 /*
 * Buffer pool section
 */
@@ -71,6 +78,19 @@
 //Warning: changing the size of this variable can affect performance 
 #define IO_BUFFERPOOL_CAPACITY 2048*16-2048 //32K buffers
 
+//Payload size classes. Every buffer has a payload buffer for frames up to
+//IO_BUFFERPOOL_SMALL_FRAME_SIZE bytes; larger (jumbo) frames borrow one
+//of the IO_BUFFERPOOL_JUMBO_CAPACITY-1 (power of 2, minus 1) jumbo payload
+//buffers. Warning: only 2047 jumbo frames can be buffered at a time (all the
+//IO_BUFFERPOOL_CAPACITY buffers used to fit one); jumbo MTU deployments may
+//have to raise it. Frames not finding a buffer are dropped (rx_dropped)
+#define IO_BUFFERPOOL_SMALL_FRAME_SIZE 2048
+#define IO_BUFFERPOOL_JUMBO_CAPACITY 2048
+
+//Back the bufferpool (packet state and payloads) with hugepages, if
+//available (falls back to regular pages). Comment out to disable
+#define IO_BUFFERPOOL_USE_HUGEPAGES
+
 /*
 * Port scheduling strategy
 */
@@ -79,6 +99,27 @@
 //Warning: not recommended!
 //#define IO_POLLING_STRATEGY
 
+/*
+* Egress (TX) scheduling of the port output queues
+*/
+
+//Use the hierarchical scheduler (strict priority classes, byte based DRR
+//within a class and per queue min/max rates). Comment out to use the legacy
+//packet based WRR (no queue configuration)
+#define IO_TX_HQOS_SCHEDULER
+
+//Max number of packets sent per port and scheduling round
+#define IO_TX_HQOS_ROUND_BUDGET 64
+
+//DRR quantum (bytes) of a queue with weight 10 (the quantum is weight*IO_TX_HQOS_QUANTUM/10)
+#define IO_TX_HQOS_QUANTUM 1514
+
+//Token bucket depth of the min/max rates (us at the configured rate)
+#define IO_TX_HQOS_BURST_US 1000
+
+//Port speed (kbps) used for the rates when it is unknown (e.g. veth)
+#define IO_TX_HQOS_DEFAULT_PORT_SPEED_KBPS 10000000
+
 
 /*
 * Interface section
@@ -99,12 +140,61 @@
 #define IO_IFACE_MMAP_BLOCKS 2 
 #define IO_IFACE_MMAP_BLOCK_SIZE 96
 
+//Use TPACKET_V3 RX rings (variable-size frames packed in blocks). Comment
+//this out to use the TPACKET_V2 (fixed-size frame slots) RX rings
+#define IO_IFACE_MMAP_RX_TPACKET_V3 1
+
+//TPACKET_V3 RX ring; number of blocks and block size (in pages)
+#define IO_IFACE_MMAP_RX_V3_BLOCKS 8
+#define IO_IFACE_MMAP_RX_V3_BLOCK_SIZE 64
+
+//TPACKET_V3 block retire timeout (ms). Partially filled blocks are handed
+//to user-space after this time; this bounds the RX latency at low rates
+#define IO_IFACE_MMAP_RX_V3_RETIRE_TOV_MS 1
+
 #define VETH_DISABLE_CHKSM_OFFLOAD 1
 
+//
+// ioport_xdp specifics (AF_XDP)
+//
+
+//UMEM frame size. Must be a power of 2 (2048 or 4096). Note that the
+//kernel reserves XDP_PACKET_HEADROOM bytes at the beginning of each frame
+#define IO_IFACE_XDP_FRAME_SIZE 2048
+
+//Number of UMEM frames, shared by all the AF_XDP ports
+//Align to a power of 2
+#define IO_IFACE_XDP_UMEM_FRAMES 32768
+
+//Fill, completion, RX and TX ring sizes
+//Align to a power of 2
+#define IO_IFACE_XDP_RING_SLOTS 2048
+
+//Copy (generic) mode only; retry period (us) of the TX when the TX ring
+//is full. In zero-copy mode, the TX thread waits for room in the ring
+#define IO_IFACE_XDP_TX_RETRY_US 100
+
+//
+// ioport_pcap specifics
+//
+
+//TX capture file write buffer (bytes)
+#define IO_IFACE_PCAP_TX_BUFFER_SIZE (1024*1024)
+
 /*
 * Kernel scheduling section
 */
 
+//Run-to-completion vlinks: packets output by an RX I/O thread to a vlink are
+//processed straight away in the peer LSI, if the peer port belongs to the same
+//RX portgroup, without going through the TX thread and the notification pipes.
+//Comment it to always use the queues
+#define IO_VLINK_RUN_TO_COMPLETION 1
+
+//Max number of chained LSIs processed in run-to-completion by an RX thread,
+//including the LSI of the RX port. Packets beyond that go through the queues
+#define IO_VLINK_RTC_MAX_DEPTH 4
+
 //Kernel scheduling policy for I/O threads. Possible values SCHED_FIFO, SCHED_RR or SCHED_OTHER
 //Warning: change it only if you know what you are doing 
 #define IO_KERN_SCHED_POL SCHED_OTHER
@@ -129,6 +219,10 @@
 //WARNING: do not over-size it or congestion can be created
 #define LSI_PKT_IN_QUEUE_SLOTS 64
 
+//PKT_OUT queue (pending PKT_OUTs to be processed by the RX I/O threads)
+//Align to a power of 2
+#define LSI_PKT_OUT_QUEUE_SLOTS 256
+
 //Buffer storage(PKT_IN) max buffers per LSI
 #define LSI_PKT_IN_STORAGE_MAX_BUF 512
 
@@ -140,9 +234,11 @@
 * Other
 */
 
-//Only enable if you want to profile code. This MUST NOT
-//be enabled in "production"
-//#define ENABLE_TIME_MEASUREMENTS
+//Stage latency histograms (util/stage_latency.h); measure 1 out of
+//STAGE_LATENCY_SAMPLING packets per I/O thread. Must be a power of 2,
+//or 0 to disable them. Can be overriden via the "latency_sampling"
+//extra parameter
+#define STAGE_LATENCY_SAMPLING 256
 
 
 //---------------------------------------------------------//
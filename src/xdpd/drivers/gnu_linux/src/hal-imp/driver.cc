@@ -16,6 +16,10 @@
 
 
 #include <stdio.h>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 #include <rofl/datapath/hal/driver.h>
 #include <rofl/common/utils/c_logger.h>
 #include <rofl/datapath/hal/cmm.h>
@@ -28,7 +32,11 @@
 
 #include "../io/iface_utils.h"
 #include "../io/pktin_dispatcher.h"
+#include "../io/pktout_dispatcher.h"
 #include "../processing/ls_internal_state.h"
+#include "../util/stage_latency.h"
+#include "../../../hal_pktin_ext.h"
+#include "../../../hal_qos_ext.h"
 
 //only for Test
 #include <stdlib.h>
@@ -38,14 +46,154 @@
 
 using namespace xdpd::gnu_linux;
 
+/*
+* Aggregate the per I/O thread counters of the port(s) before snapshotting
+*/
+static inline void __update_port_stats(switch_port_t* port){
+	if(port && port->platform_port_state)
+		((ioport*)port->platform_port_state)->update_of_port_stats();
+}
+
+static void __update_switch_ports_stats(of_switch_t* sw){
+
+	unsigned int i;
+
+	for(i=0;i<sw->max_ports;i++){
+		if(sw->logical_ports[i].attachment_state == LOGICAL_PORT_STATE_ATTACHED)
+			__update_port_stats(sw->logical_ports[i].port);
+	}
+}
+
+//Some useful macros
+#define STR(a) #a
+#define XSTR(a) STR(a)
+
 //Driver static info
 #define GNU_LINUX_CODE_NAME "gnu-linux"
 #define GNU_LINUX_VERSION VERSION 
 #define GNU_LINUX_DESC \
-"GNU/Linux user-space driver.\n\nThe GNU/Linux driver is a user-space driver and serves as a reference implementation. It contains all the necessary bits and pieces to process packets in software, including a complete I/O subsystem written in C/C++. Access to network interfaces (NICs) is done via PACKET_MMAP.\n\nAlthough this driver does not provide cutting-edge performance, still provides a reasonable level of throughput\n\nFeatures:\n - Supports the following OpenFlow versions: v1.0, v1.2, v1.3.X\n - Supports multiple Logical Switch Instances (LSIs)\n - Supports virtual links between LSIs\n - Supports vast majority of network protocols defined by OpenFlow + extensions (GTP, PPP/PPPoE).\n\nMore details here:\n\nhttp://www.xdpd.org"
+"GNU/Linux user-space driver.\n\nThe GNU/Linux driver is a user-space driver and serves as a reference implementation. It contains all the necessary bits and pieces to process packets in software, including a complete I/O subsystem written in C/C++. Access to network interfaces (NICs) is done via PACKET_MMAP or, for the interfaces configured so, via AF_XDP sockets.\n\nAlthough this driver does not provide cutting-edge performance, still provides a reasonable level of throughput\n\nFeatures:\n - Supports the following OpenFlow versions: v1.0, v1.2, v1.3.X\n - Supports multiple Logical Switch Instances (LSIs)\n - Supports virtual links between LSIs\n - Supports vast majority of network protocols defined by OpenFlow + extensions (GTP, PPP/PPPoE).\n\nMore details here:\n\nhttp://www.xdpd.org"
+
+//Extra params MACROS
+#define DRIVER_EXTRA_XDP "xdp"
+#define DRIVER_EXTRA_XDP_NATIVE "native"
+#define DRIVER_EXTRA_XDP_GENERIC "generic"
+#define DRIVER_EXTRA_LATENCY_SAMPLING "latency_sampling"
+#define DRIVER_EXTRA_PCAP "pcap"
+
+#define GNU_LINUX_USAGE  \
+"\t\t\t\t" DRIVER_EXTRA_XDP "=<iface>[:native|:generic][,<iface>...];\t - Interfaces served via AF_XDP.\n"\
+"\t\t\t\t" DRIVER_EXTRA_LATENCY_SAMPLING "=<n>;\t - Measure the stage latency of 1 out of n packets.\n"\
+"\t\t\t\t" DRIVER_EXTRA_PCAP "=<port>:<rx_file>[:<tx_file>[:<pps>[:<loops>]]][,<port>...];\t - pcap replay/capture ports.\n"
+
+#define GNU_LINUX_EXTRA_PARAMS "This driver has a number of optional \"extra parameters\" that can be used using -e option, specifying them as key1=value1;key2=value2... :\n\n"\
+"   " DRIVER_EXTRA_XDP "=<iface>[:native|:generic][,<iface>...]\t - Serve the interfaces via AF_XDP sockets instead of PACKET_MMAP. XDP mode is native (driver) by default; use generic for interfaces whose driver does not support XDP. Default: none.\n\n"\
+"   " DRIVER_EXTRA_LATENCY_SAMPLING "=<n>\t - Measure the latency of the packet processing stages of 1 out of n packets (per I/O thread). n must be a power of 2, or 0 to disable the measurements. Default: " XSTR(STAGE_LATENCY_SAMPLING) ".\n\n"\
+"   " DRIVER_EXTRA_PCAP "=<port>:<rx_file>[:<tx_file>[:<pps>[:<loops>]]][,<port>...]\t - Create ports (not backed by any interface) replaying the pcap/pcapng capture rx_file, at pps packets per second (0, default: as fast as possible) loops times (0: forever, default: 1), and writing the packets sent through them to the pcap file tx_file (empty or /dev/null, default: packets are only counted). The replay starts when the port is brought up. Default: none.\n\n"
+
+/*
+* Parse the list of AF_XDP interfaces: <iface>[:native|:generic][,<iface>...]
+*/
+static void parse_xdp_ports(const std::string& ports){
+
+	std::istringstream ss(ports);
+	std::string t, name, mode;
+	size_t pos;
+	bool native;
+
+	while(std::getline(ss, t, ',')) {
+		t.erase(std::remove_if( t.begin(), t.end(), ::isspace ), t.end() );
+		if(t.empty())
+			continue;
+
+		native = true;
+		pos = t.find(':');
+		name = t.substr(0, pos);
+
+		if(pos != std::string::npos){
+			mode = t.substr(pos+1);
+			if(mode.compare(DRIVER_EXTRA_XDP_GENERIC) == 0){
+				native = false;
+			}else if(mode.compare(DRIVER_EXTRA_XDP_NATIVE) != 0){
+				ROFL_WARN(DRIVER_NAME" WARNING: unknown XDP mode '%s' for interface %s. Using native mode...\n", mode.c_str(), name.c_str());
+			}
+		}
+
+		set_xdp_port(name.c_str(), native);
+	}
+}
 
-#define GNU_LINUX_USAGE  "" //We don't support extra params
-#define GNU_LINUX_EXTRA_PARAMS "" //We don't support extra params
+/*
+* Parse the list of pcap ports: <port>:<rx_file>[:<tx_file>[:<pps>[:<loops>]]][,<port>...]
+*/
+static void parse_pcap_ports(const std::string& ports){
+
+	std::istringstream ss(ports);
+	std::string t, f;
+	std::vector<std::string> fields;
+
+	while(std::getline(ss, t, ',')) {
+		t.erase(std::remove_if( t.begin(), t.end(), ::isspace ), t.end() );
+		if(t.empty())
+			continue;
+
+		std::istringstream ss_(t);
+		fields.clear();
+		while(std::getline(ss_, f, ':'))
+			fields.push_back(f);
+
+		if(fields.size() < 2 || fields.size() > 5 || fields[0].empty()){
+			ROFL_WARN(DRIVER_NAME" WARNING: could not understand pcap port '%s'. Ignoring it...\n", t.c_str());
+			continue;
+		}
+
+		set_pcap_port(fields[0].c_str(),
+				(fields[1].empty())? NULL : fields[1].c_str(),
+				(fields.size() < 3 || fields[2].empty())? NULL : fields[2].c_str(),
+				(fields.size() < 4)? 0 : strtoull(fields[3].c_str(), NULL, 10),
+				(fields.size() < 5)? 1 : strtoul(fields[4].c_str(), NULL, 10));
+	}
+}
+
+//Stage latency sampling
+static unsigned int latency_sampling = STAGE_LATENCY_SAMPLING;
+
+static void parse_extra_params(const std::string& params){
+
+	std::istringstream ss(params);
+	std::string t, r;
+
+	//First split
+	while(std::getline(ss, t, ';')) {
+		std::istringstream ss_(t);
+
+		//Recover parameter
+		std::getline(ss_, r, '=');
+		r.erase(std::remove_if( r.begin(), r.end(), ::isspace ),
+								r.end() );
+
+		if(r.empty())
+			continue;
+
+		if(r.compare(DRIVER_EXTRA_XDP) == 0){
+			std::getline(ss_, r);
+			parse_xdp_ports(r);
+		}else if(r.compare(DRIVER_EXTRA_PCAP) == 0){
+			std::getline(ss_, r);
+			parse_pcap_ports(r);
+		}else if(r.compare(DRIVER_EXTRA_LATENCY_SAMPLING) == 0){
+			std::getline(ss_, r);
+			latency_sampling = strtoul(r.c_str(), NULL, 10);
+		}else{
+			t.erase(std::remove_if( t.begin(), t.end(),
+						::isspace ), t.end() );
+
+			//Unknown or unparsable parameter
+			ROFL_WARN(DRIVER_NAME" WARNING: could not understand extra-param '%s'. Ignoring it...\n",
+							t.c_str());
+		}
+	}
+}
 
 /*
 * @name    hal_driver_init
@@ -55,6 +203,10 @@ using namespace xdpd::gnu_linux;
 hal_result_t hal_driver_init(hal_extension_ops_t* extensions, const char* extra_params){
 
 	ROFL_INFO(DRIVER_NAME" Initializing driver...\n");
+
+	//Parse extra parameters
+	if(extra_params)
+		parse_extra_params(std::string(extra_params));
 	
 	//Init the ROFL-PIPELINE phyisical switch
 	if(physical_switch_init() != ROFL_SUCCESS)
@@ -64,9 +216,17 @@ hal_result_t hal_driver_init(hal_extension_ops_t* extensions, const char* extra_
 	//create bufferpool
 	bufferpool::init();
 
+	//Stage latency histograms
+	if(stage_latency::init(latency_sampling) != ROFL_SUCCESS)
+		return HAL_FAILURE;
+
 	if(discover_physical_ports() != ROFL_SUCCESS)
 		return HAL_FAILURE;
 
+	//PKT_OUT notification (must be there before I/O threads are launched)
+	if(init_packetout_notification() != ROFL_SUCCESS)
+		return HAL_FAILURE;
+
 	//Initialize the iomanager
 	if(iomanager::init() != ROFL_SUCCESS)
 		return HAL_FAILURE;
@@ -121,6 +281,9 @@ hal_result_t hal_driver_destroy(){
 	//Stop the bg manager
 	stop_background_tasks_manager();
 
+	//Release PKT_OUT notification
+	destroy_packetout_notification();
+
 	//Destroy interfaces
 	destroy_ports();
 
@@ -130,8 +293,8 @@ hal_result_t hal_driver_destroy(){
 	// destroy bufferpool
 	bufferpool::destroy();
 
-	//Print stats if any
-	TM_DUMP_MEASUREMENTS();
+	//Stage latency histograms
+	stage_latency::destroy();
 	
 	ROFL_INFO(DRIVER_NAME" driver destroyed.\n");
 	
@@ -165,6 +328,12 @@ dpid_list_t* hal_driver_get_all_lsi_dpids(void){
  * @retval  Pointer to of_switch_snapshot_t instance or NULL 
  */
 of_switch_snapshot_t* hal_driver_get_switch_snapshot_by_dpid(uint64_t dpid){
+
+	of_switch_t* sw = physical_switch_get_logical_switch_by_dpid(dpid);
+
+	if(sw)
+		__update_switch_ports_stats(sw);
+
 	return physical_switch_get_logical_switch_snapshot(dpid);
 }
 
@@ -220,6 +389,9 @@ hal_result_t hal_driver_destroy_switch_by_dpid(const uint64_t dpid){
 	//Drain existing packet ins
 	drain_packet_ins(sw);
 
+	//Drain pending packet outs (no more will be accepted)
+	drain_packet_outs(sw);
+
 	//Detach ports from switch. Do not feed more packets to the switch
 	if(physical_switch_detach_all_ports_from_logical_switch(sw)!=ROFL_SUCCESS)
 		return HAL_FAILURE;
@@ -259,6 +431,7 @@ switch_port_name_list_t* hal_driver_get_all_port_names(void){
  * @ingroup port_management
  */
 switch_port_snapshot_t* hal_driver_get_port_snapshot_by_name(const char *name){
+	__update_port_stats(physical_switch_get_port_by_name(name));
 	return physical_switch_get_port_snapshot(name); 
 }
 
@@ -281,6 +454,8 @@ switch_port_snapshot_t* hal_driver_get_port_snapshot_by_num(uint64_t dpid, unsig
 	if(!port_num || port_num >= LOGICAL_SWITCH_MAX_LOG_PORTS || !lsw->logical_ports[port_num].port)
 		return NULL;
 
+	__update_port_stats(lsw->logical_ports[port_num].port);
+
 	return physical_switch_get_port_snapshot(lsw->logical_ports[port_num].port->name); 
 }
 
@@ -709,6 +884,73 @@ monitoring_snapshot_state_t* hal_driver_get_monitoring_snapshot(uint64_t rev){
 	return NULL;
 }
 
+/**
+* @brief Retrieve the latency histograms of the packet processing stages
+* of the driver (optional, see hal_stats_ext.h)
+* @ingroup hal_driver_management
+*/
+hal_result_t hal_driver_get_stage_latency(hal_stage_latency_snapshot_t* snapshot){
+
+	if(!snapshot)
+		return HAL_FAILURE;
+
+	stage_latency::snapshot(snapshot);
+
+	return HAL_SUCCESS;
+}
+
+/**
+* @brief Configure the PKT_IN policer of a logical switch
+* (optional, see hal_pktin_ext.h)
+* @ingroup hal_driver_management
+*/
+hal_result_t hal_driver_reconfigure_pkt_in_policer(uint64_t dpid, const int max_rate){
+
+	of_switch_t* lsw;
+
+	lsw = physical_switch_get_logical_switch_by_dpid(dpid);
+	if(!lsw || !lsw->platform_state)
+		return HAL_FAILURE;
+
+	pktin_policer_reconfigure(&((switch_platform_state_t*)lsw->platform_state)->policer, max_rate);
+
+	return HAL_SUCCESS;
+}
+
+/**
+* @brief Configure the egress scheduling of a port queue
+* (optional, see hal_qos_ext.h)
+* @ingroup port_management
+*/
+hal_result_t hal_driver_configure_port_queue(const char* name, uint32_t queue_id, const hal_port_queue_conf_t* conf){
+
+	switch_port_t* port;
+	ioport* io_port;
+
+	port = physical_switch_get_port_by_name(name);
+
+	if(!port || !port->platform_port_state || !conf)
+		return HAL_FAILURE;
+
+	io_port = (ioport*)port->platform_port_state;
+
+	if(queue_id >= io_port->get_num_of_queues() || queue_id >= port->max_queues)
+		return HAL_FAILURE;
+
+	if(io_port->tx_sched->configure_queue(queue_id, conf) != ROFL_SUCCESS){
+		ROFL_ERR(DRIVER_NAME" Unable to configure queue %u of port %s; unsupported by the egress scheduler or invalid configuration\n", queue_id, name);
+		return HAL_FAILURE;
+	}
+
+	//Reported as the OpenFlow queue properties
+	port->queues[queue_id].min_rate = conf->min_rate;
+	port->queues[queue_id].max_rate = conf->max_rate;
+
+	ROFL_INFO(DRIVER_NAME" Queue %u of port %s configured; priority: %u, weight: %u, min rate: %u, max rate: %u (1/10 %%)\n", queue_id, name, conf->priority, conf->weight, conf->min_rate, conf->max_rate);
+
+	return HAL_SUCCESS;
+}
+
 /**
  * @brief get a list of available matching algorithms
  * @ingroup hal_driver_management
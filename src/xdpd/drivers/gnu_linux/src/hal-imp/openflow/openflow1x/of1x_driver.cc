@@ -1,3 +1,4 @@
+#include <string.h>
 #include <rofl/datapath/hal/openflow/openflow1x/of1x_driver.h>
 #include <rofl/common/utils/c_logger.h>
 #include <rofl/datapath/pipeline/physical_switch.h>
@@ -8,8 +9,10 @@
 #include "../../../io/datapacket_storage.h"
 #include "../../../io/datapacketx86.h"
 #include "../../../io/ports/ioport.h"
+#include "../../../io/pktout_dispatcher.h"
 #include "../../../processing/ls_internal_state.h"
-#include "../../../util/time_measurements.h"
+#include "../../../../../hal_pktout_ext.h"
+#include "../../../../../hal_flows_ext.h"
 
 //Make sure pipeline-imp are BEFORE _pp.h
 //so that functions can be inlined
@@ -253,7 +256,6 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 {
 	of_switch_t* lsw;
 	datapacket_t* pkt;
-	datapacketx86* pktx86;
 
 	//Recover port	
 	lsw = physical_switch_get_logical_switch_by_dpid(dpid);
@@ -279,33 +281,10 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 		return HAL_FAILURE; /*TODO add specific error */
 	}
 	
-	//Recover pkt buffer if is stored. Otherwise pick a free buffer
+	//Stored packets are recovered by the PKT_OUT dispatcher. Otherwise pick
+	//a free buffer and copy the packet now, since buffer belongs to the caller
 	if( buffer_id && buffer_id != OF1XP_NO_BUFFER){
-	
-		//Retrieve the packet
-		pkt = ((switch_platform_state_t*)lsw->platform_state)->storage->get_packet(buffer_id);
-
-		//Buffer has expired
-		if(!pkt){
-			return HAL_FAILURE; /* TODO: add specific error */
-		}
-		
-		//Mark as pkt out (ignore counters, slow path)	
-		TM_STAMP_PKT_OUT(pkt);
-
-		/*
-		 * remark: do not overwrite clas_state.calculate_checksums_in_sw, as these flags may
-		 * have been altered by previous tables in the pipeline. A simple reclassification
-		 * suppresses necessary recalculations for IPv4, UDP, TCP, etc.
-		 */
-
-		//Reclassify the packet
-		pktx86 = (datapacketx86*)pkt->platform_state;
-		//keep checksum_calculation flags
-		uint32_t calculate_checksums_in_sw = pktx86->clas_state.calculate_checksums_in_sw;
-		classify_packet(&pktx86->clas_state, pktx86->get_buffer(), pktx86->get_buffer_length(), in_port, 0);
-		pktx86->clas_state.calculate_checksums_in_sw |= calculate_checksums_in_sw;
-
+		pkt = NULL;
 	}else{
 		//Retrieve a free buffer	
 		pkt = bufferpool::get_buffer();
@@ -315,26 +294,44 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 			return HAL_FAILURE; /* TODO: add specific error */
 		}	
 
-		//Mark as pkt out (ignore counters, slow path)	
-		TM_STAMP_PKT_OUT(pkt);
-
-		//Initialize the packet and copy
-		((datapacketx86*)pkt->platform_state)->init(buffer, buffer_size, lsw, true);
+		//Initialize the packet and copy (jumbo frames may not find a buffer)
+		if(((datapacketx86*)pkt->platform_state)->init(buffer, buffer_size, lsw, true) != ROFL_SUCCESS){
+			bufferpool::release_buffer(pkt);
+			return HAL_FAILURE; /* TODO: add specific error */
+		}
 		pkt->sw = lsw;
-
-		//Reclassify the packet
-		pktx86 = (datapacketx86*)pkt->platform_state;
-		classify_packet(&pktx86->clas_state, pktx86->get_buffer(), pktx86->get_buffer_length(), in_port, 0);
 	}
 	
-	ROFL_DEBUG_VERBOSE(DRIVER_NAME" Getting packet out [%p]\n",pkt);	
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME" Dispatching packet out [%p] buffer_id: %u\n", pkt, buffer_id);	
 	
-	//Instruct pipeline to process actions. This may reinject the packet	
-	of1x_process_packet_out_pipeline(ROFL_PIPELINE_LOCKED_TID, (of1x_switch_t*)lsw, pkt, action_group);
+	//Enqueue it to be processed by the I/O threads (or process it right away)
+	if(dispatch_packet_out(lsw, buffer_id, in_port, pkt, action_group) != ROFL_SUCCESS)
+		return HAL_FAILURE; /* TODO: add specific error */
 	
 	return HAL_SUCCESS;
 }
 
+/**
+ * @name    hal_driver_of1x_flush_packet_outs
+ * @brief   Process all the PACKET_OUTs of the switch dispatched so far
+ * (optional, see hal_pktout_ext.h)
+ * @ingroup of1x_driver_async_event_processing
+ *
+ * @param dpid 		Datapath ID of the switch
+ */
+hal_result_t hal_driver_of1x_flush_packet_outs(uint64_t dpid){
+
+	of_switch_t* lsw;
+
+	lsw = physical_switch_get_logical_switch_by_dpid(dpid);
+	if(!lsw || !lsw->platform_state)
+		return HAL_FAILURE;
+
+	flush_packet_outs(lsw);
+
+	return HAL_SUCCESS;
+}
+
 /**
  * @name    driver_of1x_process_flow_mod
  * @brief   Instructs driver to process a FLOW_MOD event
@@ -523,6 +520,88 @@ of1x_stats_flow_msg_t* hal_driver_of1x_get_flow_stats(uint64_t dpid, uint8_t tab
 	return of1x_get_flow_stats(&lsw->pipeline, table_id, cookie, cookie_mask, out_port, out_group, matches);
 }
 
+/**
+ * @name    hal_driver_of1x_get_flow_stats_page
+ * @brief   Recovers the flow stats of a page of the entries matching the filter
+ * (optional, see hal_flows_ext.h)
+ * @ingroup of1x_driver_async_event_processing
+ *
+ * Entries are only copied into the message if they are in the page; the
+ * rest are just counted, so that listing a page of a large table costs
+ * the walk, not a copy of the table.
+ */
+of1x_stats_flow_msg_t* hal_driver_of1x_get_flow_stats_page(uint64_t dpid, uint8_t table_id, uint64_t cookie, uint64_t cookie_mask, uint32_t out_port, uint32_t out_group, of1x_match_group_t *const matches, hal_flow_stats_page_t* page){
+
+	unsigned int i, first, last;
+	of1x_switch_t* lsw;
+	of1x_flow_table_t* table;
+	of1x_flow_entry_t *entry, *check_entry;
+	of1x_stats_flow_msg_t* msg;
+	of1x_stats_single_flow_msg_t* flow_stats;
+
+	//Recover port	
+	lsw = (of1x_switch_t*)physical_switch_get_logical_switch_by_dpid(dpid);
+
+	if(!lsw || !page){
+		assert(0);
+		return NULL;
+	}
+
+	if(table_id >= lsw->pipeline.num_of_tables && table_id != OF1X_FLOW_TABLE_ALL)
+		return NULL; 
+
+	msg = __of1x_init_stats_flow_msg();
+	check_entry = of1x_init_flow_entry(false);
+
+	if(!msg || !check_entry){
+		if(msg)
+			of1x_destroy_stats_flow_msg(msg);
+		if(check_entry)
+			of1x_destroy_flow_entry(check_entry);
+		return NULL;
+	}
+
+	//Borrow the matches (non-strict check); given back before destroying the entry
+	if(matches)
+		check_entry->matches = *matches;
+
+	first = (table_id == OF1X_FLOW_TABLE_ALL)? 0 : table_id;
+	last = (table_id == OF1X_FLOW_TABLE_ALL)? lsw->pipeline.num_of_tables : table_id+1;
+	page->total = 0;
+
+	for(i=first; i<last; ++i){
+		table = &lsw->pipeline.tables[i];
+
+		platform_rwlock_rdlock(table->rwlock);
+
+		for(entry=table->entries; entry; entry=entry->next){
+
+			if(page->priority != HAL_FLOW_STATS_PAGE_ANY_PRIORITY && entry->priority != (uint32_t)page->priority)
+				continue;
+			if((entry->cookie & cookie_mask) != (cookie & cookie_mask))
+				continue;
+			if(!__of1x_flow_entry_check_contained(entry, check_entry, false, false, out_port, out_group, false))
+				continue;
+
+			//In the page
+			if(page->total >= page->offset && (!page->limit || page->total - page->offset < page->limit)){
+				flow_stats = __of1x_init_stats_single_flow_msg(entry);
+				if(flow_stats)
+					__of1x_push_single_flow_stats_to_msg(msg, flow_stats);
+			}
+
+			page->total++;
+		}
+
+		platform_rwlock_rdunlock(table->rwlock);
+	}
+
+	memset(&check_entry->matches, 0, sizeof(check_entry->matches));
+	of1x_destroy_flow_entry(check_entry);
+
+	return msg;
+}
+
  
 /**
  * @name    hal_driver_of1x_get_flow_aggregate_stats
@@ -1,48 +1,70 @@
 #include "bufferpool.h"
 
 #include "datapacketx86.h"
+#include "payload_pool.h"
 #include "../config.h"
+#include <new>
 #include <stdexcept>
 
 using namespace xdpd::gnu_linux;
 
 /* Static member initialization */
 bufferpool* bufferpool::instance = NULL;
-pthread_mutex_t bufferpool::mutex = PTHREAD_MUTEX_INITIALIZER; 
+pthread_mutex_t bufferpool::mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t bufferpool::cond = PTHREAD_COND_INITIALIZER;
- 
+
+/*
+* Memory area of the pool (hugepage backed, if possible). Layout:
+*
+* [datapacket_t x N][datapacketx86 x N][small payloads x N][jumbo payloads]
+*
+* so that the packet state, which is what the pipeline touches, is dense and
+* kept apart from the (mostly cold) payloads.
+*/
+static uint8_t* area = NULL;
+static size_t area_len = 0;
+
 //Constructor and destructor
 bufferpool::bufferpool(void){
 	long long unsigned int i;
+	long long unsigned int num_of_buffers = capacity-1;
+	size_t pkts_off, states_off, small_off, jumbo_off;
 	datapacket_t* dp;
 	datapacketx86* dpx86;
 	bpool_slot_t *pslot;
-	
+
+	//Layout
+	pkts_off = 0;
+	states_off = pkts_off + PAYLOAD_POOL_ALIGN(num_of_buffers*sizeof(datapacket_t));
+	small_off = states_off + PAYLOAD_POOL_ALIGN(num_of_buffers*sizeof(datapacketx86));
+	jumbo_off = small_off + num_of_buffers*payload_pool::SMALL_BUFFER_SIZE;
+	area_len = jumbo_off + (size_t)payload_pool::NUM_OF_JUMBO_BUFFERS*payload_pool::JUMBO_BUFFER_SIZE;
+
+	area = payload_pool::alloc_area(&area_len);
+	if(!area)
+		throw std::runtime_error("Unable to allocate bufferpool; out of memory.");
+
+	ROFL_DEBUG(DRIVER_NAME"[bufferpool] Allocated %llu bytes at %p (%llu buffers of %u bytes, %u jumbo buffers of %u bytes)\n", (long long unsigned)area_len, area, num_of_buffers, payload_pool::SMALL_BUFFER_SIZE, payload_pool::NUM_OF_JUMBO_BUFFERS, payload_pool::JUMBO_BUFFER_SIZE);
+
+	payload_pool::init(area+jumbo_off);
+
 	cq = new circular_queue<bpool_slot_t>(capacity);
 	memset(pool,0,sizeof(pool));
 
-	for(i=0;i<capacity-1;++i){
+	for(i=0;i<num_of_buffers;++i){
 
 		//Init datapacket
-		dp = (datapacket_t*)malloc(sizeof(datapacket_t));
-		
-		if(!dp){
-			throw std::runtime_error("Unable to allocate bufferpool; out of memory.");
-		}
+		dp = ((datapacket_t*)(area+pkts_off)) + i;
 
 		//Memset datapacket
 		memset(dp,0,sizeof(*dp));
-		
-		//Init datapacketx86
-		try {
-			dpx86 = new datapacketx86(dp);
-		}catch(std::bad_alloc ex){
-			throw std::runtime_error("Unable to allocate bufferpool; out of memory.");
-		}		
+
+		//Init datapacketx86 (in place) with its small class payload buffer
+		dpx86 = new(((datapacketx86*)(area+states_off)) + i) datapacketx86(dp, area + small_off + i*payload_pool::SMALL_BUFFER_SIZE, payload_pool::SMALL_BUFFER_SIZE);
 
 		//Assign the buffer_id
 		dp->id = i;
-				
+
 		//Link them
 		dp->platform_state = (platform_datapacket_state_t*)dpx86;
 
@@ -50,11 +72,9 @@ bufferpool::bufferpool(void){
 		pslot = &pool[i];
 		pslot->status = BUFFERPOOL_SLOT_AVAILABLE;
 		pslot->pkt = dp;
-			
+
 		//assign to queue
 		if ( cq->non_blocking_write(pslot) != ROFL_SUCCESS ){
-			delete dpx86;
-			free(dp);
 			throw std::runtime_error("Insertion in bufferpool failed at initialization.");
 		}
 	}
@@ -75,15 +95,19 @@ bufferpool::~bufferpool(){
 			continue;
 		}
 
+		//Memory belongs to the area
 		if (pslot->pkt)
-			delete (datapacketx86*)pslot->pkt->platform_state;
-		free(pslot->pkt);
+			((datapacketx86*)pslot->pkt->platform_state)->~datapacketx86();
 		i++;
 	}
-	
+
 	delete cq;
-	
+
 	//check that no buffer was lost
 	assert(i == capacity-1);
-	
+
+	payload_pool::destroy();
+	payload_pool::free_area(area, area_len);
+	area = NULL;
+	area_len = 0;
 }
@@ -7,12 +7,13 @@
 
 #include "../util/likely.h"
 
-//Profiling
-#include "../util/time_measurements.h"
-
 //Clear flag
 #define BUFFERPOOL_CLEAR_IS_REPLICA
 
+//Return NIC buffers (e.g. AF_XDP UMEM frames) to their owner and jumbo payload buffers to the payload_pool
+#include "datapacketx86.h"
+#define BUFFERPOOL_PKT_RELEASE_HOOK(PKT) ((datapacketx86*)(PKT)->platform_state)->release_buffers()
+
 //Include the meta bufferpool
 #include "bufferpool_meta.h"
 
@@ -90,6 +90,10 @@ public:
 
 	static inline void dump(void);
 
+	//Number of buffers and number of buffers in use (approximate; lock-less)
+	static inline unsigned int get_num_of_buffers(void){ return capacity-1; }
+	static inline unsigned int get_used(void);
+
 protected:
 
 	//Singleton instance
@@ -196,6 +200,14 @@ void bufferpool::release_buffer(datapacket_t* pkt){
 	bp->cq->non_blocking_write(tmp);
 }
 
+/*
+* Buffers in use
+*/
+unsigned int bufferpool::get_used(){
+	bufferpool* bp = get_instance();
+	return get_num_of_buffers() - bp->cq->size();
+}
+
 /*
 * Dump the state of the buffer
 */
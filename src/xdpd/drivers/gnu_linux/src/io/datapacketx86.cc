@@ -1,5 +1,8 @@
 #include "datapacketx86.h"
 
+#include <stdlib.h>
+#include <new>
+
 //Include here the classifier you want to use
 
 using namespace xdpd::gnu_linux;
@@ -12,18 +15,34 @@ using namespace xdpd::gnu_linux;
 typedef struct classify_state pktclassifier;
 
 //Constructor
-datapacketx86::datapacketx86(datapacket_t*const pkt) :
+datapacketx86::datapacketx86(datapacket_t*const pkt, uint8_t* buffer, size_t buffer_size) :
 	lsw(0),
 	pktin_table_id(0),
 	pktin_reason(0),
+	nic_buffer(NULL),
+	nic_buffer_release(NULL),
+	user_space_buffer(buffer),
+	user_space_buffer_size(buffer_size),
+	user_space_buffer_owned(false),
+	jumbo_buffer(NULL),
 	buffering_status(X86_DATAPACKET_BUFFER_IS_EMPTY){
-
+	lat.rx_ts = lat.ts = 0;
+
+	//Standalone datapacket; make sure any frame fits
+	if(!user_space_buffer){
+		user_space_buffer_size = payload_pool::JUMBO_BUFFER_SIZE;
+		user_space_buffer = (uint8_t*)malloc(user_space_buffer_size);
+		if(!user_space_buffer)
+			throw std::bad_alloc();
+		user_space_buffer_owned = true;
+	}
 }
 
 
 
 datapacketx86::~datapacketx86(){
-
+	if(user_space_buffer_owned)
+		free(user_space_buffer);
 }
 
 
@@ -34,8 +53,9 @@ rofl_result_t datapacketx86::transfer_to_user_space(){
 	switch (get_buffering_status()){
 
 		case X86_DATAPACKET_BUFFERED_IN_NIC: {
-			slot.iov_base 	= user_space_buffer;
-			slot.iov_len	= sizeof(user_space_buffer);
+			//Pick the size class; jumbo frames may not find a buffer
+			if(unlikely(set_user_space_slot(clas_state.len) != ROFL_SUCCESS))
+				return ROFL_FAILURE;
 #ifndef NDEBUG
 			// not really necessary, but makes debugging a little bit easier
 			platform_memset(slot.iov_base, 0x00, slot.iov_len);
@@ -74,7 +94,8 @@ rofl_result_t datapacketx86::push(unsigned int offset, unsigned int num_of_bytes
 
 	//If not already transfer to user space
 	if(X86_DATAPACKET_BUFFERED_IN_NIC == buffering_status){
-		transfer_to_user_space();
+		if(transfer_to_user_space() != ROFL_SUCCESS)
+			return ROFL_FAILURE;
 	}
 	
 	if (offset > clas_state.len){
@@ -121,7 +142,8 @@ rofl_result_t datapacketx86::pop(unsigned int offset, unsigned int num_of_bytes)
 
 	//If not already transfer to user space
 	if(X86_DATAPACKET_BUFFERED_IN_NIC == buffering_status){
-		transfer_to_user_space();
+		if(transfer_to_user_space() != ROFL_SUCCESS)
+			return ROFL_FAILURE;
 	}
 
 	// sanity check: start of area to be deleted must not be before start of buffer
@@ -157,7 +179,8 @@ rofl_result_t datapacketx86::push(uint8_t* push_point, unsigned int num_of_bytes
 
 	//If not already transfer to user space
 	if(X86_DATAPACKET_BUFFERED_IN_NIC == buffering_status){
-		transfer_to_user_space();
+		if(transfer_to_user_space() != ROFL_SUCCESS)
+			return ROFL_FAILURE;
 	}
 	
 	if (push_point < clas_state.base){
@@ -16,9 +16,10 @@
 #include <rofl/datapath/pipeline/platform/memory.h>
 
 #include "packet_classifiers/pktclassifier.h"
+#include "payload_pool.h"
 
-//Profiling
-#include "../util/time_measurements.h"
+//Stage latency
+#include "../util/stage_latency.h"
 
 /**
 * @file datapacketx86.h
@@ -52,8 +53,11 @@ class datapacketx86{
 
 public:
 	
-	//Constructor&destructor
-	datapacketx86(datapacket_t*const pkt);
+	/**
+	* Constructor&destructor. The payload buffer (size class) is provided by
+	* the bufferpool; if none, a jumbo sized buffer is allocated
+	*/
+	datapacketx86(datapacket_t*const pkt, uint8_t* buffer=NULL, size_t buffer_size=0);
 	~datapacketx86();
 
 	//Incomming packet information
@@ -67,8 +71,8 @@ public:
 	of_packet_in_reason_t pktin_reason;	
 	uint16_t pktin_send_len;
 
-	//Time profiling
-	TM_PKT_STATE;
+	//Stage latency (sampled packets)
+	stage_latency_pkt_t lat;
 
 public: // methods
 
@@ -88,6 +92,42 @@ public: // methods
 	//Transfer buffer to user-space
 	rofl_result_t transfer_to_user_space(void);
 
+	/*
+	* NIC buffer (e.g. AF_XDP UMEM frame) holding the packet, if any. It is
+	* handed back to its owner (release function) when the packet is returned
+	* to the bufferpool, or whenever the owner takes it back (detach).
+	*/
+	typedef void (*nic_buffer_release_t)(void* nic_buffer);
+
+	inline void set_nic_buffer(void* buffer, nic_buffer_release_t release){
+		nic_buffer = buffer;
+		nic_buffer_release = release;
+	}
+	inline void* get_nic_buffer(){ return nic_buffer; }
+	inline nic_buffer_release_t get_nic_buffer_release(){ return nic_buffer_release; }
+
+	inline void* detach_nic_buffer(){
+		void* buffer = nic_buffer;
+		nic_buffer = NULL;
+		return buffer;
+	}
+
+	inline void release_nic_buffer(){
+		if(nic_buffer){
+			nic_buffer_release(nic_buffer);
+			nic_buffer = NULL;
+		}
+	}
+
+	//Release the NIC and the borrowed (jumbo) buffers, if any
+	inline void release_buffers(){
+		release_nic_buffer();
+		if(unlikely(jumbo_buffer != NULL)){
+			payload_pool::release_jumbo_buffer(jumbo_buffer);
+			jumbo_buffer = NULL;
+		}
+	}
+
 	//Header packet classification
 	struct classifier_state clas_state;
 
@@ -108,9 +148,9 @@ public: // methods
 	
 private:
 	//HOST buffer size
-	static const unsigned int PRE_GUARD_BYTES  = 256;
-	static const unsigned int FRAME_SIZE_BYTES = 9000;
-	static const unsigned int POST_GUARD_BYTES = 64;
+	static const unsigned int PRE_GUARD_BYTES  = payload_pool::PRE_GUARD_BYTES;
+	static const unsigned int FRAME_SIZE_BYTES = payload_pool::JUMBO_FRAME_SIZE;
+	static const unsigned int POST_GUARD_BYTES = payload_pool::POST_GUARD_BYTES;
 
 	/*
 	 * real memory area
@@ -119,10 +159,17 @@ private:
 	 */
 	struct iovec slot;
 
-	//FIXME: NIC buffer info MISSING
+	//NIC buffer info
+	void* nic_buffer;
+	nic_buffer_release_t nic_buffer_release;
 
-	//User space buffer	
-	uint8_t user_space_buffer[PRE_GUARD_BYTES+FRAME_SIZE_BYTES+POST_GUARD_BYTES];
+	//User space buffer (small size class, unless allocated by the constructor)
+	uint8_t* user_space_buffer;
+	size_t user_space_buffer_size;
+	bool user_space_buffer_owned;
+
+	//Jumbo buffer borrowed from the payload_pool, for frames not fitting in user_space_buffer
+	uint8_t* jumbo_buffer;
 
 	//Status of this buffer
 	x86buffering_status_t buffering_status;
@@ -131,7 +178,13 @@ private:
 	 * utility function to set the correct buffer location
 	 * @param location
 	 */
-	void init_internal_buffer_location_defaults(x86buffering_status_t location, uint8_t* buf, size_t buflen);
+	rofl_result_t init_internal_buffer_location_defaults(x86buffering_status_t location, uint8_t* buf, size_t buflen);
+
+	/**
+	* Set the user space slot to a buffer of the right size class for a frame
+	* of buflen bytes
+	*/
+	inline rofl_result_t set_user_space_slot(size_t buflen);
 	//Add more stuff here...
 
 public:
@@ -157,7 +210,30 @@ public:
 * Inline functions
 */ 
 
-inline void datapacketx86::init_internal_buffer_location_defaults(x86buffering_status_t location, uint8_t* buf, size_t buflen){
+inline rofl_result_t datapacketx86::set_user_space_slot(size_t buflen){
+
+	if(likely(buflen <= user_space_buffer_size-PRE_GUARD_BYTES-POST_GUARD_BYTES)){
+		if(unlikely(jumbo_buffer != NULL)){
+			payload_pool::release_jumbo_buffer(jumbo_buffer);
+			jumbo_buffer = NULL;
+		}
+		slot.iov_base = user_space_buffer;
+		slot.iov_len = user_space_buffer_size;
+		return ROFL_SUCCESS;
+	}
+
+	if(!jumbo_buffer){
+		jumbo_buffer = payload_pool::get_jumbo_buffer();
+		if(unlikely(jumbo_buffer == NULL))
+			return ROFL_FAILURE;
+	}
+
+	slot.iov_base = jumbo_buffer;
+	slot.iov_len = payload_pool::JUMBO_BUFFER_SIZE;
+	return ROFL_SUCCESS;
+}
+
+inline rofl_result_t datapacketx86::init_internal_buffer_location_defaults(x86buffering_status_t location, uint8_t* buf, size_t buflen){
 
 	switch (location) {
 
@@ -171,13 +247,13 @@ inline void datapacketx86::init_internal_buffer_location_defaults(x86buffering_s
 			break;
 
 		case X86_DATAPACKET_BUFFERED_IN_USER_SPACE:
-			slot.iov_base = user_space_buffer;
-			slot.iov_len = sizeof(user_space_buffer);
+			if(unlikely(set_user_space_slot(buflen) != ROFL_SUCCESS))
+				return ROFL_FAILURE;
 #ifndef NDEBUG
 			// not really necessary, but makes debugging a little bit easier
 			platform_memset(slot.iov_base, 0x00, slot.iov_len);
 #endif
-			clas_state.base = user_space_buffer + PRE_GUARD_BYTES;
+			clas_state.base = (uint8_t*)slot.iov_base + PRE_GUARD_BYTES;
 			clas_state.len = buflen; // set to requested length
 			buffering_status = X86_DATAPACKET_BUFFERED_IN_USER_SPACE;
 			break;
@@ -187,6 +263,8 @@ inline void datapacketx86::init_internal_buffer_location_defaults(x86buffering_s
 			// todo ?
 			break;
 	}
+
+	return ROFL_SUCCESS;
 }
 
 /*
@@ -206,18 +284,20 @@ rofl_result_t datapacketx86::init(
 	// do this sanity check here, as someone may request later a transfer to user space,
 	// so make sure we have enough space for doing this later
 	if (buflen > FRAME_SIZE_BYTES){
-		return ROFL_FAILURE;
+		goto INIT_ERROR;
 	}
 
 	if( copy_packet_to_internal_buffer ) {
 
-		init_internal_buffer_location_defaults(X86_DATAPACKET_BUFFERED_IN_USER_SPACE, NULL, buflen);
+		//No jumbo buffer available
+		if(unlikely(init_internal_buffer_location_defaults(X86_DATAPACKET_BUFFERED_IN_USER_SPACE, NULL, buflen) != ROFL_SUCCESS))
+			goto INIT_ERROR;
 
 		if(buf)
 			platform_memcpy(clas_state.base, buf, buflen);
 	}else{
 		if(!buf)
-			return ROFL_FAILURE;
+			goto INIT_ERROR;
 
 		init_internal_buffer_location_defaults(X86_DATAPACKET_BUFFERED_IN_NIC, buf, buflen);
 	}
@@ -225,14 +305,22 @@ rofl_result_t datapacketx86::init(
 	//Fill in
 	this->lsw = sw;
 	this->output_queue = 0;
-	//Timestamp S1	
-	TM_STAMP_STAGE_DPX86(this, TM_S1);
-	
+
+	//Not measured unless the RX port says so (STAGE_LATENCY_RX)
+	lat.rx_ts = lat.ts = 0;
+
 	//Classify the packet
 	if(classify)
 		classify_packet(&clas_state, get_buffer(), get_buffer_length(), in_port, 0);
 
 	return ROFL_SUCCESS;
+
+INIT_ERROR:
+	//Do not leave the previous frame (a buffer possibly owned by someone else) around
+	clas_state.base = NULL;
+	clas_state.len = 0;
+	buffering_status = X86_DATAPACKET_BUFFER_IS_EMPTY;
+	return ROFL_FAILURE;
 }
 
 
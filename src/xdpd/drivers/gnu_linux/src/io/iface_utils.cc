@@ -8,6 +8,7 @@
 //#include <net/if.h>
 #include <stdio.h>
 #include <map>
+#include <string>
 #include <unistd.h>
 
 //Prototypes
@@ -23,9 +24,17 @@
 #include "ports/ioport.h"
 #include "ports/mmap/ioport_mmap.h"
 #include "ports/vlink/ioport_vlink.h"
+#include "ports/xdp/ioport_xdp.h"
+#include "ports/pcap/ioport_pcap.h"
 
 using namespace xdpd::gnu_linux;
 
+//Interfaces to be served via AF_XDP (name -> native mode)
+static std::map<std::string, bool> xdp_ports;
+
+//pcap ports (name -> configuration); not backed by a kernel interface
+static std::map<std::string, pcap_port_conf_t> pcap_ports;
+
 /*
 *
 * Port management
@@ -34,19 +43,36 @@ using namespace xdpd::gnu_linux;
 *
 */
 
+/*
+* Apply the admin (IFF_UP) and link (IFF_RUNNING) state of the kernel interface to the port
+*/
+static void set_port_status(switch_port_t* port, bool up, bool link){
+
+	switch_port_snapshot_t *port_snapshot;
+	ioport* io_port = ((ioport*)port->platform_port_state);
+
+	ROFL_DEBUG(DRIVER_NAME"[ports] Interface %s is %s, and link is %s\n", port->name, (up)? "up" : "down", (link)? "detected" : "not detected");
+
+	//Update link state
+	io_port->set_link_state(link);
+
+	if(up){
+		iomanager::bring_port_up(io_port);
+	}else{
+		iomanager::bring_port_down(io_port);
+	}
+
+	//Notify the change of state to the CMM
+	port_snapshot = physical_switch_get_port_snapshot(port->name);
+	hal_cmm_notify_port_status_changed(port_snapshot);
+}
+
 rofl_result_t update_port_status(char * name){
 
 	struct ifreq ifr;
 	int sd, rc;
 
 	switch_port_t *port;
-	switch_port_snapshot_t *port_snapshot;
-
-	//Update all ports
-	if(update_physical_ports() != ROFL_SUCCESS){
-		ROFL_ERR(DRIVER_NAME"[ports] Update physical ports failed \n");
-		assert(0);
-	}
 
 	port = physical_switch_get_port_by_name(name);
 
@@ -81,21 +107,9 @@ rofl_result_t update_port_status(char * name){
 
 	//Release mutex
 	pthread_rwlock_unlock(&io_port->rwlock);
+	close(sd);
 
-	ROFL_DEBUG(DRIVER_NAME"[ports] Interface %s is %s, and link is %s\n", name,( ((IFF_UP & ifr.ifr_flags) > 0) ? "up" : "down"), ( ((IFF_RUNNING & ifr.ifr_flags) > 0) ? "detected" : "not detected"));
-
-	//Update link state
-	io_port->set_link_state( ((IFF_RUNNING & ifr.ifr_flags) > 0) );
-
-	if(IFF_UP & ifr.ifr_flags){
-		iomanager::bring_port_up(io_port);
-	}else{
-		iomanager::bring_port_down(io_port);
-	}
-
-	//Notify the change of state to the CMM
-	port_snapshot = physical_switch_get_port_snapshot(port->name);
-	hal_cmm_notify_port_status_changed(port_snapshot);
+	set_port_status(port, (IFF_UP & ifr.ifr_flags) > 0, (IFF_RUNNING & ifr.ifr_flags) > 0);
 
 	return ROFL_SUCCESS;
 }
@@ -257,23 +271,22 @@ static void fill_port_speeds_capabilities(switch_port_t* port, struct ethtool_cm
 	switch_port_set_current_max_speed(port, current_speed); //TODO: this is not right
 }
 
-static switch_port_t* fill_port(int sock, struct ifaddrs* ifa){
+static switch_port_t* fill_port(int sock, const char* name, const uint8_t* hwaddr){
 
 	int j;
 	struct ethtool_cmd edata;
 	struct ifreq ifr;
-	struct sockaddr_ll *socll;
 	switch_port_t* port;
 
 	//fetch interface info with ethtool
 	memset(&ifr, 0, sizeof(struct ifreq));
-	strcpy(ifr.ifr_name, ifa->ifa_name);
+	strncpy(ifr.ifr_name, name, IFNAMSIZ-1);
 	memset(&edata,0,sizeof(edata));
 	edata.cmd = ETHTOOL_GSET;
 	ifr.ifr_data = (char *) &edata;
 
 	//Discard loopback
-	if(strncmp("lo",ifa->ifa_name,2) == 0)
+	if(strncmp("lo",name,2) == 0)
 		return NULL;
 
 	if (ioctl(sock, SIOCETHTOOL, &ifr)==-1){
@@ -281,18 +294,17 @@ static switch_port_t* fill_port(int sock, struct ifaddrs* ifa){
 	}
 
 	//Init the port
-	port = switch_port_init(ifa->ifa_name, true/*will be overriden afterwards*/, PORT_TYPE_PHYSICAL, PORT_STATE_NONE);
+	port = switch_port_init((char*)name, true/*will be overriden afterwards*/, PORT_TYPE_PHYSICAL, PORT_STATE_NONE);
 	if(!port)
 		return NULL;
 
-	//get the MAC addr.
-	socll = (struct sockaddr_ll *)ifa->ifa_addr;
+	//MAC addr.
 	ROFL_INFO(DRIVER_NAME"[ports] Discovered interface %s mac_addr %02X:%02X:%02X:%02X:%02X:%02X \n",
-		ifa->ifa_name,socll->sll_addr[0],socll->sll_addr[1],socll->sll_addr[2],socll->sll_addr[3],
-		socll->sll_addr[4],socll->sll_addr[5]);
+		name,hwaddr[0],hwaddr[1],hwaddr[2],hwaddr[3],
+		hwaddr[4],hwaddr[5]);
 
 	for(j=0;j<6;j++)
-		port->hwaddr[j] = socll->sll_addr[j];
+		port->hwaddr[j] = hwaddr[j];
 
 	//Fill port admin/link state
 	if( fill_port_admin_and_link_state(port) == ROFL_FAILURE){
@@ -306,10 +318,16 @@ static switch_port_t* fill_port(int sock, struct ifaddrs* ifa){
 	//Fill speeds and capabilities
 	fill_port_speeds_capabilities(port, &edata);
 
-	//Initialize MMAP-based port
-	//Change this line to use another ioport...
-	//ioport* io_port = new ioport_mmapv2(port);
-	ioport* io_port = new ioport_mmap(port);
+	//Initialize the port; MMAP-based unless configured to use AF_XDP
+	ioport* io_port;
+#ifdef HAVE_AF_XDP
+	std::map<std::string, bool>::iterator it = xdp_ports.find(std::string(name));
+	if(it != xdp_ports.end()){
+		ROFL_INFO(DRIVER_NAME"[ports] Interface %s will be served via AF_XDP (%s mode)\n", name, (it->second)? "native":"generic");
+		io_port = new ioport_xdp(port, it->second);
+	}else
+#endif
+		io_port = new ioport_mmap(port);
 
 	port->platform_port_state = (platform_port_state_t*)io_port;
 
@@ -319,6 +337,108 @@ static switch_port_t* fill_port(int sock, struct ifaddrs* ifa){
 	return port;
 }
 
+rofl_result_t set_xdp_port(const char* name, bool native){
+#ifdef HAVE_AF_XDP
+	xdp_ports[std::string(name)] = native;
+	return ROFL_SUCCESS;
+#else
+	ROFL_ERR(DRIVER_NAME"[ports] Unable to serve interface %s via AF_XDP; this driver has been compiled without AF_XDP support\n", name);
+	return ROFL_FAILURE;
+#endif
+}
+
+rofl_result_t set_pcap_port(const char* name, const char* rx_file, const char* tx_file, uint64_t rate, unsigned int loops){
+
+	pcap_port_conf_t conf;
+
+	if(strlen(name) >= PORT_QUEUE_MAX_LEN_NAME){
+		ROFL_ERR(DRIVER_NAME"[ports] Invalid pcap port name %s\n", name);
+		return ROFL_FAILURE;
+	}
+
+	conf.rx_file = (rx_file)? rx_file : "";
+	conf.tx_file = (tx_file)? tx_file : "";
+	conf.rate = rate;
+	conf.loops = loops;
+
+	pcap_ports[std::string(name)] = conf;
+
+	return ROFL_SUCCESS;
+}
+
+/*
+* Random, locally administered, MAC address
+*/
+static void fill_random_hwaddr(switch_port_t* port){
+
+	unsigned int i;
+	uint16_t randnum;
+
+	for(i=0; i<6; i+=2){
+		randnum = (uint16_t)rand();
+		port->hwaddr[i] = ((uint8_t*)&randnum)[0];
+		port->hwaddr[i+1] = ((uint8_t*)&randnum)[1];
+	}
+
+	port->hwaddr[0] &= ~(1 << 0);
+	port->hwaddr[0] |=  (1 << 1);
+}
+
+/*
+* Create the pcap ports and add them to the list of physical ports
+*/
+static rofl_result_t create_pcap_ports(void){
+
+	switch_port_t* port;
+	ioport_pcap* io_port;
+	uint64_t port_capabilities = PORT_FEATURE_10GB_FD;
+
+	for(std::map<std::string, pcap_port_conf_t>::iterator it = pcap_ports.begin(); it != pcap_ports.end(); ++it){
+
+		if(physical_switch_get_port_by_name(it->first.c_str())){
+			ROFL_ERR(DRIVER_NAME"[ports] Unable to create pcap port %s; a port with the same name already exists\n", it->first.c_str());
+			return ROFL_FAILURE;
+		}
+
+		port = switch_port_init((char*)it->first.c_str(), false, PORT_TYPE_PHYSICAL, PORT_STATE_NONE);
+		if(!port){
+			ROFL_ERR(DRIVER_NAME"[ports] Not enough memory\n");
+			return ROFL_FAILURE;
+		}
+
+		io_port = new ioport_pcap(port, it->second);
+
+		if(io_port->init() != ROFL_SUCCESS){
+			ROFL_ERR(DRIVER_NAME"[ports] Unable to create pcap port %s\n", it->first.c_str());
+			delete io_port;
+			switch_port_destroy(port);
+			return ROFL_FAILURE;
+		}
+
+		switch_port_add_capabilities(&port->curr, (port_features_t)port_capabilities);
+		switch_port_add_capabilities(&port->advertised, (port_features_t)port_capabilities);
+		switch_port_add_capabilities(&port->supported, (port_features_t)port_capabilities);
+		switch_port_add_capabilities(&port->peer, (port_features_t)port_capabilities);
+		fill_random_hwaddr(port);
+
+		port->platform_port_state = (platform_port_state_t*)io_port;
+		fill_port_queues(port, io_port);
+
+		if( physical_switch_add_port(port) != ROFL_SUCCESS ){
+			ROFL_ERR(DRIVER_NAME"[ports] Unable to add pcap port %s to the physical switch; out of slots?\n", it->first.c_str());
+			delete io_port;
+			switch_port_destroy(port);
+			return ROFL_FAILURE;
+		}
+
+		ROFL_INFO(DRIVER_NAME"[ports] Created pcap port %s (RX: %s, TX: %s)\n", it->first.c_str(),
+				(it->second.rx_file.empty())? "none" : it->second.rx_file.c_str(),
+				(it->second.tx_file.empty())? "/dev/null" : it->second.tx_file.c_str());
+	}
+
+	return ROFL_SUCCESS;
+}
+
 /*
  * Looks in the system physical ports and fills up the switch_port_t sructure with them
  *
@@ -349,8 +469,14 @@ rofl_result_t discover_physical_ports(){
 		if(ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_PACKET)
 			continue;
 
+		//Shadowed by a pcap port
+		if(pcap_ports.find(std::string(ifa->ifa_name)) != pcap_ports.end()){
+			ROFL_WARN(DRIVER_NAME"[ports] WARNING: interface %s is shadowed by a pcap port with the same name\n", ifa->ifa_name);
+			continue;
+		}
+
 		//Fill port
-		port = fill_port(sock, ifa);
+		port = fill_port(sock, ifa->ifa_name, ((struct sockaddr_ll *)ifa->ifa_addr)->sll_addr);
 
 		if(!port)
 			continue;
@@ -365,8 +491,7 @@ rofl_result_t discover_physical_ports(){
 
 	}
 
-	//This MUST be here and NOT in the previous loop, or the ports will be discovered (duplicated)
-	//via update_physical_ports. FIXME: this needs to be implemented properly
+	//Admin and link state, once all the ports have been added
 	array = physical_switch_get_physical_ports(&max_ports);
 	for(i=0; i<max_ports ; i++){
 		if(array[i] != NULL){
@@ -382,7 +507,8 @@ rofl_result_t discover_physical_ports(){
 
 	freeifaddrs(ifaddr);
 
-	return ROFL_SUCCESS;
+	//Ports not backed by a kernel interface
+	return create_pcap_ports();
 }
 /*
  * Creates a virtual port pair between two switches
@@ -582,13 +708,69 @@ rofl_result_t destroy_ports(){
 */
 
 
+/*
+* Remove a port whose kernel interface no longer exists: notify the CMM, detach and destroy
+*/
+static void remove_port(switch_port_t* port){
+
+	switch_port_snapshot_t *port_snapshot;
+
+	ROFL_INFO(DRIVER_NAME"[ports] Interface %s has been removed from the system. The interface will now be detached from any logical switch it is attached to (if any), and removed from the list of physical interfaces.\n", port->name);
+
+	//Notify CMM
+	port_snapshot = physical_switch_get_port_snapshot(port->name);
+	hal_cmm_notify_port_delete(port_snapshot);
+
+	//Detach
+	if(port->attached_sw && (hal_driver_detach_port_from_switch(port->attached_sw->dpid, port->name) != HAL_SUCCESS) ){
+		ROFL_WARN(DRIVER_NAME"[ports] WARNING: unable to detach port %s from switch. This can lead to an unknown behaviour\n", port->name);
+		assert(0);
+	}
+	//Destroy and remove from the list of physical ports
+	destroy_port(port);
+}
+
+/*
+* Create the port of a new kernel interface, add it to the list of physical ports and notify the CMM
+*/
+static rofl_result_t add_port(int sock, const char* name, const uint8_t* hwaddr){
+
+	switch_port_t *port;
+	switch_port_snapshot_t *port_snapshot;
+
+	//Fill port
+	port = fill_port(sock, name, hwaddr);
+	if(!port)
+		return ROFL_FAILURE;
+
+	//Adding the
+	if( physical_switch_add_port(port) != ROFL_SUCCESS ){
+		ROFL_ERR(DRIVER_NAME"[ports] Unable to add port %s to physical switch. Not enough slots?\n", name);
+		delete (ioport*)port->platform_port_state;
+		switch_port_destroy(port);
+		return ROFL_FAILURE;
+	}
+
+	//Notify CMM
+	port_snapshot = physical_switch_get_port_snapshot(port->name);
+	hal_cmm_notify_port_add(port_snapshot);
+
+	return ROFL_SUCCESS;
+}
+
+/*
+* Ports backed by a kernel interface (not vlinks nor pcap ports)
+*/
+static inline bool is_kernel_port(switch_port_t* port){
+	return port->type == PORT_TYPE_PHYSICAL && pcap_ports.find(std::string(port->name)) == pcap_ports.end();
+}
+
 /*
  * Discover new platform ports (usually triggered by bg task manager)
  */
 rofl_result_t update_physical_ports(){
 
 	switch_port_t *port, **ports;
-	switch_port_snapshot_t *port_snapshot;
 	int sock;
 	struct ifaddrs *ifaddr, *ifa;
 	unsigned int i, max_ports;
@@ -604,6 +786,7 @@ rofl_result_t update_physical_ports(){
 	}
 
 	if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0){
+		freeifaddrs(ifaddr);
 		return ROFL_FAILURE;
     	}
 
@@ -611,13 +794,15 @@ rofl_result_t update_physical_ports(){
 	ports = physical_switch_get_physical_ports(&max_ports);
 
 	if(!ports){
+		freeifaddrs(ifaddr);
 		close(sock);
 		return ROFL_FAILURE;
 	}
 
 	//Generate some helpful vectors
 	for(i=0;i<max_ports;i++){
-		if(ports[i])
+		//pcap ports are not kernel interfaces
+		if(ports[i] && is_kernel_port(ports[i]))
 			pipeline_ifaces[std::string(ports[i]->name)] = ports[i];
 
 	}
@@ -625,6 +810,10 @@ rofl_result_t update_physical_ports(){
 		if(ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_PACKET)
 			continue;
 
+		//Shadowed by a pcap port
+		if(pcap_ports.find(std::string(ifa->ifa_name)) != pcap_ports.end())
+			continue;
+
 		system_ifaces[std::string(ifa->ifa_name)] = ifa;
 	}
 
@@ -633,47 +822,15 @@ rofl_result_t update_physical_ports(){
 	for (std::map<std::string, switch_port_t*>::iterator it = pipeline_ifaces.begin(); it != pipeline_ifaces.end(); ++it){
 		if (system_ifaces.find(it->first) == system_ifaces.end() ) {
 			//Interface has been deleted. Detach and remove
-			port = it->second;
-			if(!port)
-				continue;
-
-			ROFL_INFO(DRIVER_NAME"[ports] Interface %s has been removed from the system. The interface will now be detached from any logical switch it is attached to (if any), and removed from the list of physical interfaces.\n", it->first.c_str());
-
-			//Notify CMM
-			port_snapshot = physical_switch_get_port_snapshot(port->name);
-			hal_cmm_notify_port_delete(port_snapshot);
-
-			//Detach
-			if(port->attached_sw && (hal_driver_detach_port_from_switch(port->attached_sw->dpid, port->name) != HAL_SUCCESS) ){
-				ROFL_WARN(DRIVER_NAME"[ports] WARNING: unable to detach port %s from switch. This can lead to an unknown behaviour\n", it->first.c_str());
-				assert(0);
-			}
-			//Destroy and remove from the list of physical ports
-			destroy_port(port);
+			remove_port(it->second);
 		}
 		system_ifaces.erase(it->first);
 	}
 
 	//Add remaining "new" interfaces (remaining interfaces in system_ifaces map
 	for (std::map<std::string, struct ifaddrs*>::iterator it = system_ifaces.begin(); it != system_ifaces.end(); ++it){
-		//Fill port
-		port = fill_port(sock,  it->second);
-		if(!port){
-			//ROFL_ERR(DRIVER_NAME"[ports] Unable to initialize newly discovered interface %s\n", it->first.c_str());
-			continue;
-		}
-
-		//Adding the
-		if( physical_switch_add_port(port) != ROFL_SUCCESS ){
-			ROFL_ERR(DRIVER_NAME"[ports] Unable to add port %s to physical switch. Not enough slots?\n", it->first.c_str());
-			freeifaddrs(ifaddr);
-			continue;
-		}
-
-		//Notify CMM
-		port_snapshot = physical_switch_get_port_snapshot(port->name);
-		hal_cmm_notify_port_add(port_snapshot);
-
+		ifa = it->second;
+		add_port(sock, ifa->ifa_name, ((struct sockaddr_ll *)ifa->ifa_addr)->sll_addr);
 	}
 
 	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[ports] Update of interfaces done.\n");
@@ -683,3 +840,72 @@ rofl_result_t update_physical_ports(){
 
 	return ROFL_SUCCESS;
 }
+
+rofl_result_t resync_physical_ports(){
+
+	switch_port_t **ports;
+	unsigned int i, max_ports;
+
+	if(update_physical_ports() != ROFL_SUCCESS)
+		return ROFL_FAILURE;
+
+	//Admin and link state
+	ports = physical_switch_get_physical_ports(&max_ports);
+	for(i=0;i<max_ports;i++){
+		if(ports[i] && is_kernel_port(ports[i]))
+			update_port_status(ports[i]->name);
+	}
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t update_physical_port(const char* name, const uint8_t* hwaddr, unsigned int flags){
+
+	int sock;
+	bool up, link;
+	switch_port_t* port;
+	static const uint8_t no_hwaddr[6] = {0};
+
+	//Shadowed by a pcap port
+	if(pcap_ports.find(std::string(name)) != pcap_ports.end())
+		return ROFL_SUCCESS;
+
+	port = physical_switch_get_port_by_name(name);
+
+	if(!port){
+		//New interface
+		if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+			return ROFL_FAILURE;
+
+		//Discarded interfaces (e.g. loopback) are not an error
+		add_port(sock, name, (hwaddr)? hwaddr : no_hwaddr);
+		close(sock);
+		return ROFL_SUCCESS;
+	}
+
+	if(!is_kernel_port(port))
+		return ROFL_SUCCESS;
+
+	//Only act (and notify the CMM) if the admin or link state changed
+	up = (IFF_UP & flags) > 0;
+	link = (IFF_RUNNING & flags) > 0;
+
+	if(port->up == up && ((port->state & PORT_STATE_LINK_DOWN) == 0) == link)
+		return ROFL_SUCCESS;
+
+	set_port_status(port, up, link);
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t remove_physical_port(const char* name){
+
+	switch_port_t* port = physical_switch_get_port_by_name(name);
+
+	if(!port || !is_kernel_port(port))
+		return ROFL_SUCCESS;
+
+	remove_port(port);
+
+	return ROFL_SUCCESS;
+}
@@ -26,6 +26,20 @@ ROFL_BEGIN_DECLS
  */
 switch_port_t* get_port_by_name(const char *name);
 
+/**
+ * Serve an interface via AF_XDP (ioport_xdp) instead of PACKET_MMAP, in native
+ * (driver) or generic (SKB) XDP mode. Must be called before discover_physical_ports()
+ */
+rofl_result_t set_xdp_port(const char* name, bool native);
+
+/**
+ * Create a pcap port (ioport_pcap) replaying rx_file (if not NULL) at rate pps
+ * (0: as fast as possible) loops times (0: forever), and capturing the packets
+ * sent to tx_file (NULL or /dev/null: only counted). Must be called before
+ * discover_physical_ports()
+ */
+rofl_result_t set_pcap_port(const char* name, const char* rx_file, const char* tx_file, uint64_t rate, unsigned int loops);
+
 /**
  * Discovers platform physical ports and fills up the switch_port_t sructures
  */
@@ -51,6 +65,24 @@ rofl_result_t update_port_status(char * name);
  */
 rofl_result_t update_physical_ports(void);
 
+/**
+ * Update physical port list and the admin/link state of all the ports (full rescan).
+ * Used to resynchronize after lost netlink notifications
+ */
+rofl_result_t resync_physical_ports(void);
+
+/**
+ * Add the port of a (new) kernel interface, or update its admin/link state
+ * (IFF_UP/IFF_RUNNING flags), from a netlink (RTM_NEWLINK) notification.
+ * hwaddr may be NULL. The CMM is only notified if the state changed
+ */
+rofl_result_t update_physical_port(const char* name, const uint8_t* hwaddr, unsigned int flags);
+
+/**
+ * Detach and remove the port of a deleted kernel interface (RTM_DELLINK)
+ */
+rofl_result_t remove_physical_port(const char* name);
+
 /**
  * Destroys ports previously created
  */
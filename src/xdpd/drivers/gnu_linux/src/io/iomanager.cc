@@ -527,6 +527,8 @@ rofl_result_t iomanager::add_port_to_group(unsigned int grp_id, ioport* port){
 
 	//Add to port
 	pg->ports->push_back(port);	
+	if(pg->type == PG_RX)
+		port->rx_group_id = pg->id;
 
 	pthread_mutex_unlock(&mutex);
 
@@ -564,6 +566,10 @@ rofl_result_t iomanager::remove_port_from_group(unsigned int grp_id, ioport* por
 		return ROFL_FAILURE;
 	}
 	
+	//No more run-to-completion towards this port
+	if(pg->type == PG_RX)
+		port->rx_group_id = -1;
+
 	//Bring it down
 	bring_port_down(port, true);
 	
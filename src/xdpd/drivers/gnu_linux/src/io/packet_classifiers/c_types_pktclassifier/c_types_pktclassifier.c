@@ -12,8 +12,9 @@ void pop_pbb(datapacket_t* pkt, classifier_state_t* clas_state){
 	if(unlikely(new == PT_INVALID))
 		return;
 
-	//Take header out from packet
-	pkt_pop(pkt, NULL,0, sizeof(cpc_eth_hdr_t)+sizeof(cpc_pbb_isid_hdr_t));
+	//Take header out from packet; leave it untouched if it can't be done
+	if(unlikely(pkt_pop(pkt, NULL,0, sizeof(cpc_eth_hdr_t)+sizeof(cpc_pbb_isid_hdr_t)) == ROFL_FAILURE))
+		return;
 
 	//Set new type and base(move right)
 	clas_state->type = new; // NEU
@@ -31,8 +32,9 @@ void pop_vlan(datapacket_t* pkt, classifier_state_t* clas_state){
 	cpc_vlan_hdr_t* vlan = get_vlan_hdr(clas_state,0);
 	uint16_t ether_type = *get_vlan_type(vlan);
 	
-	//Take header out from packet
-	pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_vlan_hdr_t));
+	//Take header out from packet; leave it untouched if it can't be done
+	if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_vlan_hdr_t)) == ROFL_FAILURE))
+		return;
 
 	//Set new type and base(move right)
 	clas_state->type = new;
@@ -46,7 +48,9 @@ void pop_mpls(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether_
 	if(unlikely(new == PT_INVALID))
 		return;
 
-	pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_mpls_hdr_t));
+	//Take header out from packet; leave it untouched if it can't be done
+	if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_mpls_hdr_t)) == ROFL_FAILURE))
+		return;
 
 	//Set new type and base(move right)
 	clas_state->type = new;
@@ -66,10 +70,12 @@ void pop_pppoe(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether
 	switch ( *get_ether_type(ether_header) ) {
 		case ETH_TYPE_PPPOE_DISCOVERY:
 		{
-			pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_pppoe_hdr_t));
 			pkt_types_t new = PT_POP_PROTO(clas_state, PPPOE);
 			if(unlikely(new == PT_INVALID))
 				return;
+			//Take header out from packet; leave it untouched if it can't be done
+			if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_pppoe_hdr_t)) == ROFL_FAILURE))
+				return;
 			//Set new type and base(move right)
 			clas_state->type = new;
 		}
@@ -77,14 +83,21 @@ void pop_pppoe(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether
 
 		case ETH_TYPE_PPPOE_SESSION:
 		{
-			pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t),sizeof(cpc_pppoe_hdr_t) + sizeof(cpc_ppp_hdr_t));
+			pkt_types_t old = clas_state->type;
 			pkt_types_t new = PT_POP_PROTO(clas_state, PPP);
 			if(unlikely(new == PT_INVALID))
 				return;
 			clas_state->type = new;
 			new = PT_POP_PROTO(clas_state, PPPOE);
-			if(unlikely(new == PT_INVALID))
+			if(unlikely(new == PT_INVALID)){
+				clas_state->type = old;
+				return;
+			}
+			//Take header out from packet; leave it untouched if it can't be done
+			if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t),sizeof(cpc_pppoe_hdr_t) + sizeof(cpc_ppp_hdr_t)) == ROFL_FAILURE)){
+				clas_state->type = old;
 				return;
+			}
 
 			//Set new type and base(move right)
 			clas_state->type = new;
@@ -506,8 +519,9 @@ void pop_gtp(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether_t
 		if(unlikely(new == PT_INVALID))
 			return;
 
-		//Take header out from packet
-		pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_ipv4_hdr_t)+sizeof(cpc_udp_hdr_t)+sizeof(cpc_gtpu_base_hdr_t));
+		//Take header out from packet; leave it untouched if it can't be done
+		if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_ipv4_hdr_t)+sizeof(cpc_udp_hdr_t)+sizeof(cpc_gtpu_base_hdr_t)) == ROFL_FAILURE))
+			return;
 
 		//Set new type and base(move right)
 		clas_state->type = new;
@@ -522,8 +536,9 @@ void pop_gtp(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether_t
 		if(unlikely(new == PT_INVALID))
 			return;
 
-		//Take header out from packet
-		pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_ipv6_hdr_t)+sizeof(cpc_udp_hdr_t)+sizeof(cpc_gtpu_base_hdr_t));
+		//Take header out from packet; leave it untouched if it can't be done
+		if(unlikely(pkt_pop(pkt, NULL,/*offset=*/sizeof(cpc_eth_hdr_t), sizeof(cpc_ipv6_hdr_t)+sizeof(cpc_udp_hdr_t)+sizeof(cpc_gtpu_base_hdr_t)) == ROFL_FAILURE))
+			return;
 
 		//Set new type and base(move right)
 		clas_state->type = new;
@@ -732,8 +747,9 @@ void pop_gre(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether_t
 			num_of_bytes += sizeof(uint32_t);
 		}
 
-		//Take header out from packet
-		pkt_pop(pkt, NULL,/*offset=*/0, num_of_bytes);
+		//Take header out from packet; leave it untouched if it can't be done
+		if(unlikely(pkt_pop(pkt, NULL,/*offset=*/0, num_of_bytes) == ROFL_FAILURE))
+			return;
 
 		//Set new type and base(move right)
 		clas_state->type = new;
@@ -762,8 +778,9 @@ void pop_gre(datapacket_t* pkt, classifier_state_t* clas_state, uint16_t ether_t
 			num_of_bytes += sizeof(uint32_t);
 		}
 
-		//Take header out from packet
-		pkt_pop(pkt, NULL,/*offset=*/0, num_of_bytes);
+		//Take header out from packet; leave it untouched if it can't be done
+		if(unlikely(pkt_pop(pkt, NULL,/*offset=*/0, num_of_bytes) == ROFL_FAILURE))
+			return;
 
 		//Set new type and base(move right)
 		clas_state->type = new;
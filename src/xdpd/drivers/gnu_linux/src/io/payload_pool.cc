@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "payload_pool.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//Hugepage size used to round up the areas
+#define PAYLOAD_POOL_HUGEPAGE_SIZE (2*1024*1024)
+
+//Static members initialization
+circular_queue<uint8_t>* payload_pool::jumbo_buffers = NULL;
+
+void payload_pool::init(uint8_t* area){
+
+	unsigned int i;
+
+	if(jumbo_buffers)
+		return;
+
+	jumbo_buffers = new circular_queue<uint8_t>(IO_BUFFERPOOL_JUMBO_CAPACITY);
+
+	for(i=0; i<NUM_OF_JUMBO_BUFFERS; ++i)
+		jumbo_buffers->non_blocking_write(area + (size_t)i*JUMBO_BUFFER_SIZE);
+}
+
+void payload_pool::destroy(){
+	delete jumbo_buffers;
+	jumbo_buffers = NULL;
+}
+
+uint8_t* payload_pool::alloc_area(size_t* len){
+
+	void* map = MAP_FAILED;
+	size_t map_len = ((*len+PAYLOAD_POOL_HUGEPAGE_SIZE-1)/PAYLOAD_POOL_HUGEPAGE_SIZE)*PAYLOAD_POOL_HUGEPAGE_SIZE;
+
+#ifdef IO_BUFFERPOOL_USE_HUGEPAGES
+	//Attempt (reserved) hugepages first
+	map = mmap(NULL, map_len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+	if(map == MAP_FAILED)
+		ROFL_DEBUG(DRIVER_NAME"[bufferpool] Unable to allocate %llu bytes in hugepages (%s); using regular pages\n", (long long unsigned)map_len, strerror(errno));
+#endif
+
+	if(map == MAP_FAILED){
+		map = mmap(NULL, map_len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if(map == MAP_FAILED){
+			ROFL_ERR(DRIVER_NAME"[bufferpool] Unable to allocate %llu bytes: %s\n", (long long unsigned)map_len, strerror(errno));
+			return NULL;
+		}
+#ifdef IO_BUFFERPOOL_USE_HUGEPAGES
+		//Transparent hugepages, if enabled
+		madvise(map, map_len, MADV_HUGEPAGE);
+#endif
+	}
+
+	*len = map_len;
+
+	return (uint8_t*)map;
+}
+
+void payload_pool::free_area(uint8_t* area, size_t len){
+	if(area)
+		munmap(area, len);
+}
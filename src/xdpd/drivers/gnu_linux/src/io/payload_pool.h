@@ -0,0 +1,87 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config.h"
+#include "../util/likely.h"
+#include "../util/circular_queue.h"
+
+/**
+* @file payload_pool.h
+*
+* @brief Packet payload buffer size classes
+*
+* Every datapacket of the bufferpool has a payload buffer of the small class,
+* which fits standard MTU frames. Jumbo frames borrow a buffer of the jumbo
+* class while they are in user space, and return it when the datapacket is
+* released to the bufferpool.
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+#define PAYLOAD_POOL_ALIGN(X) ((((X)+IO_CACHE_LINE_SIZE-1)/IO_CACHE_LINE_SIZE)*IO_CACHE_LINE_SIZE)
+
+/**
+* @brief Payload buffer size classes and jumbo buffer pool
+*
+* @ingroup driver_gnu_linux_io
+*/
+class payload_pool{
+
+public:
+	//Head (push operations) and tail room of every payload buffer
+	static const unsigned int PRE_GUARD_BYTES  = 256;
+	static const unsigned int POST_GUARD_BYTES = 64;
+
+	//Max frame size of each class
+	static const unsigned int SMALL_FRAME_SIZE = IO_BUFFERPOOL_SMALL_FRAME_SIZE;
+	static const unsigned int JUMBO_FRAME_SIZE = 9000;
+
+	//Payload buffer size of each class (cache line multiple)
+	static const unsigned int SMALL_BUFFER_SIZE = PAYLOAD_POOL_ALIGN(PRE_GUARD_BYTES+SMALL_FRAME_SIZE+POST_GUARD_BYTES);
+	static const unsigned int JUMBO_BUFFER_SIZE = PAYLOAD_POOL_ALIGN(PRE_GUARD_BYTES+JUMBO_FRAME_SIZE+POST_GUARD_BYTES);
+
+	//Number of jumbo buffers (a queue can hold up to slots-1 elements)
+	static const unsigned int NUM_OF_JUMBO_BUFFERS = IO_BUFFERPOOL_JUMBO_CAPACITY-1;
+
+	/**
+	* Init the jumbo pool over area, which must be at least
+	* NUM_OF_JUMBO_BUFFERS*JUMBO_BUFFER_SIZE bytes
+	*/
+	static void init(uint8_t* area);
+	static void destroy(void);
+
+	//Get a jumbo buffer; NULL if the pool is exhausted (or not initialized)
+	static inline uint8_t* get_jumbo_buffer(void){
+		if(unlikely(jumbo_buffers == NULL))
+			return NULL;
+		return jumbo_buffers->non_blocking_read();
+	}
+
+	static inline void release_jumbo_buffer(uint8_t* buffer){
+		jumbo_buffers->non_blocking_write(buffer);
+	}
+
+	/**
+	* Allocate a memory area of at least *len bytes, hugepage backed if
+	* possible. On success, *len is set to the actual length of the area.
+	*
+	* @return the area or NULL
+	*/
+	static uint8_t* alloc_area(size_t* len);
+	static void free_area(uint8_t* area, size_t len);
+
+private:
+	static circular_queue<uint8_t>* jumbo_buffers;
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* PAYLOAD_POOL_H_ */
@@ -28,8 +28,9 @@ int pktin_not_pipe[2];
 static inline void process_sw_of1x_packet_ins(of1x_switch_t* sw){
 
 	int ret;
-	unsigned int i;
+	unsigned int i, n;
 	datapacket_t* pkt;
+	datapacket_t* pkts[BUCKETS_PER_LS];
 	datapacketx86* pkt_x86;
 	hal_result_t rv;
 	storeid id;
@@ -43,16 +44,16 @@ static inline void process_sw_of1x_packet_ins(of1x_switch_t* sw){
 	switch_platform_state_t* ls_int = (switch_platform_state_t*)sw->platform_state;
 
 	//Try to process up to BUCKETS_PER_LS packet-ins
-	for(i=0;i<BUCKETS_PER_LS;++i){
+	n = ls_int->pkt_in_queue->dequeue_bulk(pkts, BUCKETS_PER_LS);
+
+	for(i=0;i<n;++i){
 	
 		//Recover packet	
-		pkt = ls_int->pkt_in_queue->non_blocking_read();
-	
-		if(!pkt)
-			break;
+		pkt = pkts[i];
 		
 		//Recover platform state
 		pkt_x86 = (datapacketx86*)pkt->platform_state;
+		STAGE_LATENCY_END(pkt, SL_PKT_IN_QUEUE, SL_PKT_IN_TOTAL);
 		
 		//Store packet in the storage system. Packet is NOT returned to the bufferpool
 		id = ls_int->storage->store_packet(pkt);
@@ -0,0 +1,432 @@
+#include "pktout_dispatcher.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <rofl/datapath/pipeline/physical_switch.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/of1x_switch.h>
+#include <rofl/common/utils/c_logger.h>
+
+#include "../config.h"
+#include "../io/bufferpool.h"
+#include "../io/datapacketx86.h"
+#include "../io/datapacket_storage.h"
+#include "../processing/ls_internal_state.h"
+#include "../util/circular_queue.h"
+
+//Make sure pipeline-imp are BEFORE _pp.h
+//so that functions can be inlined
+#include "../pipeline-imp/atomic_operations.h"
+#include "../pipeline-imp/pthread_lock.h"
+#include "../pipeline-imp/packet.h"
+
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_pipeline_pp.h>
+
+using namespace xdpd::gnu_linux;
+
+//Max number of PKT_OUTs processed per LSI and round
+#define BUCKETS_PER_LS 32
+
+//Per LSI state
+struct pktout_state{
+	//LSI
+	of_switch_t* sw;
+
+	//Pending requests (only one consumer at a time, see busy)
+	circular_queue<pktout_request_t, CQ_MPSC>* queue;
+
+	//Free requests (slots)
+	circular_queue<pktout_request_t>* free_slots;
+	pktout_request_t* slots;
+
+	//LSI is being destroyed
+	volatile bool closed;
+
+	//Set while a thread is processing the queue; guarantees PKT_OUTs of
+	//an LSI are processed by one thread at a time, hence in order
+	volatile unsigned int busy;
+
+	//Index in the registry
+	unsigned int idx;
+};
+
+//Notification eventfd
+static int pktout_not_fd = -1;
+
+//Number of running consumers (RX I/O threads)
+static volatile unsigned int num_of_consumers = 0;
+
+//Registry of the LSIs states. Consumers iterate it with the read lock held,
+//so that the state and the LSI cannot be destroyed while being processed
+static pktout_state_t* pktout_states[PHYSICAL_SWITCH_MAX_LS] = {0};
+static pthread_rwlock_t pktout_states_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+/*
+* Wake up consumers
+*/
+static inline void notify_packet_out(void){
+	int ret;
+	uint64_t c=1;
+	ret = write(pktout_not_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+/*
+* Lookup (buffered), classify and process the actions of a PKT_OUT
+*/
+static rofl_result_t process_packet_out(unsigned int tid, of_switch_t* sw, uint32_t buffer_id, uint32_t in_port, datapacket_t* pkt, of1x_action_group_t* action_group){
+
+	datapacketx86* pktx86;
+
+	if(!pkt){
+		//Retrieve the packet
+		pkt = ((switch_platform_state_t*)sw->platform_state)->storage->get_packet(buffer_id);
+
+		//Buffer has expired
+		if(!pkt){
+			ROFL_DEBUG(DRIVER_NAME"[pkt-out-dispatcher] PKT_OUT for buffer_id %u in sw: %s could not be processed; buffer has expired\n", buffer_id, sw->name);
+			return ROFL_FAILURE;
+		}
+
+		//Do not measure the latency of PKT_OUTs
+		STAGE_LATENCY_IGNORE(pkt);
+
+		/*
+		 * remark: do not overwrite clas_state.calculate_checksums_in_sw, as these flags may
+		 * have been altered by previous tables in the pipeline. A simple reclassification
+		 * suppresses necessary recalculations for IPv4, UDP, TCP, etc.
+		 */
+
+		//Reclassify the packet
+		pktx86 = (datapacketx86*)pkt->platform_state;
+		//keep checksum_calculation flags
+		uint32_t calculate_checksums_in_sw = pktx86->clas_state.calculate_checksums_in_sw;
+		classify_packet(&pktx86->clas_state, pktx86->get_buffer(), pktx86->get_buffer_length(), in_port, 0);
+		pktx86->clas_state.calculate_checksums_in_sw |= calculate_checksums_in_sw;
+	}else{
+		//Do not measure the latency of PKT_OUTs
+		STAGE_LATENCY_IGNORE(pkt);
+
+		//Reclassify the packet
+		pktx86 = (datapacketx86*)pkt->platform_state;
+		classify_packet(&pktx86->clas_state, pktx86->get_buffer(), pktx86->get_buffer_length(), in_port, 0);
+	}
+
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[pkt-out-dispatcher] Processing packet out [%p]\n",pkt);
+
+	//Instruct pipeline to process actions. This may reinject the packet
+	of1x_process_packet_out_pipeline(tid, (of1x_switch_t*)sw, pkt, action_group);
+
+	return ROFL_SUCCESS;
+}
+
+//
+// Notification
+//
+
+rofl_result_t init_packetout_notification(){
+
+	pktout_not_fd = eventfd(0, EFD_NONBLOCK);
+
+	if(pktout_not_fd < 0){
+		ROFL_ERR(DRIVER_NAME"[pkt-out-dispatcher] Unable to create PKT_OUT notification eventfd: %s\n", strerror(errno));
+		return ROFL_FAILURE;
+	}
+
+	return ROFL_SUCCESS;
+}
+
+void destroy_packetout_notification(){
+	if(pktout_not_fd != -1)
+		close(pktout_not_fd);
+	pktout_not_fd = -1;
+}
+
+int get_packet_out_read_fd(){
+	return pktout_not_fd;
+}
+
+void register_packet_out_consumer(){
+	__sync_fetch_and_add(&num_of_consumers, 1);
+}
+
+
+//
+// LSI state
+//
+
+pktout_state_t* init_packet_out_state(of_switch_t* sw){
+
+	unsigned int i;
+	pktout_state_t* state = (pktout_state_t*)calloc(1, sizeof(pktout_state_t));
+
+	if(!state)
+		return NULL;
+
+	//Note that a queue can hold up to slots-1 elements
+	state->slots = (pktout_request_t*)calloc(LSI_PKT_OUT_QUEUE_SLOTS-1, sizeof(pktout_request_t));
+	if(!state->slots){
+		free(state);
+		return NULL;
+	}
+
+	state->sw = sw;
+	state->queue = new circular_queue<pktout_request_t, CQ_MPSC>(LSI_PKT_OUT_QUEUE_SLOTS);
+	state->free_slots = new circular_queue<pktout_request_t>(LSI_PKT_OUT_QUEUE_SLOTS);
+
+	for(i=0; i<LSI_PKT_OUT_QUEUE_SLOTS-1; ++i)
+		state->free_slots->non_blocking_write(&state->slots[i]);
+
+	//Register it
+	pthread_rwlock_wrlock(&pktout_states_rwlock);
+	for(i=0; i<PHYSICAL_SWITCH_MAX_LS; ++i){
+		if(!pktout_states[i]){
+			pktout_states[i] = state;
+			state->idx = i;
+			break;
+		}
+	}
+	pthread_rwlock_unlock(&pktout_states_rwlock);
+
+	if(i == PHYSICAL_SWITCH_MAX_LS){
+		assert(0);
+		delete state->queue;
+		delete state->free_slots;
+		free(state->slots);
+		free(state);
+		return NULL;
+	}
+
+	return state;
+}
+
+//Take the state out of the registry; no consumer is using it on return
+static void unregister_packet_out_state(pktout_state_t* state){
+	pthread_rwlock_wrlock(&pktout_states_rwlock);
+	state->closed = true;
+	if(pktout_states[state->idx] == state)
+		pktout_states[state->idx] = NULL;
+	pthread_rwlock_unlock(&pktout_states_rwlock);
+}
+
+void destroy_packet_out_state(pktout_state_t* state){
+
+	//In case the LSI was not drained (e.g. creation failed)
+	unregister_packet_out_state(state);
+
+	//There should NOT be any PKT_OUT pending
+	if(state->queue->size() != 0)
+		assert(0);
+
+	delete state->queue;
+	delete state->free_slots;
+	free(state->slots);
+	free(state);
+}
+
+//
+// Consumers
+//
+
+//Acquire the right to process the PKT_OUTs of the LSI (one thread at a time)
+static inline bool trylock_sw_packet_outs(pktout_state_t* state){
+	return __sync_bool_compare_and_swap(&state->busy, 0, 1);
+}
+
+static inline void unlock_sw_packet_outs(pktout_state_t* state){
+	__sync_lock_release(&state->busy);
+}
+
+/*
+* Processes up to max PKT_OUTs (0 means all) of an LSI. The caller must hold
+* the registry read lock (or otherwise make sure the LSI is not destroyed).
+* If wait is false and another thread is already processing the LSI, it
+* returns immediately. Returns true if there are (likely) PKT_OUTs pending.
+*/
+static bool process_sw_packet_outs(unsigned int tid, pktout_state_t* state, unsigned int max, bool wait){
+
+	unsigned int i;
+	pktout_request_t* req;
+
+	if(!trylock_sw_packet_outs(state)){
+		if(!wait)
+			return true; //Let it be retried; the other thread may miss the last ones
+
+		while(!trylock_sw_packet_outs(state))
+			sched_yield();
+	}
+
+	for(i=0; !max || i<max; ++i){
+
+		req = state->queue->non_blocking_read();
+
+		if(!req)
+			break;
+
+		process_packet_out(tid, state->sw, req->buffer_id, req->in_port, req->pkt, req->action_group);
+
+		//Release the request
+		of1x_destroy_action_group(req->action_group);
+		state->free_slots->non_blocking_write(req);
+	}
+
+	unlock_sw_packet_outs(state);
+
+	return state->queue->size() != 0;
+}
+
+//Returns true if there are (likely) PKT_OUTs still pending
+static bool process_all_packet_outs(unsigned int tid, unsigned int max, bool wait){
+
+	unsigned int i;
+	bool pending = false;
+	pktout_state_t* state;
+
+	pthread_rwlock_rdlock(&pktout_states_rwlock);
+
+	for(i=0; i<PHYSICAL_SWITCH_MAX_LS; ++i){
+		state = pktout_states[i];
+		if(state && !state->closed)
+			pending |= process_sw_packet_outs(tid, state, max, wait);
+	}
+
+	pthread_rwlock_unlock(&pktout_states_rwlock);
+
+	return pending;
+}
+
+/*
+* Process all the PKT_OUTs of an LSI in the context of the caller
+*/
+static void flush_sw_packet_outs(pktout_state_t* state){
+	pthread_rwlock_rdlock(&pktout_states_rwlock);
+	if(pktout_states[state->idx] == state)
+		process_sw_packet_outs(ROFL_PIPELINE_LOCKED_TID, state, 0, true);
+	pthread_rwlock_unlock(&pktout_states_rwlock);
+}
+
+/*
+* Attempt to process packet outs for all the switches
+*/
+void process_packet_outs(unsigned int tid){
+
+	int ret;
+	uint64_t events;
+
+	//Consume the notification(s); if another consumer got them first, just return
+	ret = read(pktout_not_fd, &events, sizeof(events));
+	if(ret != sizeof(events))
+		return;
+
+	//Let the rest be processed in the next round (do not starve RX)
+	if(process_all_packet_outs(tid, BUCKETS_PER_LS, false))
+		notify_packet_out();
+}
+
+void unregister_packet_out_consumer(unsigned int tid){
+
+	//Last consumer leaving; do not leave PKT_OUTs behind. Producers that
+	//enqueued before seeing the counter drop to 0 are drained here, the
+	//rest flush in their own context (see dispatch_packet_out())
+	if(__sync_sub_and_fetch(&num_of_consumers, 1) == 0)
+		process_all_packet_outs(tid, 0, true);
+}
+
+//
+// Producer
+//
+
+rofl_result_t dispatch_packet_out(of_switch_t* sw, uint32_t buffer_id, uint32_t in_port, datapacket_t* pkt, of1x_action_group_t* action_group){
+
+	pktout_request_t* req;
+	pktout_state_t* state = ((switch_platform_state_t*)sw->platform_state)->pkt_out;
+	bool queued = false, full = false;
+
+	//The closed check and the enqueue are done with the registry read lock
+	//held, so that drain_packet_outs() cannot run in between (and leave this
+	//request behind)
+	pthread_rwlock_rdlock(&pktout_states_rwlock);
+
+	//Defer it only if there is someone to process it
+	if(likely(num_of_consumers > 0) && likely(!state->closed)){
+
+		req = state->free_slots->non_blocking_read();
+
+		if(likely(req != NULL)){
+			//The action group is owned by the caller
+			req->action_group = __of1x_copy_action_group(action_group);
+
+			if(likely(req->action_group != NULL)){
+				req->buffer_id = buffer_id;
+				req->in_port = in_port;
+				req->pkt = pkt;
+
+				if(likely(state->queue->non_blocking_write(req) == ROFL_SUCCESS))
+					queued = true;
+				else
+					of1x_destroy_action_group(req->action_group);
+			}
+
+			//Return the slot
+			if(unlikely(!queued))
+				state->free_slots->non_blocking_write(req);
+		}
+
+		full = !queued;
+	}
+
+	pthread_rwlock_unlock(&pktout_states_rwlock);
+
+	if(likely(queued)){
+		//The last consumer may have left meanwhile (and drained the queue
+		//before this request was in)
+		__sync_synchronize();
+		if(unlikely(num_of_consumers == 0))
+			flush_sw_packet_outs(state);
+		else
+			notify_packet_out();
+		return ROFL_SUCCESS;
+	}
+
+	if(full){
+		ROFL_DEBUG(DRIVER_NAME"[pkt-out-dispatcher] PKT_OUT queue of sw: %s full; processing it in the caller context\n", sw->name);
+
+		//Do not overtake the ones already queued
+		flush_sw_packet_outs(state);
+	}
+
+	return process_packet_out(ROFL_PIPELINE_LOCKED_TID, sw, buffer_id, in_port, pkt, action_group);
+}
+
+void flush_packet_outs(of_switch_t* sw){
+
+	pktout_state_t* state = ((switch_platform_state_t*)sw->platform_state)->pkt_out;
+
+	flush_sw_packet_outs(state);
+}
+
+void drain_packet_outs(of_switch_t* sw){
+
+	pktout_request_t* req;
+	pktout_state_t* state;
+
+	if(!sw)
+		assert(0);
+
+	state = ((switch_platform_state_t*)sw->platform_state)->pkt_out;
+
+	//Stop accepting new ones; on return no consumer is using the state and
+	//no producer can enqueue anymore (see dispatch_packet_out())
+	unregister_packet_out_state(state);
+
+	//Release pending PKT_OUTs
+	while((req = state->queue->non_blocking_read()) != NULL){
+		if(req->pkt)
+			bufferpool::release_buffer(req->pkt);
+		of1x_destroy_action_group(req->action_group);
+		state->free_slots->non_blocking_write(req);
+	}
+}
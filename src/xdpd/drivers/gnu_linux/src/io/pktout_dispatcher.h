@@ -0,0 +1,100 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef PKTOUT_DISPATCHER_H
+#define PKTOUT_DISPATCHER_H
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/common/datapacket.h>
+#include <rofl/datapath/pipeline/openflow/of_switch.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_action.h>
+
+/**
+* @file pktout_dispatcher.h
+*
+* @brief Functions to dispatch pkt_outs from the HAL caller (management
+* thread) to the RX I/O threads, which process them in batches.
+*
+* The HAL caller only copies the action group (and the packet, if not
+* buffered) and enqueues the request in the LSI PKT_OUT ring. Buffer storage
+* lookup, classification and the pipeline processing of the actions happen
+* in the context of an RX I/O thread. If there is no RX I/O thread running
+* or the ring is full, PKT_OUTs are processed in the context of the caller.
+*
+* The PKT_OUTs of an LSI are processed by one thread at a time, so they are
+* sent in the order they were dispatched. flush_packet_outs() must be called
+* before replying to a BARRIER_REQUEST.
+*/
+
+/**
+* PKT_OUT request
+*/
+typedef struct pktout_request{
+	uint32_t buffer_id;
+	uint32_t in_port;
+	datapacket_t* pkt;			//Already copied packet (non-buffered PKT_OUTs) or NULL
+	of1x_action_group_t* action_group;	//Owned by the request
+}pktout_request_t;
+
+/**
+* Per LSI PKT_OUT state
+*/
+typedef struct pktout_state pktout_state_t;
+
+/**
+* Initialize the notification fd (eventfd). Must be called before launching I/O threads
+*/
+rofl_result_t init_packetout_notification(void);
+
+/**
+* Destroy the notification fd
+*/
+void destroy_packetout_notification(void);
+
+/**
+* Get the fd to be polled by the consumers (RX I/O threads)
+*/
+int get_packet_out_read_fd(void);
+
+/**
+* Register/unregister the calling RX I/O thread as a PKT_OUT consumer
+*/
+void register_packet_out_consumer(void);
+void unregister_packet_out_consumer(unsigned int tid);
+
+/**
+* Create/destroy PKT_OUT state of an LSI
+*/
+pktout_state_t* init_packet_out_state(of_switch_t* sw);
+void destroy_packet_out_state(pktout_state_t* state);
+
+/**
+* Process a PKT_OUT. If it can be deferred to an I/O thread, the request is
+* enqueued and the call returns immediately; otherwise it is processed in
+* the context of the caller. pkt (if not NULL) is always consumed, whereas
+* action_group is never consumed (a copy is enqueued).
+*/
+rofl_result_t dispatch_packet_out(of_switch_t* sw, uint32_t buffer_id, uint32_t in_port, datapacket_t* pkt, of1x_action_group_t* action_group);
+
+/**
+* Process pending PKT_OUTs of all LSIs (called by the consumers on notification)
+*/
+void process_packet_outs(unsigned int tid);
+
+/**
+* Process all the pending PKT_OUTs of an LSI in the context of the caller
+* (synchronously). On return, all the PKT_OUTs dispatched before the call
+* have been processed.
+*/
+void flush_packet_outs(of_switch_t* sw);
+
+/**
+* Stop accepting PKT_OUTs for an LSI and drain the pending ones
+*/
+void drain_packet_outs(of_switch_t* sw);
+
+#endif //PKTOUT_DISPATCHER_H
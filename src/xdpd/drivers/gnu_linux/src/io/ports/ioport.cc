@@ -23,15 +23,21 @@ ioport::ioport(switch_port_t* of_ps, unsigned int q_num){
 	
 	//Maximum packet size
 	mps = 0;
+
+	//Not (yet) in any RX portgroup
+	rx_group_id = -1;
+
+	//Egress scheduler
+	tx_sched = egress_scheduler::create();
 	
 	//Copy MAC address
 	memcpy(mac, of_ps->hwaddr, ETHER_MAC_LEN); 
 
 	//Initialize input queue
-	input_queue = new circular_queue<datapacket_t>(IO_IFACE_RING_SLOTS);	
+	input_queue = new circular_queue<datapacket_t, CQ_SPSC>(IO_IFACE_RING_SLOTS);	
 
 	for(int i=0;i<IO_IFACE_NUM_QUEUES;++i)
-		output_queues[i] = new circular_queue<datapacket_t>(IO_IFACE_RING_SLOTS);	
+		output_queues[i] = new circular_queue<datapacket_t, CQ_MPSC>(IO_IFACE_RING_SLOTS);	
 	
 	//Initalize pthread rwlock		
 	if(pthread_rwlock_init(&rwlock, NULL) < 0){
@@ -47,6 +53,8 @@ ioport::~ioport(){
 	delete input_queue;
 	for(int i=0;i<IO_IFACE_NUM_QUEUES;++i)
 		delete output_queues[i];
+
+	delete tx_sched;
 }
 
 /**
@@ -15,6 +15,8 @@
 #include <rofl/datapath/pipeline/switch_port.h>
 #include "../../config.h"
 #include "../../util/circular_queue.h" 
+#include "ioport_stats.h"
+#include "../scheduler/egress_scheduler.h"
 
 /**
 * @file ioport.h
@@ -165,8 +167,24 @@ public:
 		return output_queues[q_id]->is_empty() == false;
 	}
 
+	/**
+	* Peek the i-th packet of output queue q_id, without dequeuing it. Only
+	* to be used by the TX I/O thread (egress scheduler)
+	*/
+	inline datapacket_t* output_queue_peek(unsigned int q_id, unsigned int i){
+		return output_queues[q_id]->peek(i);
+	}
+
 	//Port state (rofl-pipeline port state reference)
 	switch_port_t* of_port_state;
+
+	/**
+	* Aggregate the per I/O thread counters into of_port_state (stats). 
+	* Must be called before snapshotting the port state.
+	*/
+	inline void update_of_port_stats(void){
+		stats.aggregate(of_port_state);
+	}
 	
 	inline void set_link_state(bool up){
 
@@ -179,6 +197,8 @@ public:
 	
 	static const unsigned int MAX_OUTPUT_QUEUES=IO_IFACE_NUM_QUEUES; /*!< Constant max output queues */
 	unsigned int port_group;
+	int rx_group_id; //RX portgroup of the port (-1 if none); set by the iomanager
+	egress_scheduler* tx_sched; //Egress scheduler of the output queues
 	pthread_rwlock_t rwlock; //Serialize management actions
 
 protected:
@@ -197,6 +217,12 @@ protected:
 	//MAC address
 	uint8_t mac[ETHER_MAC_LEN];
 
+	/**
+	* Port and queue counters. Ports MUST use these instead of updating
+	* of_port_state->stats directly
+	*/
+	ioport_stats stats;
+
 	/**
 	* @brief Output (TX) queues (num_of_queues) 
 	* 
@@ -204,7 +230,7 @@ protected:
 	* for QoS purposes (set-queue). output_queues[0] is always the queue with 
 	* least priority (best effort)
 	*/
-	circular_queue<datapacket_t>* output_queues[IO_IFACE_NUM_QUEUES];
+	circular_queue<datapacket_t, CQ_MPSC>* output_queues[IO_IFACE_NUM_QUEUES];
 
 	/**
 	* Input queue (intermediate-buffering). 
@@ -214,7 +240,7 @@ protected:
 	* to the appropiate LS processing queue.
 	*
 	*/
-	circular_queue<datapacket_t>* input_queue;
+	circular_queue<datapacket_t, CQ_SPSC>* input_queue;
 };
 
 }// namespace xdpd::gnu_linux 
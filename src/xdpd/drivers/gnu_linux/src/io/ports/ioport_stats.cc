@@ -0,0 +1,72 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ioport_stats.h"
+#include <new>
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//Threads not explicitely assigned (mgmt, bg...) use the shared shard
+__thread unsigned int ioport_stats::thread_shard = ioport_stats::SHARED_SHARD;
+
+ioport_stats::ioport_stats(){
+
+	//ioports are allocated via new, so alignment of the shards cannot
+	//be guaranteed unless they are allocated separately
+	if(posix_memalign((void**)&shards, IO_CACHE_LINE_SIZE, sizeof(ioport_counters_t)*IO_PORT_STATS_SHARDS) != 0){
+		ROFL_ERR(DRIVER_NAME" Unable to allocate port counter shards\n");
+		throw std::bad_alloc();
+	}
+	memset(shards, 0, sizeof(ioport_counters_t)*IO_PORT_STATS_SHARDS);
+}
+
+ioport_stats::~ioport_stats(){
+	free(shards);
+}
+
+void ioport_stats::aggregate(switch_port_t* port){
+
+	unsigned int i, j;
+	ioport_counters_t total;
+	volatile ioport_counters_t* c;
+
+	memset(&total, 0, sizeof(total));
+
+	//Shards are written concurrently by the I/O threads; aligned 64 bit
+	//loads are enough to get a consistent value of every single counter
+	for(i=0; i<IO_PORT_STATS_SHARDS; ++i){
+		c = &shards[i];
+
+		total.rx_packets += c->rx_packets;
+		total.rx_bytes += c->rx_bytes;
+		total.rx_dropped += c->rx_dropped;
+		total.tx_packets += c->tx_packets;
+		total.tx_bytes += c->tx_bytes;
+		total.tx_dropped += c->tx_dropped;
+		total.tx_errors += c->tx_errors;
+
+		for(j=0; j<IO_IFACE_NUM_QUEUES; ++j){
+			total.queues[j].tx_packets += c->queues[j].tx_packets;
+			total.queues[j].tx_bytes += c->queues[j].tx_bytes;
+			total.queues[j].overrun += c->queues[j].overrun;
+		}
+	}
+
+	//Port
+	port->stats.rx_packets = total.rx_packets;
+	port->stats.rx_bytes = total.rx_bytes;
+	port->stats.rx_dropped = total.rx_dropped;
+	port->stats.tx_packets = total.tx_packets;
+	port->stats.tx_bytes = total.tx_bytes;
+	port->stats.tx_dropped = total.tx_dropped;
+	port->stats.tx_errors = total.tx_errors;
+
+	//Queues
+	for(j=0; j<IO_IFACE_NUM_QUEUES; ++j){
+		port->queues[j].stats.tx_packets = total.queues[j].tx_packets;
+		port->queues[j].stats.tx_bytes = total.queues[j].tx_bytes;
+		port->queues[j].stats.overrun = total.queues[j].overrun;
+	}
+}
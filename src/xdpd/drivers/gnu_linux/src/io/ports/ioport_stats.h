@@ -0,0 +1,146 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef IOPORT_STATS_H
+#define IOPORT_STATS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/switch_port.h>
+#include "../../config.h"
+#include "../../util/likely.h"
+
+/**
+* @file ioport_stats.h
+*
+* @brief Per I/O thread port and queue counters
+*
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Per queue counters
+*/
+typedef struct ioport_queue_counters{
+	uint64_t tx_packets;
+	uint64_t tx_bytes;
+	uint64_t overrun;
+}ioport_queue_counters_t;
+
+/**
+* Counter shard. Each shard is written by a single I/O thread and is
+* aligned to a cache line, so that RX and TX threads do not bounce
+* the same line between cores.
+*/
+typedef struct ioport_counters{
+	//RX
+	uint64_t rx_packets;
+	uint64_t rx_bytes;
+	uint64_t rx_dropped;
+
+	//TX
+	uint64_t tx_packets;
+	uint64_t tx_bytes;
+	uint64_t tx_dropped;
+	uint64_t tx_errors;
+
+	//Queues
+	ioport_queue_counters_t queues[IO_IFACE_NUM_QUEUES];
+}__attribute__((aligned(IO_CACHE_LINE_SIZE))) ioport_counters_t;
+
+/**
+* @brief Sharded port and queue counters of an ioport
+*
+* Every I/O thread writes to its own shard (selected via set_thread_shard()),
+* without any atomic operation. Threads which have not been assigned a shard
+* (e.g. management or bg threads) share the last shard, which is updated
+* atomically. Shards are only aggregated when the state of the port is read
+* (snapshots), via aggregate().
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class ioport_stats{
+
+public:
+	ioport_stats(void);
+	~ioport_stats(void);
+
+	/**
+	* Assign the shard to be used by the calling thread. Must be called
+	* once by every I/O thread, before doing any I/O. Shard ids beyond
+	* the number of exclusive shards fall back to the shared shard.
+	*/
+	static inline void set_thread_shard(unsigned int id){
+		thread_shard = (id < SHARED_SHARD)? id : SHARED_SHARD;
+	}
+
+	/*
+	* RX
+	*/
+	inline void rx_packet(unsigned int bytes){
+		ioport_counters_t* c = &shards[thread_shard];
+		inc(&c->rx_packets, 1);
+		inc(&c->rx_bytes, bytes);
+	}
+
+	inline void rx_dropped(void){
+		inc(&shards[thread_shard].rx_dropped, 1);
+	}
+
+	/*
+	* TX
+	*/
+	inline void tx_packets(unsigned int q_id, unsigned int pkts, unsigned int bytes){
+		ioport_counters_t* c = &shards[thread_shard];
+		inc(&c->tx_packets, pkts);
+		inc(&c->tx_bytes, bytes);
+		inc(&c->queues[q_id].tx_packets, pkts);
+		inc(&c->queues[q_id].tx_bytes, bytes);
+	}
+
+	inline void tx_dropped(unsigned int q_id){
+		ioport_counters_t* c = &shards[thread_shard];
+		inc(&c->tx_dropped, 1);
+		inc(&c->queues[q_id].overrun, 1);
+	}
+
+	inline void tx_errors(unsigned int q_id, unsigned int pkts){
+		ioport_counters_t* c = &shards[thread_shard];
+		inc(&c->tx_errors, pkts);
+		inc(&c->queues[q_id].overrun, pkts);
+	}
+
+	/**
+	* Aggregate all the shards and write the result into the port (and queue)
+	* stats of the switch_port_t. Only the counters handled by the shards are
+	* overwritten.
+	*/
+	void aggregate(switch_port_t* port);
+
+	//Shard used by threads without an exclusive one (updated atomically)
+	static const unsigned int SHARED_SHARD = IO_PORT_STATS_SHARDS-1;
+
+private:
+	//Cache aligned array of IO_PORT_STATS_SHARDS shards
+	ioport_counters_t* shards;
+
+	//Shard of the calling thread
+	static __thread unsigned int thread_shard;
+
+	static inline void inc(uint64_t* counter, uint64_t value){
+		if(likely(thread_shard != SHARED_SHARD))
+			*counter += value;
+		else
+			__sync_fetch_and_add(counter, value);
+	}
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* IOPORT_STATS_H_ */
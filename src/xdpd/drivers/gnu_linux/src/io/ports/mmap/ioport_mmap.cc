@@ -10,8 +10,6 @@
 #include <rofl/common/protocols/fetherframe.h>
 #include <rofl/common/protocols/fvlanframe.h>
 
-//Profiling
-#include "../../../util/time_measurements.h"
 #include "../../../config.h"
 
 using namespace rofl;
@@ -85,7 +83,7 @@ void ioport_mmap::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
 	
 		//Store on queue and exit. This is NOT copying it to the mmap buffer
 		if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS){
-			TM_STAMP_STAGE(pkt, TM_SA5_FAILURE);
+			STAGE_LATENCY_DROP(pkt, SL_TX_QUEUE);
 			
 			ROFL_DEBUG(DRIVER_NAME"[mmap:%s] Packet(%p) dropped. Congestion in output queue: %d\n",  of_port_state->name, pkt, q_id);
 			//Drop packet
@@ -97,7 +95,6 @@ void ioport_mmap::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
 #endif
 			return;
 		}
-		TM_STAMP_STAGE(pkt, TM_SA5_SUCCESS);
 
 		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] Packet(%p) enqueued, buffer size: %d\n",  of_port_state->name, pkt, output_queues[q_id]->size());
 	
@@ -141,10 +138,11 @@ inline void ioport_mmap::empty_pipe(){
 	}
 }
 
-inline void ioport_mmap::fill_vlan_pkt(struct tpacket2_hdr *hdr, datapacketx86 *pkt_x86){
+inline rofl_result_t ioport_mmap::fill_vlan_pkt(mmap_rx_hdr_t *hdr, datapacketx86 *pkt_x86){
 
-	//Initialize pktx86
-	pkt_x86->init(NULL, hdr->tp_len + sizeof(struct fvlanframe::vlan_hdr_t), of_port_state->attached_sw, get_port_no(), 0, false); //Init but don't classify
+	//Initialize pktx86 (jumbo frames may not find a buffer)
+	if(unlikely(pkt_x86->init(NULL, hdr->tp_len + sizeof(struct fvlanframe::vlan_hdr_t), of_port_state->attached_sw, get_port_no(), 0, false) != ROFL_SUCCESS)) //Init but don't classify
+		return ROFL_FAILURE;
 
 	// write ethernet header
 	memcpy(pkt_x86->get_buffer(), (uint8_t*)hdr + hdr->tp_mac, sizeof(struct fetherframe::eth_hdr_t));
@@ -162,13 +160,13 @@ inline void ioport_mmap::fill_vlan_pkt(struct tpacket2_hdr *hdr, datapacketx86 *
 	struct fvlanframe::vlan_hdr_t* vlanptr =
 			(struct fvlanframe::vlan_hdr_t*) (pkt_x86->get_buffer()
 			+ sizeof(struct fetherframe::eth_hdr_t));
-	vlanptr->byte0 =  (hdr->tp_vlan_tci >> 8);
-	vlanptr->byte1 = hdr->tp_vlan_tci & 0x00ff;
+	vlanptr->byte0 =  (mmap_rx::get_vlan_tci(hdr) >> 8);
+	vlanptr->byte1 = mmap_rx::get_vlan_tci(hdr) & 0x00ff;
 	vlanptr->dl_type = ((struct fetherframe::eth_hdr_t*)((uint8_t*)hdr + hdr->tp_mac))->dl_type;
 
 #ifdef KERNEL_STAG_SUPPORT
 	// set dl_type to C-TAG, S-TAG, I-TAG, as indicated by kernel
-	((struct fetherframe::eth_hdr_t*)pkt_x86->get_buffer())->dl_type = htobe16(hdr->tp_vlan_tpid);
+	((struct fetherframe::eth_hdr_t*)pkt_x86->get_buffer())->dl_type = htobe16(mmap_rx::get_vlan_tpid(hdr));
 #endif
 
 	// write payload
@@ -178,16 +176,28 @@ inline void ioport_mmap::fill_vlan_pkt(struct tpacket2_hdr *hdr, datapacketx86 *
 
 	//And classify
 	classify_packet(&pkt_x86->clas_state, pkt_x86->get_buffer(), pkt_x86->get_buffer_length(), get_port_no(), 0);
+
+	return ROFL_SUCCESS;
 }
 	
+mmap_rx* ioport_mmap::new_rx(){
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	return new mmap_rx(std::string(of_port_state->name), IO_IFACE_MMAP_RX_V3_BLOCK_SIZE, IO_IFACE_MMAP_RX_V3_BLOCKS, frame_size);
+#else
+	return new mmap_rx(std::string(of_port_state->name), 2 * block_size, n_blocks, frame_size);
+#endif
+}
+
 // handle read
 datapacket_t* ioport_mmap::read(){
 
-	struct tpacket2_hdr *hdr;
+	mmap_rx_hdr_t *hdr;
 	struct sockaddr_ll *sll;
 	datapacket_t *pkt;
 	datapacketx86 *pkt_x86;
 	uint8_t* pkt_mac;
+	uint64_t lat_ts;
+	rofl_result_t res;
 
 	//Check if we really have to read
 	if(!of_port_state->up || of_port_state->drop_received || !rx)
@@ -202,10 +212,10 @@ next:
 		return NULL;
 
 	//Sanity check 
-	if ( unlikely(hdr->tp_mac + hdr->tp_snaplen > rx->get_tpacket_req()->tp_frame_size) ) {
+	if ( unlikely(!rx->is_within_bounds(hdr)) ) {
 		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] sanity check during read mmap failed\n",of_port_state->name);
 		//Increment error statistics
-		of_port_state->stats.rx_dropped++;		
+		stats.rx_dropped();
 
 		//Return packet to kernel in the RX ring		
 		rx->return_packet(hdr);
@@ -213,7 +223,7 @@ next:
 	}
 
 	//Check if it is an ongoing frame from TX
-	sll = (struct sockaddr_ll*)((uint8_t*)hdr + TPACKET_ALIGN(sizeof(struct tpacket_hdr)));
+	sll = mmap_rx::get_sll(hdr);
 	if (PACKET_OUTGOING == sll->sll_pkttype) {
 		/*ROFL_DEBUG_VERBOSE(DRIVER_NAME" cioport(%s)::handle_revent() outgoing "
 					"frame rcvd in slot i:%d, ignoring\n", of_port_state->name, rx->rpos);*/
@@ -234,13 +244,16 @@ next:
 		goto next;
 	}
 
+	//Stage latency sampling
+	lat_ts = stage_latency::sample();
+
 	//Retrieve buffer from pool: this is a non-blocking call
 	pkt = bufferpool::get_buffer();
 
 	//Handle no free buffer
 	if(!pkt) {
 		//Increment error statistics and drop
-		of_port_state->stats.rx_dropped++;		
+		stats.rx_dropped();
 		rx->return_packet(hdr);
 		return NULL;
 	}
@@ -251,25 +264,32 @@ next:
 	#ifdef TP_STATUS_VLAN_VALID
 	if(hdr->tp_status&TP_STATUS_VLAN_VALID){
 	#else
-	if(hdr->tp_vlan_tci != 0) {
+	if(mmap_rx::get_vlan_tci(hdr) != 0) {
         #endif			
 		//There is a VLAN
-		fill_vlan_pkt(hdr, pkt_x86);	
+		res = fill_vlan_pkt(hdr, pkt_x86);	
 	}else{
 		// no vlan tag present
-		pkt_x86->init((uint8_t*)hdr + hdr->tp_mac, hdr->tp_len, of_port_state->attached_sw, get_port_no(), 0);
+		res = pkt_x86->init((uint8_t*)hdr + hdr->tp_mac, hdr->tp_len, of_port_state->attached_sw, get_port_no(), 0);
+	}
+
+	//Handle no payload buffer (jumbo pool exhausted)
+	if(unlikely(res != ROFL_SUCCESS)){
+		stats.rx_dropped();
+		bufferpool::release_buffer(pkt);
+		rx->return_packet(hdr);
+		return NULL;
 	}
 
-	//Timestamp S2	
-	TM_STAMP_STAGE(pkt, TM_S2);
+	STAGE_LATENCY_RX(pkt, lat_ts);
 	classify_packet(&pkt_x86->clas_state, pkt_x86->get_buffer(), pkt_x86->get_buffer_length(), get_port_no(), 0);
+	STAGE_LATENCY_STAMP(pkt, SL_CLASSIFY);
 
 	//Return packet to kernel in the RX ring		
 	rx->return_packet(hdr);
 
 	//Increment statistics&return
-	of_port_state->stats.rx_packets++;
-	of_port_state->stats.rx_bytes += pkt_x86->get_buffer_length();
+	stats.rx_packet(pkt_x86->get_buffer_length());
 	
 	return pkt;
 
@@ -301,7 +321,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 	unsigned int cnt = 0;
 	int tx_bytes_local = 0;
 
-	circular_queue<datapacket_t>* queue = output_queues[q_id];
+	circular_queue<datapacket_t, CQ_MPSC>* queue = output_queues[q_id];
 
 	if ( unlikely(tx == NULL) ) {
 		return num_of_buckets;
@@ -340,7 +360,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 			break;
 		}
 	
-		TM_STAMP_STAGE(pkt, TM_SA6);
+		STAGE_LATENCY_STAMP(pkt, SL_TX_QUEUE);
 		
 		pkt_x86 = (datapacketx86*) pkt->platform_state;
 
@@ -353,8 +373,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 			bufferpool::release_buffer(pkt);
 		
 			//Increment errors
-			of_port_state->queues[q_id].stats.overrun++;
-			of_port_state->stats.tx_dropped++;
+			stats.tx_dropped(q_id);
 			
 			deferred_drain++;
 			continue;
@@ -362,7 +381,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 			fill_tx_slot(hdr, pkt_x86);
 		}
 		
-		TM_STAMP_STAGE(pkt, TM_SA7);
+		STAGE_LATENCY_END(pkt, SL_TX, SL_TOTAL);
 		
 		//Return buffer to the pool
 		bufferpool::release_buffer(pkt);
@@ -381,8 +400,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 		if(unlikely(tx->send() != ROFL_SUCCESS)){
 			ROFL_ERR(DRIVER_NAME"[mmap:%s] ERROR while sending packets. This is due very likely to an invalid ETH_TYPE value. Now the port will be reset in order to continue operation\n", of_port_state->name);
 			assert(0);
-			of_port_state->stats.tx_errors += cnt;
-			of_port_state->queues[q_id].stats.overrun += cnt;
+			stats.tx_errors(q_id, cnt);
 			
 
 			/*
@@ -407,10 +425,7 @@ unsigned int ioport_mmap::write(unsigned int q_id, unsigned int num_of_buckets){
 		}
 
 		//Increment statistics
-		of_port_state->stats.tx_packets += cnt;
-		of_port_state->stats.tx_bytes += tx_bytes_local;
-		of_port_state->queues[q_id].stats.tx_packets += cnt;
-		of_port_state->queues[q_id].stats.tx_bytes += tx_bytes_local;
+		stats.tx_packets(q_id, cnt, tx_bytes_local);
 		
 	}
 
@@ -681,7 +696,7 @@ rofl_result_t ioport_mmap::up() {
 		//If tx/rx lines are not created create them
 		if(!rx){	
 			ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] generating a new mmap_rx for RX\n",of_port_state->name);
-			rx = new mmap_rx(std::string(of_port_state->name), 2 * block_size, n_blocks, frame_size);
+			rx = new_rx();
 		}
 		if(!tx){
 			ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] generating a new mmap_tx for TX\n",of_port_state->name);
@@ -711,7 +726,7 @@ rofl_result_t ioport_mmap::up() {
 	//If tx/rx lines are not created create them
 	if(!rx){	
 		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] generating a new mmap_rx for RX\n",of_port_state->name);
-		rx = new mmap_rx(std::string(of_port_state->name), 2 * block_size, n_blocks, frame_size);
+		rx = new_rx();
 	}
 	if(!tx){
 		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[mmap:%s] generating a new mmap_tx for TX\n",of_port_state->name);
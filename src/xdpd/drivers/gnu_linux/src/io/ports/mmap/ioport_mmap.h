@@ -38,7 +38,7 @@ namespace gnu_linux {
 
 /**
 * @brief GNU/Linux interface access via Memory Mapped
-* region (MMAP) using PF_PACKET TX/RX rings (v2) 
+* region (MMAP) using PF_PACKET TX (v2) and RX (v3 or v2) rings
 *
 * @ingroup driver_gnu_linux_io_ports
 */
@@ -126,7 +126,8 @@ private:
 	static const unsigned int READ=0;
 	static const unsigned int WRITE=1;
 
-	void fill_vlan_pkt(struct tpacket2_hdr *hdr, datapacketx86 *pkt_x86);
+	mmap_rx* new_rx(void);
+	rofl_result_t fill_vlan_pkt(mmap_rx_hdr_t *hdr, datapacketx86 *pkt_x86);
 	void fill_tx_slot(struct tpacket2_hdr *hdr, datapacketx86 *packet);
 	void empty_pipe(void);
 };
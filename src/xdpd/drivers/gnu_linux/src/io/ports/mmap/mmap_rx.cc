@@ -16,6 +16,11 @@ mmap_rx::mmap_rx(
 		sd(-1),
 		//ll_addr(ETH_P_ALL, devname, 0, 0, NULL, 0),
 		rpos(0)
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+		, block(NULL),
+		curr(NULL),
+		frames_left(0)
+#endif
 {
 	int rc = 0;
 	
@@ -105,6 +110,12 @@ mmap_rx::mmap_rx(
 	req.tp_frame_size 	= frame_size; // 2048
 	req.tp_frame_nr 	= req.tp_block_size * req.tp_block_nr / req.tp_frame_size;
 
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	// frames are packed in the blocks; tp_frame_size is only the max. frame size
+	req.tp_retire_blk_tov	= IO_IFACE_MMAP_RX_V3_RETIRE_TOV_MS;
+	req.tp_sizeof_priv	= 0;
+	req.tp_feature_req_word	= 0;
+#endif
 
 	ROFL_DEBUG_VERBOSE(DRIVER_NAME" mmap_rx(%p)::initialize() block-size:%u block-nr:%u frame-size:%u frame-nr:%u\n",
 			this,
@@ -115,8 +126,13 @@ mmap_rx::mmap_rx(
 
 	// todo probe for tpacket-v2 in kernel and go back to tpacket-v1?
 
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	/* setup for the rx-ring tpacket v3 (block based) */
+	int val = TPACKET_V3;
+#else
 	/* setup for the tx/rx-ring tpacket v2 */
 	int val = TPACKET_V2; // to recv. vlan
+#endif
 	if ((rc = setsockopt(sd, SOL_PACKET, PACKET_VERSION,
 			(void *) &val, sizeof(val))) < 0)
 	{
@@ -44,7 +44,25 @@ namespace gnu_linux {
 class eConstructorMmapRx : public rofl::RoflException {};
 
 /**
-* @brief MMAP RX internals (v2)
+* RX frame header; TPACKET_V3 (block based) or TPACKET_V2 (fixed-size slots)
+*/
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+typedef struct tpacket3_hdr mmap_rx_hdr_t;
+#else
+typedef struct tpacket2_hdr mmap_rx_hdr_t;
+#endif
+
+/**
+* @brief MMAP RX internals (v3 or v2)
+*
+* In TPACKET_V3 mode the kernel packs variable-size frames in blocks, and
+* hands over (retires) a block to user-space only when it is full or when the
+* retire timeout expires. Frames are walked within the block, and the whole
+* block is returned to the kernel once its last frame has been returned.
+*
+* In TPACKET_V2 mode every frame uses a fixed-size slot of the ring.
+*
+* Frames MUST be returned (return_packet()) in the same order they were read.
 *
 * @ingroup driver_gnu_linux_io_ports
 */
@@ -62,12 +80,45 @@ private:
 	
 	int sd; // socket descriptor
 	struct sockaddr_ll ll_addr;
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	struct tpacket_req3 req; // ring buffer
+#else
 	struct tpacket_req req; // ring buffer
+#endif
 	//struct iovec *ring; // auxiliary pointers into the mmap'ed area
 
 	//Circular buffer pointer
-	unsigned int rpos; // current position within ring buffer
+	unsigned int rpos; // current position within ring buffer (v2: frame, v3: block)
 
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	//Current block walk
+	struct tpacket_block_desc* block;
+	mmap_rx_hdr_t* curr;
+	unsigned int frames_left;
+
+	inline struct tpacket_block_desc* get_block(unsigned int pos){
+		return (struct tpacket_block_desc*)((uint8_t*)map + pos * req.tp_block_size);
+	}
+
+	//Return the current block to the kernel and move to the next one
+	inline void release_block(void){
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		block = NULL;
+		rpos++;
+		if (rpos == req.tp_block_nr) {
+			rpos = 0;
+		}
+	}
+#endif
+
+	//Log discarded frames
+	inline void log_discarded(mmap_rx_hdr_t* hdr){
+		static unsigned int dropped = 0;
+
+		if( unlikely((dropped++%1000) == 0) ){
+			ROFL_ERR(DRIVER_NAME"[mmap_rx:%s] ERROR: discarded %u frames. Reason(s): %s %s (%u), length: %u. If TP_STATUS_CSUMNOTREADY is the cause, consider disabling RX/TX checksum offloading via ethtool.\n", devname.c_str(), dropped, ((hdr->tp_status&TP_STATUS_COPY) == 0)? "":"TP_STATUS_COPY", ((hdr->tp_status&TP_STATUS_CSUMNOTREADY) == 0)? "":"TP_STATUS_CSUMNOTREADY", hdr->tp_status, hdr->tp_len );
+		}
+	}
 
 public:
 	/**
@@ -81,14 +132,76 @@ public:
 	~mmap_rx(void);
 
 
+#ifdef IO_IFACE_MMAP_RX_TPACKET_V3
+	/**
+	 * Get the next frame of the current block (retrieving the next block
+	 * from the kernel if needed), or NULL if there are none
+	 */
+	inline mmap_rx_hdr_t* read_packet(){
+
+next:
+		if (!block) {
+			struct tpacket_block_desc* b = get_block(rpos);
+
+			/* block still owned by the kernel */
+			if ( (__atomic_load_n(&b->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0 ) {
+				return NULL;
+			}
+
+			block = b;
+			frames_left = block->hdr.bh1.num_pkts;
+			if ( unlikely(frames_left == 0) ) {
+				release_block();
+				goto next;
+			}
+			curr = (mmap_rx_hdr_t*)((uint8_t*)block + block->hdr.bh1.offset_to_first_pkt);
+		}
+
+		//Check if is valid 
+		if( likely( ( curr->tp_status&(TP_STATUS_COPY|TP_STATUS_CSUMNOTREADY) ) == 0 ) ){
+			return curr;
+		}else{
+			//TP_STATUS_COPY or TP_STATUS_CSUMNOTREADY (outgoing) => ignore
+			log_discarded(curr);
+
+			//Skip
+			return_packet(curr);
+			goto next;
+		}
+	}
+	
+	//Return buffer; the block is returned to the kernel after its last frame
+	inline void return_packet(mmap_rx_hdr_t* hdr){
+		assert(hdr == curr);
+
+		if (--frames_left == 0) {
+			release_block();
+			return;
+		}
+		curr = (mmap_rx_hdr_t*)((uint8_t*)hdr + hdr->tp_next_offset);
+	}
+
+	//Check that the frame lays within its block
+	inline bool is_within_bounds(mmap_rx_hdr_t* hdr){
+		return ((uint8_t*)hdr + hdr->tp_mac + hdr->tp_snaplen) <= ((uint8_t*)block + req.tp_block_size);
+	}
+
+	//VLAN tag stripped by the kernel
+	static inline uint16_t get_vlan_tci(mmap_rx_hdr_t* hdr){
+		return hdr->hv1.tp_vlan_tci;
+	}
+	static inline uint16_t get_vlan_tpid(mmap_rx_hdr_t* hdr){
+		return hdr->hv1.tp_vlan_tpid;
+	}
+#else
 	/**
 	 *
 	 */
-	inline struct tpacket2_hdr* read_packet(){
+	inline mmap_rx_hdr_t* read_packet(){
 
-		struct tpacket2_hdr *hdr;
+		mmap_rx_hdr_t *hdr;
 next:  
-		hdr = (struct tpacket2_hdr*)((uint8_t*)map + rpos * req.tp_frame_size);
+		hdr = (mmap_rx_hdr_t*)((uint8_t*)map + rpos * req.tp_frame_size);
 
 		/* treat any status besides kernel as readable */
 		if (TP_STATUS_KERNEL == hdr->tp_status) {
@@ -113,11 +226,7 @@ next:
 			return hdr;
 		}else{
 			//TP_STATUS_COPY or TP_STATUS_CSUMNOTREADY (outgoing) => ignore
-			static unsigned int dropped = 0;
-
-			if( unlikely((dropped++%1000) == 0) ){
-				ROFL_ERR(DRIVER_NAME"[mmap_rx:%s] ERROR: discarded %u frames. Reason(s): %s %s (%u), length: %u. If TP_STATUS_CSUMNOTREADY is the cause, consider disabling RX/TX checksum offloading via ethtool.\n", devname.c_str(), dropped, ((hdr->tp_status&TP_STATUS_COPY) == 0)? "":"TP_STATUS_COPY", ((hdr->tp_status&TP_STATUS_CSUMNOTREADY) == 0)? "":"TP_STATUS_CSUMNOTREADY", hdr->tp_status, hdr->tp_len );
-			}
+			log_discarded(hdr);
 
 			//Skip
 			hdr->tp_status = TP_STATUS_KERNEL;
@@ -126,19 +235,33 @@ next:
 	}
 	
 	//Return buffer
-	inline void return_packet(struct tpacket2_hdr* hdr){
+	inline void return_packet(mmap_rx_hdr_t* hdr){
 		hdr->tp_status = TP_STATUS_KERNEL;
 	}
 
+	//Check that the frame lays within its slot
+	inline bool is_within_bounds(mmap_rx_hdr_t* hdr){
+		return (hdr->tp_mac + hdr->tp_snaplen) <= req.tp_frame_size;
+	}
+
+	//VLAN tag stripped by the kernel
+	static inline uint16_t get_vlan_tci(mmap_rx_hdr_t* hdr){
+		return hdr->tp_vlan_tci;
+	}
+	static inline uint16_t get_vlan_tpid(mmap_rx_hdr_t* hdr){
+		return hdr->tp_vlan_tpid;
+	}
+#endif
+
+	//Link-layer address information of the frame
+	static inline struct sockaddr_ll* get_sll(mmap_rx_hdr_t* hdr){
+		return (struct sockaddr_ll*)((uint8_t*)hdr + TPACKET_ALIGN(sizeof(mmap_rx_hdr_t)));
+	}
+
 	// Get read fds.
 	inline int get_fd(void){
 		return sd;
 	};
-
-	// Get 
-	inline struct tpacket_req* get_tpacket_req(void){
-		return &req;
-	};
 };
 
 }// namespace xdpd::gnu_linux 
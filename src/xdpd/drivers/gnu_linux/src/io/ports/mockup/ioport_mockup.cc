@@ -76,7 +76,11 @@ datapacket_t* ioport_mockup::read(){
 	pkt_x86 = ((datapacketx86*)pkt->platform_state);
 
 	//Init in user space
-	pkt_x86->init(NULL, SIMULATED_PKT_SIZE, of_port_state->attached_sw, of_port_state->of_port_num);
+	if(pkt_x86->init(NULL, SIMULATED_PKT_SIZE, of_port_state->attached_sw, of_port_state->of_port_num) != ROFL_SUCCESS){
+		stats.rx_dropped();
+		bufferpool::release_buffer(pkt);
+		return NULL;
+	}
 	
 	//copy something from stdin to buffer
 	if(::read(input[READ],pkt_x86->get_buffer(),SIMULATED_PKT_SIZE) <0){
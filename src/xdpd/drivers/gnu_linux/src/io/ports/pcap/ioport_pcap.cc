@@ -0,0 +1,296 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ioport_pcap.h"
+#include <time.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <rofl/common/utils/c_logger.h>
+#include "../../bufferpool.h"
+#include "../../iomanager.h"
+#include "../../../util/likely.h"
+
+#include "../../../config.h"
+
+using namespace xdpd::gnu_linux;
+
+static inline uint64_t now_ns(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+}
+
+//Constructor and destructor
+ioport_pcap::ioport_pcap(switch_port_t* of_ps, const pcap_port_conf_t& conf, unsigned int num_queues) :
+			ioport(of_ps, num_queues),
+			conf(conf),
+			replaying(false),
+			next_frame(0),
+			loop(0),
+			replay_start_ns(0),
+			replayed(0){
+
+	replay_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	notify_fd = eventfd(0, EFD_NONBLOCK);
+
+	if(replay_fd < 0 || notify_fd < 0)
+		ROFL_ERR(DRIVER_NAME"[pcap:%s] Unable to create the timerfd/eventfd\n", of_ps->name);
+}
+
+ioport_pcap::~ioport_pcap(){
+	if(writer.is_open())
+		ROFL_INFO(DRIVER_NAME"[pcap:%s] Closing capture file %s\n", of_port_state->name, conf.tx_file.c_str());
+	writer.close();
+	reader.close();
+
+	if(replay_fd != -1)
+		close(replay_fd);
+	if(notify_fd != -1)
+		close(notify_fd);
+}
+
+rofl_result_t ioport_pcap::init(){
+
+	if(replay_fd < 0 || notify_fd < 0)
+		return ROFL_FAILURE;
+
+	if(!conf.rx_file.empty() && reader.open(conf.rx_file.c_str()) != ROFL_SUCCESS)
+		return ROFL_FAILURE;
+
+	if(!conf.tx_file.empty() && conf.tx_file.compare("/dev/null") != 0 && writer.open(conf.tx_file.c_str()) != ROFL_SUCCESS){
+		reader.close();
+		return ROFL_FAILURE;
+	}
+
+	return ROFL_SUCCESS;
+}
+
+inline void ioport_pcap::notify(){
+	int ret;
+	uint64_t c=1;
+	ret = ::write(notify_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+/*
+* Arm the replay timer to expire at abs_ns (CLOCK_MONOTONIC); 0 disarms it. Setting
+* the timer also clears any pending expiration, so the read fd is not readable
+* until the timer expires again
+*/
+inline void ioport_pcap::arm_replay_timer(uint64_t abs_ns){
+	int ret;
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = abs_ns / 1000000000ULL;
+	its.it_value.tv_nsec = abs_ns % 1000000000ULL;
+
+	ret = timerfd_settime(replay_fd, TFD_TIMER_ABSTIME, &its, NULL);
+	(void)ret;
+}
+
+bool ioport_pcap::is_scheduled(){
+	int grp_id;
+
+	grp_id = iomanager::get_group_id_by_port(this, PG_RX);
+	if(grp_id >= 0 && iomanager::get_group(grp_id)->running_ports->contains(this))
+		return true;
+
+	grp_id = iomanager::get_group_id_by_port(this, PG_TX);
+	if(grp_id >= 0 && iomanager::get_group(grp_id)->running_ports->contains(this))
+		return true;
+
+	return false;
+}
+
+void ioport_pcap::start_replay(){
+
+	if(reader.get_num_of_frames() == 0)
+		return;
+
+	next_frame = loop = 0;
+	replayed = 0;
+	replay_start_ns = now_ns();
+	__sync_synchronize();
+	replaying = true;
+
+	//Expire right away; the (expired) timer keeps the read fd readable until
+	//the replay ends or it is re-armed by the rate limiting
+	arm_replay_timer(replay_start_ns);
+
+	ROFL_INFO(DRIVER_NAME"[pcap:%s] Replaying %s (%u frames, %u loops, %llu pps)\n", of_port_state->name, conf.rx_file.c_str(), reader.get_num_of_frames(), conf.loops, (long long unsigned)conf.rate);
+}
+
+void ioport_pcap::stop_replay(){
+
+	if(!replaying)
+		return;
+
+	replaying = false;
+	arm_replay_timer(0);
+}
+
+//Read and write methods over port
+void ioport_pcap::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
+
+	unsigned int len;
+
+	datapacketx86* pkt_x86 = (datapacketx86*) pkt->platform_state;
+	len = pkt_x86->get_buffer_length();
+
+	if( unlikely(!of_port_state->up) ||
+		unlikely(!of_port_state->forward_packets) ||
+		unlikely(len < MIN_PKT_LEN) ||
+		unlikely(q_id >= get_num_of_queues()) ){
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[pcap:%s] dropped packet(%p) scheduled for queue %u\n", of_port_state->name, pkt, q_id);
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+
+	if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS){
+		STAGE_LATENCY_DROP(pkt, SL_TX_QUEUE);
+
+		ROFL_DEBUG(DRIVER_NAME"[pcap:%s] Packet(%p) dropped. Congestion in output queue: %d\n",  of_port_state->name, pkt, q_id);
+		stats.tx_dropped(q_id);
+		bufferpool::release_buffer(pkt);
+
+#ifndef IO_KERN_DONOT_CHANGE_SCHED
+		//Force descheduling (prioritize TX)
+		sched_yield();
+#endif
+		return;
+	}
+
+	//Wake up TX
+	notify();
+}
+
+datapacket_t* ioport_pcap::read(){
+
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+	const pcap_frame_t* frame;
+	uint64_t lat_ts;
+
+	if(unlikely(!replaying) || unlikely(!of_port_state->up) || unlikely(of_port_state->drop_received))
+		return NULL;
+
+	//Rate limiting; park the port until the next frame is due, instead of
+	//leaving the read fd readable (the RX thread would spin)
+	if(conf.rate && (replayed >= (uint64_t)((now_ns() - replay_start_ns) / 1e9 * conf.rate))){
+		arm_replay_timer(replay_start_ns + (uint64_t)((replayed+1) / (double)conf.rate * 1e9) + 1);
+		return NULL;
+	}
+
+	frame = reader.get_frame(next_frame);
+
+	//Stage latency sampling
+	lat_ts = stage_latency::sample();
+
+	//Allocate free buffer
+	pkt = bufferpool::get_buffer();
+	if(unlikely(!pkt)){
+		stats.rx_dropped();
+		return NULL;
+	}
+
+	//Next frame
+	replayed++;
+	if(++next_frame == reader.get_num_of_frames()){
+		next_frame = 0;
+		if(conf.loops && ++loop == conf.loops){
+			stop_replay();
+			ROFL_INFO(DRIVER_NAME"[pcap:%s] Replay of %s finished; %llu packets replayed\n", of_port_state->name, conf.rx_file.c_str(), (long long unsigned)replayed);
+		}
+	}
+
+	pkt_x86 = (datapacketx86*)pkt->platform_state;
+
+	//Copy (frames are read-only); classify afterwards
+	if(unlikely(frame->len < MIN_PKT_LEN) ||
+		unlikely(pkt_x86->init((uint8_t*)frame->data, frame->len, of_port_state->attached_sw, of_port_state->of_port_num, 0, false) != ROFL_SUCCESS)){
+		//Runt or oversized frame
+		stats.rx_dropped();
+		bufferpool::release_buffer(pkt);
+		return NULL;
+	}
+
+	STAGE_LATENCY_RX(pkt, lat_ts);
+	classify_packet(&pkt_x86->clas_state, pkt_x86->get_buffer(), frame->len, of_port_state->of_port_num, 0);
+	STAGE_LATENCY_STAMP(pkt, SL_CLASSIFY);
+
+	stats.rx_packet(frame->len);
+
+	return pkt;
+}
+
+unsigned int ioport_pcap::write(unsigned int q_id, unsigned int num_of_buckets){
+
+	int ret;
+	unsigned int i, len, bytes = 0;
+	uint64_t c;
+	struct timespec ts;
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+
+	ret = ::read(notify_fd, &c, sizeof(c));
+	(void)ret;
+
+	//One time stamp per burst
+	if(writer.is_open())
+		clock_gettime(CLOCK_REALTIME, &ts);
+
+	for(i=0;i<num_of_buckets;++i){
+		pkt = output_queues[q_id]->non_blocking_read();
+
+		if(!pkt)
+			break;
+
+		STAGE_LATENCY_STAMP(pkt, SL_TX_QUEUE);
+
+		pkt_x86 = (datapacketx86*)pkt->platform_state;
+		len = pkt_x86->get_buffer_length();
+
+		if(writer.is_open())
+			writer.write(pkt_x86->get_buffer(), len, &ts);
+		bytes += len;
+
+		STAGE_LATENCY_END(pkt, SL_TX, SL_TOTAL);
+
+		bufferpool::release_buffer(pkt);
+	}
+
+	if(i)
+		stats.tx_packets(q_id, i, bytes);
+
+	//Re-arm if there are still packets pending
+	for(q_id=0; q_id < get_num_of_queues(); ++q_id){
+		if(output_queue_has_packets(q_id)){
+			notify();
+			break;
+		}
+	}
+
+	return num_of_buckets-i;
+}
+
+rofl_result_t ioport_pcap::down(){
+
+	//Stop the I/O threads first; the writer is used by the TX thread
+	if(is_scheduled())
+		return iomanager::bring_port_down(this);
+
+	of_port_state->up = false;
+	stop_replay();
+	writer.flush();
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t ioport_pcap::up(){
+	of_port_state->up = true;
+	start_replay();
+	return ROFL_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef IOPORT_PCAP_H
+#define IOPORT_PCAP_H
+
+#include <string>
+#include <unistd.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/common/datapacket.h>
+#include <rofl/datapath/pipeline/switch_port.h>
+#include "../ioport.h"
+#include "../../datapacketx86.h"
+#include "pcap_file.h"
+
+/**
+* @file ioport_pcap.h
+*
+* @brief Port replaying (RX) and capturing (TX) pcap files
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Configuration of a pcap port
+*/
+typedef struct pcap_port_conf{
+	//Capture to be replayed (RX); empty: nothing is received
+	std::string rx_file;
+
+	//Capture file (TX); empty or /dev/null: packets are only counted
+	std::string tx_file;
+
+	//Replay rate (pps); 0: as fast as possible
+	uint64_t rate;
+
+	//Number of times the capture is replayed; 0: forever
+	unsigned int loops;
+}pcap_port_conf_t;
+
+/**
+* @brief Port replaying a capture file (RX) and capturing the packets sent (TX)
+* to a pcap file, for offline testing (no NICs involved).
+*
+* The RX capture (pcap or pcapng) is mapped and indexed in init(), so no file
+* I/O is performed during the replay. The replay (re)starts when the port is
+* brought up and ends after the configured number of loops. While replaying, the
+* read fd (timerfd) is kept readable, so the RX I/O thread reads from the port
+* continuously. When a rate is configured, the timer is re-armed to the time the
+* next frame is due whenever the port is ahead of the rate.
+*
+* Packets sent (TX) through the port are accounted in the port counters and
+* written to the TX capture file, if any, and returned to the bufferpool.
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class ioport_pcap : public ioport{
+
+public:
+	//ioport_pcap
+	ioport_pcap(switch_port_t* of_ps, const pcap_port_conf_t& conf, unsigned int num_queues=IO_IFACE_NUM_QUEUES);
+
+	virtual
+	~ioport_pcap();
+
+	/**
+	* Load the RX capture and create the TX capture file
+	*/
+	rofl_result_t init(void);
+
+	//Enque packet for transmission
+	virtual void enqueue_packet(datapacket_t* pkt, unsigned int q_id);
+
+	//Non-blocking read and write
+	virtual datapacket_t* read(void);
+
+	virtual unsigned int write(unsigned int q_id, unsigned int num_of_buckets);
+
+	//Get read&write fds. Return -1 if do not exist
+	inline virtual int get_read_fd(void){return replay_fd;};
+	inline virtual int get_write_fd(void){return notify_fd;};
+
+	virtual rofl_result_t down();
+	virtual rofl_result_t up();
+
+	//Number of packets replayed since the port was brought up
+	inline uint64_t get_replayed(void){ return replayed; }
+
+private:
+	//Minimum frame size (ethernet header size)
+	static const unsigned int MIN_PKT_LEN=14;
+
+	pcap_port_conf_t conf;
+
+	//fds
+	int replay_fd;
+	int notify_fd;
+
+	//Files
+	pcap_reader reader;
+	pcap_writer writer;
+
+	//Replay state (RX thread)
+	volatile bool replaying;
+	unsigned int next_frame;
+	unsigned int loop;
+	uint64_t replay_start_ns;
+	uint64_t replayed;
+
+	void start_replay(void);
+	void stop_replay(void);
+	inline void arm_replay_timer(uint64_t abs_ns);
+	bool is_scheduled(void);
+	inline void notify(void);
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* IOPORT_PCAP_H_ */
@@ -0,0 +1,330 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "pcap_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//pcapng block types
+#define PCAPNG_IDB 0x00000001	//Interface description
+#define PCAPNG_PB 0x00000002	//Packet (obsolete)
+#define PCAPNG_SPB 0x00000003	//Simple packet
+#define PCAPNG_EPB 0x00000006	//Enhanced packet
+
+//Header lengths
+#define PCAP_FILE_HDR_LEN 24
+#define PCAP_REC_HDR_LEN 16
+#define PCAPNG_BLOCK_MIN_LEN 12
+
+//Reads a 16/32 bit value in the byte order of the file
+static inline uint32_t rd32(const uint8_t* p, bool swap){
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return (swap)? __builtin_bswap32(v) : v;
+}
+
+static inline uint16_t rd16(const uint8_t* p, bool swap){
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return (swap)? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+/*
+* Reader
+*/
+pcap_reader::pcap_reader() : map(NULL), map_len(0), skipped(0), truncated(0){
+
+}
+
+pcap_reader::~pcap_reader(){
+	close();
+}
+
+void pcap_reader::close(){
+	if(map)
+		munmap((void*)map, map_len);
+	map = NULL;
+	map_len = 0;
+	frames.clear();
+	skipped = truncated = 0;
+}
+
+inline void pcap_reader::add_frame(const uint8_t* data, uint32_t caplen, uint32_t len){
+	pcap_frame_t frame;
+
+	if(caplen == 0)
+		return;
+	if(caplen < len)
+		truncated++;
+
+	frame.data = data;
+	frame.len = caplen;
+	frames.push_back(frame);
+}
+
+rofl_result_t pcap_reader::open(const char* path){
+
+	int fd;
+	struct stat st;
+	uint32_t magic;
+	rofl_result_t res;
+
+	close();
+
+	if((fd = ::open(path, O_RDONLY)) < 0){
+		ROFL_ERR(DRIVER_NAME"[pcap] Unable to open capture file %s: %s\n", path, strerror(errno));
+		return ROFL_FAILURE;
+	}
+
+	if(fstat(fd, &st) < 0 || st.st_size < PCAP_FILE_HDR_LEN){
+		ROFL_ERR(DRIVER_NAME"[pcap] Invalid capture file %s\n", path);
+		::close(fd);
+		return ROFL_FAILURE;
+	}
+
+	map_len = st.st_size;
+	map = (const uint8_t*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	::close(fd);
+
+	if(map == MAP_FAILED){
+		ROFL_ERR(DRIVER_NAME"[pcap] Unable to map capture file %s: %s\n", path, strerror(errno));
+		map = NULL;
+		map_len = 0;
+		return ROFL_FAILURE;
+	}
+
+	memcpy(&magic, map, sizeof(magic));
+
+	if(magic == PCAPNG_SHB)
+		res = index_pcapng(path);
+	else
+		res = index_pcap(path);
+
+	if(res != ROFL_SUCCESS){
+		close();
+		return ROFL_FAILURE;
+	}
+
+	if(frames.empty()){
+		ROFL_ERR(DRIVER_NAME"[pcap] No Ethernet frames found in capture file %s\n", path);
+		close();
+		return ROFL_FAILURE;
+	}
+
+	ROFL_INFO(DRIVER_NAME"[pcap] Loaded %u frames from %s (%u truncated, %u skipped)\n", get_num_of_frames(), path, truncated, skipped);
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t pcap_reader::index_pcap(const char* path){
+
+	bool swap;
+	uint32_t magic, linktype, caplen, len;
+	size_t off;
+
+	memcpy(&magic, map, sizeof(magic));
+
+	if(magic == PCAP_MAGIC || magic == PCAP_MAGIC_NS){
+		swap = false;
+	}else if(__builtin_bswap32(magic) == PCAP_MAGIC || __builtin_bswap32(magic) == PCAP_MAGIC_NS){
+		swap = true;
+	}else{
+		ROFL_ERR(DRIVER_NAME"[pcap] %s is not a pcap or pcapng file\n", path);
+		return ROFL_FAILURE;
+	}
+
+	linktype = rd32(map+20, swap) & 0x0FFFFFFF;
+	if(linktype != LINKTYPE_ETHERNET){
+		ROFL_ERR(DRIVER_NAME"[pcap] Unsupported link type %u in %s; only Ethernet captures are supported\n", linktype, path);
+		return ROFL_FAILURE;
+	}
+
+	for(off = PCAP_FILE_HDR_LEN; off + PCAP_REC_HDR_LEN <= map_len; ){
+		caplen = rd32(map+off+8, swap);
+		len = rd32(map+off+12, swap);
+		off += PCAP_REC_HDR_LEN;
+
+		if(caplen > map_len - off){
+			ROFL_WARN(DRIVER_NAME"[pcap] WARNING: capture file %s is truncated; ignoring the last record\n", path);
+			break;
+		}
+
+		add_frame(map+off, caplen, len);
+		off += caplen;
+	}
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t pcap_reader::index_pcapng(const char* path){
+
+	bool swap = false;
+	uint32_t type, block_len, iface, caplen, len;
+	size_t off;
+	const uint8_t* b;
+
+	//Link type of the interfaces of the current section
+	std::vector<uint16_t> ifaces;
+
+	for(off = 0; off + PCAPNG_BLOCK_MIN_LEN <= map_len; off += block_len){
+		b = map + off;
+		type = rd32(b, false);
+
+		//Section header; (re)sets the byte order and the interfaces
+		if(type == PCAPNG_SHB){
+			if(off + PCAPNG_BLOCK_MIN_LEN + 4 > map_len)
+				break;
+			if(rd32(b+8, false) == PCAPNG_BYTE_ORDER_MAGIC){
+				swap = false;
+			}else if(rd32(b+8, true) == PCAPNG_BYTE_ORDER_MAGIC){
+				swap = true;
+			}else{
+				ROFL_ERR(DRIVER_NAME"[pcap] Invalid pcapng section header in %s\n", path);
+				return ROFL_FAILURE;
+			}
+			ifaces.clear();
+		}else{
+			type = rd32(b, swap);
+		}
+
+		block_len = rd32(b+4, swap);
+		if(block_len < PCAPNG_BLOCK_MIN_LEN || (block_len & 0x3) || block_len > map_len - off){
+			ROFL_WARN(DRIVER_NAME"[pcap] WARNING: capture file %s is truncated or corrupted; ignoring the rest of the file\n", path);
+			break;
+		}
+
+		switch(type){
+			case PCAPNG_IDB:
+				if(block_len < 20)
+					break;
+				ifaces.push_back(rd16(b+8, swap));
+				break;
+
+			case PCAPNG_EPB:
+				if(block_len < 32)
+					break;
+				iface = rd32(b+8, swap);
+				caplen = rd32(b+20, swap);
+				len = rd32(b+24, swap);
+				if(caplen > block_len - 32)
+					break;
+				if(iface >= ifaces.size() || ifaces[iface] != LINKTYPE_ETHERNET){
+					skipped++;
+					break;
+				}
+				add_frame(b+28, caplen, len);
+				break;
+
+			case PCAPNG_SPB:
+				//Always interface 0; captured length is implicit
+				if(block_len < 16)
+					break;
+				len = rd32(b+8, swap);
+				caplen = (len < block_len - 16)? len : block_len - 16;
+				if(ifaces.empty() || ifaces[0] != LINKTYPE_ETHERNET){
+					skipped++;
+					break;
+				}
+				add_frame(b+12, caplen, len);
+				break;
+
+			case PCAPNG_PB:
+				if(block_len < 32)
+					break;
+				iface = rd16(b+8, swap);
+				caplen = rd32(b+20, swap);
+				len = rd32(b+24, swap);
+				if(caplen > block_len - 32)
+					break;
+				if(iface >= ifaces.size() || ifaces[iface] != LINKTYPE_ETHERNET){
+					skipped++;
+					break;
+				}
+				add_frame(b+28, caplen, len);
+				break;
+
+			default:
+				//Statistics, name resolution, custom blocks...
+				break;
+		}
+	}
+
+	return ROFL_SUCCESS;
+}
+
+/*
+* Writer
+*/
+pcap_writer::pcap_writer() : f(NULL), buf(NULL){
+
+}
+
+pcap_writer::~pcap_writer(){
+	close();
+}
+
+rofl_result_t pcap_writer::open(const char* path){
+
+	struct{
+		uint32_t magic;
+		uint16_t version_major;
+		uint16_t version_minor;
+		int32_t thiszone;
+		uint32_t sigfigs;
+		uint32_t snaplen;
+		uint32_t linktype;
+	}hdr;
+
+	close();
+
+	if(!(f = fopen(path, "w"))){
+		ROFL_ERR(DRIVER_NAME"[pcap] Unable to create capture file %s: %s\n", path, strerror(errno));
+		return ROFL_FAILURE;
+	}
+
+	buf = (char*)malloc(IO_IFACE_PCAP_TX_BUFFER_SIZE);
+	if(buf)
+		setvbuf(f, buf, _IOFBF, IO_IFACE_PCAP_TX_BUFFER_SIZE);
+
+	//File header (native byte order)
+	hdr.magic = pcap_reader::PCAP_MAGIC;
+	hdr.version_major = 2;
+	hdr.version_minor = 4;
+	hdr.thiszone = 0;
+	hdr.sigfigs = 0;
+	hdr.snaplen = SNAPLEN;
+	hdr.linktype = pcap_reader::LINKTYPE_ETHERNET;
+
+	if(fwrite(&hdr, sizeof(hdr), 1, f) != 1){
+		ROFL_ERR(DRIVER_NAME"[pcap] Unable to write to capture file %s: %s\n", path, strerror(errno));
+		close();
+		return ROFL_FAILURE;
+	}
+
+	return ROFL_SUCCESS;
+}
+
+void pcap_writer::flush(){
+	if(f)
+		fflush(f);
+}
+
+void pcap_writer::close(){
+	if(f)
+		fclose(f);
+	f = NULL;
+
+	//Must be freed after fclose()
+	free(buf);
+	buf = NULL;
+}
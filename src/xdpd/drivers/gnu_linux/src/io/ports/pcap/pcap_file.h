@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef PCAP_FILE_H
+#define PCAP_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <vector>
+#include <rofl_datapath.h>
+
+#include "../../../config.h"
+
+/**
+* @file pcap_file.h
+*
+* @brief pcap/pcapng capture file reader and pcap writer (no libpcap needed)
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Frame of a capture file
+*/
+typedef struct pcap_frame{
+	const uint8_t* data;
+	uint32_t len; //Captured length
+}pcap_frame_t;
+
+/**
+* @brief Capture file reader (pcap, both microsecond and nanosecond resolution, and pcapng)
+*
+* The whole file is mapped (read-only) and indexed on open(), so that frames
+* can be replayed without any file I/O. Only Ethernet (LINKTYPE_ETHERNET)
+* frames are indexed; frames of other link types are skipped. Truncated
+* frames (captured length < original length) are indexed with the captured length.
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class pcap_reader{
+
+public:
+	pcap_reader(void);
+	~pcap_reader(void);
+
+	/**
+	* Map and index the file
+	*/
+	rofl_result_t open(const char* path);
+
+	/**
+	* Unmap the file. Frames are no longer valid afterwards
+	*/
+	void close(void);
+
+	inline unsigned int get_num_of_frames(void) const { return frames.size(); }
+	inline const pcap_frame_t* get_frame(unsigned int i) const { return &frames[i]; }
+
+	//Frames not indexed (unsupported link type) and truncated frames
+	inline unsigned int get_num_of_skipped(void) const { return skipped; }
+	inline unsigned int get_num_of_truncated(void) const { return truncated; }
+
+	//File formats
+	static const uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+	static const uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+	static const uint32_t PCAPNG_SHB = 0x0a0d0d0a;
+	static const uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+	static const uint32_t LINKTYPE_ETHERNET = 1;
+
+private:
+	const uint8_t* map;
+	size_t map_len;
+	std::vector<pcap_frame_t> frames;
+	unsigned int skipped;
+	unsigned int truncated;
+
+	void add_frame(const uint8_t* data, uint32_t caplen, uint32_t len);
+	rofl_result_t index_pcap(const char* path);
+	rofl_result_t index_pcapng(const char* path);
+};
+
+/**
+* @brief pcap (microsecond resolution, Ethernet) capture file writer.
+*
+* Records are buffered (IO_IFACE_PCAP_TX_BUFFER_SIZE) and written to the file
+* when the buffer is full and on flush(). Not thread-safe.
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class pcap_writer{
+
+public:
+	pcap_writer(void);
+	~pcap_writer(void);
+
+	/**
+	* Create (truncate) the file and write the file header
+	*/
+	rofl_result_t open(const char* path);
+	void close(void);
+
+	inline bool is_open(void) const { return f != NULL; }
+
+	/**
+	* Write a frame record
+	*/
+	inline void write(const uint8_t* data, uint32_t len, const struct timespec* ts){
+		uint32_t rec[4];
+
+		rec[0] = ts->tv_sec;
+		rec[1] = ts->tv_nsec/1000;
+		rec[2] = (len > SNAPLEN)? SNAPLEN : len;
+		rec[3] = len;
+
+		fwrite(rec, sizeof(rec), 1, f);
+		fwrite(data, rec[2], 1, f);
+	}
+
+	void flush(void);
+
+	static const uint32_t SNAPLEN = 65535;
+
+private:
+	FILE* f;
+	char* buf;
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* PCAP_FILE_H_ */
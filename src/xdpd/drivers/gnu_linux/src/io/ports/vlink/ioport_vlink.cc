@@ -7,8 +7,22 @@
 
 #include "../../../config.h"
 
+//Make sure pipeline-imp are BEFORE _pp.h
+//so that functions can be inlined
+#include "../../../pipeline-imp/atomic_operations.h"
+#include "../../../pipeline-imp/pthread_lock.h"
+#include "../../../pipeline-imp/packet.h"
+
+#include <rofl/datapath/pipeline/openflow/of_switch_pp.h>
+
 using namespace xdpd::gnu_linux;
 
+//Run-to-completion context (only set in RX I/O threads)
+__thread int ioport_vlink::rtc_grp_id = -1;
+__thread unsigned int ioport_vlink::rtc_tid = ROFL_PIPELINE_LOCKED_TID;
+__thread unsigned int ioport_vlink::rtc_depth = 0;
+__thread of_switch_t* ioport_vlink::rtc_sws[IO_VLINK_RTC_MAX_DEPTH];
+
 //Constructor and destructor
 ioport_vlink::ioport_vlink(switch_port_t* of_ps, unsigned int num_queues) : ioport(of_ps,num_queues), 
 	deferred_drain_rx(0),
@@ -48,6 +62,67 @@ void ioport_vlink::set_connected_port(ioport_vlink* c_port){
 	connected_port = c_port;
 }
 
+void ioport_vlink::set_thread_rtc_context(int grp_id, unsigned int tid){
+	rtc_grp_id = grp_id;
+	rtc_tid = tid;
+	rtc_depth = 0;
+}
+
+/*
+* Process the packet in the peer LSI within the calling thread, if it is the
+* RX thread of the peer port. Returns false if the packet has to go through
+* the queues.
+*/
+inline bool ioport_vlink::run_to_completion(datapacket_t* pkt, unsigned int q_id, unsigned int len){
+
+#ifdef IO_VLINK_RUN_TO_COMPLETION
+	unsigned int i, depth;
+	of_switch_t* sw;
+	ioport_vlink* peer = connected_port;
+
+	if(rtc_grp_id < 0 || unlikely(!peer) || peer->rx_group_id != rtc_grp_id)
+		return false;
+
+	//Chain too long (at depth 0, the LSI of the RX port is pushed too)
+	depth = rtc_depth;
+	if(depth + ((depth)? 1 : 2) > IO_VLINK_RTC_MAX_DEPTH)
+		return false;
+
+	//Packets in flight through the queues must not be overtaken
+	if(!output_queues[q_id]->is_empty() || !peer->input_queue->is_empty())
+		return false;
+
+	sw = peer->of_port_state->attached_sw;
+	if(unlikely(!sw) || unlikely(peer->of_port_state->up == false))
+		return false;
+
+	//Never re-enter an LSI that this thread is already processing, including
+	//the one the packet was received in (bottom of the stack)
+	if(sw == of_port_state->attached_sw)
+		return false;
+	for(i=0;i<depth;++i){
+		if(rtc_sws[i] == sw)
+			return false;
+	}
+
+	//TX on this edge, RX on the peer
+	stats.tx_packets(q_id, 1, len);
+	((datapacketx86*)pkt->platform_state)->clas_state.port_in = peer->of_port_state->of_port_num;
+	peer->stats.rx_packet(len);
+	STAGE_LATENCY_STAMP(pkt, SL_VLINK);
+
+	if(!depth)
+		rtc_sws[rtc_depth++] = of_port_state->attached_sw;
+	rtc_sws[rtc_depth++] = sw;
+	of_process_packet_pipeline(rtc_tid, sw, pkt);
+	rtc_depth = depth;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
 //Read and write methods over port
 void ioport_vlink::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
 	
@@ -69,9 +144,15 @@ void ioport_vlink::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
 			bufferpool::release_buffer(pkt);
 			assert(0);
 		}
+
+		//Process it in the peer LSI, if possible
+		if(run_to_completion(pkt, q_id, len))
+			return;
 	
 		//Store on queue and exit. This is NOT copying it to the vlink buffer
 		if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS){
+			STAGE_LATENCY_DROP(pkt, SL_VLINK);
+
 			ROFL_DEBUG(DRIVER_NAME"[vlink:%s] Packet(%p) dropped. Congestion in output queue: %d\n",  of_port_state->name, pkt, q_id);
 			//Drop packet
 			bufferpool::release_buffer(pkt);
@@ -138,10 +219,10 @@ datapacket_t* ioport_vlink::read(){
 		empty_pipe(rx_notify_pipe, &deferred_drain_rx);
 		//FIXME statistics
 		pkt_x86->clas_state.port_in = of_port_state->of_port_num;
+		STAGE_LATENCY_STAMP(pkt, SL_VLINK);
 
 		//Increment statistics&return
-		of_port_state->stats.rx_packets++;
-		of_port_state->stats.rx_bytes += pkt_x86->get_buffer_length();
+		stats.rx_packet(pkt_x86->get_buffer_length());
 	}
 
 	return pkt;
@@ -154,7 +235,7 @@ unsigned int ioport_vlink::write(unsigned int q_id, unsigned int num_of_buckets)
 	unsigned int cnt = 0;
 	int tx_bytes_local = 0;
 
-	circular_queue<datapacket_t>* queue = output_queues[q_id];
+	circular_queue<datapacket_t, CQ_MPSC>* queue = output_queues[q_id];
 
 	// read available packets from incoming buffer
 	for ( ; 0 < num_of_buckets; --num_of_buckets ) {
@@ -171,10 +252,10 @@ unsigned int ioport_vlink::write(unsigned int q_id, unsigned int num_of_buckets)
 		if(connected_port->tx_pkt(pkt) != ROFL_SUCCESS){
 		
 			//Increment errors
-			of_port_state->queues[q_id].stats.overrun++;
-			of_port_state->stats.tx_dropped++;
+			stats.tx_dropped(q_id);
 	
 			//Congestion in the input queue of the vlink, drop
+			STAGE_LATENCY_DROP(pkt, SL_VLINK);
 			bufferpool::release_buffer(pkt);
 			continue;
 		}
@@ -185,10 +266,8 @@ unsigned int ioport_vlink::write(unsigned int q_id, unsigned int num_of_buckets)
 		
 
 	//Increment statistics
-	of_port_state->stats.tx_packets += cnt;
-	of_port_state->stats.tx_bytes += tx_bytes_local;
-	of_port_state->queues[q_id].stats.tx_packets += cnt;
-	of_port_state->queues[q_id].stats.tx_bytes += tx_bytes_local;
+	if(likely(cnt > 0))
+		stats.tx_packets(q_id, cnt, tx_bytes_local);
 
 	//Empty reading pipe (batch)
 	empty_pipe(tx_notify_pipe, &deferred_drain_tx);
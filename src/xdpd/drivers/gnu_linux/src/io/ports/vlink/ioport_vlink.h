@@ -66,6 +66,14 @@ public:
 	* Reference to the other edge (connected ioport)
 	*/
 	ioport_vlink* connected_port;
+
+	/**
+	* Set the run-to-completion context of the calling RX I/O thread (portgroup
+	* and pipeline tid). Packets enqueued by this thread in a vlink whose peer
+	* port belongs to the same RX portgroup are processed straight away in the
+	* peer LSI (see IO_VLINK_RUN_TO_COMPLETION).
+	*/
+	static void set_thread_rtc_context(int grp_id, unsigned int tid);
 	
 protected:
 	//fds
@@ -84,6 +92,15 @@ protected:
 	static const unsigned int MIN_PKT_LEN=14;
 	
 	void empty_pipe(int* pipe, int* deferred_drain);
+
+	//Run-to-completion
+	inline bool run_to_completion(datapacket_t* pkt, unsigned int q_id, unsigned int len);
+
+	//Run-to-completion context of the thread
+	static __thread int rtc_grp_id;
+	static __thread unsigned int rtc_tid;
+	static __thread unsigned int rtc_depth;
+	static __thread of_switch_t* rtc_sws[IO_VLINK_RTC_MAX_DEPTH]; //LSIs being processed
 };
 
 }// namespace xdpd::gnu_linux 
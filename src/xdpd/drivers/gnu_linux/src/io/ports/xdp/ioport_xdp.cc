@@ -0,0 +1,610 @@
+#include "ioport_xdp.h"
+
+#ifdef HAVE_AF_XDP
+
+#include <errno.h>
+#include <string.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <linux/if.h>
+#include <linux/sockios.h>
+#include <linux/ethtool.h>
+#include <linux/bpf.h>
+#include "../../bufferpool.h"
+#include "../../datapacketx86.h"
+#include "../../iomanager.h"
+#include "../../../util/likely.h"
+
+#include <rofl/common/utils/c_logger.h>
+#include <rofl/common/protocols/fetherframe.h>
+
+#include "../../../config.h"
+
+using namespace rofl;
+using namespace xdpd::gnu_linux;
+
+#define PORT_ETHER_LENGTH 18
+#define PORT_DEFAULT_PKT_SIZE 1518
+
+//Max frame size that fits in a UMEM frame (RX)
+#define XDP_MAX_PKT_SIZE (IO_IFACE_XDP_FRAME_SIZE-XDP_PACKET_HEADROOM)
+
+//Constructor and destructor
+ioport_xdp::ioport_xdp(switch_port_t* of_ps, bool native, unsigned int num_queues) :
+			ioport(of_ps, num_queues),
+			native(native),
+			xsk(NULL),
+			rx_since_refill(0),
+			tx_waiting(false)
+{
+	struct epoll_event ev;
+
+	//TX notification
+	notify_fd = eventfd(0, EFD_NONBLOCK);
+	retry_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	tx_epfd = epoll_create1(0);
+
+	if(notify_fd < 0 || retry_fd < 0 || tx_epfd < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to create TX notification fds\n", of_ps->name);
+		return;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = notify_fd;
+	epoll_ctl(tx_epfd, EPOLL_CTL_ADD, notify_fd, &ev);
+	ev.data.fd = retry_fd;
+	epoll_ctl(tx_epfd, EPOLL_CTL_ADD, retry_fd, &ev);
+}
+
+ioport_xdp::~ioport_xdp(){
+	if(xsk)
+		delete xsk;
+
+	if(tx_epfd != -1)
+		close(tx_epfd);
+	if(retry_fd != -1)
+		close(retry_fd);
+	if(notify_fd != -1)
+		close(notify_fd);
+}
+
+inline void ioport_xdp::notify(){
+	int ret;
+	uint64_t c=1;
+	ret = ::write(notify_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+/*
+* Start or stop waiting for room in the TX ring (see get_write_fd())
+*/
+inline void ioport_xdp::wait_for_tx_room(bool wait){
+
+	struct epoll_event ev;
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+
+	if(!wait){
+		if(likely(!tx_waiting))
+			return;
+
+		if(xsk && xsk->is_zero_copy())
+			epoll_ctl(tx_epfd, EPOLL_CTL_DEL, xsk->get_fd(), NULL);
+		else
+			timerfd_settime(retry_fd, 0, &its, NULL); //Disarm
+		tx_waiting = false;
+		return;
+	}
+
+	if(xsk->is_zero_copy()){
+		//The NIC drains the ring by itself; wait until it is writable
+		if(!tx_waiting){
+			memset(&ev, 0, sizeof(ev));
+			ev.events = EPOLLOUT;
+			ev.data.fd = xsk->get_fd();
+			epoll_ctl(tx_epfd, EPOLL_CTL_ADD, xsk->get_fd(), &ev);
+		}
+	}else{
+		//(Re)arm; clears the previous expiration
+		its.it_value.tv_nsec = IO_IFACE_XDP_TX_RETRY_US*1000;
+		timerfd_settime(retry_fd, 0, &its, NULL);
+	}
+
+	tx_waiting = true;
+}
+
+/*
+* Consume the pending TX notifications, and re-arm them if there are still
+* packets in the output queues (e.g. no buckets left). If they are held back
+* by a full TX ring, wait for room in it instead, so that the TX thread does
+* not spin until the kernel completes descriptors.
+*/
+inline void ioport_xdp::consume_notifications(){
+	int ret;
+	unsigned int q_id;
+	uint64_t c;
+
+	ret = ::read(notify_fd, &c, sizeof(c));
+	if(tx_waiting)
+		ret = ::read(retry_fd, &c, sizeof(c)); //Expirations, if any
+	(void)ret;
+
+	for(q_id=0; q_id < get_num_of_queues(); ++q_id){
+		if(output_queue_has_packets(q_id))
+			break;
+	}
+
+	//Nothing left
+	if(q_id == get_num_of_queues()){
+		wait_for_tx_room(false);
+		return;
+	}
+
+	if(xsk && !xsk->has_free_slot()){
+		//Kick it; in copy mode this may free slots right away
+		xsk->send();
+		if(!xsk->has_free_slot()){
+			wait_for_tx_room(true);
+			return;
+		}
+	}
+
+	wait_for_tx_room(false);
+	notify();
+}
+
+/*
+* Hand free frames to the kernel (fill ring). Only the frames actually handed
+* are discounted, so that it is retried if the UMEM runs short of free frames
+*/
+inline void ioport_xdp::refill(){
+	unsigned int n = xsk->refill();
+	rx_since_refill = (n < rx_since_refill)? rx_since_refill-n : 0;
+}
+
+/*
+* Check whether the port is still scheduled in an RX or TX portgroup
+*/
+bool ioport_xdp::is_scheduled(){
+	int grp_id;
+
+	grp_id = iomanager::get_group_id_by_port(this, PG_RX);
+	if(grp_id >= 0 && iomanager::get_group(grp_id)->running_ports->contains(this))
+		return true;
+
+	grp_id = iomanager::get_group_id_by_port(this, PG_TX);
+	if(grp_id >= 0 && iomanager::get_group(grp_id)->running_ports->contains(this))
+		return true;
+
+	return false;
+}
+
+//Read and write methods over port
+void ioport_xdp::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
+
+	unsigned int len;
+
+	datapacketx86* pkt_x86 = (datapacketx86*) pkt->platform_state;
+	len = pkt_x86->get_buffer_length();
+
+	if ( likely(of_port_state->up) &&
+		likely(of_port_state->forward_packets) &&
+		likely(len >= MIN_PKT_LEN) ) {
+
+		//Safe check for q_id
+		if( unlikely(q_id >= get_num_of_queues()) ){
+			ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Packet(%p) trying to be enqueued in an invalid q_id: %u\n",  of_port_state->name, pkt, q_id);
+			q_id = 0;
+			bufferpool::release_buffer(pkt);
+			assert(0);
+		}
+
+		//Store on queue and exit. This is NOT copying it to the UMEM
+		if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS){
+			STAGE_LATENCY_DROP(pkt, SL_TX_QUEUE);
+
+			ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Packet(%p) dropped. Congestion in output queue: %d\n",  of_port_state->name, pkt, q_id);
+			//Drop packet
+			bufferpool::release_buffer(pkt);
+
+#ifndef IO_KERN_DONOT_CHANGE_SCHED
+			//Force descheduling (prioritize TX)
+			sched_yield();
+#endif
+			return;
+		}
+
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] Packet(%p) enqueued, buffer size: %d\n",  of_port_state->name, pkt, output_queues[q_id]->size());
+
+		//Wake up TX
+		notify();
+	} else {
+		if(len < MIN_PKT_LEN){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] ERROR: attempt to send invalid packet size for packet(%p) scheduled for queue %u. Packet size: %u\n", of_port_state->name, pkt, q_id, len);
+			assert(0);
+		}else{
+			ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] dropped packet(%p) scheduled for queue %u\n", of_port_state->name, pkt, q_id);
+		}
+
+		//Drop packet
+		bufferpool::release_buffer(pkt);
+	}
+}
+
+// handle read
+datapacket_t* ioport_xdp::read(){
+
+	struct xdp_desc* desc;
+	datapacket_t *pkt;
+	datapacketx86 *pkt_x86;
+	uint8_t* frame, *data;
+	uint32_t len;
+	uint64_t lat_ts;
+
+	//Check if we really have to read
+	if(!of_port_state->up || of_port_state->drop_received || !xsk)
+		return NULL;
+
+next:
+	//Retrieve a packet
+	desc = xsk->read_packet();
+
+	//No packets available; give the kernel the frames back
+	if(!desc){
+		if(rx_since_refill)
+			refill();
+		return NULL;
+	}
+
+	data = xdp_umem::get_ptr(desc->addr);
+	len = desc->len;
+
+	//The frame is now ours
+	frame = xsk->return_packet(desc);
+
+	//Retried on every frame while the UMEM is short of free frames
+	if(unlikely(++rx_since_refill >= REFILL_THRESHOLD))
+		refill();
+
+	//Sanity check
+	if( unlikely(len < MIN_PKT_LEN) ){
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] sanity check during read failed\n",of_port_state->name);
+		stats.rx_dropped();
+		xdp_umem::release_frame(frame);
+		return NULL;
+	}
+
+	//Discard frames generated by the switch or the OS (feedback)
+	if( unlikely(memcmp(((struct fetherframe::eth_hdr_t*)data)->dl_src, mac, ETHER_MAC_LEN) == 0) ){
+		xdp_umem::release_frame(frame);
+		goto next;
+	}
+
+	//Stage latency sampling
+	lat_ts = stage_latency::sample();
+
+	//Retrieve buffer from pool: this is a non-blocking call
+	pkt = bufferpool::get_buffer();
+
+	//Handle no free buffer
+	if(!pkt) {
+		//Increment error statistics and drop
+		stats.rx_dropped();
+		xdp_umem::release_frame(frame);
+		return NULL;
+	}
+
+	pkt_x86 = (datapacketx86*) pkt->platform_state;
+
+	//Attach the frame to the packet (no copy); classify afterwards
+	if(unlikely(pkt_x86->init(data, len, of_port_state->attached_sw, get_port_no(), 0, false, false) != ROFL_SUCCESS)){
+		stats.rx_dropped();
+		bufferpool::release_buffer(pkt);
+		xdp_umem::release_frame(frame);
+		return NULL;
+	}
+	pkt_x86->set_nic_buffer(frame, xdp_umem::release_frame);
+
+	STAGE_LATENCY_RX(pkt, lat_ts);
+	classify_packet(&pkt_x86->clas_state, pkt_x86->get_buffer(), pkt_x86->get_buffer_length(), get_port_no(), 0);
+	STAGE_LATENCY_STAMP(pkt, SL_CLASSIFY);
+
+	//Increment statistics&return
+	stats.rx_packet(len);
+
+	return pkt;
+}
+
+unsigned int ioport_xdp::write(unsigned int q_id, unsigned int num_of_buckets){
+
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+	uint8_t* frame;
+	unsigned int cnt = 0;
+	unsigned int len;
+	int tx_bytes_local = 0;
+
+	circular_queue<datapacket_t, CQ_MPSC>* queue = output_queues[q_id];
+
+	if ( unlikely(xsk == NULL) ) {
+		return num_of_buckets;
+	}
+
+	//Return transmitted frames to the UMEM
+	xsk->reap_completions();
+
+	// read available packets from incoming buffer
+	for ( ; 0 < num_of_buckets; --num_of_buckets ) {
+
+		//Check
+		if(queue->size() == 0){
+			ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] no packet left in output_queue %u left, %u buckets left\n",
+					of_port_state->name,
+					q_id,
+					num_of_buckets);
+			break;
+		}
+
+		//Skip, TX is full
+		if(!xsk->has_free_slot())
+			break;
+
+		//Retrieve the buffer
+		pkt = queue->non_blocking_read();
+
+		if(!pkt){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] A packet has been discarded due to race condition on the output queue. Are you really running the TX group with a single thread? output_queue %u left, %u buckets left\n",
+				of_port_state->name,
+				q_id,
+				num_of_buckets);
+
+			assert(0);
+			break;
+		}
+
+		STAGE_LATENCY_STAMP(pkt, SL_TX_QUEUE);
+
+		pkt_x86 = (datapacketx86*) pkt->platform_state;
+		len = pkt_x86->get_buffer_length();
+
+		if(unlikely(len > mps)){
+			//This should NEVER happen
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] Packet length above the Max Packet Size (MPS). Packet length: %u, MPS %u.. discarding\n", of_port_state->name, len, mps);
+			assert(0);
+
+			//Return buffer to the pool
+			bufferpool::release_buffer(pkt);
+
+			//Increment errors
+			stats.tx_dropped(q_id);
+			continue;
+		}
+
+		if(pkt_x86->get_buffering_status() == X86_DATAPACKET_BUFFERED_IN_NIC &&
+			pkt_x86->get_nic_buffer() &&
+			pkt_x86->get_nic_buffer_release() == xdp_umem::release_frame){
+			//Still in a UMEM frame; send it as is. The frame goes back to the UMEM on completion
+			pkt_x86->detach_nic_buffer();
+			xsk->fill_tx_slot(pkt_x86->get_buffer(), len);
+		}else{
+			//Copy it to a free frame
+			frame = xdp_umem::get_frame();
+
+			if(unlikely(!frame)){
+				ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] No free UMEM frames; dropping packet(%p)\n", of_port_state->name, pkt);
+				bufferpool::release_buffer(pkt);
+				stats.tx_dropped(q_id);
+				continue;
+			}
+
+			memcpy(frame, pkt_x86->get_buffer(), len);
+			xsk->fill_tx_slot(frame, len);
+		}
+
+		STAGE_LATENCY_END(pkt, SL_TX, SL_TOTAL);
+
+		//Return buffer to the pool
+		bufferpool::release_buffer(pkt);
+
+		tx_bytes_local += len;
+		cnt++;
+	}
+
+	//Increment stats and return
+	if (likely(cnt > 0)) {
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] schedule %u packet(s) to be send\n", of_port_state->name, cnt);
+
+		// send packets in TX
+		if(unlikely(xsk->send() != ROFL_SUCCESS)){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] ERROR while sending packets: %s\n", of_port_state->name, strerror(errno));
+			stats.tx_errors(q_id, cnt);
+		}else{
+			//Increment statistics
+			stats.tx_packets(q_id, cnt, tx_bytes_local);
+		}
+	}
+
+	consume_notifications();
+
+	// return not used buckets
+	return num_of_buckets;
+}
+
+/*
+*
+* Enable and down port routines
+*
+*/
+rofl_result_t ioport_xdp::up() {
+
+	struct ifreq ifr;
+	struct ethtool_value eval;
+	struct ethtool_channels channels;
+	int sd, rc;
+
+	ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Trying to bring up\n",of_port_state->name);
+
+	if ((sd = socket(AF_PACKET, SOCK_RAW, 0)) < 0){
+		return ROFL_FAILURE;
+	}
+
+	/*
+	* Make sure Large Receive Offload and RX VLAN stripping are disabled;
+	* XDP programs cannot be attached with LRO and VLAN tags would be lost
+	*/
+	memset(&ifr, 0, sizeof(struct ifreq));
+	strncpy(ifr.ifr_name, of_port_state->name, sizeof(ifr.ifr_name)-1);
+	eval.cmd = ETHTOOL_GFLAGS;
+	eval.data = 0;
+	ifr.ifr_data = (caddr_t)&eval;
+
+	if (ioctl(sd, SIOCETHTOOL, &ifr) < 0) {
+		ROFL_WARN(DRIVER_NAME"[xdp:%s] Unable to detect if LRO and RX VLAN offload features on the NIC are enabled or not. Please make sure they are disabled using ethtool or similar...\n", of_port_state->name);
+	} else if (eval.data & (ETH_FLAG_LRO|ETH_FLAG_RXVLAN)) {
+		eval.cmd = ETHTOOL_SFLAGS;
+		eval.data &= ~(ETH_FLAG_LRO|ETH_FLAG_RXVLAN);
+		ifr.ifr_data = (caddr_t)&eval;
+
+		if (ioctl(sd, SIOCETHTOOL, &ifr) < 0)
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] Could not disable LRO and RX VLAN offload features on the NIC. This can be potentially dangeros...be advised!\n",  of_port_state->name);
+		else
+			ROFL_DEBUG(DRIVER_NAME"[xdp:%s] LRO and RX VLAN offload successfully disabled.\n", of_port_state->name);
+	}
+
+	//Only queue 0 is served
+	memset(&channels, 0, sizeof(channels));
+	channels.cmd = ETHTOOL_GCHANNELS;
+	ifr.ifr_data = (caddr_t)&channels;
+
+	if (ioctl(sd, SIOCETHTOOL, &ifr) == 0 && (channels.rx_count + channels.combined_count) > 1) {
+		ROFL_WARN(DRIVER_NAME"[xdp:%s] Interface has %u RX queues, but only queue 0 is served via AF_XDP; the rest of the traffic goes to the network stack. Consider using a single channel: ethtool -L %s combined 1\n", of_port_state->name, channels.rx_count + channels.combined_count, of_port_state->name);
+	}
+
+	//Recover MTU
+	memset((void*)&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, of_port_state->name, sizeof(ifr.ifr_name)-1);
+
+	if(ioctl(sd, SIOCGIFMTU, &ifr) < 0) {
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Could not retreive MTU value from NIC. Default %u Max Packet Size(MPS) size will be used (%u total bytes).\n",  of_port_state->name, (PORT_DEFAULT_PKT_SIZE-PORT_ETHER_LENGTH), PORT_DEFAULT_PKT_SIZE);
+		mps = PORT_DEFAULT_PKT_SIZE;
+	}else{
+		mps = ifr.ifr_mtu+PORT_ETHER_LENGTH;
+		ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Discovered Max Packet Size(MPS) of %u.\n",  of_port_state->name, mps);
+	}
+
+	if(mps > XDP_MAX_PKT_SIZE){
+		ROFL_WARN(DRIVER_NAME"[xdp:%s] MTU exceeds the UMEM frame size; Max Packet Size(MPS) limited to %u bytes. Packets exceeding this size will be DROPPED (Jumbo frames).\n",  of_port_state->name, XDP_MAX_PKT_SIZE);
+		mps = XDP_MAX_PKT_SIZE;
+	}
+
+	// enable promiscous mode
+	if ((rc = ioctl(sd, SIOCGIFFLAGS, &ifr)) < 0){
+		close(sd);
+		return ROFL_FAILURE;
+	}
+
+	ifr.ifr_flags |= IFF_PROMISC;
+
+	//Prevent race conditions with LINK/STATUS notification threads (bg)
+	pthread_rwlock_wrlock(&rwlock);
+
+	if( !(IFF_UP & ifr.ifr_flags) )
+		ifr.ifr_flags |= IFF_UP;
+
+	if ((rc = ioctl(sd, SIOCSIFFLAGS, &ifr)) < 0){
+		ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Unable to bring interface up via ioctl\n",of_port_state->name);
+		close(sd);
+		pthread_rwlock_unlock(&rwlock);
+		return ROFL_FAILURE;
+	}
+
+	//Release mutex
+	pthread_rwlock_unlock(&rwlock);
+	close(sd);
+
+	//If the socket is not created, create it
+	if(!xsk){
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] generating a new AF_XDP socket\n",of_port_state->name);
+		try{
+			xsk = new xdp_socket(std::string(of_port_state->name), native);
+		}catch(...){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to create the AF_XDP socket (%s mode)\n", of_port_state->name, (native)? "native":"generic");
+			xsk = NULL;
+			return ROFL_FAILURE;
+		}
+
+		//The socket fills what it can; make the RX thread retry the rest
+		rx_since_refill = IO_IFACE_XDP_RING_SLOTS;
+	}
+
+	of_port_state->up = true;
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t ioport_xdp::down() {
+
+	struct ifreq ifr;
+	int sd, rc;
+
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] Trying to bring down\n",of_port_state->name);
+
+	//The I/O threads must not be using the socket when it is destroyed.
+	//iomanager quiesces the portgroups and calls down() again
+	if(is_scheduled())
+		return iomanager::bring_port_down(this);
+
+	//Destroy the socket (detaches the XDP program and reclaims the frames)
+	if(xsk){
+		wait_for_tx_room(false);
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[xdp:%s] destroying AF_XDP socket\n",of_port_state->name);
+		delete xsk;
+		xsk = NULL;
+	}
+
+	of_port_state->up = false;
+
+	if ((sd = socket(AF_PACKET, SOCK_RAW, 0)) < 0) {
+		return ROFL_FAILURE;
+	}
+
+	memset(&ifr, 0, sizeof(struct ifreq));
+	strncpy(ifr.ifr_name, of_port_state->name, sizeof(ifr.ifr_name)-1);
+
+	if ((rc = ioctl(sd, SIOCGIFFLAGS, &ifr)) < 0) {
+		close(sd);
+		return ROFL_FAILURE;
+	}
+
+	if ( !(IFF_UP & ifr.ifr_flags) ) {
+		close(sd);
+		//Already down.. Silently skip
+		return ROFL_SUCCESS;
+	}
+
+	//Prevent race conditions with LINK/STATUS notification threads (bg)
+	pthread_rwlock_wrlock(&rwlock);
+
+	ifr.ifr_flags &= ~IFF_UP;
+
+	if ((rc = ioctl(sd, SIOCSIFFLAGS, &ifr)) < 0) {
+		ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Unable to bring interface down via ioctl\n",of_port_state->name);
+		close(sd);
+		pthread_rwlock_unlock(&rwlock);
+		return ROFL_FAILURE;
+	}
+
+	//Release mutex
+	pthread_rwlock_unlock(&rwlock);
+
+	close(sd);
+
+	return ROFL_SUCCESS;
+}
+
+#endif //HAVE_AF_XDP
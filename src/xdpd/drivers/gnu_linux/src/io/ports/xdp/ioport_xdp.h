@@ -0,0 +1,132 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef IOPORT_XDP_H
+#define IOPORT_XDP_H
+
+#ifdef HAVE_AF_XDP
+
+#include <string>
+
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/common/datapacket.h>
+#include <rofl/datapath/pipeline/switch_port.h>
+
+#include "../ioport.h"
+#include "xdp_socket.h"
+#include "../../datapacketx86.h"
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* @file ioport_xdp.h
+*
+* @brief GNU/Linux interface access via AF_XDP sockets
+*/
+
+
+/**
+* @brief GNU/Linux interface access via AF_XDP sockets
+*
+* Received frames are not copied; the UMEM frame is attached to the
+* bufferpool packet (datapacketx86 NIC buffer) and handed back to the UMEM
+* when the packet is released. Packets still held in a UMEM frame are sent
+* without copies as well; the rest are copied to a free UMEM frame.
+*
+* The XSK fd is used as the read fd. Since the XSK fd is (almost) always
+* writable, an eventfd is used to notify the TX thread about enqueued packets.
+* The write fd is an epoll set with that eventfd and, while the TX ring is
+* full, what signals room in it: the XSK fd (POLLOUT) in zero-copy mode, or a
+* retry timer in copy mode (the kernel only transmits when kicked).
+*
+* Only queue 0 of the interface is served; use ethtool -L to configure a
+* single (combined) channel in multi-queue NICs.
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class ioport_xdp : public ioport{
+
+public:
+	//ioport_xdp
+	ioport_xdp(switch_port_t* of_ps, bool native, unsigned int num_queues = IO_IFACE_NUM_QUEUES);
+
+	virtual
+	~ioport_xdp();
+
+	//Enque packet for transmission(blocking)
+	virtual void enqueue_packet(datapacket_t* pkt, unsigned int q_id);
+
+	//Non-blocking read and write
+	virtual datapacket_t* read(void);
+
+	virtual unsigned int write(unsigned int q_id, unsigned int num_of_buckets);
+
+	// Get read fds. Return -1 if do not exist
+	inline virtual int get_read_fd(void){
+		if(xsk)
+			return xsk->get_fd();
+		return -1;
+	};
+
+	// Get write fds. Return -1 if do not exist
+	inline virtual int get_write_fd(void){
+		return tx_epfd;
+	};
+
+	unsigned int get_port_no() {
+		if(of_port_state)
+			return of_port_state->of_port_num;
+		else
+			return 0;
+	}
+
+	/**
+	 * Sets the port administratively up. This MUST change the of_port_state appropiately
+	 */
+	virtual rofl_result_t up(void);
+
+	/**
+	 * Sets the port administratively down. This MUST change the of_port_state appropiately
+	 */
+	virtual rofl_result_t down(void);
+
+private:
+
+	//Minimum frame size (ethernet header size)
+	static const unsigned int MIN_PKT_LEN=14;
+
+	//Number of frames received before refilling the fill ring
+	static const unsigned int REFILL_THRESHOLD=64;
+
+	//Native (driver) or generic (SKB) XDP mode
+	bool native;
+
+	xdp_socket* xsk;
+
+	//RX frames not yet replaced in the fill ring
+	unsigned int rx_since_refill;
+
+	//TX notification
+	int notify_fd;
+
+	//Write fd; notify_fd plus, while waiting for room in the TX ring, the
+	//XSK fd (zero-copy) or retry_fd (copy mode)
+	int tx_epfd;
+	int retry_fd;
+	bool tx_waiting;
+
+	void notify(void);
+	void consume_notifications(void);
+	void wait_for_tx_room(bool wait);
+	void refill(void);
+	bool is_scheduled(void);
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif //HAVE_AF_XDP
+
+#endif /* IOPORT_XDP_H_ */
@@ -0,0 +1,335 @@
+#include "xdp_socket.h"
+
+#ifdef HAVE_AF_XDP
+
+#include <assert.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <linux/if_link.h>
+#include <linux/bpf.h>
+
+using namespace xdpd::gnu_linux;
+
+//Queue the socket is bound to
+#define XDP_SOCKET_QUEUE_ID 0
+
+/*
+* bpf(2) wrapper (there is no glibc wrapper)
+*/
+static inline int sys_bpf(enum bpf_cmd cmd, union bpf_attr* attr){
+	return syscall(__NR_bpf, cmd, attr, sizeof(*attr));
+}
+
+xdp_socket::xdp_socket(std::string __devname, bool native, unsigned int ring_slots) :
+	devname(__devname),
+	fd(-1),
+	zero_copy(false),
+	map_fd(-1),
+	prog_fd(-1),
+	link_fd(-1),
+	rx_frames(NULL),
+	tx_frames(NULL)
+{
+	int ifindex;
+	struct xdp_umem_reg reg;
+	struct xdp_mmap_offsets off;
+	struct sockaddr_xdp sxdp;
+	socklen_t optlen;
+
+	memset(&fr, 0, sizeof(fr));
+	memset(&cr, 0, sizeof(cr));
+	memset(&rx, 0, sizeof(rx));
+	memset(&tx, 0, sizeof(tx));
+
+	if(xdp_umem::init() != ROFL_SUCCESS)
+		throw eConstructorXdpSocket();
+
+	rx_frames = (uint64_t*)calloc(IO_IFACE_XDP_UMEM_FRAMES/64+1, sizeof(uint64_t));
+	tx_frames = (uint64_t*)calloc(IO_IFACE_XDP_UMEM_FRAMES/64+1, sizeof(uint64_t));
+	if(!rx_frames || !tx_frames){
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	if((fd = socket(AF_XDP, SOCK_RAW, 0)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to create AF_XDP socket: %s\n", devname.c_str(), strerror(errno));
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	//Get the ifindex
+	if((ifindex = if_nametoindex(devname.c_str())) == 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to retrieve the interface index: %s\n", devname.c_str(), strerror(errno));
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	//Register the shared area as the UMEM of the socket
+	memset(&reg, 0, sizeof(reg));
+	reg.addr = (uint64_t)(uintptr_t)xdp_umem::get_area();
+	reg.len = xdp_umem::get_size();
+	reg.chunk_size = xdp_umem::FRAME_SIZE;
+	reg.headroom = 0;
+
+	if(setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to register UMEM: %s. Check the locked memory limits (ulimit -l)\n", devname.c_str(), strerror(errno));
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	//Rings
+	if(setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &ring_slots, sizeof(ring_slots)) < 0 ||
+		setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_slots, sizeof(ring_slots)) < 0 ||
+		setsockopt(fd, SOL_XDP, XDP_RX_RING, &ring_slots, sizeof(ring_slots)) < 0 ||
+		setsockopt(fd, SOL_XDP, XDP_TX_RING, &ring_slots, sizeof(ring_slots)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to set ring sizes: %s\n", devname.c_str(), strerror(errno));
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	optlen = sizeof(off);
+	if(getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optlen) < 0){
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	//Map them (throws)
+	try{
+		map_ring(&fr, &off.fr, XDP_UMEM_PGOFF_FILL_RING, ring_slots, sizeof(uint64_t));
+		map_ring(&cr, &off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, ring_slots, sizeof(uint64_t));
+		map_ring(&rx, &off.rx, XDP_PGOFF_RX_RING, ring_slots, sizeof(struct xdp_desc));
+		map_ring(&tx, &off.tx, XDP_PGOFF_TX_RING, ring_slots, sizeof(struct xdp_desc));
+	}catch(...){
+		release();
+		throw;
+	}
+
+	//Bind to the queue; attempt zero-copy in native mode
+	memset(&sxdp, 0, sizeof(sxdp));
+	sxdp.sxdp_family = AF_XDP;
+	sxdp.sxdp_ifindex = ifindex;
+	sxdp.sxdp_queue_id = XDP_SOCKET_QUEUE_ID;
+	sxdp.sxdp_flags = (native)? XDP_ZEROCOPY : XDP_COPY;
+
+	if(bind(fd, (struct sockaddr*)&sxdp, sizeof(sxdp)) < 0){
+		if(!native){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to bind AF_XDP socket: %s\n", devname.c_str(), strerror(errno));
+			release();
+			throw eConstructorXdpSocket();
+		}
+
+		ROFL_DEBUG(DRIVER_NAME"[xdp:%s] Zero-copy not supported by the driver (%s); falling back to copy mode\n", devname.c_str(), strerror(errno));
+		sxdp.sxdp_flags = XDP_COPY;
+		if(bind(fd, (struct sockaddr*)&sxdp, sizeof(sxdp)) < 0){
+			ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to bind AF_XDP socket: %s\n", devname.c_str(), strerror(errno));
+			release();
+			throw eConstructorXdpSocket();
+		}
+	}else{
+		zero_copy = native;
+	}
+
+	//Hand frames to the kernel
+	refill();
+
+	//Redirect the queue to the socket (throws)
+	try{
+		attach_program(ifindex, native);
+	}catch(...){
+		release();
+		throw;
+	}
+
+	ROFL_DEBUG(DRIVER_NAME"[xdp:%s] AF_XDP socket bound to queue %u in %s mode (%s)\n", devname.c_str(), XDP_SOCKET_QUEUE_ID, (native)? "native":"generic", (zero_copy)? "zero-copy":"copy");
+}
+
+xdp_socket::xdp_socket(unsigned int ring_slots) :
+	devname("none"),
+	fd(-1),
+	zero_copy(false),
+	map_fd(-1),
+	prog_fd(-1),
+	link_fd(-1),
+	rx_frames(NULL),
+	tx_frames(NULL)
+{
+	struct xdp_ring_offset off;
+
+	memset(&fr, 0, sizeof(fr));
+	memset(&cr, 0, sizeof(cr));
+	memset(&rx, 0, sizeof(rx));
+	memset(&tx, 0, sizeof(tx));
+
+	if(xdp_umem::init() != ROFL_SUCCESS)
+		throw eConstructorXdpSocket();
+
+	rx_frames = (uint64_t*)calloc(IO_IFACE_XDP_UMEM_FRAMES/64+1, sizeof(uint64_t));
+	tx_frames = (uint64_t*)calloc(IO_IFACE_XDP_UMEM_FRAMES/64+1, sizeof(uint64_t));
+	if(!rx_frames || !tx_frames){
+		release();
+		throw eConstructorXdpSocket();
+	}
+
+	//Same layout as the kernel rings
+	memset(&off, 0, sizeof(off));
+	off.producer = 0;
+	off.consumer = 64;
+	off.desc = 128;
+
+	try{
+		map_ring(&fr, &off, 0, ring_slots, sizeof(uint64_t));
+		map_ring(&cr, &off, 0, ring_slots, sizeof(uint64_t));
+		map_ring(&rx, &off, 0, ring_slots, sizeof(struct xdp_desc));
+		map_ring(&tx, &off, 0, ring_slots, sizeof(struct xdp_desc));
+	}catch(...){
+		release();
+		throw;
+	}
+}
+
+xdp_socket::~xdp_socket(){
+	release();
+}
+
+void xdp_socket::map_ring(xdp_ring_t* ring, const struct xdp_ring_offset* off, uint64_t pgoff, unsigned int slots, size_t desc_size){
+
+	ring->map_len = off->desc + slots*desc_size;
+	if(fd != -1)
+		ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, pgoff);
+	else
+		ring->map = mmap(NULL, ring->map_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+
+	if(ring->map == MAP_FAILED){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to mmap() ring: %s\n", devname.c_str(), strerror(errno));
+		ring->map = NULL;
+		throw eConstructorXdpSocket();
+	}
+
+	ring->producer = (uint32_t*)((uint8_t*)ring->map + off->producer);
+	ring->consumer = (uint32_t*)((uint8_t*)ring->map + off->consumer);
+	ring->descs = (uint8_t*)ring->map + off->desc;
+	ring->size = slots;
+	ring->mask = slots-1;
+	ring->cached_prod = *ring->producer;
+	ring->cached_cons = *ring->consumer;
+}
+
+/*
+* Load a minimal XDP program redirecting the frames of the queue to the socket
+* (XSKMAP), and attach it to the interface. Frames of other queues, or received
+* while the socket is not in the map, go to the network stack (XDP_PASS).
+*/
+void xdp_socket::attach_program(int ifindex, bool native){
+
+	union bpf_attr attr;
+	uint32_t key = XDP_SOCKET_QUEUE_ID;
+	uint32_t value = fd;
+
+	//XSKMAP
+	memset(&attr, 0, sizeof(attr));
+	attr.map_type = BPF_MAP_TYPE_XSKMAP;
+	attr.key_size = sizeof(uint32_t);
+	attr.value_size = sizeof(uint32_t);
+	attr.max_entries = XDP_SOCKET_QUEUE_ID+1;
+
+	if((map_fd = sys_bpf(BPF_MAP_CREATE, &attr)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to create XSKMAP: %s\n", devname.c_str(), strerror(errno));
+		throw eConstructorXdpSocket();
+	}
+
+	memset(&attr, 0, sizeof(attr));
+	attr.map_fd = map_fd;
+	attr.key = (uint64_t)(uintptr_t)&key;
+	attr.value = (uint64_t)(uintptr_t)&value;
+	attr.flags = BPF_ANY;
+
+	if(sys_bpf(BPF_MAP_UPDATE_ELEM, &attr) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to insert the socket in the XSKMAP: %s\n", devname.c_str(), strerror(errno));
+		throw eConstructorXdpSocket();
+	}
+
+	/*
+	* r2 = ctx->rx_queue_index
+	* r1 = xskmap
+	* r3 = XDP_PASS (action on lookup failure)
+	* return bpf_redirect_map(r1, r2, r3)
+	*/
+	struct bpf_insn prog[] = {
+		{ BPF_LDX|BPF_MEM|BPF_W, BPF_REG_2, BPF_REG_1, offsetof(struct xdp_md, rx_queue_index), 0 },
+		{ BPF_LD|BPF_DW|BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0, map_fd },
+		{ 0, 0, 0, 0, 0 },
+		{ BPF_ALU64|BPF_MOV|BPF_K, BPF_REG_3, 0, 0, XDP_PASS },
+		{ BPF_JMP|BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map },
+		{ BPF_JMP|BPF_EXIT, 0, 0, 0, 0 },
+	};
+
+	memset(&attr, 0, sizeof(attr));
+	attr.prog_type = BPF_PROG_TYPE_XDP;
+	attr.insns = (uint64_t)(uintptr_t)prog;
+	attr.insn_cnt = sizeof(prog)/sizeof(prog[0]);
+	attr.license = (uint64_t)(uintptr_t)"Dual MPL/GPL";
+
+	if((prog_fd = sys_bpf(BPF_PROG_LOAD, &attr)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to load XDP program: %s\n", devname.c_str(), strerror(errno));
+		throw eConstructorXdpSocket();
+	}
+
+	//Attach it (the link is removed when link_fd is closed)
+	memset(&attr, 0, sizeof(attr));
+	attr.link_create.prog_fd = prog_fd;
+	attr.link_create.target_ifindex = ifindex;
+	attr.link_create.attach_type = BPF_XDP;
+	attr.link_create.flags = (native)? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+
+	if((link_fd = sys_bpf(BPF_LINK_CREATE, &attr)) < 0){
+		ROFL_ERR(DRIVER_NAME"[xdp:%s] Unable to attach XDP program in %s mode: %s. Is there another XDP program attached?%s\n", devname.c_str(), (native)? "native":"generic", strerror(errno), (native)? " Use the generic mode if the NIC driver does not support XDP.":"");
+		throw eConstructorXdpSocket();
+	}
+}
+
+void xdp_socket::release(){
+
+	unsigned int i, j;
+
+	//Detach program first
+	if(link_fd != -1)
+		close(link_fd);
+	if(prog_fd != -1)
+		close(prog_fd);
+	if(map_fd != -1)
+		close(map_fd);
+	link_fd = prog_fd = map_fd = -1;
+
+	if(fr.map)
+		munmap(fr.map, fr.map_len);
+	if(cr.map)
+		munmap(cr.map, cr.map_len);
+	if(rx.map)
+		munmap(rx.map, rx.map_len);
+	if(tx.map)
+		munmap(tx.map, tx.map_len);
+	fr.map = cr.map = rx.map = tx.map = NULL;
+
+	if(fd != -1)
+		close(fd);
+	fd = -1;
+
+	//Reclaim the frames the kernel did not hand back
+	for(i=0; i<IO_IFACE_XDP_UMEM_FRAMES/64+1; ++i){
+		for(j=0; j<64; ++j){
+			if(rx_frames && rx_frames[i] & (1ULL << j))
+				xdp_umem::release_frame(xdp_umem::get_area() + ((uint64_t)i*64+j)*xdp_umem::FRAME_SIZE);
+			if(tx_frames && tx_frames[i] & (1ULL << j))
+				xdp_umem::release_frame(xdp_umem::get_area() + ((uint64_t)i*64+j)*xdp_umem::FRAME_SIZE);
+		}
+	}
+
+	free(rx_frames);
+	free(tx_frames);
+	rx_frames = tx_frames = NULL;
+}
+
+#endif //HAVE_AF_XDP
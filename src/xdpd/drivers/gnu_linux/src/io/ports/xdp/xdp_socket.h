@@ -0,0 +1,257 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef XDP_SOCKET_H
+#define XDP_SOCKET_H
+
+#ifdef HAVE_AF_XDP
+
+#include <string>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/if_xdp.h>
+
+#include <rofl/common/croflexception.h>
+#include <rofl/common/utils/c_logger.h>
+#include "../../../util/likely.h"
+#include "../../../config.h"
+#include "xdp_umem.h"
+
+/**
+* @file xdp_socket.h
+*
+* @brief AF_XDP socket (XSK) internals
+*
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+class eConstructorXdpSocket : public rofl::RoflException {};
+
+/**
+* mmap()ed AF_XDP ring. All the rings are single producer, single consumer.
+*/
+typedef struct xdp_ring{
+	uint32_t* producer;
+	uint32_t* consumer;
+	void* descs;
+	uint32_t mask;
+	uint32_t size;
+
+	//Local copies
+	uint32_t cached_prod;
+	uint32_t cached_cons;
+
+	//Mapping
+	void* map;
+	size_t map_len;
+}xdp_ring_t;
+
+/**
+* @brief AF_XDP socket bound to queue 0 of an interface
+*
+* The socket registers the (shared) xdp_umem area as its UMEM and loads and
+* attaches (BPF link) a minimal XDP program redirecting the frames of the
+* queue to it. The attachment is removed when the socket is destroyed.
+*
+* In native mode the program is attached in driver mode and zero-copy is
+* requested (falling back to copy mode if the driver does not support it).
+* In generic mode the program is attached in SKB mode (e.g. veth, or NICs
+* without XDP support).
+*
+* The fill and RX rings must be used by a single (RX) thread, and the TX and
+* completion rings by a single (TX) thread.
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class xdp_socket{
+
+public:
+	xdp_socket(std::string devname, bool native, unsigned int ring_slots = IO_IFACE_XDP_RING_SLOTS);
+	~xdp_socket(void);
+
+	// Get the XSK fd
+	inline int get_fd(void){
+		return fd;
+	};
+
+	inline bool is_zero_copy(void){
+		return zero_copy;
+	};
+
+	/*
+	* Fill ring (RX thread)
+	*/
+
+	/**
+	* Hand free UMEM frames to the kernel (fill ring). Returns the number of frames
+	*/
+	inline unsigned int refill(void){
+		unsigned int i, n;
+		uint8_t* frame;
+
+		n = fr.size - (fr.cached_prod - __atomic_load_n(fr.consumer, __ATOMIC_ACQUIRE));
+
+		for(i=0; i<n; ++i){
+			frame = xdp_umem::get_frame();
+			if(unlikely(!frame))
+				break;
+			own(rx_frames, frame);
+			((uint64_t*)fr.descs)[fr.cached_prod++ & fr.mask] = xdp_umem::get_addr(frame);
+		}
+
+		if(i)
+			__atomic_store_n(fr.producer, fr.cached_prod, __ATOMIC_RELEASE);
+
+		return i;
+	}
+
+	/*
+	* RX ring (RX thread)
+	*/
+
+	/**
+	* Get the next received frame descriptor, or NULL if there are none
+	*/
+	inline struct xdp_desc* read_packet(void){
+		if(rx.cached_cons == rx.cached_prod){
+			rx.cached_prod = __atomic_load_n(rx.producer, __ATOMIC_ACQUIRE);
+			if(rx.cached_cons == rx.cached_prod)
+				return NULL;
+		}
+		return &((struct xdp_desc*)rx.descs)[rx.cached_cons & rx.mask];
+	}
+
+	/**
+	* Release the descriptor returned by read_packet(). The frame itself is
+	* now owned by the caller
+	*/
+	inline uint8_t* return_packet(struct xdp_desc* desc){
+		uint8_t* frame = xdp_umem::get_frame_by_addr(desc->addr);
+		disown(rx_frames, frame);
+		__atomic_store_n(rx.consumer, ++rx.cached_cons, __ATOMIC_RELEASE);
+		return frame;
+	}
+
+	/*
+	* TX and completion rings (TX thread)
+	*/
+
+	/**
+	* Check whether there is an empty TX descriptor
+	*/
+	inline bool has_free_slot(void){
+		if(tx.cached_prod - tx.cached_cons == tx.size){
+			tx.cached_cons = __atomic_load_n(tx.consumer, __ATOMIC_ACQUIRE);
+			if(tx.cached_prod - tx.cached_cons == tx.size)
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	* Fill the next TX descriptor (has_free_slot() must be checked before) with
+	* data of a UMEM frame. The frame is now owned by the socket until its
+	* completion. Descriptors are handed to the kernel on send()
+	*/
+	inline void fill_tx_slot(uint8_t* data, uint32_t len){
+		struct xdp_desc* desc = &((struct xdp_desc*)tx.descs)[tx.cached_prod++ & tx.mask];
+
+		own(tx_frames, xdp_umem::get_frame_by_addr(xdp_umem::get_addr(data)));
+		desc->addr = xdp_umem::get_addr(data);
+		desc->len = len;
+		desc->options = 0;
+	}
+
+	/**
+	* Hand the filled TX descriptors to the kernel
+	*/
+	inline rofl_result_t send(void){
+		__atomic_store_n(tx.producer, tx.cached_prod, __ATOMIC_RELEASE);
+
+		//Kick TX; this is required in copy (and generic) mode
+		if(unlikely(sendto(fd, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0)){
+			if(errno != EAGAIN && errno != EBUSY && errno != ENOBUFS && errno != ENETDOWN)
+				return ROFL_FAILURE;
+		}
+		return ROFL_SUCCESS;
+	}
+
+	/**
+	* Return the frames already transmitted (completion ring) to the UMEM.
+	* Returns the number of frames
+	*/
+	inline unsigned int reap_completions(void){
+		unsigned int n = 0;
+		uint8_t* frame;
+
+		cr.cached_prod = __atomic_load_n(cr.producer, __ATOMIC_ACQUIRE);
+
+		while(cr.cached_cons != cr.cached_prod){
+			frame = xdp_umem::get_frame_by_addr(((uint64_t*)cr.descs)[cr.cached_cons++ & cr.mask]);
+			disown(tx_frames, frame);
+			xdp_umem::release_frame(frame);
+			n++;
+		}
+
+		if(n)
+			__atomic_store_n(cr.consumer, cr.cached_cons, __ATOMIC_RELEASE);
+
+		return n;
+	}
+
+protected:
+	/**
+	* Socket-less instance over anonymous memory rings. The kernel side of
+	* the rings is driven by the caller (unit tests)
+	*/
+	xdp_socket(unsigned int ring_slots);
+
+	//Rings
+	xdp_ring_t fr;	//Fill
+	xdp_ring_t cr;	//Completion
+	xdp_ring_t rx;
+	xdp_ring_t tx;
+
+private:
+	std::string devname;
+	int fd;
+	bool zero_copy;
+
+	//XDP program (XSKMAP redirect)
+	int map_fd;
+	int prog_fd;
+	int link_fd;
+
+	/*
+	* Frames currently handed to the kernel (bitmaps); fill+RX rings (RX
+	* thread) and TX+completion rings (TX thread). These are reclaimed when
+	* the socket is destroyed.
+	*/
+	uint64_t* rx_frames;
+	uint64_t* tx_frames;
+
+	static inline void own(uint64_t* frames, uint8_t* frame){
+		uint64_t idx = xdp_umem::get_addr(frame) / xdp_umem::FRAME_SIZE;
+		frames[idx >> 6] |= (1ULL << (idx & 0x3F));
+	}
+	static inline void disown(uint64_t* frames, uint8_t* frame){
+		uint64_t idx = xdp_umem::get_addr(frame) / xdp_umem::FRAME_SIZE;
+		frames[idx >> 6] &= ~(1ULL << (idx & 0x3F));
+	}
+
+	void map_ring(xdp_ring_t* ring, const struct xdp_ring_offset* off, uint64_t pgoff, unsigned int slots, size_t desc_size);
+	void attach_program(int ifindex, bool native);
+	void release(void);
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif //HAVE_AF_XDP
+
+#endif /* XDP_SOCKET_H_ */
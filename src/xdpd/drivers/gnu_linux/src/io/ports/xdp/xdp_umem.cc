@@ -0,0 +1,64 @@
+#include "xdp_umem.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//Static members initialization
+uint8_t* xdp_umem::area = NULL;
+uint64_t xdp_umem::size = 0;
+circular_queue<uint8_t>* xdp_umem::free_frames = NULL;
+pthread_mutex_t xdp_umem::mutex = PTHREAD_MUTEX_INITIALIZER;
+
+rofl_result_t xdp_umem::init(){
+
+	unsigned int i;
+	void* map;
+	uint64_t len = (uint64_t)IO_IFACE_XDP_UMEM_FRAMES*FRAME_SIZE;
+
+	pthread_mutex_lock(&mutex);
+
+	if(area){
+		//Already there
+		pthread_mutex_unlock(&mutex);
+		return ROFL_SUCCESS;
+	}
+
+	//Attempt hugepages first, then fall back to regular pages
+	map = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+	if(map == MAP_FAILED){
+		ROFL_DEBUG(DRIVER_NAME"[xdp] Unable to allocate UMEM in hugepages (%s); using regular pages\n", strerror(errno));
+		map = mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_POPULATE, -1, 0);
+	}
+
+	if(map == MAP_FAILED){
+		ROFL_ERR(DRIVER_NAME"[xdp] Unable to allocate UMEM of %llu bytes: %s\n", (long long unsigned)len, strerror(errno));
+		pthread_mutex_unlock(&mutex);
+		return ROFL_FAILURE;
+	}
+
+	try{
+		free_frames = new circular_queue<uint8_t>(IO_IFACE_XDP_UMEM_FRAMES);
+	}catch(...){
+		munmap(map, len);
+		pthread_mutex_unlock(&mutex);
+		return ROFL_FAILURE;
+	}
+
+	area = (uint8_t*)map;
+	size = len;
+
+	//Note that a queue can hold up to slots-1 elements
+	for(i=0; i<IO_IFACE_XDP_UMEM_FRAMES-1; ++i)
+		free_frames->non_blocking_write(area + (uint64_t)i*FRAME_SIZE);
+
+	ROFL_DEBUG(DRIVER_NAME"[xdp] UMEM of %u frames (%u bytes each) allocated at %p\n", IO_IFACE_XDP_UMEM_FRAMES-1, FRAME_SIZE, area);
+
+	pthread_mutex_unlock(&mutex);
+
+	return ROFL_SUCCESS;
+}
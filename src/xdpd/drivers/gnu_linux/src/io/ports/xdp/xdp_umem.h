@@ -0,0 +1,97 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef XDP_UMEM_H
+#define XDP_UMEM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <rofl_datapath.h>
+
+#include "../../../util/likely.h"
+#include "../../../util/circular_queue.h"
+#include "../../../config.h"
+
+/**
+* @file xdp_umem.h
+*
+* @brief AF_XDP UMEM frame area, shared by all the AF_XDP ports
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* @brief AF_XDP UMEM frame area
+*
+* A single memory area (hugepage backed, if available) is registered as the
+* UMEM of every AF_XDP socket, so that UMEM addresses (offsets) are valid
+* across all of them. Frames are owned by the driver: they are handed to the
+* kernel via the fill (RX) and TX rings, attached to the bufferpool packets
+* while in the pipeline (datapacketx86 NIC buffers) and returned to the free
+* list on completion (TX) or when the packet is released (bufferpool).
+*
+* The area is never unmapped while the driver is running, since frames may
+* still be referenced by packets (e.g. in the PKT_IN storage).
+*
+* @ingroup driver_gnu_linux_io_ports
+*/
+class xdp_umem{
+
+public:
+	static const unsigned int FRAME_SIZE = IO_IFACE_XDP_FRAME_SIZE;
+
+	/**
+	* Allocate the area (only once; thread-safe)
+	*/
+	static rofl_result_t init(void);
+
+	/**
+	* Get a free frame (multi-thread safe). Returns NULL if there are none
+	*/
+	static inline uint8_t* get_frame(void){
+		return free_frames->non_blocking_read();
+	}
+
+	/**
+	* Return a frame to the free list (multi-thread safe). This is also used
+	* as the release function of the datapacketx86 NIC buffers
+	*/
+	static inline void release_frame(void* frame){
+		if(unlikely(free_frames->non_blocking_write((uint8_t*)frame) != ROFL_SUCCESS))
+			assert(0); //Frame returned twice
+	}
+
+	/**
+	* Conversions between pointers and UMEM addresses (offsets)
+	*/
+	static inline uint64_t get_addr(const uint8_t* ptr){
+		return ptr - area;
+	}
+	static inline uint8_t* get_ptr(uint64_t addr){
+		return area + addr;
+	}
+	static inline uint8_t* get_frame_by_addr(uint64_t addr){
+		return area + (addr & ~((uint64_t)FRAME_SIZE-1));
+	}
+
+	static inline uint8_t* get_area(void){ return area; }
+	static inline uint64_t get_size(void){ return size; }
+
+private:
+	static uint8_t* area;
+	static uint64_t size;
+
+	//Free frames
+	static circular_queue<uint8_t>* free_frames;
+
+	static pthread_mutex_t mutex;
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* XDP_UMEM_H_ */
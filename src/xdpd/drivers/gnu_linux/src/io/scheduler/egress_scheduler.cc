@@ -0,0 +1,43 @@
+#include "egress_scheduler.h"
+#include "hqos_egress_scheduler.h"
+#include "../ports/ioport.h"
+
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//Static members initialization
+const float wrr_egress_scheduler::WRITE_QOS_QUEUE_FACTOR[IO_IFACE_NUM_QUEUES]={1,1.2,1.5,2,2.2,2.5,2.7,3.0};
+
+egress_scheduler* egress_scheduler::create(){
+#ifdef IO_TX_HQOS_SCHEDULER
+	return new hqos_egress_scheduler();
+#else
+	return new wrr_egress_scheduler();
+#endif
+}
+
+unsigned int wrr_egress_scheduler::schedule(ioport* port){
+
+	unsigned int q_id;
+	unsigned int n_buckets;
+	unsigned int tx_packets=0;
+
+	//Process output (up to WRITE_BUCKETS[output_queue_state])
+	for(q_id=0; q_id < port->get_num_of_queues(); ++q_id){
+
+		//Fast pre-check (avoid virtual function call overhead)
+		if(port->output_queue_has_packets(q_id) == false)
+			continue;
+
+		//Increment number of buckets
+		n_buckets = WRITE_BUCKETS_PP*WRITE_QOS_QUEUE_FACTOR[q_id];
+
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[%s] Trying to write at port queue: %d with n_buckets: %d.\n", port->of_port_state->name, q_id, n_buckets);
+
+		//Perform up to n_buckets write
+		tx_packets += n_buckets - port->write(q_id, n_buckets);
+	}
+
+	return tx_packets;
+}
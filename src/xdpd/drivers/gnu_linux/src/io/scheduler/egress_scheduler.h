@@ -0,0 +1,100 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef EGRESS_SCHEDULER_H
+#define EGRESS_SCHEDULER_H
+
+#include <rofl_datapath.h>
+#include "../../config.h"
+#include "../../../../hal_qos_ext.h"
+
+/**
+* @file egress_scheduler.h
+*
+* @brief Egress (TX) scheduler of the output queues of an ioport
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+class ioport;
+
+/**
+* @brief Egress (TX) scheduler of the output queues of an ioport
+*
+* @ingroup driver_gnu_linux_io_schedulers
+*
+* @description Decides which output queues are served, and how many packets
+* of each, every time the TX I/O thread processes the port. schedule() is
+* only called by the TX I/O thread of the port; configure_queue() is called
+* by management (HAL) threads.
+*/
+class egress_scheduler{
+
+public:
+	egress_scheduler(void) : parked(false){};
+	virtual ~egress_scheduler(void){};
+
+	/**
+	* Serve (write) the output queues of the port
+	* @return number of packets written
+	*/
+	virtual unsigned int schedule(ioport* port)=0;
+
+	/**
+	* Configure the scheduling of queue q_id
+	*/
+	virtual rofl_result_t configure_queue(unsigned int q_id, const hal_port_queue_conf_t* conf){
+		return ROFL_FAILURE;
+	}
+
+	/**
+	* Wake-up (timer) fd of the scheduler, or -1 if it never parks the port.
+	*
+	* The port is parked when the last schedule() left packets in the output
+	* queues that cannot be sent before the timer expires (e.g. shaped). The
+	* TX I/O thread must then only be woken up by the timer or by new packets,
+	* instead of polling the port.
+	*/
+	virtual int get_wakeup_fd(void){
+		return -1;
+	}
+
+	inline bool is_parked(void){
+		return parked;
+	}
+
+	/**
+	* Create the egress scheduler selected in config.h (IO_TX_HQOS_SCHEDULER)
+	*/
+	static egress_scheduler* create(void);
+
+protected:
+	//Set by schedule() (TX I/O thread)
+	bool parked;
+};
+
+/**
+* @brief Legacy packet based WRR egress scheduler
+*
+* @ingroup driver_gnu_linux_io_schedulers
+*
+* @description Serves all the queues in order, up to a fixed number of packets
+* per queue (WRITE_BUCKETS_PP*WRITE_QOS_QUEUE_FACTOR[q_id]). Cannot be configured.
+*/
+class wrr_egress_scheduler : public egress_scheduler{
+
+public:
+	virtual unsigned int schedule(ioport* port);
+
+protected:
+	//WRiting buckets
+	static const unsigned int WRITE_BUCKETS_PP=4;
+	static const float WRITE_QOS_QUEUE_FACTOR[IO_IFACE_NUM_QUEUES];
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* EGRESS_SCHEDULER_H_ */
@@ -23,7 +23,6 @@
 using namespace xdpd::gnu_linux;
 
 //Static members initialization
-const float epoll_ioscheduler::WRITE_QOS_QUEUE_FACTOR[ioport::MAX_OUTPUT_QUEUES]={1,1.2,1.5,2,2.2,2.5,2.7,3.0};
 #ifdef DEBUG
 bool epoll_ioscheduler::by_pass_processing = false;
 #endif
@@ -45,6 +44,7 @@ void epoll_ioscheduler::add_fd_epoll(struct epoll_event* ev, int epfd, ioport* p
 	ev->events = EPOLLIN | EPOLLPRI /*| EPOLLERR | EPOLLET*/;
 	port_data->fd = fd;
 	port_data->port = port;
+	port_data->write_ev = NULL;
 	ev->data.ptr = (void*)port_data; //Use pointer ONLY
 	
 	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[epoll_ioscheduler] Trying to add event with flags: %u and port_data:%p\n", ev->events, port_data); 
@@ -62,8 +62,8 @@ void epoll_ioscheduler::release_resources( int epfd, struct epoll_event* ev, str
 
 	if(epfd != -1){
 		close(epfd);	
-		//Release port_data stuff
-		for(i=0;i<current_num_of_ports;++i){
+		//Release port_data stuff (including PKT_OUT notification and TX wake-up timers)
+		for(i=0;i<2*current_num_of_ports+1;++i){
 			if(ev[i].data.ptr)
 				free(ev[i].data.ptr);
 		}
@@ -77,7 +77,7 @@ void epoll_ioscheduler::release_resources( int epfd, struct epoll_event* ev, str
 */
 void epoll_ioscheduler::init_or_update_fds(portgroup_state* pg, safevector<ioport*>& ports, int* epfd, struct epoll_event** ev, struct epoll_event** events, unsigned int* current_num_of_ports, unsigned int* current_hash, bool rx ){
 
-	unsigned int i;
+	unsigned int i, n;
 	int fd;
 	ioport* port;
 
@@ -88,9 +88,11 @@ void epoll_ioscheduler::init_or_update_fds(portgroup_state* pg, safevector<iopor
 	//Destroy previous epoll instance, if any
 	release_resources(*epfd, *ev, *events, *current_num_of_ports);
 
-	//Allocate memory
-	*ev = (epoll_event*)malloc( sizeof(struct epoll_event) * pg->running_ports->size());
-	*events = (epoll_event*)malloc( sizeof(struct epoll_event) * pg->running_ports->size());
+	//Allocate memory; per port fd, the PKT_OUT notification and, for TX, the
+	//wake-up timer of the egress scheduler of each port
+	n = 2*pg->running_ports->size()+1;
+	*ev = (epoll_event*)calloc(n, sizeof(struct epoll_event));
+	*events = (epoll_event*)calloc(n, sizeof(struct epoll_event));
 
 	if(!*ev || !*events){
 	       //FIXME: what todo...
@@ -127,8 +129,23 @@ void epoll_ioscheduler::init_or_update_fds(portgroup_state* pg, safevector<iopor
 			epoll_ioscheduler::add_fd_epoll( &((*ev)[i]), *epfd, port, fd);
 		}else
 			(*ev)[i].data.ptr = NULL;
+
+		//Wake-up timer of the (parked) output queues
+		if(rx || (*ev)[i].data.ptr == NULL || (fd = port->tx_sched->get_wakeup_fd()) == -1)
+			continue;
+
+		n = *current_num_of_ports+1+i;
+		epoll_ioscheduler::add_fd_epoll( &((*ev)[n]), *epfd, port, fd);
+		((epoll_event_data_t*)(*ev)[i].data.ptr)->write_ev = &((*ev)[i]);
+		((epoll_event_data_t*)(*ev)[n].data.ptr)->write_ev = &((*ev)[i]);
 	}
 
+	//RX threads also process PKT_OUTs
+	if(rx)
+		epoll_ioscheduler::add_fd_epoll( &((*ev)[*current_num_of_ports]), *epfd, NULL, get_packet_out_read_fd());
+	else
+		(*ev)[*current_num_of_ports].data.ptr = NULL;
+
 	//Assign current hash
 	*current_hash = pg->running_hash;	
 
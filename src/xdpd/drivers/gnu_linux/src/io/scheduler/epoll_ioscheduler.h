@@ -16,8 +16,10 @@
 #include "../iomanager.h"
 #include "../bufferpool.h"
 #include "../ports/ioport.h"
+#include "../ports/vlink/ioport_vlink.h"
 #include "../../util/safevector.h"
 #include "../../util/circular_queue.h"
+#include "../pktout_dispatcher.h"
 
 //Make sure pipeline-imp are BEFORE _pp.h
 //so that functions can be inlined
@@ -27,8 +29,8 @@
 
 #include <rofl/datapath/pipeline/openflow/of_switch_pp.h>
 
-//Profiling
-#include "../../util/time_measurements.h"
+//Stage latency
+#include "../../util/stage_latency.h"
 
 /**
 * @file epoll_ioscheduler.h
@@ -48,6 +50,7 @@ class portgroup_state;
 typedef struct epoll_event_data{
 	int fd;
 	ioport* port;
+	struct epoll_event* write_ev; //TX only; event of the port's write fd
 }epoll_event_data_t;
 
 //Max number of ports per port_group
@@ -80,14 +83,12 @@ protected:
 	//READing buckets
 	static const unsigned int READ_BUCKETS_PP=4;
 
-	//WRITing buckets	
-	static const unsigned int WRITE_BUCKETS_PP=4;
-	static const float WRITE_QOS_QUEUE_FACTOR[ioport::MAX_OUTPUT_QUEUES];
+	//WRITing is delegated to the egress scheduler of the port (egress_scheduler)
 
 	/* Methods */
 	//WRR
 	static inline bool process_port_rx(unsigned int tid, ioport* port);
-	static inline int process_port_tx(ioport* port);
+	static inline int process_port_tx(int epfd, epoll_event_data_t* data);
 
 	//EPOLL related	
 	static void release_resources(int epfd, struct epoll_event* ev, struct epoll_event* events, unsigned int current_num_of_ports);
@@ -147,7 +148,6 @@ inline bool epoll_ioscheduler::process_port_rx(unsigned tid, ioport* port){
 				* Process packets
 				*/
 				//Process it through the pipeline
-				TM_STAMP_STAGE(pkt, TM_S3);
 				of_process_packet_pipeline(tid, sw, pkt);
 					
 #ifdef DEBUG
@@ -162,32 +162,28 @@ inline bool epoll_ioscheduler::process_port_rx(unsigned tid, ioport* port){
 	return i==(READ_BUCKETS_PP);
 }
 
-inline int epoll_ioscheduler::process_port_tx(ioport* port){
-	
-	unsigned int q_id;
-	unsigned int n_buckets;
-	int tx_packets=0;
+inline int epoll_ioscheduler::process_port_tx(int epfd, epoll_event_data_t* data){
+
+	int tx_packets;
+	uint32_t events;
+	ioport* port = data->port;
+	struct epoll_event* ev = data->write_ev;
 
 	if(unlikely(!port) || unlikely(!port->of_port_state))
 		return 0;
 
-	//Process output (up to WRITE_BUCKETS[output_queue_state])
-	for(q_id=0; q_id < IO_IFACE_NUM_QUEUES; ++q_id){
-
-		//Fas pre-check (avoid virtual function call overhead)
-		if(port->output_queue_has_packets(q_id) == false)
-			continue;
-		
-		//Increment number of buckets
-		n_buckets = WRITE_BUCKETS_PP*WRITE_QOS_QUEUE_FACTOR[q_id];
+	//Serve the output queues according to the port's egress scheduler
+	tx_packets = port->tx_sched->schedule(port);
 
-		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[%s] Trying to write at port queue: %d with n_buckets: %d.\n", port->of_port_state->name, q_id, n_buckets);
-		
-		//Perform up to n_buckets write	
-		tx_packets += n_buckets - port->write(q_id, n_buckets);
+	//While parked, the (readable) write fd only reports new packets (edge
+	//triggered); the scheduler's wake-up timer reports the rest
+	events = (port->tx_sched->is_parked())? (EPOLLIN | EPOLLPRI | EPOLLET) : (EPOLLIN | EPOLLPRI);
+	if(ev && unlikely(ev->events != events)){
+		ev->events = events;
+		epoll_ctl(epfd, EPOLL_CTL_MOD, ((epoll_event_data_t*)ev->data.ptr)->fd, ev);
 	}
-	
-	return tx_packets; 
+
+	return tx_packets;
 }
 
 template<bool is_rx>
@@ -199,6 +195,7 @@ void* epoll_ioscheduler::process_io(void* grp){
 	unsigned int current_hash=0, current_num_of_ports=0;
 	portgroup_state* pg = (portgroup_state*)grp;
 	ioport* port;
+	epoll_event_data_t* data;
 	safevector<ioport*> ports;	//Ports of the group currently performing I/O operations
 	unsigned int tid;
 	
@@ -214,6 +211,10 @@ void* epoll_ioscheduler::process_io(void* grp){
 	//Set scheduling and priority
 	set_kernel_scheduling();
 
+	//Port counters and latency histograms of this thread go to its own shard
+	ioport_stats::set_thread_shard(pg->id);
+	stage_latency::set_thread_shard(pg->id);
+
 	//Set tid
 	if(pg->id < ROFL_PIPELINE_MAX_TIDS){
 		tid = pg->id;
@@ -223,30 +224,49 @@ void* epoll_ioscheduler::process_io(void* grp){
 			ROFL_ERR(DRIVER_NAME"[epoll_ioscheduler] WARNING: RX portgroup within I/O thread: #%u, with ID %u will have to use locking within rofl-pipeline (ROFL_PIPELINE_LOCKED_TID), since %u >= ROFL_PIPELINE_MAX_TIDS(%u). You should probably compile the pipeline with the support of more running threads or decrease the number of threads in RX/TX groups \n", pthread_self(), pg->id, pg->id, ROFL_PIPELINE_MAX_TIDS);
 		tid = ROFL_PIPELINE_LOCKED_TID;
 	}
+
+	//RX threads consume PKT_OUTs and process vlink peers in run-to-completion
+	if(is_rx){
+		register_packet_out_consumer();
+		ioport_vlink::set_thread_rtc_context(pg->id, tid);
+	}
+
 	/*
 	* Infinite loop unless group is stopped. e.g. all ports detached
 	*/
 	while(likely(iomanager::keep_on_working(pg))){
 
 		//Wait for events or TIMEOUT_MS
-		res = epoll_wait(epfd, events, current_num_of_ports, EPOLL_TIMEOUT_MS);
+		res = epoll_wait(epfd, events, 2*current_num_of_ports+1, EPOLL_TIMEOUT_MS);
 		
 		if(unlikely(res == -1)){
 			//This can occur when interfaces are removed from the system
 		}else{
 
 			if(res == 0){
-				//Timeout
+				//Timeout; let the RX ports recover from stalls that do not
+				//raise events (e.g. AF_XDP fill ring left empty)
+				if(is_rx){
+					for(i=0; i<(int)ports.size(); ++i)
+						epoll_ioscheduler::process_port_rx(tid, ports[i]);
+				}
 			}else{	
 				ROFL_DEBUG_VERBOSE(DRIVER_NAME"[epoll_ioscheduler] Got %d events\n", res); 
 				for(i=0; i<res; ++i){
 					
-					port = ((epoll_event_data_t*)events[i].data.ptr)->port;
+					data = (epoll_event_data_t*)events[i].data.ptr;
+					port = data->port;
+
+					if(is_rx && unlikely(port == NULL)){
+						//PKT_OUT notification
+						process_packet_outs(tid);
+						continue;
+					}
 					
 					if(is_rx)
 						epoll_ioscheduler::process_port_rx(tid, port);
 					else
-						epoll_ioscheduler::process_port_tx(port);
+						epoll_ioscheduler::process_port_tx(epfd, data);
 				}
 			}
 		}
@@ -256,6 +276,9 @@ void* epoll_ioscheduler::process_io(void* grp){
 			init_or_update_fds(pg, ports, &epfd, &ev, &events, &current_num_of_ports, &current_hash, is_rx);
 	}
 
+	if(is_rx)
+		unregister_packet_out_consumer(tid);
+
 	//Release resources
 	release_resources(epfd, ev, events, current_num_of_ports);
 
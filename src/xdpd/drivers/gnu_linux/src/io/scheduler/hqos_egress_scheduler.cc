@@ -0,0 +1,383 @@
+#include "hqos_egress_scheduler.h"
+
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <rofl/common/utils/c_logger.h>
+#include <rofl/datapath/pipeline/switch_port.h>
+#include "../ports/ioport.h"
+#include "../datapacketx86.h"
+#include "../../util/likely.h"
+
+using namespace xdpd::gnu_linux;
+
+//Static members initialization
+const uint16_t hqos_egress_scheduler::DEFAULT_WEIGHTS[IO_IFACE_NUM_QUEUES]={10,12,15,20,22,25,27,30};
+
+hqos_egress_scheduler::hqos_egress_scheduler(){
+
+	unsigned int i;
+
+	pthread_mutex_init(&conf_mutex, NULL);
+
+	for(i=0; i<IO_IFACE_NUM_QUEUES; ++i){
+		conf[i].priority = 0;
+		conf[i].weight = DEFAULT_WEIGHTS[i];
+		conf[i].min_rate = 0;
+		conf[i].max_rate = 0;
+		order[i] = i;
+	}
+
+	memset(queues, 0, sizeof(queues));
+	has_rates = false;
+	port_speed_kbps = 0;
+	last_refill_ns = 0;
+
+	//Applied on the first round
+	conf_version = 0;
+	applied_version = ~0U;
+
+	//Without a timer the port is never parked (polled while shaping)
+	wakeup_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	if(wakeup_fd < 0){
+		ROFL_WARN(DRIVER_NAME"[hqos] Unable to create the wake-up timer: %s\n", strerror(errno));
+		wakeup_fd = -1;
+	}
+}
+
+hqos_egress_scheduler::~hqos_egress_scheduler(){
+	if(wakeup_fd != -1)
+		close(wakeup_fd);
+	pthread_mutex_destroy(&conf_mutex);
+}
+
+rofl_result_t hqos_egress_scheduler::configure_queue(unsigned int q_id, const hal_port_queue_conf_t* queue_conf){
+
+	if(q_id >= IO_IFACE_NUM_QUEUES || !queue_conf || queue_conf->weight == 0)
+		return ROFL_FAILURE;
+
+	pthread_mutex_lock(&conf_mutex);
+
+	//Odd while writing
+	__sync_fetch_and_add(&conf_version, 1);
+	conf[q_id] = *queue_conf;
+	__sync_fetch_and_add(&conf_version, 1);
+
+	pthread_mutex_unlock(&conf_mutex);
+
+	return ROFL_SUCCESS;
+}
+
+uint64_t hqos_egress_scheduler::get_port_speed_kbps(ioport* port){
+
+	switch(port->of_port_state->curr_speed){
+		case PORT_FEATURE_10MB_HD:
+		case PORT_FEATURE_10MB_FD:
+			return 10000;
+		case PORT_FEATURE_100MB_HD:
+		case PORT_FEATURE_100MB_FD:
+			return 100000;
+		case PORT_FEATURE_1GB_HD:
+		case PORT_FEATURE_1GB_FD:
+			return 1000000;
+		case PORT_FEATURE_10GB_FD:
+			return 10000000;
+		default:
+			return IO_TX_HQOS_DEFAULT_PORT_SPEED_KBPS;
+	}
+}
+
+inline void hqos_egress_scheduler::set_bucket(token_bucket_t* tb, uint64_t speed_kbps, uint16_t rate){
+
+	if(rate == 0 || rate > HAL_PORT_QUEUE_MAX_RATE){
+		tb->rate = 0;
+		tb->depth = tb->tokens = 0;
+		return;
+	}
+
+	//kbps*1000/8 bytes/s * rate/1000
+	tb->rate = speed_kbps*rate/8;
+	tb->depth = tb->rate*IO_TX_HQOS_BURST_US/1000000;
+	if(tb->depth < MIN_BUCKET_DEPTH)
+		tb->depth = MIN_BUCKET_DEPTH;
+	tb->tokens = tb->depth;
+}
+
+void hqos_egress_scheduler::apply_conf(ioport* port){
+
+	unsigned int i, j, tmp;
+	uint32_t version;
+	hal_port_queue_conf_t c[IO_IFACE_NUM_QUEUES];
+	hqos_queue_t* q;
+	struct timespec ts;
+
+	//Read a consistent copy, or retry on the next round
+	version = conf_version;
+	if(version & 0x1)
+		return;
+	__sync_synchronize();
+	memcpy(c, conf, sizeof(c));
+	__sync_synchronize();
+	if(version != conf_version)
+		return;
+
+	port_speed_kbps = get_port_speed_kbps(port);
+	has_rates = false;
+
+	for(i=0; i<IO_IFACE_NUM_QUEUES; ++i){
+		q = &queues[i];
+		q->priority = c[i].priority;
+		q->quantum = (int64_t)c[i].weight*IO_TX_HQOS_QUANTUM/10;
+		if(q->quantum < 1)
+			q->quantum = 1;
+		q->min_rate = c[i].min_rate;
+		q->max_rate = c[i].max_rate;
+		set_bucket(&q->min, port_speed_kbps, q->min_rate);
+		set_bucket(&q->max, port_speed_kbps, q->max_rate);
+		q->deficit = 0;
+
+		if(q->min.rate || q->max.rate)
+			has_rates = true;
+	}
+
+	//Serve order; highest priority first
+	for(i=0; i<IO_IFACE_NUM_QUEUES; ++i)
+		order[i] = i;
+	for(i=1; i<IO_IFACE_NUM_QUEUES; ++i){
+		for(j=i; j>0 && queues[order[j-1]].priority < queues[order[j]].priority; --j){
+			tmp = order[j];
+			order[j] = order[j-1];
+			order[j-1] = tmp;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	last_refill_ns = (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+
+	applied_version = version;
+
+	ROFL_DEBUG(DRIVER_NAME"[hqos][%s] Egress scheduling configuration applied (port speed: %llu kbps)\n", port->of_port_state->name, (long long unsigned)port_speed_kbps);
+}
+
+inline void hqos_egress_scheduler::refill(){
+
+	unsigned int i;
+	uint64_t now, elapsed;
+	token_bucket_t* tb;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	now = (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+	elapsed = now - last_refill_ns;
+	last_refill_ns = now;
+
+	//Buckets are full after 1s anyway (and this prevents overflows)
+	if(elapsed > 1000000000ULL)
+		elapsed = 1000000000ULL;
+
+	for(i=0; i<IO_IFACE_NUM_QUEUES; ++i){
+		tb = &queues[i].min;
+		if(tb->rate){
+			tb->tokens += tb->rate*elapsed/1000000000ULL;
+			if(tb->tokens > tb->depth)
+				tb->tokens = tb->depth;
+		}
+		tb = &queues[i].max;
+		if(tb->rate){
+			tb->tokens += tb->rate*elapsed/1000000000ULL;
+			if(tb->tokens > tb->depth)
+				tb->tokens = tb->depth;
+		}
+	}
+}
+
+/*
+* Write as many packets of q_id as the mode (min rate or deficit), the max
+* rate and the budget allow. Packet lengths are peeked from the queue, and only
+* the packets actually written are charged.
+*
+* @return number of packets written
+*/
+inline unsigned int hqos_egress_scheduler::serve(ioport* port, unsigned int q_id, serve_mode_t mode, unsigned int* budget, bool* port_busy){
+
+	unsigned int i, n, sent;
+	int64_t bytes, len, lens[MAX_BATCH];
+	datapacket_t* pkt;
+	hqos_queue_t* q = &queues[q_id];
+	int64_t credit = (mode == SERVE_MIN_RATE)? q->min.tokens : q->deficit;
+
+	for(n=0, bytes=0; n < *budget && n < MAX_BATCH; ++n){
+
+		pkt = port->output_queue_peek(q_id, n);
+		if(!pkt)
+			break;
+
+		len = ((datapacketx86*)pkt->platform_state)->get_buffer_length();
+
+		if(bytes+len > credit)
+			break;
+		if(q->max.rate && bytes+len > q->max.tokens)
+			break;
+
+		lens[n] = len;
+		bytes += len;
+	}
+
+	if(n == 0)
+		return 0;
+
+	sent = n - port->write(q_id, n);
+
+	//TX ring full
+	if(sent < n)
+		*port_busy = true;
+
+	for(i=0, bytes=0; i<sent; ++i)
+		bytes += lens[i];
+
+	if(mode == SERVE_MIN_RATE)
+		q->min.tokens -= bytes;
+	else
+		q->deficit -= bytes;
+	if(q->max.rate)
+		q->max.tokens -= bytes;
+
+	*budget -= sent;
+
+	return sent;
+}
+
+/*
+* Arm the wake-up timer rel_ns from now; 0 disarms it. Either way, pending
+* expirations are cleared.
+*/
+inline void hqos_egress_scheduler::arm_wakeup_timer(uint64_t rel_ns){
+
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = rel_ns / 1000000000ULL;
+	its.it_value.tv_nsec = rel_ns % 1000000000ULL;
+
+	timerfd_settime(wakeup_fd, 0, &its, NULL);
+}
+
+/*
+* Park the port if the backlog can only make progress once a max rate
+* bucket has enough tokens for the head packet of its queue
+*/
+inline void hqos_egress_scheduler::park(ioport* port){
+
+	unsigned int q_id;
+	int64_t missing;
+	uint64_t wait_ns, min_wait_ns = 0;
+	datapacket_t* pkt;
+	hqos_queue_t* q;
+
+	if(wakeup_fd == -1)
+		return;
+
+	for(q_id=0; q_id<IO_IFACE_NUM_QUEUES; ++q_id){
+
+		pkt = port->output_queue_peek(q_id, 0);
+		if(!pkt)
+			continue;
+
+		//Not shaped, or it can already make progress
+		q = &queues[q_id];
+		if(!q->max.rate)
+			return;
+		missing = (int64_t)((datapacketx86*)pkt->platform_state)->get_buffer_length() - q->max.tokens;
+		if(missing <= 0)
+			return;
+
+		wait_ns = (uint64_t)missing*1000000000ULL/q->max.rate + 1;
+		if(!min_wait_ns || wait_ns < min_wait_ns)
+			min_wait_ns = wait_ns;
+	}
+
+	//No backlog
+	if(!min_wait_ns)
+		return;
+
+	arm_wakeup_timer(min_wait_ns);
+	parked = true;
+}
+
+unsigned int hqos_egress_scheduler::schedule(ioport* port){
+
+	unsigned int i, j, end, q_id, sent;
+	unsigned int budget = IO_TX_HQOS_ROUND_BUDGET;
+	unsigned int tx_packets = 0;
+	bool port_busy = false, active;
+	uint8_t prio;
+	hqos_queue_t* q;
+
+	if(unlikely(parked)){
+		arm_wakeup_timer(0);
+		parked = false;
+	}
+
+	if(unlikely(applied_version != conf_version))
+		apply_conf(port);
+
+	if(has_rates){
+		//Link speed changed
+		if(unlikely(get_port_speed_kbps(port) != port_speed_kbps))
+			apply_conf(port);
+
+		refill();
+
+		//Guaranteed rates first
+		for(i=0; i<IO_IFACE_NUM_QUEUES && budget && !port_busy; ++i){
+			q_id = order[i];
+			if(queues[q_id].min.rate == 0 || port->output_queue_has_packets(q_id) == false)
+				continue;
+			tx_packets += serve(port, q_id, SERVE_MIN_RATE, &budget, &port_busy);
+		}
+	}
+
+	//Strict priority classes
+	for(i=0; i<IO_IFACE_NUM_QUEUES && budget && !port_busy; i=end){
+
+		prio = queues[order[i]].priority;
+		for(end=i; end<IO_IFACE_NUM_QUEUES && queues[order[end]].priority == prio; ++end);
+
+		//DRR within the class, while any of its queues can make progress
+		do{
+			active = false;
+
+			for(j=i; j<end && budget && !port_busy; ++j){
+				q_id = order[j];
+				q = &queues[q_id];
+
+				if(port->output_queue_has_packets(q_id) == false){
+					q->deficit = 0;
+					continue;
+				}
+
+				q->deficit += q->quantum;
+				sent = serve(port, q_id, SERVE_DRR, &budget, &port_busy);
+				tx_packets += sent;
+
+				if(port->output_queue_has_packets(q_id) == false){
+					q->deficit = 0;
+				}else if(q->max.rate && q->max.tokens < q->deficit){
+					//Shaped; do not accumulate credit while waiting for tokens
+					if(q->deficit > q->quantum)
+						q->deficit = q->quantum;
+				}else{
+					active = true;
+				}
+			}
+		}while(active && budget && !port_busy);
+	}
+
+	//Backlog waiting for tokens; do not let the TX thread spin on the port
+	if(has_rates && budget && !port_busy)
+		park(port);
+
+	return tx_packets;
+}
@@ -0,0 +1,125 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HQOS_EGRESS_SCHEDULER_H
+#define HQOS_EGRESS_SCHEDULER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "egress_scheduler.h"
+
+/**
+* @file hqos_egress_scheduler.h
+*
+* @brief Hierarchical egress scheduler: strict priority classes, byte
+* based DRR within a class and per queue min/max rates
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* @brief Hierarchical egress scheduler
+*
+* @ingroup driver_gnu_linux_io_schedulers
+*
+* @description Every scheduling round (up to IO_TX_HQOS_ROUND_BUDGET packets):
+*
+* 1. Queues with a min_rate are served up to their guaranteed rate (token
+*    bucket), in priority order.
+* 2. Classes are served in strict priority order (highest first). Within a
+*    class, queues are served with byte based Deficit Round Robin; the quantum
+*    of a queue is weight*IO_TX_HQOS_QUANTUM/10 bytes (weight 10 is one
+*    IO_TX_HQOS_QUANTUM).
+*
+* In both steps, queues with a max_rate never exceed it (token bucket). Rates
+* are in 1/10 of a percent of the port speed, as in OpenFlow.
+*
+* If the round ends with a backlog that is only held back by max rates, the
+* port is parked and the wake-up timer is armed at the time the first of
+* these queues has enough tokens for its head packet.
+*
+* By default all queues are in the same class, without rates, and with the
+* weights of the legacy WRR scheduler (higher queue ids get more bandwidth).
+*/
+class hqos_egress_scheduler : public egress_scheduler{
+
+public:
+	hqos_egress_scheduler(void);
+	virtual ~hqos_egress_scheduler(void);
+
+	virtual unsigned int schedule(ioport* port);
+	virtual rofl_result_t configure_queue(unsigned int q_id, const hal_port_queue_conf_t* conf);
+
+	virtual int get_wakeup_fd(void){
+		return wakeup_fd;
+	}
+
+protected:
+	//Max packets written per call to ioport::write()
+	static const unsigned int MAX_BATCH=32;
+
+	//Min token bucket depth; a jumbo frame must always fit
+	static const int64_t MIN_BUCKET_DEPTH=10000;
+
+	//Default weights (legacy WRR factors*10); quantum is weight*IO_TX_HQOS_QUANTUM/10
+	static const uint16_t DEFAULT_WEIGHTS[IO_IFACE_NUM_QUEUES];
+
+	typedef struct token_bucket{
+		uint64_t rate;		//bytes/s; 0 disabled
+		int64_t depth;		//bytes
+		int64_t tokens;		//bytes
+	}token_bucket_t;
+
+	typedef struct hqos_queue{
+		uint8_t priority;
+		int64_t quantum;
+		uint16_t min_rate;	//1/10 %
+		uint16_t max_rate;	//1/10 %
+		token_bucket_t min;
+		token_bucket_t max;
+		int64_t deficit;
+	}hqos_queue_t;
+
+	typedef enum{
+		SERVE_MIN_RATE,
+		SERVE_DRR,
+	}serve_mode_t;
+
+	/*
+	* Configuration; written by the management threads (conf_mutex) and
+	* applied by the TX thread when conf_version changes (seqlock; odd while
+	* being written)
+	*/
+	hal_port_queue_conf_t conf[IO_IFACE_NUM_QUEUES];
+	volatile uint32_t conf_version;
+	pthread_mutex_t conf_mutex;
+
+	/*
+	* TX thread state
+	*/
+	uint32_t applied_version;
+	hqos_queue_t queues[IO_IFACE_NUM_QUEUES];
+	unsigned int order[IO_IFACE_NUM_QUEUES];	//Queue ids, by priority (desc)
+	bool has_rates;
+	uint64_t port_speed_kbps;
+	uint64_t last_refill_ns;
+
+	//Wake-up timer (timerfd) of the parked port
+	int wakeup_fd;
+
+	void apply_conf(ioport* port);
+	inline void refill(void);
+	inline unsigned int serve(ioport* port, unsigned int q_id, serve_mode_t mode, unsigned int* budget, bool* port_busy);
+	inline void park(ioport* port);
+	inline void arm_wakeup_timer(uint64_t rel_ns);
+
+	static uint64_t get_port_speed_kbps(ioport* port);
+	static inline void set_bucket(token_bucket_t* tb, uint64_t speed_kbps, uint16_t rate);
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* HQOS_EGRESS_SCHEDULER_H_ */
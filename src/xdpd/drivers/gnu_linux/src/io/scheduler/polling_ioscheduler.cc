@@ -29,7 +29,6 @@
 using namespace xdpd::gnu_linux;
 
 //Static members initialization
-const float polling_ioscheduler::WRITE_QOS_QUEUE_FACTOR[ioport::MAX_OUTPUT_QUEUES]={1,1.2,1.5,2,2.2,2.5,2.7,3.0};
 
 #ifdef DEBUG
 bool polling_ioscheduler::by_pass_processing = false;
@@ -40,7 +39,7 @@ bool polling_ioscheduler::by_pass_processing = false;
 */
 inline void polling_ioscheduler::process_port_io(ioport* port){
 
-	unsigned int i, q_id, n_buckets;
+	unsigned int i;
 	datapacket_t* pkt;
 	
 	if(!port || !port->of_port_state)
@@ -85,17 +84,8 @@ inline void polling_ioscheduler::process_port_io(ioport* port){
 		}
 	}
 
-	//Process output up to WRITE_BUCKETS_PP
-	for(q_id=0; q_id < IO_IFACE_NUM_QUEUES; ++q_id){
-		
-		//Increment number of buckets
-		n_buckets = WRITE_BUCKETS_PP*WRITE_QOS_QUEUE_FACTOR[q_id];
-
-		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[%s] Trying to write at port queue: %d with n_buckets: %d.\n", port->of_port_state->name, q_id, n_buckets);
-		
-		//Perform up to n_buckets write	
-		port->write(q_id,n_buckets);
-	}
+	//Process output according to the port's egress scheduler
+	port->tx_sched->schedule(port);
 
 }
 
@@ -144,6 +134,10 @@ void* polling_ioscheduler::process_io(void* grp){
 	portgroup_state* pg = (portgroup_state*)grp;
 	ioport** running_ports=NULL; //C-array of ioports
  
+	//Port counters and latency histograms of this thread go to its own shard
+	ioport_stats::set_thread_shard(pg->id);
+	stage_latency::set_thread_shard(pg->id);
+
 	//Update 
 	update_running_ports(pg, &running_ports, &num_of_ports, &current_hash);	
 
@@ -61,9 +61,7 @@ protected:
 	//READing buckets
 	static const unsigned int READ_BUCKETS_PP=4;
 
-	//WRITing buckets	
-	static const unsigned int WRITE_BUCKETS_PP=4;
-	static const float WRITE_QOS_QUEUE_FACTOR[ioport::MAX_OUTPUT_QUEUES];
+	//WRITing is delegated to the egress scheduler of the port (egress_scheduler)
 
 	/* Methods */
 	//WRR
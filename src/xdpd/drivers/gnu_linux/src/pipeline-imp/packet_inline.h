@@ -41,14 +41,15 @@ using namespace xdpd::gnu_linux;
 
 /* Cloning of the packet */
 STATIC_PACKET_INLINE__
-void clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
+rofl_result_t clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
 
 	//Initialize buffer
 	datapacketx86 *pack_src = (datapacketx86*)src->platform_state;
 	datapacketx86 *pack_dst = (datapacketx86*)dst->platform_state;
 	
-	//Initialize the buffer and copy but do not classify
-	pack_dst->init(pack_src->get_buffer(), pack_src->get_buffer_length(), pack_src->lsw, pack_src->clas_state.port_in, pack_src->clas_state.phy_port_in, false, true);
+	//Initialize the buffer and copy but do not classify (jumbo frames may not find a buffer)
+	if(unlikely(pack_dst->init(pack_src->get_buffer(), pack_src->get_buffer_length(), pack_src->lsw, pack_src->clas_state.port_in, pack_src->clas_state.phy_port_in, false, true) != ROFL_SUCCESS))
+		return ROFL_FAILURE;
 
 	//Copy output_queue
 	pack_dst->output_queue = pack_src->output_queue;
@@ -58,6 +59,8 @@ void clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
 	pack_dst->clas_state.port_in = pack_src->clas_state.port_in;
 	pack_dst->clas_state.phy_port_in = pack_src->clas_state.phy_port_in;
 	pack_dst->clas_state.calculate_checksums_in_sw = pack_src->clas_state.calculate_checksums_in_sw;
+
+	return ROFL_SUCCESS;
 }
 
 STATIC_PACKET_INLINE__
@@ -71,6 +74,8 @@ STATIC_PACKET_INLINE__
 void platform_packet_drop(datapacket_t* pkt)
 {
 	ROFL_DEBUG(DRIVER_NAME"[pkt] Dropping packet(%p)\n",pkt);
+
+	STAGE_LATENCY_DROP(pkt, SL_PIPELINE);
 	
 	//Release buffer
 	bufferpool::release_buffer(pkt);
@@ -85,7 +90,7 @@ void output_single_packet(datapacket_t* pkt, datapacketx86* pack, switch_port_t*
 		
 		ROFL_DEBUG(DRIVER_NAME"[pkt][%s] OUTPUT packet(%p)\n", port->name, pkt);
 
-		TM_STAMP_STAGE(pkt, TM_SA5_PRE);
+		STAGE_LATENCY_STAMP(pkt, SL_PIPELINE);
 		
 		//Schedule in the port
 		ioport* ioport_inst = (ioport*)port->platform_port_state; 
@@ -129,7 +134,11 @@ datapacket_t* platform_packet_replicate(datapacket_t* pkt){
 	copy->sw = pkt->sw;
 
 	//Clone contents
-	clone_pkt_contents(pkt,copy);
+	if(unlikely(clone_pkt_contents(pkt,copy) != ROFL_SUCCESS)){
+		bufferpool::release_buffer(copy);
+		return NULL;
+	}
+
 	return copy;	
 }
 
@@ -186,6 +195,8 @@ void platform_packet_output(datapacket_t* pkt, switch_port_t* output_port){
 
 			//replicate packet
 			replica = platform_packet_replicate(pkt); 	
+			if(unlikely(!replica))
+				continue;
 			replica_pack = (datapacketx86*) (replica->platform_state);
 
 			ROFL_DEBUG(DRIVER_NAME"[pkt][%s] OUTPUT FLOOD packet(%p), origin(%p)\n", port_it->name, replica, pkt);
@@ -15,7 +15,7 @@
 #include "../io/pktin_dispatcher.h"
 
 //Time measurements
-#include "../util/time_measurements.h"
+#include "../util/stage_latency.h"
 
 using namespace xdpd::gnu_linux;
 
@@ -30,6 +30,16 @@ rofl_result_t platform_post_init_of1x_switch(of1x_switch_t* sw){
 
 	ls_int->pkt_in_queue = new circular_queue<datapacket_t>(LSI_PKT_IN_QUEUE_SLOTS);
 	ls_int->storage = new datapacket_storage( LSI_PKT_IN_STORAGE_MAX_BUF, LSI_PKT_IN_STORAGE_EXPIRATION_S); // todo make this value configurable
+	ls_int->pkt_out = init_packet_out_state((of_switch_t*)sw);
+	pktin_policer_init(&ls_int->policer);
+
+	if(!ls_int->pkt_out){
+		ROFL_ERR(DRIVER_NAME" Unable to allocate PKT_OUT state for switch: %s\n", sw->name);
+		delete ls_int->pkt_in_queue;
+		delete ls_int->storage;
+		free(ls_int);
+		return ROFL_FAILURE;
+	}
 
 	sw->platform_state = (of_switch_platform_state_t*)ls_int;
 
@@ -76,6 +86,7 @@ rofl_result_t platform_pre_destroy_of1x_switch(of1x_switch_t* sw){
 	
 	delete ls_int->pkt_in_queue;
 	delete ls_int->storage;
+	destroy_packet_out_state(ls_int->pkt_out);
 	free(sw->platform_state);
 	
 	return ROFL_SUCCESS;
@@ -93,6 +104,16 @@ void platform_of1x_packet_in(const of1x_switch_t* sw, uint8_t table_id, datapack
 	datapacketx86* pkt_x86;
 	switch_platform_state_t* ls_state = (switch_platform_state_t*)sw->platform_state;
 
+	//Police before using any resource of the PKT_IN path
+	if(unlikely(pktin_policer_filter(&ls_state->policer))){
+		ROFL_DEBUG(DRIVER_NAME" PKT_IN for packet(%p) exceeds the configured rate for sw:%s. Dropping..\n",pkt,sw->name);
+		STAGE_LATENCY_DROP(pkt, SL_PIPELINE);
+
+		//Return to the bufferpool
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+
 	ROFL_DEBUG(DRIVER_NAME" Enqueuing PKT_IN event for packet(%p) in switch: %s\n",pkt,sw->name);
 	
 	//Recover platform state and fill it so that state can be recovered afterwards
@@ -101,23 +122,19 @@ void platform_of1x_packet_in(const of1x_switch_t* sw, uint8_t table_id, datapack
 	pkt_x86->pktin_reason = reason;
 	pkt_x86->pktin_send_len = send_len;
 	
-	//Timestamp SB6_PRE	
-	TM_STAMP_STAGE(pkt, TM_SB5_PRE);
+	//Stamp before enqueuing; the PKT_IN dispatcher owns the packet afterwards
+	STAGE_LATENCY_STAMP(pkt, SL_PIPELINE);
 		
 	//Enqueue
 	if( ls_state->pkt_in_queue->non_blocking_write(pkt) == ROFL_SUCCESS ){
 		//Notify
 		notify_packet_in();
-			
-		//Timestamp SB6_SUCCESS	
-		TM_STAMP_STAGE(pkt, TM_SB5_SUCCESS);
 	}else{
 		ROFL_DEBUG(DRIVER_NAME" PKT_IN for packet(%p) could not be sent for sw:%s (PKT_IN queue full). Dropping..\n",pkt,sw->name);
+		STAGE_LATENCY_DROP(pkt, SL_PKT_IN_QUEUE);
+
 		//Return to the bufferpool
 		bufferpool::release_buffer(pkt);
-
-		//Timestamp SB6_FAILURE
-		TM_STAMP_STAGE(pkt, TM_SB5_FAILURE);
 	}
 }
 
@@ -7,7 +7,9 @@
 
 #include "../config.h"
 #include "../util/circular_queue.h"
+#include "../util/pktin_policer.h"
 #include "../io/datapacket_storage.h"
+#include "../io/pktout_dispatcher.h"
 
 /**
 * @file ls_internal_state.h
@@ -21,9 +23,15 @@ namespace xdpd {
 namespace gnu_linux {
 
 typedef struct switch_platform_state {
-	//PKT_IN queue
+	//PKT_IN queue (MPMC: drained by the mgmt thread on LSI destruction)
 	circular_queue<datapacket_t>* pkt_in_queue; 
 
+	//PKT_IN policer (applied by the I/O threads, before enqueuing)
+	pktin_policer_t policer;
+
+	//PKT_OUT queue
+	pktout_state_t* pkt_out;
+
         //Packet storage pointer 
         datapacket_storage* storage;
 }switch_platform_state_t;
@@ -5,6 +5,7 @@
 #ifndef CIRCULAR_QUEUE_H
 #define CIRCULAR_QUEUE_H 1
 
+#include <stdint.h>
 #include <string.h>
 #include <pthread.h>
 #include <rofl_datapath.h>
@@ -12,246 +13,287 @@
 #include <rofl/common/utils/c_logger.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sched.h>
 
 #include "likely.h"
 
-/*
- * Implementation of a ring elements
- */
+/**
+* @file circular_queue.h
+*
+* @brief Lock-free ring of (pointers to) elements
+*/
 
 namespace xdpd {
 namespace gnu_linux {
 
-//#define PTHREAD_IMP 1 
+//Cache line size used to separate the producer and consumer indexes
+#define CQ_CACHE_LINE_SIZE 64
+
+//Spins waiting for a preceding producer (consumer) to commit before yielding
+//the CPU (it might have been preempted)
+#define CQ_SPINS_BEFORE_YIELD 1024
 
 //Exception
 class eCircularQueueInvalidSize{};
 
-template<typename T>
+/**
+* Producer/consumer shape of a circular_queue. Use the cheapest one that
+* fits the site: single producer/consumer sides need no atomic operations.
+*/
+typedef enum circular_queue_sync{
+	CQ_SPSC,	//Single producer, single consumer
+	CQ_MPSC,	//Multiple producers, single consumer
+	CQ_MPMC,	//Multiple producers, multiple consumers
+}circular_queue_sync_t;
+
+/**
+* @brief Lock-free ring (power of two slots).
+*
+* Producers and consumers each have a head (reservation) and a tail (commit)
+* index, in separate cache lines. Indexes are free-running 32 bit counters,
+* masked on access. A multi-producer (consumer) side reserves slots with a
+* single CAS on its head, and commits them in order by updating the tail;
+* single-producer (consumer) sides use plain stores. The bulk operations
+* reserve and commit all the elements at once.
+*
+* As with the previous implementation, one slot is always kept empty, so
+* the capacity is slots-1.
+*/
+template<typename T, circular_queue_sync_t SYNC=CQ_MPMC>
 class circular_queue{
 
 public:
 	//Constructor
 	circular_queue(long long unsigned int capacity);
 	~circular_queue(void);
-	
+
 	//Read
 	inline T* non_blocking_read(void);
-	//inline T* blocking_read(unsigned int seconds=0);
 
 	//Write
 	inline rofl_result_t non_blocking_write(T* elem);
-	//inline rofl_result_t blocking_write(T* elem, unsigned int seconds=0);
 
-	//
-	inline unsigned int size(void)
-	{
-		return (writep >= readp) ? (writep-readp) : slots - (readp-writep);
+	/**
+	* Enqueue up to n elements
+	* @return number of elements enqueued
+	*/
+	inline unsigned int enqueue_bulk(T* const* elems, unsigned int n);
+
+	/**
+	* Dequeue up to n elements
+	* @return number of elements dequeued
+	*/
+	inline unsigned int dequeue_bulk(T** elems, unsigned int n);
+
+	/**
+	* Peek the i-th element from the head, without dequeuing it. Only valid
+	* for single consumer queues (or from the consumer side of an MPSC one)
+	* @return the element or NULL if there are not more than i elements
+	*/
+	inline T* peek(unsigned int i){
+		uint32_t head = cons.head;
+		if(i >= prod.tail - head)
+			return NULL;
+		barrier();
+		return elements[(head+i) & mask];
 	}
 
-	inline bool is_empty(void);
-	inline bool is_empty(T*** write, T*** read);
-	inline bool is_full(void);
-	inline bool is_full(T*** write, T*** read);
-
-	long long unsigned int slots;
-
-	void dump(void)  __attribute__((used));
-private:
-	//Buffer
-	T** elements;
+	inline unsigned int size(void){
+		return prod.tail - cons.tail;
+	}
 
-	T** writep;
-	T** _writep; //used only between writers (assembly 2 stage commit)
-	T** readp;
+	inline bool is_empty(void){
+		return prod.tail == cons.tail;
+	}
 
-	//Condition for blocking calls
-	pthread_cond_t write_cond;
-	pthread_cond_t read_cond;
+	inline bool is_full(void){
+		return size() == mask;
+	}
 
-	//Only used when multi-readers enabled
-	pthread_mutex_t mutex_readers;
-	pthread_mutex_t mutex_writers;
+	long long unsigned int slots;
 
-	/* Private methods */
-	void update_elements_state();
-	T** circ_inc_pointer(T** pointer);
+	void dump(void)  __attribute__((used));
 
-};
+private:
 
-//Utility funcs
-template<typename T>
-inline bool circular_queue<T>::is_full(){
-	// todo would perform slightly better using "int readpos,writepos"
-	return ((size_t)(writep + 1 - elements) & (slots-1)) == (size_t)(readp - elements);
-}
+	//Head/tail pair, alone in its cache line
+	typedef struct headtail{
+		volatile uint32_t head;
+		volatile uint32_t tail;
+	}__attribute__((aligned(CQ_CACHE_LINE_SIZE))) headtail_t;
 
-template<typename T>
-inline bool circular_queue<T>::is_full(T*** write, T*** read){
-	return ((size_t)(*write + 1 - elements) & (slots-1)) == (size_t)(*read - elements);
-}
+	//Read-only after construction
+	T** elements;
+	uint32_t mask;
 
-template<typename T>
-inline bool circular_queue<T>::is_empty(){
-	return writep == readp;
-}
+	headtail_t prod;
+	headtail_t cons;
 
-template<typename T>
-inline bool circular_queue<T>::is_empty(T*** write, T*** read){
-	return *write == *read;
-}
+	static inline bool multi_producer(void){ return SYNC != CQ_SPSC; }
+	static inline bool multi_consumer(void){ return SYNC == CQ_MPMC; }
 
-template<typename T>
-inline T** circular_queue<T>::circ_inc_pointer(T** pointer){
-	if ((elements + slots) == (pointer + 1) )
-		return &elements[0];
-	else
-		return pointer+1;
-}
+	static inline void relax(unsigned int* spins){
+		if(unlikely(++(*spins) == CQ_SPINS_BEFORE_YIELD)){
+			*spins = 0;
+			sched_yield();
+			return;
+		}
+#if defined(__i386__) || defined(__x86_64__)
+		__asm__ __volatile__("pause" ::: "memory");
+#else
+		__sync_synchronize();
+#endif
+	}
 
-template<typename T>
-circular_queue<T>::circular_queue(long long unsigned int capacity){
+	//Orders the slot accesses with respect to the index updates. x86 does not
+	//reorder stores with older stores, nor loads with older loads
+	static inline void barrier(void){
+#if defined(__i386__) || defined(__x86_64__)
+		__asm__ __volatile__("" ::: "memory");
+#else
+		__sync_synchronize();
+#endif
+	}
+};
 
+template<typename T, circular_queue_sync_t SYNC>
+circular_queue<T, SYNC>::circular_queue(long long unsigned int capacity){
 
-	if( ( (capacity & (capacity - 1)) != 0 ) || capacity == 0){
+	if( ( (capacity & (capacity - 1)) != 0 ) || capacity == 0 || capacity > (1ULL<<31) ){
 		//Not power of 2!!
-		ROFL_ERR("Unable to instantiate queue of size: %u. It is not power of 2! Revise your settings",capacity);
+		ROFL_ERR("Unable to instantiate queue of size: %llu. It is not power of 2! Revise your settings",capacity);
 		throw eCircularQueueInvalidSize();
 	}
 
 	//Allocate
 	elements = new T*[capacity];
 	slots = capacity;
+	mask = capacity-1;
 
 	//Set 0 structure
 	memset(elements, 0, sizeof(T*)*capacity);
 
-	//Set pointers
-	writep = _writep = readp = elements;
-
-	//Init conditions
-	pthread_cond_init(&write_cond, NULL);
-	pthread_cond_init(&read_cond, NULL);
-
-	//Mutexes
-	pthread_mutex_init(&mutex_readers, NULL);
-	pthread_mutex_init(&mutex_writers, NULL);
+	//Set indexes
+	prod.head = prod.tail = cons.head = cons.tail = 0;
 }
 
-template<typename T>
-circular_queue<T>::~circular_queue(){
-
-	//Destroy
-	pthread_cond_destroy(&write_cond);
-	pthread_cond_destroy(&read_cond);
-	pthread_mutex_destroy(&mutex_readers);
-	pthread_mutex_destroy(&mutex_writers);
-	
+template<typename T, circular_queue_sync_t SYNC>
+circular_queue<T, SYNC>::~circular_queue(){
 	delete[] elements;
 }
 
-//Read
-template<typename T>
-T* circular_queue<T>::non_blocking_read(void){
-
+template<typename T, circular_queue_sync_t SYNC>
+inline unsigned int circular_queue<T, SYNC>::enqueue_bulk(T* const* elems, unsigned int n){
 
-#ifndef PTHREAD_IMP
-	T** next, **read_cpy;
-	T* to_return;
+	uint32_t head, next, free_slots;
+	unsigned int i;
 
+	//Reserve
 	do{
-		//Recover current read pointer: MUST BE HERE
-		read_cpy = readp;
+		head = prod.head;
+		free_slots = mask + cons.tail - head;
 
-		if (unlikely(is_empty(&writep, &read_cpy))) {
-			return NULL;
-		}
-		
-		to_return = *read_cpy;
-		
-		//Calculate readp+1
-		next = circ_inc_pointer(read_cpy); 
+		if(unlikely(n > free_slots))
+			n = free_slots;
+		if(unlikely(n == 0))
+			return 0;
 
-	//Try to set it atomically
-	}while(__sync_bool_compare_and_swap(&readp, read_cpy, next) != true);
+		next = head + n;
 
-	return to_return;
-#else	
-	T* elem;
-	
-	pthread_mutex_lock(&mutex_readers);
-	
-	if (is_empty()) {
-		pthread_mutex_unlock(&mutex_readers);
-		return NULL;
-	}
+		if(!multi_producer()){
+			prod.head = next;
+			break;
+		}
+	}while(unlikely(__sync_bool_compare_and_swap(&prod.head, head, next) != true));
 
-	elem = *readp;
-	//*readp = NULL;
-	readp = circ_inc_pointer(readp);
+	//Fill
+	for(i=0;i<n;++i)
+		elements[(head+i) & mask] = elems[i];
 
-	pthread_mutex_unlock(&mutex_readers);
-	
-	return elem;
-#endif
-}
+	barrier();
 
+	//Commit in order; wait for the preceding producers
+	if(multi_producer()){
+		unsigned int spins = 0;
+		while(unlikely(prod.tail != head))
+			relax(&spins);
+	}
+	prod.tail = next;
 
-//Write
-template<typename T>
-rofl_result_t circular_queue<T>::non_blocking_write(T* elem){
+	return n;
+}
 
-#ifndef PTHREAD_IMP
+template<typename T, circular_queue_sync_t SYNC>
+inline unsigned int circular_queue<T, SYNC>::dequeue_bulk(T** elems, unsigned int n){
 
-	T** next, **write_cpy;
+	uint32_t head, next, entries;
+	unsigned int i;
 
-	//Increment
+	//Reserve
 	do{
+		head = cons.head;
+		entries = prod.tail - head;
 
-		//Calculate writep+1: MUST BE HERE
-		write_cpy = _writep;
+		if(n > entries)
+			n = entries;
+		if(n == 0)
+			return 0;
 
-		if(unlikely(is_full(&write_cpy, &readp))) {
-			return ROFL_FAILURE;
+		next = head + n;
+
+		if(!multi_consumer()){
+			cons.head = next;
+			break;
 		}
-		
-		next = circ_inc_pointer(write_cpy); 
+	}while(unlikely(__sync_bool_compare_and_swap(&cons.head, head, next) != true));
 
-	//Try to set writers only index atomically
-	}while(__sync_bool_compare_and_swap(&_writep, write_cpy, next) != true);
+	barrier();
 
-	*write_cpy = elem;
+	//Copy
+	for(i=0;i<n;++i)
+		elems[i] = elements[(head+i) & mask];
 
-	//Two stage commit, now let readers read it 
-	while(__sync_bool_compare_and_swap(&writep, write_cpy, next) != true);
+	barrier();
 
-	return ROFL_SUCCESS;
+	//Release the slots in order; wait for the preceding consumers
+	if(multi_consumer()){
+		unsigned int spins = 0;
+		while(unlikely(cons.tail != head))
+			relax(&spins);
+	}
+	cons.tail = next;
 
-#else
+	return n;
+}
+
+//Read
+template<typename T, circular_queue_sync_t SYNC>
+inline T* circular_queue<T, SYNC>::non_blocking_read(void){
 
-	pthread_mutex_lock(&mutex_writers);
+	T* elem;
 
-	if (is_full()) {
-		pthread_mutex_unlock(&mutex_writers);
-		return ROFL_FAILURE;
-	}
+	if(dequeue_bulk(&elem, 1) == 0)
+		return NULL;
+
+	return elem;
+}
 
-	*writep = elem;
-	writep = circ_inc_pointer(writep);
+//Write
+template<typename T, circular_queue_sync_t SYNC>
+inline rofl_result_t circular_queue<T, SYNC>::non_blocking_write(T* elem){
 
-	pthread_mutex_unlock(&mutex_writers);
+	if(unlikely(enqueue_bulk(&elem, 1) == 0))
+		return ROFL_FAILURE;
 
 	return ROFL_SUCCESS;
-#endif
 }
 
-
-template<typename T>
-void circular_queue<T>::dump(void){
+template<typename T, circular_queue_sync_t SYNC>
+void circular_queue<T, SYNC>::dump(void){
 	for(long long unsigned int i=0; i<slots;++i){
-		if(readp == elements+i)
+		if((cons.tail & mask) == i)
 			ROFL_INFO(">");
-		if(writep == elements+i)
+		if((prod.tail & mask) == i)
 			ROFL_INFO("=||");
 		ROFL_INFO("[%llu:%p],", i, elements[i]);
 		if(i%10 == 0)
@@ -260,7 +302,7 @@ void circular_queue<T>::dump(void){
 	ROFL_INFO("\n");
 }
 
-}// namespace xdpd::gnu_linux 
+}// namespace xdpd::gnu_linux
 }// namespace xdpd
 
 #endif /* CIRCULAR_QUEUE_H_ */
@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef PKTIN_POLICER_H
+#define PKTIN_POLICER_H 1
+
+#include <stdint.h>
+#include <time.h>
+#include "likely.h"
+
+/**
+* @file pktin_policer.h
+*
+* @brief Datapath side PKT_IN policer
+*
+* Token bucket with the same semantics as the PIRL of the CMM (max_rate/
+* PKTIN_POLICER_BUCKETS_PER_S tokens every 1/PKTIN_POLICER_BUCKETS_PER_S s),
+* but safe to be used concurrently by several I/O threads, so that excess
+* PKT_INs are dropped before consuming buffers, storage slots and
+* management thread CPU.
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+//Disabled (default)
+#define PKTIN_POLICER_DISABLED 0
+
+//Buckets (refills) per second; must match the PIRL's
+#define PKTIN_POLICER_BUCKETS_PER_S 10
+
+typedef struct pktin_policer{
+	//Configured max rate (PKT_IN/s) or PKTIN_POLICER_DISABLED
+	volatile int max_rate;
+
+	//Current bucket (ms/(1000/PKTIN_POLICER_BUCKETS_PER_S))
+	volatile uint64_t bucket_ts;
+
+	//Remaining tokens of the current bucket (may go below 0)
+	volatile int tokens;
+
+	//Number of PKT_INs dropped (approximate; not atomically updated)
+	uint64_t dropped;
+}pktin_policer_t;
+
+static inline void pktin_policer_reconfigure(pktin_policer_t* p, int max_rate){
+	//Force a refill with the new rate on the next PKT_IN
+	p->bucket_ts = 0;
+	p->max_rate = (max_rate > 0)? max_rate : PKTIN_POLICER_DISABLED;
+}
+
+static inline void pktin_policer_init(pktin_policer_t* p){
+	p->tokens = 0;
+	p->dropped = 0;
+	pktin_policer_reconfigure(p, PKTIN_POLICER_DISABLED);
+}
+
+/**
+* Apply the policer to a PKT_IN.
+*
+* @return true when the PKT_IN must be dropped.
+*/
+static inline bool pktin_policer_filter(pktin_policer_t* p){
+
+	struct timespec tp;
+	uint64_t curr_ts, last_ts;
+	int max_rate = p->max_rate;
+
+	if(likely(max_rate == PKTIN_POLICER_DISABLED))
+		return false;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &tp);
+	curr_ts = (tp.tv_sec*1000 + tp.tv_nsec/1000000)/(1000/PKTIN_POLICER_BUCKETS_PER_S);
+
+	//Refill; only the thread that moves the bucket forward does it
+	last_ts = p->bucket_ts;
+	if(unlikely(last_ts != curr_ts)){
+		if(__sync_bool_compare_and_swap(&p->bucket_ts, last_ts, curr_ts))
+			p->tokens = max_rate/PKTIN_POLICER_BUCKETS_PER_S;
+	}
+
+	//Under a storm, most PKT_INs are dropped here with a plain read
+	if(p->tokens <= 0 || __sync_fetch_and_sub(&p->tokens, 1) <= 0){
+		p->dropped++;
+		return true;
+	}
+
+	return false;
+}
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* PKTIN_POLICER_H_ */
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "stage_latency.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <rofl/common/utils/c_logger.h>
+
+using namespace xdpd::gnu_linux;
+
+//Static members
+stage_latency_shard_t* stage_latency::shards = NULL;
+unsigned int stage_latency::sampling = 0;
+uint64_t stage_latency::sampling_mask = ~0ULL;
+__thread unsigned int stage_latency::thread_shard = stage_latency::SHARED_SHARD;
+__thread uint64_t stage_latency::thread_cnt = 0;
+
+const char* stage_latency::names[SL_MAX] = {
+	"rx",			//SL_RX
+	"classify",		//SL_CLASSIFY
+	"pipeline",		//SL_PIPELINE
+	"tx-queue",		//SL_TX_QUEUE
+	"vlink",		//SL_VLINK
+	"tx",			//SL_TX
+	"total",		//SL_TOTAL
+	"pkt-in-queue",		//SL_PKT_IN_QUEUE
+	"pkt-in-total",		//SL_PKT_IN_TOTAL
+};
+
+rofl_result_t stage_latency::init(unsigned int sampling_){
+
+	if(sampling_ & (sampling_-1)){
+		ROFL_ERR(DRIVER_NAME"[stage-latency] Invalid sampling value %u; must be 0 (disabled) or a power of 2\n", sampling_);
+		return ROFL_FAILURE;
+	}
+
+	if(posix_memalign((void**)&shards, IO_CACHE_LINE_SIZE, sizeof(stage_latency_shard_t)*IO_PORT_STATS_SHARDS) != 0){
+		ROFL_ERR(DRIVER_NAME"[stage-latency] Unable to allocate latency histogram shards\n");
+		return ROFL_FAILURE;
+	}
+	memset(shards, 0, sizeof(stage_latency_shard_t)*IO_PORT_STATS_SHARDS);
+
+	//Disabled: the counter never wraps in practice
+	sampling = sampling_;
+	sampling_mask = (sampling)? sampling-1 : ~0ULL;
+
+	if(sampling)
+		ROFL_INFO(DRIVER_NAME"[stage-latency] Measuring stage latency of 1 out of %u packets\n", sampling);
+	else
+		ROFL_INFO(DRIVER_NAME"[stage-latency] Stage latency measurements disabled\n");
+
+	return ROFL_SUCCESS;
+}
+
+void stage_latency::destroy(){
+	sampling = 0;
+	sampling_mask = ~0ULL;
+	free(shards);
+	shards = NULL;
+}
+
+double stage_latency::get_hz(){
+
+	static double hz = 0.0;
+	struct timespec t0, t1;
+	uint64_t c0, c1;
+
+#if !defined(__x86_64__) && !defined(__i386__)
+	//cycles() is CLOCK_MONOTONIC
+	hz = 1e9;
+#endif
+
+	if(hz != 0.0)
+		return hz;
+
+	//Calibrate against the monotonic clock
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t0);
+	c0 = cycles();
+	usleep(50000);
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t1);
+	c1 = cycles();
+
+	hz = (c1-c0) / ((t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec)/1e9);
+
+	ROFL_DEBUG(DRIVER_NAME"[stage-latency] Cycle counter frequency: %.0f Hz\n", hz);
+
+	return hz;
+}
+
+void stage_latency::snapshot(hal_stage_latency_snapshot_t* snapshot){
+
+	unsigned int i, j, k;
+	double ns_per_cycle = 1e9/get_hz();
+	volatile stage_latency_hist_t* h;
+	hal_stage_latency_t* s;
+	uint64_t sum, max;
+
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	snapshot->sampling = sampling;
+	snapshot->num_of_stages = SL_MAX;
+
+	for(j=0; j<HAL_STAGE_LATENCY_BUCKETS; ++j)
+		snapshot->bucket_upper_ns[j] = (uint64_t)((2ULL << j) * ns_per_cycle);
+
+	if(!shards)
+		return;
+
+	for(i=0; i<SL_MAX; ++i){
+		s = &snapshot->stages[i];
+		strncpy(s->name, names[i], HAL_STAGE_LATENCY_NAME_LEN-1);
+
+		sum = max = 0;
+
+		//Shards are written concurrently by the I/O threads; aligned 64 bit
+		//loads are enough to get a consistent value of every single counter
+		for(k=0; k<IO_PORT_STATS_SHARDS; ++k){
+			h = &shards[k].stages[i];
+
+			s->samples += h->samples;
+			s->dropped += h->dropped;
+			sum += h->sum;
+			if(h->max > max)
+				max = h->max;
+			for(j=0; j<HAL_STAGE_LATENCY_BUCKETS; ++j)
+				s->buckets[j] += h->buckets[j];
+		}
+
+		s->sum_ns = (uint64_t)(sum * ns_per_cycle);
+		s->max_ns = (uint64_t)(max * ns_per_cycle);
+	}
+}
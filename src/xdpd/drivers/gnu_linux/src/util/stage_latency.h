@@ -0,0 +1,274 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef STAGE_LATENCY_H
+#define STAGE_LATENCY_H
+
+#include <stdint.h>
+#include <time.h>
+#include <rofl_datapath.h>
+#include "../config.h"
+#include "likely.h"
+#include "../../../hal_stats_ext.h"
+
+/**
+* @file stage_latency.h
+*
+* @brief Sampled, per I/O thread, latency histograms of the packet
+* processing stages (always on).
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Packet processing stages. Every stage measures the time elapsed since the
+* previous stage reached by the packet.
+*/
+typedef enum stage_latency_stage{
+	//Fast path
+	SL_RX = 0,		//Buffer allocation and init/copy
+	SL_CLASSIFY,		//Header classification
+	SL_PIPELINE,		//OF pipeline processing (until output or PKT_IN)
+	SL_TX_QUEUE,		//Enqueue and wait in the output queue of the port
+	SL_VLINK,		//Enqueue and wait in the vlink queues, until read by the peer LSI
+	SL_TX,			//TX (copy to the ring/UMEM)
+	SL_TOTAL,		//Overall (RX to TX)
+
+	//Slow path
+	SL_PKT_IN_QUEUE,	//Enqueue and wait in the PKT_IN queue, until dispatched
+	SL_PKT_IN_TOTAL,	//Overall (RX to PKT_IN dispatch)
+
+	SL_MAX			//Must be the last one
+}stage_latency_stage_t;
+
+/**
+* Per packet state (part of datapacketx86). ts is 0 for packets not being measured
+*/
+typedef struct stage_latency_pkt{
+	uint64_t rx_ts;
+	uint64_t ts;
+}stage_latency_pkt_t;
+
+/**
+* Histogram of a stage (cycles). Bucket i holds [2^i, 2^(i+1)) cycles
+*/
+typedef struct stage_latency_hist{
+	uint64_t samples;
+	uint64_t dropped;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[HAL_STAGE_LATENCY_BUCKETS];
+}stage_latency_hist_t;
+
+/**
+* Shard; written by a single I/O thread (except the shared one)
+*/
+typedef struct stage_latency_shard{
+	stage_latency_hist_t stages[SL_MAX];
+}__attribute__((aligned(IO_CACHE_LINE_SIZE))) stage_latency_shard_t;
+
+/**
+* @brief Sampled latency histograms of the packet processing stages
+*
+* Only 1 out of sampling packets (per I/O thread) is measured; for the rest
+* the cost is a thread local counter increment at RX and a branch per stage.
+* Timestamps are taken with the TSC (invariant TSC is assumed, so that
+* the stages across RX and TX threads can be measured).
+*
+* Histograms follow the same sharding as the port counters (ioport_stats):
+* every I/O thread writes to its own shard, and the rest share the last one,
+* which is updated atomically. Shards are only aggregated on snapshot().
+*
+* @ingroup driver_gnu_linux
+*/
+class stage_latency{
+
+public:
+	/**
+	* Initialize; sampling MUST be 0 (disabled) or a power of 2
+	*/
+	static rofl_result_t init(unsigned int sampling = STAGE_LATENCY_SAMPLING);
+	static void destroy(void);
+
+	/**
+	* Assign the shard to be used by the calling thread (see ioport_stats::set_thread_shard())
+	*/
+	static inline void set_thread_shard(unsigned int id){
+		thread_shard = (id < SHARED_SHARD)? id : SHARED_SHARD;
+	}
+
+	/**
+	* Current cycle counter
+	*/
+	static inline uint64_t cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+		uint32_t hi, lo;
+		__asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+		return ((uint64_t)lo) | ((uint64_t)hi << 32);
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+	}
+
+	/**
+	* Sampling decision; must be called by the RX ports before getting the buffer
+	* of a new packet. Returns the timestamp to be passed to rx(), or 0 if the
+	* packet shall not be measured.
+	*/
+	static inline uint64_t sample(void){
+		if(likely((++thread_cnt & sampling_mask) != 0))
+			return 0;
+		return cycles();
+	}
+
+	/**
+	* Packet has been received (buffer initialized); ts is the value returned
+	* by sample()
+	*/
+	static inline void rx(stage_latency_pkt_t* lat, uint64_t ts){
+		lat->rx_ts = lat->ts = ts;
+		if(unlikely(ts != 0))
+			stamp(lat, SL_RX);
+	}
+
+	/**
+	* Packet has reached the end of stage. Must be called while the packet is
+	* still owned by the calling thread (i.e. before enqueuing it)
+	*/
+	static inline void stamp(stage_latency_pkt_t* lat, stage_latency_stage_t stage){
+		uint64_t now;
+
+		if(likely(lat->ts == 0))
+			return;
+
+		now = cycles();
+		record(stage, (now > lat->ts)? now - lat->ts : 0);
+		lat->ts = now;
+	}
+
+	/**
+	* Packet has reached the end of the last stage of the path; total
+	* is the overall stage of the path
+	*/
+	static inline void end(stage_latency_pkt_t* lat, stage_latency_stage_t stage, stage_latency_stage_t total){
+		if(likely(lat->ts == 0))
+			return;
+
+		stamp(lat, stage);
+		record(total, (lat->ts > lat->rx_ts)? lat->ts - lat->rx_ts : 0);
+		lat->ts = 0;
+	}
+
+	/**
+	* Packet has been dropped during stage (e.g. queue full)
+	*/
+	static inline void drop(stage_latency_pkt_t* lat, stage_latency_stage_t stage){
+		if(likely(lat->ts == 0))
+			return;
+
+		inc(&shards[thread_shard].stages[stage].dropped, 1);
+		lat->ts = 0;
+	}
+
+	/**
+	* Stop measuring the packet (e.g. PKT_OUTs)
+	*/
+	static inline void ignore(stage_latency_pkt_t* lat){
+		lat->ts = 0;
+	}
+
+	/**
+	* Aggregate all the shards into a HAL snapshot
+	*/
+	static void snapshot(hal_stage_latency_snapshot_t* snapshot);
+
+	//Shard used by threads without an exclusive one (updated atomically)
+	static const unsigned int SHARED_SHARD = IO_PORT_STATS_SHARDS-1;
+
+private:
+	//Cache aligned array of IO_PORT_STATS_SHARDS shards
+	static stage_latency_shard_t* shards;
+
+	//Sampling
+	static unsigned int sampling;
+	static uint64_t sampling_mask;
+
+	//Shard and sampling counter of the calling thread
+	static __thread unsigned int thread_shard;
+	static __thread uint64_t thread_cnt;
+
+	static const char* names[SL_MAX];
+
+	static inline void inc(uint64_t* counter, uint64_t value){
+		if(likely(thread_shard != SHARED_SHARD))
+			*counter += value;
+		else
+			__sync_fetch_and_add(counter, value);
+	}
+
+	static inline void record(stage_latency_stage_t stage, uint64_t delta){
+		unsigned int b;
+		uint64_t max;
+		stage_latency_hist_t* h = &shards[thread_shard].stages[stage];
+
+		b = (delta)? 63 - __builtin_clzll(delta) : 0;
+		if(unlikely(b >= HAL_STAGE_LATENCY_BUCKETS))
+			b = HAL_STAGE_LATENCY_BUCKETS-1;
+
+		inc(&h->samples, 1);
+		inc(&h->sum, delta);
+		inc(&h->buckets[b], 1);
+
+		if(likely(thread_shard != SHARED_SHARD)){
+			if(delta > h->max)
+				h->max = delta;
+		}else{
+			max = h->max;
+			while(delta > max && !__sync_bool_compare_and_swap(&h->max, max, delta))
+				max = h->max;
+		}
+	}
+
+	//Cycles per second (calibrated on the first snapshot)
+	static double get_hz(void);
+};
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+/*
+* Packet level helpers (datapacket_t*). Replicas are not measured
+*/
+#define STAGE_LATENCY_RX(pkt_p, ts)\
+	do{\
+		xdpd::gnu_linux::stage_latency::rx(&((xdpd::gnu_linux::datapacketx86*)(pkt_p)->platform_state)->lat, ts);\
+	}while(0)
+
+#define STAGE_LATENCY_STAMP(pkt_p, stage)\
+	do{\
+		if((pkt_p)->is_replica == false)\
+			xdpd::gnu_linux::stage_latency::stamp(&((xdpd::gnu_linux::datapacketx86*)(pkt_p)->platform_state)->lat, stage);\
+	}while(0)
+
+#define STAGE_LATENCY_END(pkt_p, stage, total)\
+	do{\
+		if((pkt_p)->is_replica == false)\
+			xdpd::gnu_linux::stage_latency::end(&((xdpd::gnu_linux::datapacketx86*)(pkt_p)->platform_state)->lat, stage, total);\
+	}while(0)
+
+#define STAGE_LATENCY_DROP(pkt_p, stage)\
+	do{\
+		if((pkt_p)->is_replica == false)\
+			xdpd::gnu_linux::stage_latency::drop(&((xdpd::gnu_linux::datapacketx86*)(pkt_p)->platform_state)->lat, stage);\
+	}while(0)
+
+#define STAGE_LATENCY_IGNORE(pkt_p)\
+	do{\
+		xdpd::gnu_linux::stage_latency::ignore(&((xdpd::gnu_linux::datapacketx86*)(pkt_p)->platform_state)->lat);\
+	}while(0)
+
+#endif /* STAGE_LATENCY_H_ */
@@ -0,0 +1,213 @@
+#include "bench_scenarios.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <endian.h>
+#include <string>
+#include <sstream>
+#include <rofl/datapath/pipeline/openflow/openflow1x/of1x_switch.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_flow_entry.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_flow_table.h>
+
+using namespace xdpd::gnu_linux;
+
+namespace xdpd {
+namespace gnu_linux {
+
+const char* bench_scenario_names[BENCH_SCENARIO_MAX] = {
+	"l2-exact",
+	"acl",
+	"mpls",
+};
+
+}// namespace xdpd::gnu_linux 
+}// namespace xdpd
+
+/*
+* Traffic
+*/
+static inline void put_mac(uint8_t* p, uint64_t mac){
+	for(int i=5;i>=0;--i, mac >>= 8)
+		p[i] = mac & 0xFF;
+}
+
+bench_traffic::bench_traffic(unsigned int __num_of_flows, const std::vector<unsigned int>& __sizes) :
+				num_of_flows(__num_of_flows),
+				max_size(0),
+				sizes(__sizes){
+
+	uint8_t* f;
+	uint16_t* ip;
+	uint32_t csum;
+	unsigned int i, j;
+
+	for(i=0;i<sizes.size();++i)
+		if(sizes[i] > max_size)
+			max_size = sizes[i];
+
+	frames.resize(num_of_flows*max_size, 0);
+
+	for(i=0;i<num_of_flows;++i){
+		f = &frames[i*max_size];
+
+		//Ethernet
+		put_mac(f, get_eth_dst(i));
+		put_mac(f+6, get_eth_src());
+		*(uint16_t*)(f+12) = htobe16(0x0800);
+
+		//IPv4 (ttl 64, UDP); checksum computed with the total length set to 0
+		f[L3_OFFSET] = 0x45;
+		f[L3_OFFSET+8] = 64;
+		f[L3_OFFSET+9] = 17;
+		*(uint32_t*)(f+L3_OFFSET+12) = htobe32(get_ip4_src(i));
+		*(uint32_t*)(f+L3_OFFSET+16) = htobe32(get_ip4_dst(i));
+
+		ip = (uint16_t*)(f+L3_OFFSET);
+		for(j=0, csum=0;j<10;++j)
+			csum += be16toh(ip[j]);
+		while(csum >> 16)
+			csum = (csum & 0xFFFF) + (csum >> 16);
+		*(uint16_t*)(f+L3_OFFSET+10) = htobe16(~csum & 0xFFFF);
+
+		//UDP (no checksum)
+		*(uint16_t*)(f+L4_OFFSET) = htobe16(get_udp_src(i));
+		*(uint16_t*)(f+L4_OFFSET+2) = htobe16(get_udp_dst(i));
+	}
+}
+
+void bench_traffic::set_length(uint8_t* frame, unsigned int len){
+	uint16_t* csum = (uint16_t*)(frame+L3_OFFSET+10);
+	uint32_t c;
+	uint16_t tot_len = len - L3_OFFSET;
+
+	//IPv4 total length; incremental checksum update (RFC 1624) from 0
+	*(uint16_t*)(frame+L3_OFFSET+2) = htobe16(tot_len);
+	c = (~be16toh(*csum) & 0xFFFF) + tot_len;
+	c = (c & 0xFFFF) + (c >> 16);
+	*csum = htobe16(~c & 0xFFFF);
+
+	//UDP length
+	*(uint16_t*)(frame+L4_OFFSET+4) = htobe16(len - L4_OFFSET);
+}
+
+bool bench_traffic::parse_sizes(const char* str, std::vector<unsigned int>& sizes){
+
+	std::string s(str), tok;
+	std::istringstream ss(s);
+	unsigned int i;
+	char* end;
+	long size;
+
+	sizes.clear();
+
+	if(s == "imix"){
+		for(i=0;i<7;++i)
+			sizes.push_back(64);
+		for(i=0;i<4;++i)
+			sizes.push_back(570);
+		sizes.push_back(1518);
+		return true;
+	}
+
+	while(std::getline(ss, tok, ',')){
+		size = strtol(tok.c_str(), &end, 10);
+		if(tok.empty() || *end != '\0' || size < (long)MIN_FRAME_SIZE || size > (long)MAX_FRAME_SIZE)
+			return false;
+		sizes.push_back(size);
+	}
+
+	return !sizes.empty();
+}
+
+/*
+* Flow tables
+*/
+static of1x_action_group_t* output_action(of1x_action_group_t* ac_group, unsigned int out_port){
+	wrap_uint_t field;
+	memset(&field, 0, sizeof(field));
+	field.u32 = out_port;
+	of1x_push_packet_action_to_group(ac_group, of1x_init_packet_action(OF1X_AT_OUTPUT, field, 0x0));
+	return ac_group;
+}
+
+static void push_mpls_actions(of1x_action_group_t* ac_group, unsigned int flow){
+	wrap_uint_t field;
+	memset(&field, 0, sizeof(field));
+	field.u16 = 0x8847;
+	of1x_push_packet_action_to_group(ac_group, of1x_init_packet_action(OF1X_AT_PUSH_MPLS, field, 0x0));
+	memset(&field, 0, sizeof(field));
+	field.u32 = bench_traffic::get_mpls_label(flow);
+	of1x_push_packet_action_to_group(ac_group, of1x_init_packet_action(OF1X_AT_SET_FIELD_MPLS_LABEL, field, 0x0));
+}
+
+static void pop_mpls_action(of1x_action_group_t* ac_group){
+	wrap_uint_t field;
+	memset(&field, 0, sizeof(field));
+	field.u16 = 0x0800;
+	of1x_push_packet_action_to_group(ac_group, of1x_init_packet_action(OF1X_AT_POP_MPLS, field, 0x0));
+}
+
+rofl_result_t xdpd::gnu_linux::bench_install_flows(of_switch_t* sw, bench_scenario_t scenario, unsigned int position, unsigned int num_of_lsis, unsigned int out_port, const bench_traffic& traffic){
+
+	unsigned int i;
+	of1x_flow_entry_t* entry;
+	of1x_action_group_t* ac_group;
+	bool first = (position == 0);
+	bool last = (position == num_of_lsis-1);
+
+	for(i=0;i<traffic.get_num_of_flows();++i){
+
+		entry = of1x_init_flow_entry(false);
+		ac_group = of1x_init_action_group(NULL);
+		if(!entry || !ac_group)
+			return ROFL_FAILURE;
+		entry->priority = 100;
+
+		switch(scenario){
+			case BENCH_SCENARIO_L2_EXACT:
+				of1x_add_match_to_entry(entry, of1x_init_eth_dst_match(bench_traffic::get_eth_dst(i), 0xFFFFFFFFFFFFULL));
+				break;
+
+			case BENCH_SCENARIO_ACL:
+				of1x_add_match_to_entry(entry, of1x_init_eth_type_match(0x0800));
+				of1x_add_match_to_entry(entry, of1x_init_ip_proto_match(17));
+				of1x_add_match_to_entry(entry, of1x_init_ip4_src_match(bench_traffic::get_ip4_src(i), 0xFFFFFFFF));
+				of1x_add_match_to_entry(entry, of1x_init_ip4_dst_match(bench_traffic::get_ip4_dst(i), 0xFFFFFFFF));
+				of1x_add_match_to_entry(entry, of1x_init_udp_src_match(bench_traffic::get_udp_src(i)));
+				of1x_add_match_to_entry(entry, of1x_init_udp_dst_match(bench_traffic::get_udp_dst(i)));
+				break;
+
+			case BENCH_SCENARIO_MPLS:
+				if(first){
+					//Ingress LER: classify by ETH_DST and push the label
+					of1x_add_match_to_entry(entry, of1x_init_eth_dst_match(bench_traffic::get_eth_dst(i), 0xFFFFFFFFFFFFULL));
+					push_mpls_actions(ac_group, i);
+					if(last) //Single LSI; push and pop
+						pop_mpls_action(ac_group);
+				}else{
+					//LSR or egress LER
+					of1x_add_match_to_entry(entry, of1x_init_eth_type_match(0x8847));
+					of1x_add_match_to_entry(entry, of1x_init_mpls_label_match(bench_traffic::get_mpls_label(i)));
+					if(last)
+						pop_mpls_action(ac_group);
+				}
+				break;
+
+			default:
+				assert(0);
+				return ROFL_FAILURE;
+		}
+
+		output_action(ac_group, out_port);
+		of1x_add_instruction_to_group(&entry->inst_grp, OF1X_IT_APPLY_ACTIONS, ac_group, NULL, NULL, 0);
+
+		if(of1x_add_flow_entry_table(&((of1x_switch_t*)sw)->pipeline, 0, &entry, false, false) != ROFL_OF1X_FM_SUCCESS){
+			fprintf(stderr, "Unable to install flow entry %u in LSI %s\n", i, sw->name);
+			return ROFL_FAILURE;
+		}
+	}
+
+	return ROFL_SUCCESS;
+}
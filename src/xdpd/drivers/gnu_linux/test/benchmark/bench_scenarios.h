@@ -0,0 +1,103 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BENCH_SCENARIOS_H
+#define BENCH_SCENARIOS_H 
+
+#include <vector>
+#include <stdint.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/openflow/of_switch.h>
+
+/**
+* @file bench_scenarios.h
+*
+* @brief Traffic (packet mixes) and flow tables of the forwarding benchmark
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Flow table scenarios
+*/
+typedef enum{
+	BENCH_SCENARIO_L2_EXACT=0,	//Static L2 table (exact ETH_DST -> output); no MAC learning
+	BENCH_SCENARIO_ACL,	//5-tuple ACL (IPv4/UDP 5-tuple -> output)
+	BENCH_SCENARIO_MPLS,	//MPLS push (first LSI), label switching, MPLS pop (last LSI)
+	BENCH_SCENARIO_MAX
+}bench_scenario_t;
+
+extern const char* bench_scenario_names[BENCH_SCENARIO_MAX];
+
+/**
+* @brief Traffic to be generated
+*
+* num_of_flows Ethernet/IPv4/UDP flows, each one with a different ETH_DST,
+* 5-tuple and MPLS label. Frame sizes are picked round-robin from the sizes
+* vector (the packet mix). 
+*/
+class bench_traffic{
+
+public:
+	static const unsigned int MIN_FRAME_SIZE=64;
+	static const unsigned int MAX_FRAME_SIZE=8192;
+	static const unsigned int L3_OFFSET=14;
+	static const unsigned int L4_OFFSET=L3_OFFSET+20;
+
+	/**
+	* Bytes at the end of the frames reserved for the benchmark (timestamp)
+	*/
+	static const unsigned int TRAILER_LEN=8;
+
+	bench_traffic(unsigned int num_of_flows, const std::vector<unsigned int>& sizes);
+
+	inline unsigned int get_num_of_flows(void) const { return num_of_flows; }
+	inline unsigned int get_num_of_sizes(void) const { return sizes.size(); }
+	inline unsigned int get_size(unsigned int i) const { return sizes[i]; }
+	inline unsigned int get_max_size(void) const { return max_size; }
+
+	/**
+	* Template frame (get_max_size() bytes) of flow
+	*/
+	inline const uint8_t* get_frame(unsigned int flow) const { return &frames[flow*max_size]; }
+
+	/**
+	* Set the length fields of a frame (IPv4 total length, UDP length)
+	*/
+	static void set_length(uint8_t* frame, unsigned int len);
+
+	//Flow keys (host byte order)
+	static uint64_t get_eth_src(void){ return 0x02be00000001ULL; }
+	static uint64_t get_eth_dst(unsigned int flow){ return 0x02be01000000ULL | flow; }
+	static uint32_t get_ip4_src(unsigned int flow){ return 0x0a000000 | flow; }
+	static uint32_t get_ip4_dst(unsigned int flow){ return 0x0b000000 | flow; }
+	static uint16_t get_udp_src(unsigned int flow){ return 1024 + (flow & 0x7FFF); }
+	static uint16_t get_udp_dst(unsigned int flow){ return 2048 + (flow >> 15); }
+	static uint32_t get_mpls_label(unsigned int flow){ return 16 + flow; }
+
+	/**
+	* Parse a packet mix; comma separated list of frame sizes (e.g. "64,64,1518")
+	* or "imix" (7:4:1 of 64, 570 and 1518 bytes)
+	*/
+	static bool parse_sizes(const char* str, std::vector<unsigned int>& sizes);
+
+private:
+	unsigned int num_of_flows;
+	unsigned int max_size;
+	std::vector<unsigned int> sizes;
+	std::vector<uint8_t> frames;
+};
+
+/**
+* Install the flow table of the LSI at position (0 being the LSI attached to
+* the generator) in a chain of num_of_lsis LSIs. Packets matching are sent
+* to out_port. 
+*/
+rofl_result_t bench_install_flows(of_switch_t* sw, bench_scenario_t scenario, unsigned int position, unsigned int num_of_lsis, unsigned int out_port, const bench_traffic& traffic);
+
+}// namespace xdpd::gnu_linux 
+}// namespace xdpd
+
+#endif /* BENCH_SCENARIOS_H_ */
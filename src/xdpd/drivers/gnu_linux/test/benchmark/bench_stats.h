@@ -0,0 +1,145 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H 
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+* @file bench_stats.h
+*
+* @brief Time stamping and latency histograms for the forwarding benchmark
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* Cycle counter (TSC); falls back to CLOCK_MONOTONIC (ns) in non-x86 platforms
+*/
+static inline uint64_t bench_cycles(void){
+#if defined(__x86_64__) || defined(__i386__)
+	uint32_t hi, lo;
+	__asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((uint64_t)lo) | ((uint64_t)hi << 32);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/**
+* Estimate the bench_cycles() frequency (Hz)
+*/
+static inline double bench_cycles_hz(void){
+	struct timespec t0, t1;
+	uint64_t c0, c1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	c0 = bench_cycles();
+	usleep(100000);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	c1 = bench_cycles();
+
+	return (c1-c0) / ((t1.tv_sec-t0.tv_sec) + (t1.tv_nsec-t0.tv_nsec)/1e9);
+}
+
+/**
+* @brief Log2 histogram of cycle counts
+*
+* Bucket i holds the samples in [2^i, 2^(i+1)) cycles (bucket 0 also holds
+* 0). Not thread-safe; every histogram must be updated by a single thread.
+*/
+class bench_histogram{
+
+public:
+	static const unsigned int NUM_OF_BUCKETS=48;
+
+	bench_histogram(){ reset(); }
+
+	inline void reset(void){
+		memset(buckets, 0, sizeof(buckets));
+		samples = sum = 0;
+		max = 0;
+	}
+
+	inline void add(uint64_t cycles){
+		unsigned int b = (cycles) ? 63 - __builtin_clzll(cycles) : 0;
+		if(b >= NUM_OF_BUCKETS)
+			b = NUM_OF_BUCKETS-1;
+		buckets[b]++;
+		samples++;
+		sum += cycles;
+		if(cycles > max)
+			max = cycles;
+	}
+
+	inline void merge(const bench_histogram& h){
+		for(unsigned int i=0;i<NUM_OF_BUCKETS;++i)
+			buckets[i] += h.buckets[i];
+		samples += h.samples;
+		sum += h.sum;
+		if(h.max > max)
+			max = h.max;
+	}
+
+	inline uint64_t get_samples(void) const { return samples; }
+
+	/**
+	* Upper bound (cycles) of the bucket containing the percentile p (0-100)
+	*/
+	inline uint64_t percentile(double p) const {
+		uint64_t acc = 0, target = (uint64_t)(samples*p/100.0);
+		for(unsigned int i=0;i<NUM_OF_BUCKETS;++i){
+			acc += buckets[i];
+			if(acc > target || (acc == samples && acc))
+				return (2ULL << i);
+		}
+		return 0;
+	}
+
+	/**
+	* Print the histogram summary, and the buckets if requested; hz is the
+	* cycle frequency
+	*/
+	void dump(FILE* f, const char* title, double hz, bool buckets_too=true) const {
+		double ns = 1e9/hz;
+		unsigned int i;
+
+		fprintf(f, "%s: %llu samples", title, (unsigned long long)samples);
+		if(!samples){
+			fprintf(f, "\n");
+			return;
+		}
+		fprintf(f, ", avg %.0f ns, p50 < %.0f ns, p99 < %.0f ns, p99.9 < %.0f ns, max %.0f ns\n",
+				(double)sum/samples*ns, percentile(50)*ns, percentile(99)*ns, percentile(99.9)*ns, max*ns);
+
+		if(!buckets_too)
+			return;
+
+		for(i=0;i<NUM_OF_BUCKETS;++i){
+			if(!buckets[i])
+				continue;
+			fprintf(f, "\t[%10.0f, %10.0f) ns: %12llu (%6.2f%%)\n", (1ULL << i)*ns, (2ULL << i)*ns,
+					(unsigned long long)buckets[i], buckets[i]*100.0/samples);
+		}
+	}
+
+private:
+	uint64_t buckets[NUM_OF_BUCKETS];
+	uint64_t samples;
+	uint64_t sum;
+	uint64_t max;
+};
+
+}// namespace xdpd::gnu_linux 
+}// namespace xdpd
+
+#endif /* BENCH_STATS_H_ */
@@ -0,0 +1,337 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+/*
+* Forwarding benchmark of the GNU/Linux driver
+*
+* Builds a chain of LSIs connected via virtual links (ioport_vlink):
+*
+*   [bench-gen] -> LSI 0 -> vlink -> LSI 1 -> ... -> LSI n-1 -> [bench-sink]
+*
+* loads one of the flow table scenarios (bench_scenarios.h) in every LSI,
+* drives the configured packet mix through the chain and reports the
+* throughput, the generation and end-to-end latency histograms and the
+* bufferpool occupancy. No NICs are required.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <vector>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/physical_switch.h>
+#include <rofl/datapath/hal/driver.h>
+#include "io/bufferpool.h"
+#include "io/iomanager.h"
+#include "util/stage_latency.h"
+
+#include "ioport_bench.h"
+#include "bench_stats.h"
+#include "bench_scenarios.h"
+
+#define BENCH_BASE_DPID 0xbe00
+#define BENCH_MAX_LSIS 64
+#define BENCH_MAX_FLOWS 65536
+#define BENCH_GEN_PORT "bench-gen"
+#define BENCH_SINK_PORT "bench-sink"
+
+using namespace xdpd::gnu_linux;
+
+typedef struct bench_config{
+	unsigned int num_of_lsis;
+	bench_scenario_t scenario;
+	unsigned int num_of_flows;
+	const char* mix;
+	uint64_t rate;
+	unsigned int duration;
+	unsigned int warmup;
+	double min_mpps;
+	bool verbose_histograms;
+}bench_config_t;
+
+static void usage(const char* prog){
+	fprintf(stderr, "Usage: %s [options]\n", prog);
+	fprintf(stderr, "  -n <lsis>       Number of chained LSIs (default 1, max %u)\n", BENCH_MAX_LSIS);
+	fprintf(stderr, "  -s <scenario>   Flow table: l2-exact, acl or mpls (default l2-exact)\n");
+	fprintf(stderr, "  -f <flows>      Number of flows/flow entries per LSI (default 64, max %u)\n", BENCH_MAX_FLOWS);
+	fprintf(stderr, "  -m <mix>        Packet mix: comma separated frame sizes or \"imix\" (default 64)\n");
+	fprintf(stderr, "  -r <pps>        Generation rate in pps (default 0, as fast as possible)\n");
+	fprintf(stderr, "  -d <seconds>    Measurement duration (default 10)\n");
+	fprintf(stderr, "  -w <seconds>    Warm-up duration (default 2)\n");
+	fprintf(stderr, "  -t <mpps>       Fail (exit code 1) if the forwarding rate is below <mpps>\n");
+	fprintf(stderr, "  -v              Dump the full latency histograms\n");
+}
+
+static bool parse_args(int argc, char** argv, bench_config_t* cfg){
+	int c;
+	unsigned int i;
+
+	memset(cfg, 0, sizeof(*cfg));
+	cfg->num_of_lsis = 1;
+	cfg->scenario = BENCH_SCENARIO_L2_EXACT;
+	cfg->num_of_flows = 64;
+	cfg->mix = "64";
+	cfg->duration = 10;
+	cfg->warmup = 2;
+
+	while((c = getopt(argc, argv, "n:s:f:m:r:d:w:t:vh")) != -1){
+		switch(c){
+			case 'n': cfg->num_of_lsis = atoi(optarg);
+				break;
+			case 's':
+				for(i=0;i<BENCH_SCENARIO_MAX;++i)
+					if(strcmp(optarg, bench_scenario_names[i]) == 0)
+						break;
+				if(i == BENCH_SCENARIO_MAX)
+					return false;
+				cfg->scenario = (bench_scenario_t)i;
+				break;
+			case 'f': cfg->num_of_flows = atoi(optarg);
+				break;
+			case 'm': cfg->mix = optarg;
+				break;
+			case 'r': cfg->rate = strtoull(optarg, NULL, 10);
+				break;
+			case 'd': cfg->duration = atoi(optarg);
+				break;
+			case 'w': cfg->warmup = atoi(optarg);
+				break;
+			case 't': cfg->min_mpps = atof(optarg);
+				break;
+			case 'v': cfg->verbose_histograms = true;
+				break;
+			default:
+				return false;
+		}
+	}
+
+	return cfg->num_of_lsis > 0 && cfg->num_of_lsis <= BENCH_MAX_LSIS &&
+		cfg->num_of_flows > 0 && cfg->num_of_flows <= BENCH_MAX_FLOWS &&
+		cfg->duration > 0;
+}
+
+/*
+* Create a generator/sink port and attach it to the LSI
+*/
+static ioport_bench* create_bench_port(const char* name, uint64_t dpid, unsigned int* of_port_num){
+
+	switch_port_t* port;
+	ioport_bench* io_port;
+
+	//Virtual; not subject to the discovery of system interfaces
+	port = switch_port_init((char*)name, true, PORT_TYPE_VIRTUAL, PORT_STATE_LIVE);
+	if(!port)
+		return NULL;
+
+	io_port = new ioport_bench(port);
+	port->platform_port_state = (platform_port_state_t*)io_port;
+
+	if(physical_switch_add_port(port) != ROFL_SUCCESS)
+		return NULL;
+
+	*of_port_num = 0;
+	if(hal_driver_attach_port_to_switch(dpid, name, of_port_num) != HAL_SUCCESS)
+		return NULL;
+
+	if(hal_driver_bring_port_up(name) != HAL_SUCCESS)
+		return NULL;
+
+	return io_port;
+}
+
+/*
+* Dump the driver stage latency (sampled) accumulated between two snapshots
+*/
+static void dump_stage_latency(FILE* f, const hal_stage_latency_snapshot_t* before, hal_stage_latency_snapshot_t* after){
+
+	unsigned int i, j;
+	hal_stage_latency_t* s;
+
+	//Differential
+	for(i=0;i<after->num_of_stages;++i){
+		s = &after->stages[i];
+		s->samples -= before->stages[i].samples;
+		s->dropped -= before->stages[i].dropped;
+		s->sum_ns -= before->stages[i].sum_ns;
+		for(j=0;j<HAL_STAGE_LATENCY_BUCKETS;++j)
+			s->buckets[j] -= before->stages[i].buckets[j];
+	}
+
+	fprintf(f, "Driver stage latency (1 out of %u packets sampled, ns; percentiles are bucket upper bounds):\n", after->sampling);
+	fprintf(f, "\t%-16s %12s %10s %10s %10s %10s %10s\n", "stage", "samples", "dropped", "avg", "p50", "p99", "max(*)");
+
+	for(i=0;i<after->num_of_stages;++i){
+		s = &after->stages[i];
+		if(!s->samples && !s->dropped)
+			continue;
+		fprintf(f, "\t%-16s %12llu %10llu %10.0f %10llu %10llu %10llu\n", s->name,
+				(unsigned long long)s->samples,
+				(unsigned long long)s->dropped,
+				(s->samples)? (double)s->sum_ns/s->samples : 0.0,
+				(unsigned long long)hal_stage_latency_percentile(after, s, 0.5),
+				(unsigned long long)hal_stage_latency_percentile(after, s, 0.99),
+				(unsigned long long)s->max_ns);
+	}
+	fprintf(f, "\t(*) including warm-up\n\n");
+}
+
+/*
+* Build the chain of LSIs and load the flow tables
+*/
+static rofl_result_t setup(const bench_config_t* cfg, const bench_traffic& traffic, ioport_bench** gen, ioport_bench** sink){
+
+	unsigned int i, port_in, port_out, sink_port_num;
+	char name[32];
+	std::vector<unsigned int> out_ports(cfg->num_of_lsis);
+	switch_port_snapshot_t *snap1, *snap2;
+	of1x_matching_algorithm_available ma_list[] = { of1x_loop_matching_algorithm };
+	of_switch_t* sw;
+
+	//LSIs
+	for(i=0;i<cfg->num_of_lsis;++i){
+		snprintf(name, sizeof(name), "bench%u", i);
+		if(hal_driver_create_switch(name, BENCH_BASE_DPID+i, OF_VERSION_13, 1, (int*)ma_list) != HAL_SUCCESS){
+			fprintf(stderr, "Unable to create LSI %s\n", name);
+			return ROFL_FAILURE;
+		}
+	}
+
+	//Virtual links
+	for(i=0;i+1<cfg->num_of_lsis;++i){
+		port_out = port_in = 0;
+		if(hal_driver_connect_switches(BENCH_BASE_DPID+i, &port_out, &snap1, BENCH_BASE_DPID+i+1, &port_in, &snap2) != HAL_SUCCESS){
+			fprintf(stderr, "Unable to connect LSIs %u and %u\n", i, i+1);
+			return ROFL_FAILURE;
+		}
+		switch_port_destroy_snapshot(snap1);
+		switch_port_destroy_snapshot(snap2);
+		out_ports[i] = port_out;
+	}
+
+	//Generator and sink
+	*gen = create_bench_port(BENCH_GEN_PORT, BENCH_BASE_DPID, &port_in);
+	*sink = create_bench_port(BENCH_SINK_PORT, BENCH_BASE_DPID+cfg->num_of_lsis-1, &sink_port_num);
+	if(!*gen || !*sink){
+		fprintf(stderr, "Unable to create the generator/sink ports\n");
+		return ROFL_FAILURE;
+	}
+	out_ports[cfg->num_of_lsis-1] = sink_port_num;
+
+	//Flow tables
+	for(i=0;i<cfg->num_of_lsis;++i){
+		sw = physical_switch_get_logical_switch_by_dpid(BENCH_BASE_DPID+i);
+		if(!sw || bench_install_flows(sw, cfg->scenario, i, cfg->num_of_lsis, out_ports[i], traffic) != ROFL_SUCCESS)
+			return ROFL_FAILURE;
+	}
+
+	return ROFL_SUCCESS;
+}
+
+int main(int argc, char** argv){
+
+	bench_config_t cfg;
+	std::vector<unsigned int> sizes;
+	hal_extension_ops_t hal_extension_ops;
+	ioport_bench *gen, *sink;
+	hal_stage_latency_snapshot_t lat0, lat1;
+	double hz, elapsed, mpps, gen_mpps, gbps;
+	uint64_t t0, t1, gen0, gen1, received, bytes;
+	uint64_t bp_min, bp_max, bp_sum, bp_samples, bp_used;
+	unsigned int i;
+	bool success;
+
+	if(!parse_args(argc, argv, &cfg) || !bench_traffic::parse_sizes(cfg.mix, sizes)){
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bench_traffic traffic(cfg.num_of_flows, sizes);
+
+	if(hal_driver_init(&hal_extension_ops, NULL) != HAL_SUCCESS){
+		fprintf(stderr, "Unable to initialize the driver\n");
+		return EXIT_FAILURE;
+	}
+
+	if(setup(&cfg, traffic, &gen, &sink) != ROFL_SUCCESS){
+		hal_driver_destroy();
+		return EXIT_FAILURE;
+	}
+
+	hz = bench_cycles_hz();
+
+	fprintf(stdout, "\nxDPD GNU/Linux forwarding benchmark\n");
+	fprintf(stdout, "-----------------------------------\n");
+	fprintf(stdout, "LSIs: %u, scenario: %s, flows: %u, mix: %s, rate: ", cfg.num_of_lsis, bench_scenario_names[cfg.scenario], cfg.num_of_flows, cfg.mix);
+	if(cfg.rate)
+		fprintf(stdout, "%llu pps", (unsigned long long)cfg.rate);
+	else
+		fprintf(stdout, "max");
+	fprintf(stdout, ", duration: %us (warm-up %us), bufferpool: %u buffers, cycle counter: %.3f GHz\n\n",
+			cfg.duration, cfg.warmup, bufferpool::get_num_of_buffers(), hz/1e9);
+
+	//Warm-up
+	gen->start_generation(&traffic, cfg.rate, hz);
+	sleep(cfg.warmup);
+
+	//Measure
+	gen->reset_counters();
+	sink->reset_counters();
+	gen0 = gen->get_generated();
+	hal_driver_get_stage_latency(&lat0);
+	t0 = bench_cycles();
+
+	bp_min = ~0ULL;
+	bp_max = bp_sum = bp_samples = 0;
+	for(i=0;i<cfg.duration*10;++i){
+		usleep(100000);
+
+		//Bufferpool occupancy
+		bp_used = bufferpool::get_used();
+		bp_sum += bp_used;
+		bp_samples++;
+		if(bp_used < bp_min)
+			bp_min = bp_used;
+		if(bp_used > bp_max)
+			bp_max = bp_used;
+
+		if((i+1)%10 == 0)
+			fprintf(stdout, "[%3us] forwarded: %12llu\n", (i+1)/10, (unsigned long long)sink->get_received());
+	}
+
+	t1 = bench_cycles();
+	gen1 = gen->get_generated();
+	received = sink->get_received();
+	bytes = sink->get_received_bytes();
+	hal_driver_get_stage_latency(&lat1);
+	gen->stop_generation();
+
+	elapsed = (t1-t0)/hz;
+	gen_mpps = (gen1-gen0)/elapsed/1e6;
+	mpps = received/elapsed/1e6;
+	gbps = (bytes*8)/elapsed/1e9;
+
+	//Report
+	fprintf(stdout, "\nResults (%.2fs)\n", elapsed);
+	fprintf(stdout, "Generated: %12llu pkts (%.3f Mpps), no buffer: %llu\n", (unsigned long long)(gen1-gen0), gen_mpps, (unsigned long long)gen->get_gen_failures());
+	fprintf(stdout, "Forwarded: %12llu pkts (%.3f Mpps, %.3f Gbps L2)\n", (unsigned long long)received, mpps, gbps);
+	fprintf(stdout, "Loss:      %12.3f%% (approx.; includes packets in flight)\n", (gen1 > gen0)? (1.0 - (double)received/(gen1-gen0))*100 : 0.0);
+	fprintf(stdout, "Bufferpool occupancy: min %llu, avg %.0f, max %llu (of %u)\n\n",
+			(unsigned long long)bp_min, (double)bp_sum/bp_samples, (unsigned long long)bp_max, bufferpool::get_num_of_buffers());
+
+	gen->get_gen_cost().dump(stdout, "Generation (alloc+copy+classify)", hz, cfg.verbose_histograms);
+	sink->get_latency().dump(stdout, "End-to-end latency", hz, cfg.verbose_histograms);
+	dump_stage_latency(stdout, &lat0, &lat1);
+
+	success = (cfg.min_mpps <= 0 || mpps >= cfg.min_mpps);
+	if(!success)
+		fprintf(stdout, "\nFAILED: forwarding rate %.3f Mpps is below %.3f Mpps\n", mpps, cfg.min_mpps);
+
+	//Let in-flight packets drain and tear down
+	sleep(1);
+	hal_driver_destroy();
+
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
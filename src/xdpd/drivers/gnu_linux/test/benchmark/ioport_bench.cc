@@ -0,0 +1,227 @@
+#include "ioport_bench.h"
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <rofl/common/utils/c_logger.h>
+#include "io/bufferpool.h" 
+
+using namespace xdpd::gnu_linux;
+
+//Constructor and destructor
+ioport_bench::ioport_bench(switch_port_t* of_ps, unsigned int num_queues):
+			ioport(of_ps,num_queues),
+			traffic(NULL),
+			generating(false),
+			next_flow(0),
+			next_size(0),
+			rate(0),
+			cycles_hz(0),
+			gen_start(0),
+			generated(0),
+			gen_failures(0),
+			rx_reset_pending(false),
+			tx_reset_pending(false),
+			received(0),
+			received_bytes(0){
+
+	gen_fd = eventfd(0, EFD_NONBLOCK);
+	notify_fd = eventfd(0, EFD_NONBLOCK);
+
+	if(gen_fd < 0 || notify_fd < 0){
+		ROFL_ERR(DRIVER_NAME"[bench:%s] Unable to create eventfds\n", of_port_state->name);
+		throw std::exception();
+	}
+}
+
+ioport_bench::~ioport_bench(){
+	close(gen_fd);
+	close(notify_fd);
+}
+
+inline void ioport_bench::notify(){
+	int ret;
+	uint64_t c=1;
+	ret = ::write(notify_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+void ioport_bench::start_generation(const bench_traffic* __traffic, uint64_t __rate, double __cycles_hz){
+	int ret;
+	uint64_t c=1;
+
+	traffic = __traffic;
+	rate = __rate;
+	cycles_hz = __cycles_hz;
+	next_flow = next_size = 0;
+	generated = gen_failures = 0;
+	gen_start = bench_cycles();
+	__sync_synchronize();
+	generating = true;
+
+	//Keep the read fd readable until stopped
+	ret = ::write(gen_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+void ioport_bench::stop_generation(){
+	int ret;
+	uint64_t c;
+
+	generating = false;
+	ret = ::read(gen_fd, &c, sizeof(c));
+	(void)ret;
+}
+
+void ioport_bench::reset_counters(){
+	//Performed by the RX and TX threads
+	rx_reset_pending = true;
+	tx_reset_pending = true;
+}
+
+//Read and write methods over port
+void ioport_bench::enqueue_packet(datapacket_t* pkt, unsigned int q_id){
+
+	if( unlikely(!of_port_state->up) || unlikely(q_id >= get_num_of_queues()) ){
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+
+	if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS){
+		STAGE_LATENCY_DROP(pkt, SL_TX_QUEUE);
+		stats.tx_dropped(q_id);
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+
+	//Wake up TX
+	notify();
+}
+
+datapacket_t* ioport_bench::read(){
+
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+	uint8_t* buf;
+	unsigned int len, flow;
+	uint64_t now, lat_ts;
+
+	if(unlikely(!generating) || unlikely(!of_port_state->up) || unlikely(of_port_state->drop_received))
+		return NULL;
+
+	if(unlikely(rx_reset_pending)){
+		gen_cost.reset();
+		rx_reset_pending = false;
+	}
+
+	now = bench_cycles();
+
+	//Rate limiting
+	if(rate && (generated >= (uint64_t)((now - gen_start) / cycles_hz * rate)))
+		return NULL;
+
+	//Stage latency sampling
+	lat_ts = stage_latency::sample();
+
+	//Allocate free buffer
+	pkt = bufferpool::get_buffer();
+	if(unlikely(!pkt)){
+		gen_failures++;
+		return NULL;
+	}
+
+	pkt_x86 = (datapacketx86*)pkt->platform_state;
+
+	//Pick the next frame of the mix
+	flow = next_flow;
+	len = traffic->get_size(next_size);
+	if(++next_flow == traffic->get_num_of_flows())
+		next_flow = 0;
+	if(++next_size == traffic->get_num_of_sizes())
+		next_size = 0;
+
+	//Copy (do not classify yet)
+	pkt_x86->init((uint8_t*)traffic->get_frame(flow), len, of_port_state->attached_sw, of_port_state->of_port_num, 0, false);
+	buf = pkt_x86->get_buffer();
+	bench_traffic::set_length(buf, len);
+
+	//Time stamp (trailer)
+	memcpy(buf + len - bench_traffic::TRAILER_LEN, &now, sizeof(now));
+	STAGE_LATENCY_RX(pkt, lat_ts);
+
+	//Classify
+	classify_packet(&pkt_x86->clas_state, buf, len, of_port_state->of_port_num, 0);
+	STAGE_LATENCY_STAMP(pkt, SL_CLASSIFY);
+
+	gen_cost.add(bench_cycles() - now);
+	generated++;
+	stats.rx_packet(len);
+
+	return pkt;	
+}
+
+unsigned int ioport_bench::write(unsigned int q_id, unsigned int num_of_buckets){
+
+	int ret;
+	unsigned int i, len, bytes = 0;
+	uint64_t c, ts;
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+
+	ret = ::read(notify_fd, &c, sizeof(c));
+	(void)ret;
+
+	if(unlikely(tx_reset_pending)){
+		received = received_bytes = 0;
+		latency.reset();
+		tx_reset_pending = false;
+	}
+
+	for(i=0;i<num_of_buckets;++i){	
+		pkt = output_queues[q_id]->non_blocking_read();
+		
+		if(!pkt)
+			break;
+
+		STAGE_LATENCY_STAMP(pkt, SL_TX_QUEUE);
+
+		pkt_x86 = (datapacketx86*)pkt->platform_state;
+		len = pkt_x86->get_buffer_length();
+
+		//Latency
+		if(likely(len >= bench_traffic::TRAILER_LEN)){
+			memcpy(&ts, pkt_x86->get_buffer() + len - bench_traffic::TRAILER_LEN, sizeof(ts));
+			latency.add(bench_cycles() - ts);
+		}
+		bytes += len;
+
+		STAGE_LATENCY_END(pkt, SL_TX, SL_TOTAL);
+		
+		//Put it into the "wire"
+		bufferpool::release_buffer(pkt);
+	}
+
+	if(i){
+		stats.tx_packets(q_id, i, bytes);
+		received += i;
+		received_bytes += bytes;
+	}
+
+	//Re-arm if there are still packets pending
+	for(q_id=0; q_id < get_num_of_queues(); ++q_id){
+		if(output_queue_has_packets(q_id)){
+			notify();
+			break;
+		}
+	}
+
+	return num_of_buckets-i;
+}
+
+rofl_result_t ioport_bench::down(){
+	of_port_state->up = false;
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t ioport_bench::up(){
+	of_port_state->up = true;
+	return ROFL_SUCCESS;
+}
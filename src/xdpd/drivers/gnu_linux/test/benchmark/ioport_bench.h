@@ -0,0 +1,118 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef IOPORT_BENCH_H
+#define IOPORT_BENCH_H 
+
+#include <unistd.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/common/datapacket.h>
+#include <rofl/datapath/pipeline/switch_port.h>
+#include "io/ports/ioport.h" 
+#include "io/datapacketx86.h" 
+
+#include "bench_stats.h"
+#include "bench_scenarios.h"
+
+namespace xdpd {
+namespace gnu_linux {
+
+/**
+* @file ioport_bench.h
+*
+* @brief Traffic generator and sink port of the forwarding benchmark
+*/
+
+/**
+* @brief Traffic generator and sink port, used for benchmarking purposes only.
+*
+* While generating, the port synthesizes (RX) packets from the bench_traffic
+* templates as fast as the I/O thread can process them (or at a fixed rate),
+* time stamping them in the frame trailer. The read fd (eventfd) is kept
+* readable during the generation. The generation cost (buffer allocation,
+* copy and classification) is added to the generation histogram.
+*
+* Packets sent (TX) through the port are accounted and their latency (time
+* since generation) is added to the latency histogram. Packets are then
+* returned to the bufferpool.
+*/
+class ioport_bench : public ioport{
+
+public:
+	//ioport_bench
+	ioport_bench(switch_port_t* of_ps, unsigned int num_queues=IO_IFACE_NUM_QUEUES);
+
+	virtual
+	~ioport_bench();
+
+	//Enque packet for transmission (blocking)
+	virtual void enqueue_packet(datapacket_t* pkt, unsigned int q_id);
+
+	//Non-blocking read and write
+	virtual datapacket_t* read(void);
+
+	virtual unsigned int write(unsigned int q_id, unsigned int num_of_buckets);
+
+	//Get read&write fds. Return -1 if do not exist
+	inline virtual int get_read_fd(void){return gen_fd;};
+	inline virtual int get_write_fd(void){return notify_fd;};
+
+	virtual rofl_result_t down();
+	virtual rofl_result_t up();
+
+	/**
+	* Start generating traffic (rate in pps, 0 unlimited). traffic must
+	* outlive the generation
+	*/
+	void start_generation(const bench_traffic* traffic, uint64_t rate, double cycles_hz);
+
+	/**
+	* Stop generating traffic
+	*/
+	void stop_generation(void);
+
+	/**
+	* Reset the sink counters and the histograms (e.g. after the warm-up)
+	*/
+	void reset_counters(void);
+
+	//Counters
+	inline uint64_t get_generated(void){ return generated; }
+	inline uint64_t get_gen_failures(void){ return gen_failures; }
+	inline uint64_t get_received(void){ return received; }
+	inline uint64_t get_received_bytes(void){ return received_bytes; }
+	inline const bench_histogram& get_gen_cost(void){ return gen_cost; }
+	inline const bench_histogram& get_latency(void){ return latency; }
+
+protected:
+	//fds
+	int gen_fd;
+	int notify_fd;
+
+	//Generator (RX thread)
+	const bench_traffic* traffic;
+	volatile bool generating;
+	unsigned int next_flow;
+	unsigned int next_size;
+	uint64_t rate;
+	double cycles_hz;
+	uint64_t gen_start;
+	uint64_t generated;
+	uint64_t gen_failures; //No buffers
+	volatile bool rx_reset_pending;
+	bench_histogram gen_cost;
+
+	//Sink (TX thread)
+	volatile bool tx_reset_pending;
+	uint64_t received;
+	uint64_t received_bytes;
+	bench_histogram latency;
+
+	inline void notify(void);
+};
+
+}// namespace xdpd::gnu_linux 
+}// namespace xdpd
+
+#endif /* IOPORT_BENCH_H_ */
@@ -30,3 +30,5 @@ sudo ./test_portmmap
 #test for the hcl notifications for port events (add, delete & status change)
 sudo ./test_port_status
 
+#vlinks connected in a loop (run-to-completion)
+sudo ./test_vlink_loop
@@ -0,0 +1,168 @@
+/**
+* This is a regression test that must check that the run-to-completion
+* processing of vlinks never re-enters an LSI, including the LSI the packet
+* was received in, when two LSIs are connected in a loop (A <-> B)
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/pipeline/physical_switch.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/of1x_switch.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_flow_entry.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_flow_table.h>
+#include <rofl/datapath/hal/driver.h>
+#include "config.h"
+#include "io/iomanager.h"
+#include "io/bufferpool.h"
+#include "io/datapacketx86.h"
+#include "io/ports/vlink/ioport_vlink.h"
+
+#define TEST_DPID_A 0x1043
+#define TEST_DPID_B 0x1044
+#define TEST_PKT_LEN 64
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+class VlinkLoopTestCase : public CppUnit::TestFixture{
+
+	CPPUNIT_TEST_SUITE(VlinkLoopTestCase);
+	CPPUNIT_TEST(test_no_reentry);
+	CPPUNIT_TEST_SUITE_END();
+
+	//Test methods
+	void test_no_reentry(void);
+
+	of_switch_t *sw_a, *sw_b;
+	ioport_vlink *vport_a, *vport_b;
+
+	void install_loop_flow(of_switch_t* sw);
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+/*
+* Send every packet back through the port it was received from
+*/
+void VlinkLoopTestCase::install_loop_flow(of_switch_t* sw){
+
+	wrap_uint_t field;
+	of1x_flow_entry_t* entry = of1x_init_flow_entry(false);
+	of1x_action_group_t* ac_group = of1x_init_action_group(NULL);
+
+	CPPUNIT_ASSERT(entry != NULL && ac_group != NULL);
+
+	memset(&field, 0, sizeof(field));
+	field.u32 = OF1X_PORT_IN_PORT;
+	of1x_push_packet_action_to_group(ac_group, of1x_init_packet_action(OF1X_AT_OUTPUT, field, 0x0));
+	of1x_add_instruction_to_group(&entry->inst_grp, OF1X_IT_APPLY_ACTIONS, ac_group, NULL, NULL, 0);
+
+	CPPUNIT_ASSERT(of1x_add_flow_entry_table(&((of1x_switch_t*)sw)->pipeline, 0, &entry, false, false) == ROFL_OF1X_FM_SUCCESS);
+}
+
+/* Setup and tear down */
+void VlinkLoopTestCase::setUp(){
+
+	unsigned int port_num_a=0, port_num_b=0;
+	switch_port_snapshot_t *snap_a, *snap_b;
+	hal_extension_ops_t hal_extension_ops;
+	of1x_matching_algorithm_available ma_list[] = { of1x_loop_matching_algorithm };
+
+	fprintf(stderr,"<%s:%d> ************** VlinkLoopTestCase Set up ************\n",__func__,__LINE__);
+
+	CPPUNIT_ASSERT(hal_driver_init(&hal_extension_ops, NULL) == HAL_SUCCESS);
+
+	CPPUNIT_ASSERT(hal_driver_create_switch((char*)"switchA", TEST_DPID_A, OF_VERSION_13, 1, (int*)ma_list) == HAL_SUCCESS);
+	CPPUNIT_ASSERT(hal_driver_create_switch((char*)"switchB", TEST_DPID_B, OF_VERSION_13, 1, (int*)ma_list) == HAL_SUCCESS);
+	sw_a = physical_switch_get_logical_switch_by_dpid(TEST_DPID_A);
+	sw_b = physical_switch_get_logical_switch_by_dpid(TEST_DPID_B);
+	CPPUNIT_ASSERT(sw_a && sw_b);
+
+	//A <-> B
+	CPPUNIT_ASSERT(hal_driver_connect_switches(TEST_DPID_A, &port_num_a, &snap_a, TEST_DPID_B, &port_num_b, &snap_b) == HAL_SUCCESS);
+	switch_port_destroy_snapshot(snap_a);
+	switch_port_destroy_snapshot(snap_b);
+
+	vport_a = (ioport_vlink*)physical_switch_get_port_by_num(TEST_DPID_A, port_num_a)->platform_port_state;
+	vport_b = (ioport_vlink*)physical_switch_get_port_by_num(TEST_DPID_B, port_num_b)->platform_port_state;
+	CPPUNIT_ASSERT(vport_a && vport_b);
+
+	install_loop_flow(sw_a);
+	install_loop_flow(sw_b);
+
+	//Stop the I/O threads; this thread plays the RX thread of both edges
+	CPPUNIT_ASSERT(iomanager::bring_port_down(vport_a) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(iomanager::bring_port_down(vport_b) == ROFL_SUCCESS);
+	vport_a->of_port_state->up = vport_b->of_port_state->up = true;
+	vport_b->rx_group_id = vport_a->rx_group_id;
+	CPPUNIT_ASSERT(vport_a->rx_group_id >= 0);
+}
+
+void VlinkLoopTestCase::tearDown(){
+	fprintf(stderr,"<%s:%d> ************** VlinkLoopTestCase Tear Down ************\n",__func__,__LINE__);
+
+	CPPUNIT_ASSERT(hal_driver_destroy_switch_by_dpid(TEST_DPID_A) == HAL_SUCCESS);
+	CPPUNIT_ASSERT(hal_driver_destroy_switch_by_dpid(TEST_DPID_B) == HAL_SUCCESS);
+	CPPUNIT_ASSERT(hal_driver_destroy() == HAL_SUCCESS);
+}
+
+/* Tests */
+void VlinkLoopTestCase::test_no_reentry(){
+
+	uint8_t frame[TEST_PKT_LEN];
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+
+	memset(frame, 0, sizeof(frame));
+	ioport_vlink::set_thread_rtc_context(vport_a->rx_group_id, ROFL_PIPELINE_LOCKED_TID);
+
+	//A outputs a packet to the vlink
+	pkt = bufferpool::get_buffer();
+	CPPUNIT_ASSERT(pkt != NULL);
+	pkt_x86 = (datapacketx86*)pkt->platform_state;
+	CPPUNIT_ASSERT(pkt_x86->init(frame, sizeof(frame), sw_a, vport_a->of_port_state->of_port_num) == ROFL_SUCCESS);
+
+	vport_a->enqueue_packet(pkt, 0);
+
+	//B processed it in run-to-completion, and sent it back to A through the
+	//queues, since A is being processed by this thread
+	CPPUNIT_ASSERT(!vport_a->output_queue_has_packets(0));
+	CPPUNIT_ASSERT(vport_b->output_queue_has_packets(0));
+
+	//Deliver it to A (as the TX thread would do) and release it
+	CPPUNIT_ASSERT(vport_b->write(0, 1) == 0);
+	pkt = vport_a->read();
+	CPPUNIT_ASSERT(pkt != NULL);
+	bufferpool::release_buffer(pkt);
+
+	ioport_vlink::set_thread_rtc_context(-1, ROFL_PIPELINE_LOCKED_TID);
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(VlinkLoopTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
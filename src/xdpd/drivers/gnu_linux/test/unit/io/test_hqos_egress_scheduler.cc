@@ -0,0 +1,374 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the hierarchical egress scheduler (hqos_egress_scheduler):
+* weights, priorities, min/max rates, the charging of the packets actually
+* written and the parking of shaped ports
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include "io/bufferpool.h"
+#include "io/datapacketx86.h"
+#include "io/ports/ioport.h"
+#include "io/scheduler/hqos_egress_scheduler.h"
+
+#define PORT_NAME "mock0"
+#define PKT_LEN 1000
+#define PKTS_PER_QUEUE 1000
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+extern "C"{
+
+void platform_packet_drop(datapacket_t* pkt){};
+
+}
+
+/*
+* Mock ioport; write() "transmits" up to tx_room packets per call (TX ring)
+* and accounts the bytes written per queue
+*/
+class ioport_mock : public ioport{
+
+public:
+	ioport_mock(switch_port_t* of_ps) : ioport(of_ps), tx_room(~0U){
+		memset(tx_bytes, 0, sizeof(tx_bytes));
+	}
+
+	virtual void enqueue_packet(datapacket_t* pkt, unsigned int q_id){
+		if(output_queues[q_id]->non_blocking_write(pkt) != ROFL_SUCCESS)
+			bufferpool::release_buffer(pkt);
+	}
+
+	virtual datapacket_t* read(void){ return NULL; }
+
+	virtual unsigned int write(unsigned int q_id, unsigned int up_to_buckets){
+
+		datapacket_t* pkt;
+
+		while(up_to_buckets && tx_room){
+			pkt = output_queues[q_id]->non_blocking_read();
+			if(!pkt)
+				break;
+
+			tx_bytes[q_id] += ((datapacketx86*)pkt->platform_state)->get_buffer_length();
+			bufferpool::release_buffer(pkt);
+
+			--up_to_buckets;
+			if(tx_room != ~0U)
+				--tx_room;
+		}
+
+		return up_to_buckets;
+	}
+
+	virtual int get_read_fd(void){ return -1; }
+	virtual int get_write_fd(void){ return -1; }
+	virtual rofl_result_t up(void){ return ROFL_SUCCESS; }
+	virtual rofl_result_t down(void){ return ROFL_SUCCESS; }
+
+	inline unsigned int queue_len(unsigned int q_id){
+		return output_queues[q_id]->size();
+	}
+
+	unsigned int tx_room;
+	uint64_t tx_bytes[IO_IFACE_NUM_QUEUES];
+};
+
+class HQoSEgressSchedulerTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(HQoSEgressSchedulerTestCase);
+	CPPUNIT_TEST(test_weights);
+	CPPUNIT_TEST(test_priorities);
+	CPPUNIT_TEST(test_min_rate);
+	CPPUNIT_TEST(test_max_rate);
+	CPPUNIT_TEST(test_write_charging);
+	CPPUNIT_TEST(test_parking);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_weights(void);
+	void test_priorities(void);
+	void test_min_rate(void);
+	void test_max_rate(void);
+	void test_write_charging(void);
+	void test_parking(void);
+
+	uint8_t frame[PKT_LEN];
+	switch_port_t of_port;
+	ioport_mock* port;
+
+	void fill_queue(unsigned int q_id, unsigned int num);
+	void configure(unsigned int q_id, uint8_t priority, uint16_t weight, uint16_t min_rate, uint16_t max_rate);
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+void HQoSEgressSchedulerTestCase::setUp(){
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Set up ************\n",__func__,__LINE__);
+
+	memset(frame, 0, sizeof(frame));
+	bufferpool::init();
+
+	//1Gbps port; 125000 bytes/ms
+	memset(&of_port, 0, sizeof(of_port));
+	strncpy(of_port.name, PORT_NAME, sizeof(of_port.name)-1);
+	of_port.curr_speed = PORT_FEATURE_1GB_FD;
+
+	port = new ioport_mock(&of_port);
+}
+
+void HQoSEgressSchedulerTestCase::tearDown(){
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Tear Down ************\n",__func__,__LINE__);
+	delete port;
+	bufferpool::destroy();
+}
+
+void HQoSEgressSchedulerTestCase::fill_queue(unsigned int q_id, unsigned int num){
+
+	unsigned int i;
+	datapacket_t* pkt;
+
+	for(i=0;i<num;++i){
+		pkt = bufferpool::get_buffer();
+		CPPUNIT_ASSERT(pkt != NULL);
+		CPPUNIT_ASSERT(((datapacketx86*)pkt->platform_state)->init(frame, PKT_LEN, NULL, 1, 0, false) == ROFL_SUCCESS);
+		port->enqueue_packet(pkt, q_id);
+	}
+	CPPUNIT_ASSERT(port->queue_len(q_id) == num);
+}
+
+void HQoSEgressSchedulerTestCase::configure(unsigned int q_id, uint8_t priority, uint16_t weight, uint16_t min_rate, uint16_t max_rate){
+
+	hal_port_queue_conf_t conf;
+
+	conf.priority = priority;
+	conf.weight = weight;
+	conf.min_rate = min_rate;
+	conf.max_rate = max_rate;
+
+	CPPUNIT_ASSERT(port->tx_sched->configure_queue(q_id, &conf) == ROFL_SUCCESS);
+}
+
+/* Tests */
+void HQoSEgressSchedulerTestCase::test_weights(){
+
+	unsigned int i;
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test weights ************\n",__func__,__LINE__);
+
+	//Weight 0 is not a valid configuration
+	hal_port_queue_conf_t conf;
+	memset(&conf, 0, sizeof(conf));
+	CPPUNIT_ASSERT(port->tx_sched->configure_queue(0, &conf) == ROFL_FAILURE);
+	conf.weight = 10;
+	CPPUNIT_ASSERT(port->tx_sched->configure_queue(IO_IFACE_NUM_QUEUES, &conf) == ROFL_FAILURE);
+
+	//Same class; queue 1 gets 3 times the bytes of queue 0
+	configure(0, 0, 10, 0, 0);
+	configure(1, 0, 30, 0, 0);
+	fill_queue(0, PKTS_PER_QUEUE);
+	fill_queue(1, PKTS_PER_QUEUE);
+
+	//While both are backlogged
+	for(i=0;i<10;++i)
+		CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+
+	CPPUNIT_ASSERT(port->tx_bytes[0]+port->tx_bytes[1] == 10*IO_TX_HQOS_ROUND_BUDGET*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_bytes[1] >= 2.7*port->tx_bytes[0]);
+	CPPUNIT_ASSERT(port->tx_bytes[1] <= 3.3*port->tx_bytes[0]);
+
+	//Once queue 1 is drained, queue 0 gets all the bandwidth
+	while(port->queue_len(1))
+		port->tx_sched->schedule(port);
+	while(port->queue_len(0))
+		CPPUNIT_ASSERT(port->tx_sched->schedule(port) > 0);
+
+	CPPUNIT_ASSERT(port->tx_bytes[0] == PKTS_PER_QUEUE*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == PKTS_PER_QUEUE*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == false);
+}
+
+void HQoSEgressSchedulerTestCase::test_priorities(){
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test priorities ************\n",__func__,__LINE__);
+
+	//Queue 0 has the highest priority despite its weight
+	configure(0, 1, 10, 0, 0);
+	configure(1, 0, 30, 0, 0);
+	fill_queue(0, 2*IO_TX_HQOS_ROUND_BUDGET);
+	fill_queue(1, 2*IO_TX_HQOS_ROUND_BUDGET);
+
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+	CPPUNIT_ASSERT(port->tx_bytes[0] == IO_TX_HQOS_ROUND_BUDGET*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == 0);
+
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+	CPPUNIT_ASSERT(port->queue_len(0) == 0);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == 0);
+
+	//Lower class is only served when the higher one is empty
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == IO_TX_HQOS_ROUND_BUDGET*PKT_LEN);
+}
+
+void HQoSEgressSchedulerTestCase::test_min_rate(){
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test min rate ************\n",__func__,__LINE__);
+
+	//Queue 0 is in the lowest class, but it is guaranteed 10% (12500 bytes
+	//of burst on a 1Gbps port)
+	configure(0, 0, 10, 100, 0);
+	configure(1, 1, 10, 0, 0);
+	fill_queue(0, PKTS_PER_QUEUE);
+	fill_queue(1, PKTS_PER_QUEUE);
+
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+
+	//Burst of the min rate bucket first, the rest to the higher class
+	CPPUNIT_ASSERT(port->tx_bytes[0] == 12*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == (IO_TX_HQOS_ROUND_BUDGET-12)*PKT_LEN);
+}
+
+void HQoSEgressSchedulerTestCase::test_max_rate(){
+
+	unsigned int i;
+	uint64_t sent, elapsed_ms;
+	struct timespec start, end;
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test max rate ************\n",__func__,__LINE__);
+
+	//Queue 1 is capped to 0.1% (125000 bytes/s; one packet every 8ms) with
+	//the minimum burst (10000 bytes); queue 0 is not shaped
+	configure(0, 0, 10, 0, 0);
+	configure(1, 0, 10, 0, 1);
+	fill_queue(0, IO_TX_HQOS_ROUND_BUDGET);
+	fill_queue(1, IO_TX_HQOS_ROUND_BUDGET);
+
+	//Burst, then the unshaped queue gets the rest of the budget
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == IO_TX_HQOS_ROUND_BUDGET);
+	CPPUNIT_ASSERT(port->tx_bytes[1] == 10*PKT_LEN);
+
+	for(i=0;i<10;++i)
+		port->tx_sched->schedule(port);
+	CPPUNIT_ASSERT(port->queue_len(0) == 0);
+	sent = port->tx_bytes[1];
+	CPPUNIT_ASSERT(sent <= 11*PKT_LEN);
+
+	//Tokens are refilled over time (125 bytes/ms)
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	usleep(20000);
+	port->tx_sched->schedule(port);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed_ms = (end.tv_sec-start.tv_sec)*1000 + (end.tv_nsec-start.tv_nsec)/1000000 + 1;
+
+	CPPUNIT_ASSERT(port->tx_bytes[1] >= sent+2*PKT_LEN);
+	CPPUNIT_ASSERT(port->tx_bytes[1] <= sent+PKT_LEN+elapsed_ms*125);
+}
+
+void HQoSEgressSchedulerTestCase::test_write_charging(){
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test write charging ************\n",__func__,__LINE__);
+
+	//The min rate (12500 bytes of burst) lets the whole max rate burst (10
+	//packets, one more every 8ms) be peeked in a single batch
+	configure(0, 0, 10, 100, 1);
+	fill_queue(0, 20);
+
+	//TX ring can only take 3 packets of the batch
+	port->tx_room = 3;
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == 3);
+	CPPUNIT_ASSERT(port->queue_len(0) == 17);
+
+	//TX ring full; the port is not parked, but busy
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == false);
+
+	//Only the written packets have been charged; the rest of the burst is
+	//still available (peeked packets are not dequeued)
+	port->tx_room = ~0U;
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == 7);
+	CPPUNIT_ASSERT(port->tx_bytes[0] == 10*PKT_LEN);
+	CPPUNIT_ASSERT(port->queue_len(0) == 10);
+}
+
+void HQoSEgressSchedulerTestCase::test_parking(){
+
+	int fd;
+	struct pollfd pfd;
+	struct itimerspec its;
+	uint64_t value_ns;
+
+	fprintf(stderr,"<%s:%d> ************** HQoSEgressSchedulerTestCase Test parking ************\n",__func__,__LINE__);
+
+	fd = port->tx_sched->get_wakeup_fd();
+	CPPUNIT_ASSERT(fd != -1);
+
+	//Not parked without a backlog
+	configure(0, 0, 10, 0, 1);
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == 0);
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == false);
+
+	//Shaped backlog; parked until the next packet can be sent (<= 8ms)
+	fill_queue(0, 20);
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) == 10);
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == true);
+
+	CPPUNIT_ASSERT(timerfd_gettime(fd, &its) == 0);
+	value_ns = its.it_value.tv_sec*1000000000ULL + its.it_value.tv_nsec;
+	CPPUNIT_ASSERT(value_ns > 0);
+	CPPUNIT_ASSERT(value_ns <= 8000000ULL+1);
+	CPPUNIT_ASSERT(its.it_interval.tv_sec == 0 && its.it_interval.tv_nsec == 0);
+
+	//The timer fires once the tokens are there
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	CPPUNIT_ASSERT(poll(&pfd, 1, 1000) == 1);
+	CPPUNIT_ASSERT(pfd.revents & POLLIN);
+
+	CPPUNIT_ASSERT(port->tx_sched->schedule(port) >= 1);
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == true);
+
+	//The expiration has been consumed (timer re-armed)
+	CPPUNIT_ASSERT(poll(&pfd, 1, 0) == 0);
+
+	//Unshaped backlog left (budget exhausted); never parked
+	configure(1, 0, 10, 0, 0);
+	fill_queue(1, 2*IO_TX_HQOS_ROUND_BUDGET);
+	port->tx_sched->schedule(port);
+	CPPUNIT_ASSERT(port->tx_sched->is_parked() == false);
+	CPPUNIT_ASSERT(timerfd_gettime(fd, &its) == 0);
+	CPPUNIT_ASSERT(its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0);
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(HQoSEgressSchedulerTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the payload size classes of the bufferpool
+* (small and jumbo buffers), including the exhaustion of the jumbo pool
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "io/bufferpool.h"
+#include "io/datapacketx86.h"
+#include "io/payload_pool.h"
+
+#define SMALL_PKT_LEN 1500
+#define JUMBO_PKT_LEN payload_pool::JUMBO_FRAME_SIZE
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+extern "C"{
+
+void platform_packet_drop(datapacket_t* pkt){};
+
+}
+
+class PayloadPoolTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(PayloadPoolTestCase);
+	CPPUNIT_TEST(test_size_classes);
+	CPPUNIT_TEST(test_jumbo_exhaustion);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_size_classes(void);
+	void test_jumbo_exhaustion(void);
+
+	uint8_t frame[JUMBO_PKT_LEN+1];
+
+	datapacket_t* get_pkt(size_t len, rofl_result_t expected);
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+void PayloadPoolTestCase::setUp(){
+	unsigned int i;
+
+	fprintf(stderr,"<%s:%d> ************** PayloadPoolTestCase Set up ************\n",__func__,__LINE__);
+
+	for(i=0;i<sizeof(frame);++i)
+		frame[i] = (uint8_t)i;
+
+	bufferpool::init();
+}
+
+void PayloadPoolTestCase::tearDown(){
+	fprintf(stderr,"<%s:%d> ************** PayloadPoolTestCase Tear Down ************\n",__func__,__LINE__);
+	bufferpool::destroy();
+}
+
+/*
+* Get a buffer and init it with a frame of len bytes
+*/
+datapacket_t* PayloadPoolTestCase::get_pkt(size_t len, rofl_result_t expected){
+
+	datapacket_t* pkt = bufferpool::get_buffer();
+	datapacketx86* pkt_x86;
+
+	CPPUNIT_ASSERT(pkt != NULL);
+	pkt_x86 = (datapacketx86*)pkt->platform_state;
+
+	CPPUNIT_ASSERT(pkt_x86->init(frame, len, NULL, 1, 0, false) == expected);
+
+	if(expected == ROFL_SUCCESS){
+		CPPUNIT_ASSERT(pkt_x86->get_buffer() != NULL);
+		CPPUNIT_ASSERT(pkt_x86->get_buffer_length() == len);
+		CPPUNIT_ASSERT(pkt_x86->get_buffering_status() == X86_DATAPACKET_BUFFERED_IN_USER_SPACE);
+		CPPUNIT_ASSERT(memcmp(pkt_x86->get_buffer(), frame, len) == 0);
+	}else{
+		//No stale frame left behind
+		CPPUNIT_ASSERT(pkt_x86->get_buffer() == NULL);
+		CPPUNIT_ASSERT(pkt_x86->get_buffer_length() == 0);
+		CPPUNIT_ASSERT(pkt_x86->get_buffering_status() == X86_DATAPACKET_BUFFER_IS_EMPTY);
+	}
+
+	return pkt;
+}
+
+/* Tests */
+void PayloadPoolTestCase::test_size_classes(){
+
+	datapacket_t* pkt;
+	datapacketx86* pkt_x86;
+	uint8_t *small_buffer, *jumbo_buffer;
+
+	fprintf(stderr,"<%s:%d> ************** PayloadPoolTestCase Test size classes ************\n",__func__,__LINE__);
+
+	//Standard MTU frames use the buffer of the datapacket
+	pkt = get_pkt(SMALL_PKT_LEN, ROFL_SUCCESS);
+	pkt_x86 = (datapacketx86*)pkt->platform_state;
+	small_buffer = pkt_x86->get_buffer();
+
+	CPPUNIT_ASSERT(pkt_x86->init(frame, payload_pool::SMALL_FRAME_SIZE, NULL, 1, 0, false) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(pkt_x86->get_buffer() == small_buffer);
+
+	//Jumbo frames borrow a jumbo buffer...
+	CPPUNIT_ASSERT(pkt_x86->init(frame, payload_pool::SMALL_FRAME_SIZE+1, NULL, 1, 0, false) == ROFL_SUCCESS);
+	jumbo_buffer = pkt_x86->get_buffer();
+	CPPUNIT_ASSERT(jumbo_buffer != small_buffer);
+	CPPUNIT_ASSERT(memcmp(jumbo_buffer, frame, payload_pool::SMALL_FRAME_SIZE+1) == 0);
+
+	//...which is kept while the frame is jumbo...
+	CPPUNIT_ASSERT(pkt_x86->init(frame, JUMBO_PKT_LEN, NULL, 1, 0, false) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(pkt_x86->get_buffer() == jumbo_buffer);
+	CPPUNIT_ASSERT(memcmp(pkt_x86->get_buffer(), frame, JUMBO_PKT_LEN) == 0);
+
+	//...and returned otherwise
+	CPPUNIT_ASSERT(pkt_x86->init(frame, SMALL_PKT_LEN, NULL, 1, 0, false) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(pkt_x86->get_buffer() == small_buffer);
+
+	//Frames larger than the jumbo class are never buffered
+	CPPUNIT_ASSERT(pkt_x86->init(frame, JUMBO_PKT_LEN+1, NULL, 1, 0, false) == ROFL_FAILURE);
+	CPPUNIT_ASSERT(pkt_x86->get_buffer() == NULL);
+	CPPUNIT_ASSERT(pkt_x86->get_buffer_length() == 0);
+
+	bufferpool::release_buffer(pkt);
+}
+
+void PayloadPoolTestCase::test_jumbo_exhaustion(){
+
+	unsigned int i, round;
+	datapacket_t *pkt, *small;
+	std::vector<datapacket_t*> jumbos;
+
+	fprintf(stderr,"<%s:%d> ************** PayloadPoolTestCase Test jumbo exhaustion ************\n",__func__,__LINE__);
+
+	//Twice, to check that the jumbo buffers are returned on release
+	for(round=0;round<2;++round){
+
+		//Drain the jumbo pool
+		for(i=0;i<payload_pool::NUM_OF_JUMBO_BUFFERS;++i)
+			jumbos.push_back(get_pkt(JUMBO_PKT_LEN, ROFL_SUCCESS));
+
+		//No jumbo buffer left; init() must fail (and reset the packet)
+		pkt = get_pkt(SMALL_PKT_LEN, ROFL_SUCCESS);
+		CPPUNIT_ASSERT(((datapacketx86*)pkt->platform_state)->init(frame, JUMBO_PKT_LEN, NULL, 1, 0, false) == ROFL_FAILURE);
+		CPPUNIT_ASSERT(((datapacketx86*)pkt->platform_state)->get_buffer() == NULL);
+		CPPUNIT_ASSERT(((datapacketx86*)pkt->platform_state)->get_buffer_length() == 0);
+		bufferpool::release_buffer(pkt);
+
+		//Standard MTU frames are not affected
+		small = get_pkt(SMALL_PKT_LEN, ROFL_SUCCESS);
+
+		//Releasing a jumbo frame makes room for the next one
+		bufferpool::release_buffer(jumbos.back());
+		jumbos.pop_back();
+		jumbos.push_back(get_pkt(JUMBO_PKT_LEN, ROFL_SUCCESS));
+		bufferpool::release_buffer(get_pkt(JUMBO_PKT_LEN, ROFL_FAILURE));
+
+		//A jumbo frame that shrinks returns its jumbo buffer
+		CPPUNIT_ASSERT(((datapacketx86*)jumbos.back()->platform_state)->init(frame, SMALL_PKT_LEN, NULL, 1, 0, false) == ROFL_SUCCESS);
+		bufferpool::release_buffer(get_pkt(JUMBO_PKT_LEN, ROFL_SUCCESS));
+
+		bufferpool::release_buffer(small);
+		for(i=0;i<jumbos.size();++i)
+			bufferpool::release_buffer(jumbos[i]);
+		jumbos.clear();
+	}
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(PayloadPoolTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the pcap/pcapng reader and the pcap writer
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+#include "io/ports/pcap/pcap_file.h"
+
+#define NUM_OF_FRAMES 10
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+class PcapFileTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(PcapFileTestCase);
+	CPPUNIT_TEST(test_write_read);
+	CPPUNIT_TEST(test_swapped);
+	CPPUNIT_TEST(test_truncated_file);
+	CPPUNIT_TEST(test_pcapng);
+	CPPUNIT_TEST(test_invalid);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_write_read(void);
+	void test_swapped(void);
+	void test_truncated_file(void);
+	void test_pcapng(void);
+	void test_invalid(void);
+
+	char path[64];
+	uint8_t frames[NUM_OF_FRAMES][128];
+
+	void write_file(const std::vector<uint8_t>& buf);
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+//Byte buffer helpers
+static void put32(std::vector<uint8_t>& buf, uint32_t v, bool swap=false){
+	if(swap)
+		v = __builtin_bswap32(v);
+	buf.insert(buf.end(), (uint8_t*)&v, (uint8_t*)&v+sizeof(v));
+}
+
+static void put16(std::vector<uint8_t>& buf, uint16_t v){
+	buf.insert(buf.end(), (uint8_t*)&v, (uint8_t*)&v+sizeof(v));
+}
+
+void PcapFileTestCase::setUp(){
+	int fd;
+	unsigned int i, j;
+
+	snprintf(path, sizeof(path), "/tmp/xdpd_test_pcap_XXXXXX");
+	fd = mkstemp(path);
+	CPPUNIT_ASSERT(fd >= 0);
+	close(fd);
+
+	for(i=0;i<NUM_OF_FRAMES;i++)
+		for(j=0;j<sizeof(frames[i]);j++)
+			frames[i][j] = i+j;
+}
+
+void PcapFileTestCase::tearDown(){
+	unlink(path);
+}
+
+void PcapFileTestCase::write_file(const std::vector<uint8_t>& buf){
+	FILE* f = fopen(path, "w");
+	CPPUNIT_ASSERT(f != NULL);
+	CPPUNIT_ASSERT(fwrite(&buf[0], buf.size(), 1, f) == 1);
+	fclose(f);
+}
+
+/* Tests */
+void PcapFileTestCase::test_write_read(){
+	unsigned int i;
+	struct timespec ts = {1, 1000};
+	pcap_writer writer;
+	pcap_reader reader;
+
+	fprintf(stderr,"<%s:%d> ************** Test write&read ************\n",__func__,__LINE__);
+
+	CPPUNIT_ASSERT(writer.open(path) == ROFL_SUCCESS);
+	for(i=0;i<NUM_OF_FRAMES;i++)
+		writer.write(frames[i], 60+i, &ts);
+	writer.close();
+
+	CPPUNIT_ASSERT(reader.open(path) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(reader.get_num_of_frames() == NUM_OF_FRAMES);
+	CPPUNIT_ASSERT(reader.get_num_of_truncated() == 0);
+
+	for(i=0;i<NUM_OF_FRAMES;i++){
+		CPPUNIT_ASSERT(reader.get_frame(i)->len == 60+i);
+		CPPUNIT_ASSERT(memcmp(reader.get_frame(i)->data, frames[i], 60+i) == 0);
+	}
+}
+
+void PcapFileTestCase::test_swapped(){
+	std::vector<uint8_t> buf;
+	pcap_reader reader;
+
+	fprintf(stderr,"<%s:%d> ************** Test swapped (big endian, ns) ************\n",__func__,__LINE__);
+
+	//File header
+	put32(buf, pcap_reader::PCAP_MAGIC_NS, true);
+	put32(buf, 0x00020004, true);
+	put32(buf, 0);
+	put32(buf, 0);
+	put32(buf, 65535, true);
+	put32(buf, pcap_reader::LINKTYPE_ETHERNET, true);
+
+	//Record (truncated frame: 64 out of 100 bytes captured)
+	put32(buf, 1, true);
+	put32(buf, 2, true);
+	put32(buf, 64, true);
+	put32(buf, 100, true);
+	buf.insert(buf.end(), frames[0], frames[0]+64);
+
+	write_file(buf);
+
+	CPPUNIT_ASSERT(reader.open(path) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(reader.get_num_of_frames() == 1);
+	CPPUNIT_ASSERT(reader.get_num_of_truncated() == 1);
+	CPPUNIT_ASSERT(reader.get_frame(0)->len == 64);
+	CPPUNIT_ASSERT(memcmp(reader.get_frame(0)->data, frames[0], 64) == 0);
+}
+
+void PcapFileTestCase::test_truncated_file(){
+	unsigned int i;
+	struct timespec ts = {1, 1000};
+	pcap_writer writer;
+	pcap_reader reader;
+
+	fprintf(stderr,"<%s:%d> ************** Test truncated file ************\n",__func__,__LINE__);
+
+	CPPUNIT_ASSERT(writer.open(path) == ROFL_SUCCESS);
+	for(i=0;i<NUM_OF_FRAMES;i++)
+		writer.write(frames[i], 100, &ts);
+	writer.close();
+
+	//Cut the last record
+	CPPUNIT_ASSERT(truncate(path, 24 + (NUM_OF_FRAMES-1)*(16+100) + 50) == 0);
+
+	CPPUNIT_ASSERT(reader.open(path) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(reader.get_num_of_frames() == NUM_OF_FRAMES-1);
+}
+
+void PcapFileTestCase::test_pcapng(){
+	std::vector<uint8_t> buf;
+	pcap_reader reader;
+
+	fprintf(stderr,"<%s:%d> ************** Test pcapng ************\n",__func__,__LINE__);
+
+	//SHB
+	put32(buf, pcap_reader::PCAPNG_SHB);
+	put32(buf, 28);
+	put32(buf, pcap_reader::PCAPNG_BYTE_ORDER_MAGIC);
+	put16(buf, 1);
+	put16(buf, 0);
+	put32(buf, 0xFFFFFFFF);
+	put32(buf, 0xFFFFFFFF);
+	put32(buf, 28);
+
+	//IDB 0 (Ethernet) and 1 (raw IP)
+	put32(buf, 0x1);
+	put32(buf, 20);
+	put16(buf, pcap_reader::LINKTYPE_ETHERNET);
+	put16(buf, 0);
+	put32(buf, 0);
+	put32(buf, 20);
+
+	put32(buf, 0x1);
+	put32(buf, 20);
+	put16(buf, 101);
+	put16(buf, 0);
+	put32(buf, 0);
+	put32(buf, 20);
+
+	//EPB iface 0 (62 bytes, padded to 64)
+	put32(buf, 0x6);
+	put32(buf, 32+64);
+	put32(buf, 0);
+	put32(buf, 0);
+	put32(buf, 0);
+	put32(buf, 62);
+	put32(buf, 62);
+	buf.insert(buf.end(), frames[1], frames[1]+62);
+	put16(buf, 0);
+	put32(buf, 32+64);
+
+	//EPB iface 1 (skipped)
+	put32(buf, 0x6);
+	put32(buf, 32+64);
+	put32(buf, 1);
+	put32(buf, 0);
+	put32(buf, 0);
+	put32(buf, 64);
+	put32(buf, 64);
+	buf.insert(buf.end(), frames[2], frames[2]+64);
+	put32(buf, 32+64);
+
+	//Unknown block (skipped)
+	put32(buf, 0x5);
+	put32(buf, 16);
+	put32(buf, 0);
+	put32(buf, 16);
+
+	//SPB (iface 0)
+	put32(buf, 0x3);
+	put32(buf, 16+64);
+	put32(buf, 64);
+	buf.insert(buf.end(), frames[3], frames[3]+64);
+	put32(buf, 16+64);
+
+	write_file(buf);
+
+	CPPUNIT_ASSERT(reader.open(path) == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(reader.get_num_of_frames() == 2);
+	CPPUNIT_ASSERT(reader.get_num_of_skipped() == 1);
+	CPPUNIT_ASSERT(reader.get_frame(0)->len == 62);
+	CPPUNIT_ASSERT(memcmp(reader.get_frame(0)->data, frames[1], 62) == 0);
+	CPPUNIT_ASSERT(reader.get_frame(1)->len == 64);
+	CPPUNIT_ASSERT(memcmp(reader.get_frame(1)->data, frames[3], 64) == 0);
+}
+
+void PcapFileTestCase::test_invalid(){
+	std::vector<uint8_t> buf(64, 0xAA);
+	pcap_reader reader;
+
+	fprintf(stderr,"<%s:%d> ************** Test invalid ************\n",__func__,__LINE__);
+
+	write_file(buf);
+	CPPUNIT_ASSERT(reader.open(path) == ROFL_FAILURE);
+	CPPUNIT_ASSERT(reader.open("/nonexistent/file.pcap") == ROFL_FAILURE);
+	CPPUNIT_ASSERT(reader.get_num_of_frames() == 0);
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(PcapFileTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
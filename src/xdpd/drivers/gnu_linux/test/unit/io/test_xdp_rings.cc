@@ -0,0 +1,287 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the AF_XDP UMEM and the fill/RX/TX/completion
+* ring handling of xdp_socket (the kernel side is simulated)
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <vector>
+#include "io/ports/xdp/xdp_socket.h"
+
+#ifdef HAVE_AF_XDP
+
+#include <linux/bpf.h>
+
+#define RING_SLOTS 64
+#define PKT_LEN 64
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+/*
+* xdp_socket over memory rings; the test plays the kernel
+*/
+class xdp_socket_sim : public xdp_socket{
+
+public:
+	xdp_socket_sim() : xdp_socket(RING_SLOTS){}
+
+	//Take up to n frames from the fill ring and receive a frame in each
+	unsigned int kernel_rx(unsigned int n){
+		unsigned int i;
+		uint32_t cons = *fr.consumer, rx_prod = *rx.producer;
+		struct xdp_desc* desc;
+
+		for(i=0; i<n && cons != *fr.producer && rx_prod - *rx.consumer < rx.size; ++i){
+			desc = &((struct xdp_desc*)rx.descs)[rx_prod++ & rx.mask];
+			desc->addr = ((uint64_t*)fr.descs)[cons++ & fr.mask] + XDP_PACKET_HEADROOM;
+			desc->len = PKT_LEN;
+			desc->options = 0;
+		}
+
+		*fr.consumer = cons;
+		*rx.producer = rx_prod;
+		return i;
+	}
+
+	//Transmit up to n TX descriptors (post them in the completion ring)
+	unsigned int kernel_tx(unsigned int n){
+		unsigned int i;
+		uint32_t cons = *tx.consumer, cr_prod = *cr.producer;
+
+		for(i=0; i<n && cons != *tx.producer; ++i)
+			((uint64_t*)cr.descs)[cr_prod++ & cr.mask] = ((struct xdp_desc*)tx.descs)[cons++ & tx.mask].addr;
+
+		*tx.consumer = cons;
+		*cr.producer = cr_prod;
+		return i;
+	}
+
+	uint32_t tx_published(void){
+		return *tx.producer;
+	}
+};
+
+//Count the free frames of the UMEM (and put them back)
+static unsigned int count_free_frames(){
+	vector<uint8_t*> frames;
+	uint8_t* frame;
+	unsigned int i;
+
+	while((frame = xdp_umem::get_frame()) != NULL)
+		frames.push_back(frame);
+
+	for(i=0; i<frames.size(); ++i)
+		xdp_umem::release_frame(frames[i]);
+
+	return frames.size();
+}
+
+class XdpRingsTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(XdpRingsTestCase);
+	CPPUNIT_TEST(test_umem);
+	CPPUNIT_TEST(test_fill_rx);
+	CPPUNIT_TEST(test_refill_umem_exhausted);
+	CPPUNIT_TEST(test_tx_completion);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_umem(void);
+	void test_fill_rx(void);
+	void test_refill_umem_exhausted(void);
+	void test_tx_completion(void);
+
+	unsigned int total_frames;
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+void XdpRingsTestCase::setUp(){
+	fprintf(stderr,"<%s:%d> ************** XdpRingsTestCase Set up ************\n",__func__,__LINE__);
+	CPPUNIT_ASSERT(xdp_umem::init() == ROFL_SUCCESS);
+	total_frames = IO_IFACE_XDP_UMEM_FRAMES-1;
+}
+
+void XdpRingsTestCase::tearDown(){
+	//Every test must give all the frames back
+	CPPUNIT_ASSERT(count_free_frames() == total_frames);
+	fprintf(stderr,"<%s:%d> ************** XdpRingsTestCase Tear Down ************\n",__func__,__LINE__);
+}
+
+void XdpRingsTestCase::test_umem(){
+
+	uint8_t* frame;
+
+	//Only one area, regardless of the number of calls
+	CPPUNIT_ASSERT(xdp_umem::init() == ROFL_SUCCESS);
+	CPPUNIT_ASSERT(xdp_umem::get_size() == (uint64_t)IO_IFACE_XDP_UMEM_FRAMES*xdp_umem::FRAME_SIZE);
+	CPPUNIT_ASSERT(count_free_frames() == total_frames);
+
+	frame = xdp_umem::get_frame();
+	CPPUNIT_ASSERT(frame != NULL);
+	CPPUNIT_ASSERT(xdp_umem::get_addr(frame) % xdp_umem::FRAME_SIZE == 0);
+	CPPUNIT_ASSERT(xdp_umem::get_ptr(xdp_umem::get_addr(frame)) == frame);
+
+	//Addresses within the frame (e.g. headroom) map to the frame
+	CPPUNIT_ASSERT(xdp_umem::get_frame_by_addr(xdp_umem::get_addr(frame)+XDP_PACKET_HEADROOM) == frame);
+	CPPUNIT_ASSERT(xdp_umem::get_frame_by_addr(xdp_umem::get_addr(frame)+xdp_umem::FRAME_SIZE-1) == frame);
+
+	CPPUNIT_ASSERT(count_free_frames() == total_frames-1);
+	xdp_umem::release_frame(frame);
+}
+
+void XdpRingsTestCase::test_fill_rx(){
+
+	unsigned int i;
+	struct xdp_desc* desc;
+	uint8_t* frame;
+	vector<uint8_t*> frames;
+	xdp_socket_sim* sock = new xdp_socket_sim();
+
+	//Nothing received yet
+	CPPUNIT_ASSERT(sock->read_packet() == NULL);
+
+	//Fill ring is filled completely, and only once
+	CPPUNIT_ASSERT(sock->refill() == RING_SLOTS);
+	CPPUNIT_ASSERT(sock->refill() == 0);
+	CPPUNIT_ASSERT(count_free_frames() == total_frames-RING_SLOTS);
+
+	//Receive some
+	CPPUNIT_ASSERT(sock->kernel_rx(10) == 10);
+
+	for(i=0; i<10; ++i){
+		desc = sock->read_packet();
+		CPPUNIT_ASSERT(desc != NULL);
+		CPPUNIT_ASSERT(desc->len == PKT_LEN);
+		CPPUNIT_ASSERT(xdp_umem::get_ptr(desc->addr) == xdp_umem::get_frame_by_addr(desc->addr)+XDP_PACKET_HEADROOM);
+
+		frame = sock->return_packet(desc);
+		CPPUNIT_ASSERT(frame == xdp_umem::get_frame_by_addr(desc->addr));
+		frames.push_back(frame);
+	}
+	CPPUNIT_ASSERT(sock->read_packet() == NULL);
+
+	//Only the frames taken by the kernel are refilled
+	CPPUNIT_ASSERT(sock->refill() == 10);
+	CPPUNIT_ASSERT(sock->refill() == 0);
+
+	//Received frames are ours until released
+	CPPUNIT_ASSERT(count_free_frames() == total_frames-RING_SLOTS-10);
+	for(i=0; i<frames.size(); ++i)
+		xdp_umem::release_frame(frames[i]);
+
+	//Frames in the rings are reclaimed on destruction
+	delete sock;
+}
+
+void XdpRingsTestCase::test_refill_umem_exhausted(){
+
+	unsigned int i;
+	struct xdp_desc* desc;
+	vector<uint8_t*> hoarded, frames;
+	uint8_t* frame;
+	xdp_socket_sim* sock = new xdp_socket_sim();
+
+	//Leave only 5 free frames in the UMEM
+	while((frame = xdp_umem::get_frame()) != NULL)
+		hoarded.push_back(frame);
+	for(i=0; i<5; ++i){
+		xdp_umem::release_frame(hoarded.back());
+		hoarded.pop_back();
+	}
+
+	CPPUNIT_ASSERT(sock->refill() == 5);
+
+	//All of them received and still held (e.g. in the pipeline)
+	CPPUNIT_ASSERT(sock->kernel_rx(RING_SLOTS) == 5);
+	while((desc = sock->read_packet()) != NULL)
+		frames.push_back(sock->return_packet(desc));
+	CPPUNIT_ASSERT(frames.size() == 5);
+
+	//Nothing to refill with; it must be retried later
+	CPPUNIT_ASSERT(sock->refill() == 0);
+
+	//Packets released
+	for(i=0; i<frames.size(); ++i)
+		xdp_umem::release_frame(frames[i]);
+
+	CPPUNIT_ASSERT(sock->refill() == 5);
+
+	//Give the rest back, and the ring is filled up
+	for(i=0; i<hoarded.size(); ++i)
+		xdp_umem::release_frame(hoarded[i]);
+
+	CPPUNIT_ASSERT(sock->refill() == RING_SLOTS-5);
+
+	delete sock;
+}
+
+void XdpRingsTestCase::test_tx_completion(){
+
+	unsigned int i;
+	uint8_t* frame;
+	xdp_socket_sim* sock = new xdp_socket_sim();
+
+	//Nothing to complete
+	CPPUNIT_ASSERT(sock->reap_completions() == 0);
+
+	//Fill the TX ring up
+	for(i=0; sock->has_free_slot(); ++i){
+		frame = xdp_umem::get_frame();
+		CPPUNIT_ASSERT(frame != NULL);
+		sock->fill_tx_slot(frame+XDP_PACKET_HEADROOM, PKT_LEN);
+	}
+	CPPUNIT_ASSERT(i == RING_SLOTS);
+	CPPUNIT_ASSERT(count_free_frames() == total_frames-RING_SLOTS);
+
+	//Hand them to the "kernel" (there is no socket to kick)
+	sock->send();
+	CPPUNIT_ASSERT(sock->tx_published() == RING_SLOTS);
+
+	//Half of them transmitted
+	CPPUNIT_ASSERT(sock->kernel_tx(RING_SLOTS/2) == RING_SLOTS/2);
+	CPPUNIT_ASSERT(sock->has_free_slot());
+	CPPUNIT_ASSERT(sock->reap_completions() == RING_SLOTS/2);
+	CPPUNIT_ASSERT(sock->reap_completions() == 0);
+	CPPUNIT_ASSERT(count_free_frames() == total_frames-RING_SLOTS/2);
+
+	//Frames not completed are reclaimed on destruction
+	delete sock;
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(XdpRingsTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
+
+#else
+
+//AF_XDP not supported by the kernel headers; skip
+int main( int argc, char* argv[] )
+{
+	return 77;
+}
+
+#endif //HAVE_AF_XDP
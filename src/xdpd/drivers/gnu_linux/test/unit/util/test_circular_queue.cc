@@ -0,0 +1,239 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the SPSC, MPSC and MPMC circular_queue
+* variants, including the bulk operations
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+#include "util/circular_queue.h"
+
+#define NUM_OF_ELEMS 200000
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define BULK 16
+
+using namespace std;
+using namespace xdpd::gnu_linux;
+
+class CircularQueueTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(CircularQueueTestCase);
+	CPPUNIT_TEST(test_bulk);
+	CPPUNIT_TEST(test_spsc);
+	CPPUNIT_TEST(test_mpsc);
+	CPPUNIT_TEST(test_mpmc);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_bulk(void);
+	void test_spsc(void);
+	void test_mpsc(void);
+	void test_mpmc(void);
+
+public:
+	void setUp(void){}
+	void tearDown(void){}
+};
+
+//Elements are encoded as (producer, sequence) pointers; never dereferenced
+static inline uintptr_t* encode(unsigned int producer, unsigned int seq){
+	return (uintptr_t*)(((uintptr_t)producer << 32) | (seq+1));
+}
+
+static inline void decode(uintptr_t* elem, unsigned int* producer, unsigned int* seq){
+	*producer = (uintptr_t)elem >> 32;
+	*seq = ((uintptr_t)elem & 0xFFFFFFFF) - 1;
+}
+
+template<circular_queue_sync_t SYNC>
+struct thread_args{
+	circular_queue<uintptr_t, SYNC>* queue;
+	unsigned int id;
+	unsigned int count;
+	bool bulk;
+
+	//Consumer results
+	std::vector<unsigned int>* seen;
+	bool in_order;
+};
+
+template<circular_queue_sync_t SYNC>
+static void* produce(void* arg){
+	thread_args<SYNC>* a = (thread_args<SYNC>*)arg;
+	uintptr_t* elems[BULK];
+	unsigned int i = 0, j, n;
+
+	while(i < a->count){
+		n = (a->bulk)? BULK : 1;
+		if(n > a->count-i)
+			n = a->count-i;
+		for(j=0;j<n;j++)
+			elems[j] = encode(a->id, i+j);
+		n = a->queue->enqueue_bulk(elems, n);
+		if(!n)
+			sched_yield(); //Full
+		i += n;
+	}
+
+	return NULL;
+}
+
+template<circular_queue_sync_t SYNC>
+static void* consume(void* arg){
+	thread_args<SYNC>* a = (thread_args<SYNC>*)arg;
+	uintptr_t* elems[BULK];
+	unsigned int i = 0, j, n, producer, seq;
+	std::vector<unsigned int> last(PRODUCERS, 0);
+
+	a->in_order = true;
+
+	while(i < a->count){
+		n = (a->bulk)? BULK : 1;
+		if(n > a->count-i)
+			n = a->count-i;
+		n = a->queue->dequeue_bulk(elems, n);
+		if(!n)
+			sched_yield(); //Empty
+		for(j=0;j<n;j++){
+			decode(elems[j], &producer, &seq);
+			(*a->seen)[producer*NUM_OF_ELEMS + seq]++;
+
+			//Per producer FIFO order (a single consumer sees all of them)
+			if(seq+1 <= last[producer])
+				a->in_order = false;
+			last[producer] = seq+1;
+		}
+		i += n;
+	}
+
+	return NULL;
+}
+
+template<circular_queue_sync_t SYNC>
+static void run(unsigned int producers, unsigned int consumers, bool check_order){
+	unsigned int i;
+	circular_queue<uintptr_t, SYNC> queue(1024);
+	std::vector<unsigned int> seen(PRODUCERS*NUM_OF_ELEMS, 0);
+	std::vector<thread_args<SYNC> > p_args(producers), c_args(consumers);
+	std::vector<pthread_t> p_threads(producers), c_threads(consumers);
+
+	for(i=0;i<consumers;i++){
+		c_args[i].queue = &queue;
+		c_args[i].id = i;
+		c_args[i].count = (producers*NUM_OF_ELEMS)/consumers;
+		c_args[i].bulk = (i%2 == 0);
+		c_args[i].seen = &seen;
+		CPPUNIT_ASSERT(pthread_create(&c_threads[i], NULL, consume<SYNC>, &c_args[i]) == 0);
+	}
+	for(i=0;i<producers;i++){
+		p_args[i].queue = &queue;
+		p_args[i].id = i;
+		p_args[i].count = NUM_OF_ELEMS;
+		p_args[i].bulk = (i%2 == 1);
+		CPPUNIT_ASSERT(pthread_create(&p_threads[i], NULL, produce<SYNC>, &p_args[i]) == 0);
+	}
+
+	for(i=0;i<producers;i++)
+		pthread_join(p_threads[i], NULL);
+	for(i=0;i<consumers;i++){
+		pthread_join(c_threads[i], NULL);
+		if(check_order)
+			CPPUNIT_ASSERT(c_args[i].in_order);
+	}
+
+	//Every element exactly once
+	for(i=0;i<producers*NUM_OF_ELEMS;i++)
+		CPPUNIT_ASSERT(seen[i] == 1);
+	CPPUNIT_ASSERT(queue.is_empty());
+}
+
+/* Tests */
+void CircularQueueTestCase::test_bulk(){
+	unsigned int i;
+	bool thrown;
+	uintptr_t* in[64];
+	uintptr_t* out[64];
+	circular_queue<uintptr_t, CQ_SPSC> queue(16);
+
+	fprintf(stderr,"<%s:%d> ************** Test bulk ************\n",__func__,__LINE__);
+
+	for(i=0;i<64;i++)
+		in[i] = encode(0, i);
+
+	//Capacity is slots-1
+	CPPUNIT_ASSERT(queue.enqueue_bulk(in, 64) == 15);
+	CPPUNIT_ASSERT(queue.is_full());
+	CPPUNIT_ASSERT(queue.size() == 15);
+	CPPUNIT_ASSERT(queue.non_blocking_write(in[0]) == ROFL_FAILURE);
+
+	//Partial dequeue and wrap around
+	CPPUNIT_ASSERT(queue.dequeue_bulk(out, 10) == 10);
+	for(i=0;i<10;i++)
+		CPPUNIT_ASSERT(out[i] == in[i]);
+	CPPUNIT_ASSERT(queue.enqueue_bulk(&in[15], 10) == 10);
+	CPPUNIT_ASSERT(queue.dequeue_bulk(out, 64) == 15);
+	for(i=0;i<15;i++)
+		CPPUNIT_ASSERT(out[i] == in[10+i]);
+
+	CPPUNIT_ASSERT(queue.is_empty());
+	CPPUNIT_ASSERT(queue.dequeue_bulk(out, 64) == 0);
+	CPPUNIT_ASSERT(queue.non_blocking_read() == NULL);
+
+	//Single element operations over the wrap around
+	for(i=0;i<1000;i++){
+		CPPUNIT_ASSERT(queue.non_blocking_write(in[i%64]) == ROFL_SUCCESS);
+		CPPUNIT_ASSERT(queue.non_blocking_read() == in[i%64]);
+	}
+
+	//Not a power of 2
+	try{
+		circular_queue<uintptr_t> invalid(100);
+		thrown = false;
+	}catch(eCircularQueueInvalidSize& e){
+		thrown = true;
+	}
+	CPPUNIT_ASSERT(thrown);
+}
+
+void CircularQueueTestCase::test_spsc(){
+	fprintf(stderr,"<%s:%d> ************** Test SPSC ************\n",__func__,__LINE__);
+	run<CQ_SPSC>(1, 1, true);
+}
+
+void CircularQueueTestCase::test_mpsc(){
+	fprintf(stderr,"<%s:%d> ************** Test MPSC ************\n",__func__,__LINE__);
+	run<CQ_MPSC>(PRODUCERS, 1, true);
+}
+
+void CircularQueueTestCase::test_mpmc(){
+	fprintf(stderr,"<%s:%d> ************** Test MPMC ************\n",__func__,__LINE__);
+	run<CQ_MPMC>(PRODUCERS, CONSUMERS, false);
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(CircularQueueTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post build check.
+	bool wasSuccessful = runner.run( "" );
+
+	std::cerr<<"************** Test finished ************"<<std::endl;
+
+	// Return error code 1 if the one of test failed.
+	return wasSuccessful ? 0 : 1;
+}
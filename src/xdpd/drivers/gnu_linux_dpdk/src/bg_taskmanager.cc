@@ -24,6 +24,8 @@
 #include "io/bufferpool.h"
 #include "io/iface_manager.h"
 #include "io/datapacket_storage.h"
+#include "processing/ls_internal_state.h"
+#include "processing/processing.h"
 #include "util/time_utils.h"
 
 using namespace xdpd::gnu_linux;
@@ -35,12 +37,16 @@ static bool bg_continue_execution = true;
 //IVANO: tmp code
 extern struct rte_mempool *pool_direct;
 
+//Period of the rebalancing of ports across cores (ms)
+extern unsigned int port_rebalance_ms;
+
 /**
  * This piece of code is meant to manage a thread that does:
  * 
  * - the expiration of the flow entries.
  * - the update the status of the ports
  * - purge old buffers in the buffer storage of a logical switch(pkt-in) 
+ * - the rebalancing of the ports across cores
  * - more?
  */
 
@@ -97,7 +103,7 @@ int process_timeouts(){
 			if(logical_switches[i] != NULL){
 
 				//Recover storage pointer
-				dps = (datapacket_storage*)logical_switches[i]->platform_state;
+				dps = ((switch_platform_state_t*)logical_switches[i]->platform_state)->storage;
 
 				//Loop until the oldest expired packet is taken out
 				while(dps->oldest_packet_needs_expiration(&buffer_id)){
@@ -132,7 +138,7 @@ int process_timeouts(){
  */
 void* x86_background_tasks_routine(void* param){
 
-	static struct timeval last_time_stats_updated={0,0}, last_time_links_updated={0,0}, now;
+	static struct timeval last_time_stats_updated={0,0}, last_time_links_updated={0,0}, last_time_ports_rebalanced={0,0}, last_time_core_idle_updated={0,0}, now;
 #ifdef GNU_LINUX_DPDK_ENABLE_NF
 	static struct timeval last_time_kni_commands_handled={0,0};
 #endif //GNU_LINUX_DPDK_ENABLE_NF
@@ -155,6 +161,18 @@ void* x86_background_tasks_routine(void* param){
 			iface_manager_update_stats();
 			last_time_stats_updated = now;
 		}
+
+		//Update the idle cycles of the cores
+		if(get_time_difference_ms(&now, &last_time_core_idle_updated)>=BG_UPDATE_CORE_IDLE_MS){
+			processing_update_core_idle();
+			last_time_core_idle_updated = now;
+		}
+
+		//Rebalance ports across cores
+		if(port_rebalance_ms && get_time_difference_ms(&now, &last_time_ports_rebalanced)>=port_rebalance_ms){
+			processing_rebalance_ports();
+			last_time_ports_rebalanced = now;
+		}
 		
 		//Handle commands for KNI ports
 #ifdef GNU_LINUX_DPDK_ENABLE_NF
@@ -13,6 +13,11 @@ COMPILER_ASSERT(INVALID_io_bufferpool_reservoir, (IO_BUFFERPOOL_RESERVOIR >= 64)
 
 COMPILER_ASSERT(INVALID_max_cpu_sockets, (MAX_CPU_SOCKETS > 0) );
 
+//Processing
+COMPILER_ASSERT(INVALID_processing_rebalance_min_load, (PROCESSING_REBALANCE_MIN_LOAD <= 100) );
+COMPILER_ASSERT(INVALID_processing_idle_polls_before_backoff, (PROCESSING_IDLE_POLLS_BEFORE_BACKOFF > 0) );
+COMPILER_ASSERT(INVALID_processing_worker_ring_slots, ((PROCESSING_WORKER_RING_SLOTS & (PROCESSING_WORKER_RING_SLOTS-1)) == 0) );
+
 //#if defined(GNU_LINUX_DPDK_ENABLE_NF) && !defined(DPDK_PATCHED_KNI)
 	//#warning DPDK is not patched to support rte_kni_init()
 //#endif
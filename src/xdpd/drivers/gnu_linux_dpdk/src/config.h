@@ -37,13 +37,71 @@
 //Frequency(period) of handling KNI commands in milliseconds
 #define BG_HANDLE_KNI_COMMANDS_MS 1000
 
+//Frequency(period) of the rebalancing of physical ports across cores, based
+//on their measured RX load, in milliseconds. 0 disables it. Can be overridden
+//with the rebalance_ms extra param
+#define BG_REBALANCE_PORTS_MS 1000
+
+//Frequency(period) of the update of the idle cycles (%) of the cores in
+//milliseconds
+#define BG_UPDATE_CORE_IDLE_MS 1000
+
+//Minimum load (% of cycles) of the most loaded core to rebalance ports
+#define PROCESSING_REBALANCE_MIN_LOAD 50
+
+//Minimum reduction (% of cycles) of the load of the most loaded core for a
+//port to be migrated
+#define PROCESSING_REBALANCE_MIN_GAIN 10
+
+/*
+* Processing model
+*/
+
+//Number of RX cores of the pipeline mode. In pipeline mode, the ports are
+//read by the RX cores, which distribute the packets, by a symmetric 5-tuple
+//hash (flow order is preserved), to the rest of the cores (workers). Workers
+//run the pipeline and TX. Useful for ports without RSS (e.g. NF ports).
+//0 (default) processes the packets of a port to completion in a single core.
+//Can be overridden with the rx_cores extra param
+#define PROCESSING_PIPELINE_RX_CORES 0
+
+//Slots of the ring of each worker (power of 2)
+#define PROCESSING_WORKER_RING_SLOTS 4096
+
+/*
+* Idle backoff
+*/
+
+//Number of consecutive polls without packets after which a core backs off.
+//It first pauses (rte_pause) during as many polls, and then sleeps
+#define PROCESSING_IDLE_POLLS_BEFORE_BACKOFF 1024
+
+//Max sleep of an idle core in microseconds; the sleep doubles on every idle
+//poll up to this value. It bounds the wake up latency, so RTE_RX_DESC_DEFAULT
+//must be able to absorb a burst during it. 0 disables the backoff (busy
+//polling). Can be overridden with the idle_max_us extra param
+#define PROCESSING_IDLE_MAX_SLEEP_US 20
+
+//Scale down (rte_power) the frequency of the cores while they sleep, and
+//back to the max when they receive packets. Requires the acpi-cpufreq driver
+//(userspace governor)
+//#define PROCESSING_IDLE_FREQ_SCALING
+
 /*
 * I/O stuff
 */
 //Number of output queues per interface
 #define IO_IFACE_NUM_QUEUES 1 //8
 #define IO_IFACE_MAX_PKT_BURST 32
-#define IO_MAX_PACKET_SIZE 1518
+
+//Maximum frame size (jumbo frames). Frames larger than the mbuf data room
+//(MBUF_DATA_SIZE) are received in multiple segments (scattered RX)
+#define IO_MAX_PACKET_SIZE 9216
+
+//Minimum number of bytes of the first segment of multi-segment frames. Headers
+//are only looked up in the first segment, so frames with a shorter first
+//segment are linearized on reception
+#define IO_MIN_FIRST_SEG_LEN 256
 
 //Bufferpool reservoir(PKT_INs); ideally at least X*max_num_lsis
 #define IO_BUFFERPOOL_RESERVOIR 2048
@@ -60,6 +118,15 @@
 //Buffer storage(PKT_IN) expiration time (seconds)
 #define IO_PKT_IN_STORAGE_EXPIRATION_S 10
 
+//PKT_IN queue (rte_ring) size, per LSI. Must be a power of 2
+#define IO_PKT_IN_LSI_QUEUE_SLOTS 1024
+
+//Max. PKT_INs dispatched per LSI and round (LSIs are served round-robin)
+#define IO_PKT_IN_BURST 32
+
+//Max. time the PKT_IN dispatcher sleeps when idle (ms)
+#define IO_PKT_IN_IDLE_TIMEOUT_MS 1000
+
 /*
  * RX and TX Prefetch, Host, and Write-back threshold values should be
  * carefully set for optimal performance. Consult the network
@@ -110,13 +177,26 @@
 
 //Other parameters
 #define RTE_MEM_CHANNELS 2
-#define MBUF_SIZE (/*2048*/9000 + sizeof(struct rte_mbuf) + RTE_PKTMBUF_HEADROOM)
+
+//mbuf data room (excluding the headroom)
+#define MBUF_DATA_SIZE 2048
+#define MBUF_SIZE (MBUF_DATA_SIZE + sizeof(struct rte_mbuf) + RTE_PKTMBUF_HEADROOM)
+
+//mbufs of the jumbo pools, holding a whole frame in a single segment
+#define JUMBO_MBUF_SIZE (IO_MAX_PACKET_SIZE + sizeof(struct rte_mbuf) + RTE_PKTMBUF_HEADROOM)
 
 /*
  * Default number of MBUFs per pool
  */
 #define DEFAULT_NB_MBUF 24576
 
+/*
+ * Number of MBUFs per jumbo pool. Jumbo mbufs are only used for the
+ * multi-segment frames that need to be linearized (e.g. L4 checksum
+ * recalculation, PKT_IN) and for large PACKET_OUTs
+ */
+#define DEFAULT_NB_JUMBO_MBUF 1024
+
 
 
 /**
@@ -129,6 +209,16 @@
 //Maximum number of KNI interfaces, used during preallocation
 #define GNU_LINUX_DPDK_MAX_KNI_IFACES 4
 
+/**
+* vhost-user NF ports. When the driver is configured with --enable-vhost
+* (GNU_LINUX_DPDK_ENABLE_VHOST), EXTERNAL NF ports are vhost-user ports, with
+* xDPd as the vhost backend, instead of KNI interfaces. There is no limit on
+* the number of vhost-user ports (other than PORT_MANAGER_MAX_PORTS).
+*
+* The unix socket of each port is GNU_LINUX_DPDK_VHOST_SOCKET_DIR/<port name>
+*/
+#define GNU_LINUX_DPDK_VHOST_SOCKET_DIR "/var/run/xdpd"
+
 /**
 * Uncomment the following line to enable the samaphore and implement a batch
 * meachanism in the DPDK secondary processes NF
@@ -25,6 +25,7 @@
 #include <rte_mempool.h> 
 #include <rte_mbuf.h> 
 #include <rte_ethdev.h> 
+#include <rte_cycles.h> 
 
 //only for Test
 #include <stdlib.h>
@@ -36,6 +37,8 @@
 #include "../io/iface_manager.h"
 #include "../io/pktin_dispatcher.h"
 #include "../processing/processing.h"
+#include "../../../hal_pktin_ext.h"
+#include "../../../hal_stats_ext.h"
 
 //Extensions
 #include "nf_extensions.h"
@@ -48,6 +51,9 @@ using namespace xdpd::gnu_linux;
 //Extra params MACROS
 #define DRIVER_EXTRA_COREMASK "coremask"
 #define DRIVER_EXTRA_POOL_SIZE "pool_size"
+#define DRIVER_EXTRA_REBALANCE_MS "rebalance_ms"
+#define DRIVER_EXTRA_RX_CORES "rx_cores"
+#define DRIVER_EXTRA_IDLE_MAX_US "idle_max_us"
 
 //Some useful macros
 #define STR(a) #a
@@ -61,22 +67,37 @@ using namespace xdpd::gnu_linux;
 "This driver supports Network Function port extensions. This functions enable xDPd to communicate to other entities via dedicated ports. The port type mapping from abstract xDPd ports to DPDK is the following:\n"\
 "   -NATIVE: not supported.\n"\
 "   -SHMEM: rte_ring shared memory port. The NF name is the name of the RTE ring.\n"\
-"   -EXTERNAL: KNI port.\n"\
+"   -EXTERNAL: KNI port (vhost-user port, if the driver is configured with --enable-vhost). The vhost-user socket is " GNU_LINUX_DPDK_VHOST_SOCKET_DIR "/<port name>.\n"\
 "\n\n"\
 "[1] http://www.dpdk.org"
 #define GNU_LINUX_DPDK_USAGE  \
 "\t\t\t\t" DRIVER_EXTRA_COREMASK "=<hexadecimal mask>;\t - DPDK coremask.\n"\
-"\t\t\t\t" DRIVER_EXTRA_POOL_SIZE "=<#bufs>;\t\t - Number of MBUFs in the pool (per CPU socket).\n"
+"\t\t\t\t" DRIVER_EXTRA_POOL_SIZE "=<#bufs>;\t\t - Number of MBUFs in the pool (per CPU socket).\n"\
+"\t\t\t\t" DRIVER_EXTRA_REBALANCE_MS "=<ms>;\t\t - Period of the rebalancing of ports across cores (0 disables it).\n"\
+"\t\t\t\t" DRIVER_EXTRA_RX_CORES "=<#cores>;\t\t - Pipeline mode; number of RX cores, the rest are workers (0 disables it).\n"\
+"\t\t\t\t" DRIVER_EXTRA_IDLE_MAX_US "=<us>;\t\t - Max sleep of idle cores (0 busy polling).\n"
 
 #define GNU_LINUX_DPDK_EXTRA_PARAMS "This driver has a number of optional \"extra parameters\" that can be used using -e option, specifying them as key1=value1;key2=value2... :\n\n"\
 "   " DRIVER_EXTRA_COREMASK "=<hexadecimal mask>\t - Overrides default coremaskDPDK EAL coremask. Default: " XSTR(DEFAULT_RTE_CORE_MASK) ".\n"\
-"   " DRIVER_EXTRA_POOL_SIZE "=<#bufs>;\t\t - Override the number of MBUFs or size of the pool (per CPU socket). Default: " XSTR(DEFAULT_NB_MBUF) ".\n\n"\
+"   " DRIVER_EXTRA_POOL_SIZE "=<#bufs>;\t\t - Override the number of MBUFs or size of the pool (per CPU socket). Default: " XSTR(DEFAULT_NB_MBUF) ".\n"\
+"   " DRIVER_EXTRA_REBALANCE_MS "=<ms>;\t\t - Override the period of the load-aware rebalancing of ports across cores; 0 disables it. Default: " XSTR(BG_REBALANCE_PORTS_MS) ".\n"\
+"   " DRIVER_EXTRA_RX_CORES "=<#cores>;\t\t - Enable the pipeline mode: the first #cores cores only read the ports, and distribute the packets by flow to the rest of the cores (workers); 0 is run-to-completion. Default: " XSTR(PROCESSING_PIPELINE_RX_CORES) ".\n"\
+"   " DRIVER_EXTRA_IDLE_MAX_US "=<us>;\t\t - Override the max sleep (wake up latency) of the cores that receive no packets; 0 disables the idle backoff (busy polling). Default: " XSTR(PROCESSING_IDLE_MAX_SLEEP_US) ".\n\n"\
 "The use of \"extra-params\" is highly discouraged for production machines. Tunning of the config.h is preferable.\n\n"
 
 
 //Number of MBUFs per pool (per CPU socket)
 unsigned int mbuf_pool_size = DEFAULT_NB_MBUF;
 
+//Period of the rebalancing of ports across cores (ms)
+unsigned int port_rebalance_ms = BG_REBALANCE_PORTS_MS;
+
+//Number of RX cores of the pipeline mode (0 run-to-completion)
+unsigned int pipeline_rx_cores = PROCESSING_PIPELINE_RX_CORES;
+
+//Max sleep of the idle backoff of the cores (us); 0 busy polling
+unsigned int idle_max_sleep_us = PROCESSING_IDLE_MAX_SLEEP_US;
+
 //Fake argv for eal
 static const char* argv_fake[] = {"xdpd", "-c", NULL, "-n", XSTR(RTE_MEM_CHANNELS), NULL};
 
@@ -124,6 +145,36 @@ static void parse_extra_params(const std::string& params){
 			ss__ >> mbufs;
 			mbuf_pool_size = mbufs;
 			ROFL_DEBUG(DRIVER_NAME" Overriding default #mbufs per pool(%u) with %u\n", DEFAULT_NB_MBUF, mbufs);
+		}else if(r.compare(DRIVER_EXTRA_REBALANCE_MS) == 0){
+			std::getline(ss_, r, '=');
+			r.erase(std::remove_if( r.begin(), r.end(),
+						::isspace ), r.end() );
+
+			std::istringstream ss__(r);
+			unsigned int ms;
+			ss__ >> ms;
+			port_rebalance_ms = ms;
+			ROFL_DEBUG(DRIVER_NAME" Overriding default port rebalancing period(%u ms) with %u ms\n", BG_REBALANCE_PORTS_MS, ms);
+		}else if(r.compare(DRIVER_EXTRA_RX_CORES) == 0){
+			std::getline(ss_, r, '=');
+			r.erase(std::remove_if( r.begin(), r.end(),
+						::isspace ), r.end() );
+
+			std::istringstream ss__(r);
+			unsigned int cores;
+			ss__ >> cores;
+			pipeline_rx_cores = cores;
+			ROFL_DEBUG(DRIVER_NAME" Overriding default number of pipeline RX cores(%u) with %u\n", PROCESSING_PIPELINE_RX_CORES, cores);
+		}else if(r.compare(DRIVER_EXTRA_IDLE_MAX_US) == 0){
+			std::getline(ss_, r, '=');
+			r.erase(std::remove_if( r.begin(), r.end(),
+						::isspace ), r.end() );
+
+			std::istringstream ss__(r);
+			unsigned int us;
+			ss__ >> us;
+			idle_max_sleep_us = us;
+			ROFL_DEBUG(DRIVER_NAME" Overriding default max idle sleep(%u us) with %u us\n", PROCESSING_IDLE_MAX_SLEEP_US, us);
 		}else{
 			t.erase(std::remove_if( t.begin(), t.end(),
 						::isspace ), t.end() );
@@ -746,6 +797,61 @@ monitoring_snapshot_state_t* hal_driver_get_monitoring_snapshot(uint64_t rev){
 	return NULL;
 }
 
+/**
+* @brief Configure the PKT_IN policer of a logical switch
+* (optional, see hal_pktin_ext.h)
+* @ingroup driver_management
+*/
+hal_result_t hal_driver_reconfigure_pkt_in_policer(uint64_t dpid, const int max_rate){
+
+	of_switch_t* lsw;
+
+	lsw = physical_switch_get_logical_switch_by_dpid(dpid);
+	if(!lsw || !lsw->platform_state)
+		return HAL_FAILURE;
+
+	pktin_policer_reconfigure(&((switch_platform_state_t*)lsw->platform_state)->policer, max_rate);
+
+	return HAL_SUCCESS;
+}
+
+/**
+* @brief Retrieve the idle cycles of the packet processing cores
+* (optional, see hal_stats_ext.h)
+* @ingroup driver_management
+*/
+hal_result_t hal_driver_get_core_idle(hal_core_idle_snapshot_t* snapshot){
+
+	unsigned int i;
+	core_tasks_t* core_task;
+	hal_core_idle_t* core;
+
+	if(!snapshot)
+		return HAL_FAILURE;
+
+	snapshot->cycles_hz = rte_get_tsc_hz();
+	snapshot->period_ms = BG_UPDATE_CORE_IDLE_MS;
+	snapshot->num_of_cores = 0;
+
+	for(i=0; i<RTE_MAX_LCORE && snapshot->num_of_cores < HAL_CORE_IDLE_MAX_CORES; ++i){
+		core_task = &processing_core_tasks[i];
+
+		if(!core_task->available)
+			continue;
+
+		core = &snapshot->cores[snapshot->num_of_cores++];
+		core->core_id = i;
+		core->socket_id = rte_lcore_to_socket_id(i);
+		core->active = core_task->active;
+		core->idle_pct = (core_task->active)? core_task->idle : 100;
+		core->idle_cycles = core_task->idle_cycles;
+		core->busy_cycles = core_task->busy_cycles;
+		core->backoffs = core_task->backoffs;
+	}
+
+	return HAL_SUCCESS;
+}
+
 /**
  * @brief get a list of available matching algorithms
  * @ingroup driver_management
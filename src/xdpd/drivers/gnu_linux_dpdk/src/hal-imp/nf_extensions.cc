@@ -24,9 +24,14 @@ hal_result_t hal_driver_dpdk_nf_create_nf_port(const char *nf_name, const char *
 	//for that the DPDK KNI kernel module should take into account that 
 	//the number of KNI interfaces to bootstrap the kthread/s 
 
-	//Initialize KNI subsystem if 
+	//Initialize KNI (or vhost-user) subsystem if 
 	if(nf_port_type == PORT_TYPE_NF_EXTERNAL && !kni_inited){
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+		if(nf_iface_manager_vhost_init() != ROFL_SUCCESS)
+			return HAL_FAILURE;
+#else
 		rte_kni_init(GNU_LINUX_DPDK_MAX_KNI_IFACES);
+#endif
 		kni_inited = true;
 	}
 
@@ -1,5 +1,6 @@
 #include <rofl_datapath.h>
 #include <assert.h>
+#include <string.h>
 #include <rofl/datapath/hal/openflow/openflow1x/of1x_driver.h>
 #include <rofl/common/utils/c_logger.h>
 #include <rofl/datapath/pipeline/physical_switch.h>
@@ -20,11 +21,14 @@
 #include "../../../io/bufferpool.h"
 #include "../../../io/dpdk_datapacket.h"
 #include "../../../io/datapacket_storage.h"
+#include "../../../processing/ls_internal_state.h"
+#include "../../../../../hal_flows_ext.h"
 
 
 #include <rte_memcpy.h>
 
 extern struct rte_mempool* direct_pools[];
+extern struct rte_mempool* jumbo_pools[];
 
 using namespace xdpd::gnu_linux;
 
@@ -246,7 +250,7 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 	if(!action_group_of1x_packet_in_contains_output(action_group)){
 
 		if (OF1XP_NO_BUFFER != buffer_id) {
-			pkt = ((datapacket_storage*)lsw->platform_state)->get_packet(buffer_id);
+			pkt = ((switch_platform_state_t*)lsw->platform_state)->storage->get_packet(buffer_id);
 			if (NULL != pkt) {
 				bufferpool::release_buffer(pkt);
 			}
@@ -260,7 +264,7 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 	if( buffer_id && buffer_id != OF1XP_NO_BUFFER){
 	
 		//Retrieve the packet
-		pkt = ((datapacket_storage*)lsw->platform_state)->get_packet(buffer_id);
+		pkt = ((switch_platform_state_t*)lsw->platform_state)->storage->get_packet(buffer_id);
 
 		//Buffer has expired
 		if(!pkt){
@@ -271,7 +275,7 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 		datapacket_dpdk_t* pkt_dpdk = (datapacket_dpdk_t*)pkt->platform_state;
 		//keep checksum_calculation flags
 		uint32_t calculate_checksums_in_sw = pkt_dpdk->clas_state.calculate_checksums_in_sw;
-		classify_packet(&pkt_dpdk->clas_state, get_buffer_dpdk(pkt_dpdk), get_buffer_length_dpdk(pkt_dpdk), in_port, 0);
+		classify_datapacket_dpdk(pkt_dpdk, in_port, 0);
 		pkt_dpdk->clas_state.calculate_checksums_in_sw |= calculate_checksums_in_sw;
 	}else{
 		//Retrieve a free buffer	
@@ -282,13 +286,19 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 			return HAL_FAILURE; /* TODO: add specific error */
 		}	
 	
-		//Initialize the packet and copy
-		struct rte_mbuf* mbuf = rte_pktmbuf_alloc(direct_pools[0]);
+		//Initialize the packet and copy (frames larger than the mbuf data room in a jumbo mbuf)
+		struct rte_mbuf* mbuf = rte_pktmbuf_alloc((buffer_size > MBUF_DATA_SIZE)? jumbo_pools[0] : direct_pools[0]);
 		if(mbuf==NULL){
 			ROFL_ERR("Error prependig packet to mbuf\n");
+			bufferpool::release_buffer(pkt);
+			return HAL_FAILURE;
+		}
+		if(rte_pktmbuf_append(mbuf, buffer_size) == NULL){
+			ROFL_ERR("PACKET_OUT of %u bytes exceeds the maximum frame size (%u)\n", buffer_size, IO_MAX_PACKET_SIZE);
+			rte_pktmbuf_free(mbuf);
+			bufferpool::release_buffer(pkt);
 			return HAL_FAILURE;
 		}
-		rte_pktmbuf_append(mbuf, buffer_size);
 		rte_memcpy(rte_pktmbuf_mtod(mbuf, uint8_t*), buffer, buffer_size);
 		assert( rte_pktmbuf_pkt_len(mbuf) == buffer_size );
 		
@@ -297,7 +307,7 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 
 		//Reclassify the packet
 		datapacket_dpdk_t* pkt_dpdk = (datapacket_dpdk_t*)pkt->platform_state;
-		classify_packet(&pkt_dpdk->clas_state, get_buffer_dpdk(pkt_dpdk), get_buffer_length_dpdk(pkt_dpdk), in_port, 0);
+		classify_datapacket_dpdk(pkt_dpdk, in_port, 0);
 	}
 
 
@@ -344,7 +354,7 @@ hal_fm_result_t hal_driver_of1x_process_flow_mod_add(uint64_t dpid, uint8_t tabl
 
 	if(buffer_id && buffer_id != OF1XP_NO_BUFFER){
 	
-		datapacket_t* pkt = ((datapacket_storage*)lsw->platform_state)->get_packet(buffer_id);
+		datapacket_t* pkt = ((switch_platform_state_t*)lsw->platform_state)->storage->get_packet(buffer_id);
 	
 		if(!pkt){
 			//Return failure (buffer ID was invalid/expired)
@@ -395,7 +405,7 @@ hal_fm_result_t hal_driver_of1x_process_flow_mod_modify(uint64_t dpid, uint8_t t
 
 	if(buffer_id && buffer_id != OF1XP_NO_BUFFER){
 
-		datapacket_t* pkt = ((datapacket_storage*)lsw->platform_state)->get_packet(buffer_id);
+		datapacket_t* pkt = ((switch_platform_state_t*)lsw->platform_state)->storage->get_packet(buffer_id);
 
 		//Return failure (buffer ID was invalid/expired)
 		if(!pkt)
@@ -491,6 +501,88 @@ of1x_stats_flow_msg_t* hal_driver_of1x_get_flow_stats(uint64_t dpid, uint8_t tab
 	return of1x_get_flow_stats(&lsw->pipeline, table_id, cookie, cookie_mask, out_port, out_group, matches);
 }
 
+/**
+ * @name    hal_driver_of1x_get_flow_stats_page
+ * @brief   Recovers the flow stats of a page of the entries matching the filter
+ * (optional, see hal_flows_ext.h)
+ * @ingroup of1x_driver_async_event_processing
+ *
+ * Entries are only copied into the message if they are in the page; the
+ * rest are just counted, so that listing a page of a large table costs
+ * the walk, not a copy of the table.
+ */
+of1x_stats_flow_msg_t* hal_driver_of1x_get_flow_stats_page(uint64_t dpid, uint8_t table_id, uint64_t cookie, uint64_t cookie_mask, uint32_t out_port, uint32_t out_group, of1x_match_group_t *const matches, hal_flow_stats_page_t* page){
+
+	unsigned int i, first, last;
+	of1x_switch_t* lsw;
+	of1x_flow_table_t* table;
+	of1x_flow_entry_t *entry, *check_entry;
+	of1x_stats_flow_msg_t* msg;
+	of1x_stats_single_flow_msg_t* flow_stats;
+
+	//Recover port	
+	lsw = (of1x_switch_t*)physical_switch_get_logical_switch_by_dpid(dpid);
+
+	if(!lsw || !page){
+		assert(0);
+		return NULL;
+	}
+
+	if(table_id >= lsw->pipeline.num_of_tables && table_id != OF1X_FLOW_TABLE_ALL)
+		return NULL; 
+
+	msg = __of1x_init_stats_flow_msg();
+	check_entry = of1x_init_flow_entry(false);
+
+	if(!msg || !check_entry){
+		if(msg)
+			of1x_destroy_stats_flow_msg(msg);
+		if(check_entry)
+			of1x_destroy_flow_entry(check_entry);
+		return NULL;
+	}
+
+	//Borrow the matches (non-strict check); given back before destroying the entry
+	if(matches)
+		check_entry->matches = *matches;
+
+	first = (table_id == OF1X_FLOW_TABLE_ALL)? 0 : table_id;
+	last = (table_id == OF1X_FLOW_TABLE_ALL)? lsw->pipeline.num_of_tables : table_id+1;
+	page->total = 0;
+
+	for(i=first; i<last; ++i){
+		table = &lsw->pipeline.tables[i];
+
+		platform_rwlock_rdlock(table->rwlock);
+
+		for(entry=table->entries; entry; entry=entry->next){
+
+			if(page->priority != HAL_FLOW_STATS_PAGE_ANY_PRIORITY && entry->priority != (uint32_t)page->priority)
+				continue;
+			if((entry->cookie & cookie_mask) != (cookie & cookie_mask))
+				continue;
+			if(!__of1x_flow_entry_check_contained(entry, check_entry, false, false, out_port, out_group, false))
+				continue;
+
+			//In the page
+			if(page->total >= page->offset && (!page->limit || page->total - page->offset < page->limit)){
+				flow_stats = __of1x_init_stats_single_flow_msg(entry);
+				if(flow_stats)
+					__of1x_push_single_flow_stats_to_msg(msg, flow_stats);
+			}
+
+			page->total++;
+		}
+
+		platform_rwlock_rdunlock(table->rwlock);
+	}
+
+	memset(&check_entry->matches, 0, sizeof(check_entry->matches));
+	of1x_destroy_flow_entry(check_entry);
+
+	return msg;
+}
+
  
 /**
  * @name    hal_driver_of1x_get_flow_aggregate_stats
@@ -1,4 +1,9 @@
 #include "dpdk_datapacket.h"
+#include <rte_memcpy.h>
+#include <rte_lcore.h>
+
+//Jumbo MBUF pools (linearized frames)
+extern struct rte_mempool* jumbo_pools[MAX_CPU_SOCKETS];
 
 datapacket_dpdk_t* create_datapacket_dpdk(datapacket_t* pkt){
 	datapacket_dpdk_t* dpkt = (datapacket_dpdk_t*) malloc(sizeof(datapacket_dpdk_t));
@@ -11,21 +16,130 @@ void destroy_datapacket_dpdk(datapacket_dpdk_t* dpkt){
 }
 
 /*
- * Push&pop operations
+ * Multi-segment (jumbo) frames
+ */
+struct rte_mbuf* copy_mbuf_dpdk(struct rte_mbuf* mbuf, struct rte_mempool* pool){
+
+	struct rte_mbuf *head, *tail, *seg;
+	uint32_t off, len, room;
+
+	head = tail = rte_pktmbuf_alloc(pool);
+	if(unlikely(head == NULL))
+		return NULL;
+
+	MBUF_IN_PORT(head) = MBUF_IN_PORT(mbuf);
+
+	for(seg = mbuf; seg; seg = MBUF_NEXT(seg)){
+		for(off = 0; off < rte_pktmbuf_data_len(seg); off += len){
+
+			room = rte_pktmbuf_tailroom(tail);
+
+			//Chain a new segment
+			if(unlikely(room == 0)){
+				MBUF_NEXT(tail) = rte_pktmbuf_alloc(pool);
+				if(unlikely(MBUF_NEXT(tail) == NULL)){
+					rte_pktmbuf_free(head);
+					return NULL;
+				}
+				tail = MBUF_NEXT(tail);
+				MBUF_NB_SEGS(head)++;
+				room = rte_pktmbuf_tailroom(tail);
+			}
+
+			len = RTE_MIN(room, rte_pktmbuf_data_len(seg) - off);
+			rte_memcpy(rte_pktmbuf_mtod(tail, uint8_t*) + rte_pktmbuf_data_len(tail), rte_pktmbuf_mtod(seg, uint8_t*) + off, len);
+			rte_pktmbuf_data_len(tail) += len;
+			rte_pktmbuf_pkt_len(head) += len;
+		}
+	}
+
+	return head;
+}
+
+struct rte_mbuf* linearize_mbuf_dpdk(struct rte_mbuf* mbuf){
+
+	struct rte_mbuf* linear;
+	struct rte_mempool* pool = jumbo_pools[rte_socket_id()];
+
+	if(unlikely(pool == NULL))
+		pool = jumbo_pools[0];
+
+	linear = copy_mbuf_dpdk(mbuf, pool);
+	if(unlikely(linear == NULL))
+		return NULL;
+
+	//Larger than the jumbo data room
+	if(unlikely(!rte_pktmbuf_is_contiguous(linear))){
+		rte_pktmbuf_free(linear);
+		return NULL;
+	}
+
+	rte_pktmbuf_free(mbuf);
+	return linear;
+}
+
+rofl_result_t linearize_datapacket_dpdk(datapacket_dpdk_t *dpkt){
+
+	struct rte_mbuf* mbuf;
+	uint32_t calculate_checksums_in_sw;
+
+	if(rte_pktmbuf_is_contiguous(dpkt->mbuf))
+		return ROFL_SUCCESS;
+
+	mbuf = linearize_mbuf_dpdk(dpkt->mbuf);
+	if(unlikely(mbuf == NULL))
+		return ROFL_FAILURE;
+	dpkt->mbuf = mbuf;
+
+	//Headers have moved; reclassify keeping the checksum calculation flags
+	calculate_checksums_in_sw = dpkt->clas_state.calculate_checksums_in_sw;
+	classify_datapacket_dpdk(dpkt, dpkt->clas_state.port_in, dpkt->clas_state.phy_port_in);
+	dpkt->clas_state.calculate_checksums_in_sw = calculate_checksums_in_sw;
+
+	return ROFL_SUCCESS;
+}
+
+/*
+ * Make the frame contiguous before headers are pushed or popped; the classifier
+ * reclassifies the whole frame (clas_state.len) afterwards
+ */
+static inline rofl_result_t linearize_for_push_pop(datapacket_dpdk_t *dpkt){
+
+	struct rte_mbuf* mbuf;
+
+	if(likely(rte_pktmbuf_is_contiguous(dpkt->mbuf)))
+		return ROFL_SUCCESS;
+
+	mbuf = linearize_mbuf_dpdk(dpkt->mbuf);
+	if(unlikely(mbuf == NULL))
+		return ROFL_FAILURE;
+	dpkt->mbuf = mbuf;
+
+	return ROFL_SUCCESS;
+}
+
+/*
+ * Push&pop operations. Multi-segment frames are linearized first, and the
+ * headers shifted using the headroom
  */
 rofl_result_t push_datapacket_offset(datapacket_dpdk_t *dpkt, unsigned int offset, unsigned int num_of_bytes){
 	
-	uint8_t *src_ptr = get_buffer_dpdk(dpkt);
-	uint8_t *dst_ptr = (uint8_t*)rte_pktmbuf_prepend(dpkt->mbuf, num_of_bytes);
+	uint8_t *src_ptr;
+	uint8_t *dst_ptr;
+
+	if( linearize_for_push_pop(dpkt) != ROFL_SUCCESS )
+		return ROFL_FAILURE;
+
+	src_ptr = get_buffer_dpdk(dpkt);
+
+	if( offset > get_buffer_seg_length_dpdk(dpkt) )
+		return ROFL_FAILURE;
+
+	dst_ptr = (uint8_t*)rte_pktmbuf_prepend(dpkt->mbuf, num_of_bytes);
 	//NOTE dst_ptr = src_ptr - num_of_bytes
 	
 	if( NULL==dst_ptr )
 		return ROFL_FAILURE;
-	
-	if(false==rte_pktmbuf_is_contiguous(dpkt->mbuf)){
-		assert(0);
-		return ROFL_FAILURE;
-	}
 
 	// move header num_of_bytes backward
 	memmove(dst_ptr, src_ptr, offset);
@@ -44,17 +158,22 @@ rofl_result_t push_datapacket_offset(datapacket_dpdk_t *dpkt, unsigned int offse
 
 rofl_result_t pop_datapacket_offset(datapacket_dpdk_t *dpkt, unsigned int offset, unsigned int num_of_bytes){
 	
-	uint8_t *src_ptr = get_buffer_dpdk(dpkt);
-	uint8_t *dst_ptr = (uint8_t*)rte_pktmbuf_adj(dpkt->mbuf, num_of_bytes);
+	uint8_t *src_ptr;
+	uint8_t *dst_ptr;
+
+	if( linearize_for_push_pop(dpkt) != ROFL_SUCCESS )
+		return ROFL_FAILURE;
+
+	src_ptr = get_buffer_dpdk(dpkt);
+
+	if( (offset + num_of_bytes) > get_buffer_seg_length_dpdk(dpkt) )
+		return ROFL_FAILURE;
+
+	dst_ptr = (uint8_t*)rte_pktmbuf_adj(dpkt->mbuf, num_of_bytes);
 	//NOTE dst_ptr = src_ptr + num_of_bytes
 	
 	if( NULL==dst_ptr )
 		return ROFL_FAILURE;
-
-	if(false==rte_pktmbuf_is_contiguous(dpkt->mbuf)){
-		assert(0);
-		return ROFL_FAILURE;
-	}
 	
 	// move first bytes backward
 	memmove(dst_ptr, src_ptr, offset);
@@ -75,16 +194,11 @@ rofl_result_t push_datapacket_point(datapacket_dpdk_t *dpkt, uint8_t* push_point
 	
 	uint8_t *src_ptr = get_buffer_dpdk(dpkt);
 	
-	if(false==rte_pktmbuf_is_contiguous(dpkt->mbuf)){
-		assert(0);
-		return ROFL_FAILURE;
-	}
-	
 	if (push_point < src_ptr){
 		return ROFL_FAILURE;
 	}
 
-	if (((uint8_t*)push_point + num_of_bytes) > (src_ptr + get_buffer_length_dpdk(dpkt))){
+	if (((uint8_t*)push_point + num_of_bytes) > (src_ptr + get_buffer_seg_length_dpdk(dpkt))){
 		return ROFL_FAILURE;
 	}
 
@@ -99,20 +213,15 @@ rofl_result_t pop_datapacket_point(datapacket_dpdk_t *dpkt, uint8_t* pop_point,
 	
 	uint8_t *src_ptr = get_buffer_dpdk(dpkt);
 	
-	if(false==rte_pktmbuf_is_contiguous(dpkt->mbuf)){
-		assert(0);
-		return ROFL_FAILURE;
-	}
-	
 	if (pop_point < src_ptr){
 		return ROFL_FAILURE;
 	}
 
-	if (((uint8_t*)pop_point + num_of_bytes) > (src_ptr + get_buffer_length_dpdk(dpkt))){
+	if (((uint8_t*)pop_point + num_of_bytes) > (src_ptr + get_buffer_seg_length_dpdk(dpkt))){
 		return ROFL_FAILURE;
 	}
 
-	size_t offset = (src_ptr - pop_point);
+	size_t offset = (pop_point - src_ptr);
 
 	return pop_datapacket_offset(dpkt, offset, num_of_bytes);
 }
@@ -12,6 +12,7 @@
 #include <rte_common.h> 
 #include <rte_eal.h> 
 #include <rte_mbuf.h> 
+#include "mbuf_compat.h"
 
 #include "packet_classifiers/pktclassifier.h"
 
@@ -70,6 +71,21 @@ static inline size_t get_buffer_length_dpdk(datapacket_dpdk_t *dpkt){
 	return rte_pktmbuf_pkt_len(dpkt->mbuf);
 }
 
+//Return the length of the first segment. Headers are always within the first segment
+static inline size_t get_buffer_seg_length_dpdk(datapacket_dpdk_t *dpkt){
+	return rte_pktmbuf_data_len(dpkt->mbuf);
+}
+
+/*
+* Classify the packet. Only the first segment of multi-segment (jumbo) frames
+* is contiguous, so the headers are parsed within it (frames are received with
+* at least IO_MIN_FIRST_SEG_LEN bytes in it); len is the frame length
+*/
+static inline void classify_datapacket_dpdk(datapacket_dpdk_t *dpkt, uint32_t in_port, uint32_t in_phy_port){
+	classify_packet(&dpkt->clas_state, get_buffer_dpdk(dpkt), get_buffer_seg_length_dpdk(dpkt), in_port, in_phy_port);
+	dpkt->clas_state.len = get_buffer_length_dpdk(dpkt);
+}
+
 //Init & reset (inline)
 static inline rofl_result_t init_datapacket_dpdk(datapacket_dpdk_t *dpkt, struct rte_mbuf* mbuf, of_switch_t* sw, uint32_t in_port, uint32_t in_phy_port, bool classify, bool packet_is_in_bufferpool){
 	
@@ -85,7 +101,7 @@ static inline rofl_result_t init_datapacket_dpdk(datapacket_dpdk_t *dpkt, struct
 
 	//Classify the packet
 	if(likely(classify)){
-		classify_packet(&dpkt->clas_state, get_buffer_dpdk(dpkt), get_buffer_length_dpdk(dpkt), in_port, in_phy_port);
+		classify_datapacket_dpdk(dpkt, in_port, in_phy_port);
 	}else{
 		//Just initialize the base and len pointers in the classification state
 		dpkt->clas_state.base = get_buffer_dpdk(dpkt);
@@ -96,6 +112,36 @@ static inline rofl_result_t init_datapacket_dpdk(datapacket_dpdk_t *dpkt, struct
 }
 
 
+/**
+* Copy an mbuf (chain) into new mbufs of pool, filling each segment up to its
+* data room. Returns NULL if the pool is exhausted.
+*/
+struct rte_mbuf* copy_mbuf_dpdk(struct rte_mbuf* mbuf, struct rte_mempool* pool);
+
+/**
+* Linearize a multi-segment mbuf into a single jumbo mbuf. On success the
+* original mbuf is released and the new one is returned; on failure NULL is
+* returned and the original mbuf is left untouched.
+*/
+struct rte_mbuf* linearize_mbuf_dpdk(struct rte_mbuf* mbuf);
+
+/**
+* Linearize a multi-segment packet (reclassifying it), so that it can be
+* accessed as a contiguous buffer. No-op for single segment packets.
+*/
+rofl_result_t linearize_datapacket_dpdk(datapacket_dpdk_t *dpkt);
+
+//Whether the packet has to be linearized before the L4 checksums, which span
+//the payload, can be recalculated in software
+static inline bool l4_checksum_needs_linearization_dpdk(datapacket_dpdk_t *dpkt){
+#ifndef DONT_CALCULATE_ANY_CHECKSUM_IN_SW
+	return unlikely(!rte_pktmbuf_is_contiguous(dpkt->mbuf)) &&
+		(dpkt->clas_state.calculate_checksums_in_sw & ~(1 << RECALCULATE_IPV4_CHECKSUM_IN_SW));
+#else
+	return false;
+#endif
+}
+
 // Push & Pop raw operations. To be used ONLY by classifiers
 rofl_result_t push_datapacket_offset(datapacket_dpdk_t *dpkt, unsigned int offset, unsigned int num_of_bytes);
 rofl_result_t pop_datapacket_offset(datapacket_dpdk_t *dpkt, unsigned int offset, unsigned int num_of_bytes);
@@ -0,0 +1,129 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _FLOW_HASH_H_
+#define _FLOW_HASH_H_
+
+#include <stdint.h>
+#include <rte_config.h>
+#include <rte_common.h>
+#include <rte_mbuf.h>
+#include <rte_byteorder.h>
+#include <rte_jhash.h>
+
+/**
+* @file flow_hash.h
+*
+* @brief Symmetric flow hash of a received frame, used to distribute the
+* packets to the worker cores (pipeline mode) without reordering flows.
+*/
+
+namespace xdpd {
+namespace gnu_linux_dpdk {
+
+#define FLOW_HASH_ETH_HDR_LEN 14
+#define FLOW_HASH_VLAN_HDR_LEN 4
+#define FLOW_HASH_MAX_VLAN_TAGS 2
+
+#define FLOW_HASH_ETH_TYPE_IPV4 0x0800
+#define FLOW_HASH_ETH_TYPE_IPV6 0x86DD
+#define FLOW_HASH_ETH_TYPE_VLAN 0x8100
+#define FLOW_HASH_ETH_TYPE_QINQ 0x88A8
+
+#define FLOW_HASH_IP_PROTO_TCP 6
+#define FLOW_HASH_IP_PROTO_UDP 17
+#define FLOW_HASH_IP_PROTO_SCTP 132
+
+//Both directions of a flow get the same hash
+static inline uint32_t flow_hash_words(uint32_t src, uint32_t dst, uint16_t sport, uint16_t dport, uint8_t proto){
+
+	uint32_t a = RTE_MIN(src, dst);
+	uint32_t b = RTE_MAX(src, dst);
+	uint32_t c = ((uint32_t)RTE_MIN(sport, dport) << 16 | RTE_MAX(sport, dport)) ^ proto;
+
+	return rte_jhash_3words(a, b, c, 0);
+}
+
+static inline uint32_t flow_hash_fold_ipv6(const uint8_t* addr){
+	const uint32_t* w = (const uint32_t*)addr;
+	return w[0] ^ w[1] ^ w[2] ^ w[3];
+}
+
+static inline uint32_t flow_hash_fold_mac(const uint8_t* mac){
+	return ((uint32_t)mac[0] << 24 | (uint32_t)mac[1] << 16 | (uint32_t)mac[2] << 8 | mac[3]) ^ ((uint32_t)mac[4] << 8 | mac[5]);
+}
+
+/**
+* Symmetric 5-tuple hash (IPv4/IPv6 addresses, protocol and TCP/UDP/SCTP
+* ports) of the frame. Fragments are hashed by their addresses and protocol
+* only, so that all the fragments of a datagram get the same hash. Non-IP
+* frames are hashed by their MAC addresses.
+*/
+static inline uint32_t flow_hash_symmetric(struct rte_mbuf* mbuf){
+
+	const uint8_t* data = rte_pktmbuf_mtod(mbuf, const uint8_t*);
+	unsigned int len = rte_pktmbuf_data_len(mbuf);
+	unsigned int off = FLOW_HASH_ETH_HDR_LEN, l4_off = 0, i;
+	uint16_t eth_type, sport = 0, dport = 0;
+	uint32_t src = 0, dst = 0;
+	uint8_t proto = 0;
+	bool ip = false, fragment = false;
+
+	if(unlikely(len < FLOW_HASH_ETH_HDR_LEN))
+		return 0;
+
+	eth_type = rte_be_to_cpu_16(*(const uint16_t*)(data+12));
+
+	//Skip VLAN tags
+	for(i=0; i<FLOW_HASH_MAX_VLAN_TAGS && (eth_type == FLOW_HASH_ETH_TYPE_VLAN || eth_type == FLOW_HASH_ETH_TYPE_QINQ); ++i){
+		if(unlikely(len < off + FLOW_HASH_VLAN_HDR_LEN))
+			break;
+		eth_type = rte_be_to_cpu_16(*(const uint16_t*)(data+off+2));
+		off += FLOW_HASH_VLAN_HDR_LEN;
+	}
+
+	switch(eth_type){
+		case FLOW_HASH_ETH_TYPE_IPV4:
+			if(unlikely(len < off + 20))
+				break;
+			proto = data[off+9];
+			src = *(const uint32_t*)(data+off+12);
+			dst = *(const uint32_t*)(data+off+16);
+			//MF flag or fragment offset set
+			fragment = (rte_be_to_cpu_16(*(const uint16_t*)(data+off+6)) & 0x3FFF) != 0;
+			l4_off = off + (data[off] & 0x0F)*4;
+			ip = true;
+			break;
+
+		case FLOW_HASH_ETH_TYPE_IPV6:
+			if(unlikely(len < off + 40))
+				break;
+			//Extension headers are not followed; the flow is then the address pair
+			proto = data[off+6];
+			src = flow_hash_fold_ipv6(data+off+8);
+			dst = flow_hash_fold_ipv6(data+off+24);
+			l4_off = off + 40;
+			ip = true;
+			break;
+
+		default:
+			break;
+	}
+
+	//Non-IP (or truncated)
+	if(!ip)
+		return flow_hash_words(flow_hash_fold_mac(data), flow_hash_fold_mac(data+6), 0, 0, 0);
+
+	if(!fragment && (proto == FLOW_HASH_IP_PROTO_TCP || proto == FLOW_HASH_IP_PROTO_UDP || proto == FLOW_HASH_IP_PROTO_SCTP) && likely(len >= l4_off + 4)){
+		sport = *(const uint16_t*)(data+l4_off);
+		dport = *(const uint16_t*)(data+l4_off+2);
+	}
+
+	return flow_hash_words(src, dst, sport, dport, proto);
+}
+
+}// namespace xdpd::gnu_linux_dpdk
+}// namespace xdpd
+
+#endif //_FLOW_HASH_H_
@@ -67,6 +67,9 @@ static switch_port_t* configure_port(unsigned int port_id){
 	//Set rx and tx queues
 	memset(&port_conf, 0, sizeof(port_conf));
 	port_conf.rxmode.max_rx_pkt_len =  IO_MAX_PACKET_SIZE;
+	//Jumbo frames; the PMD scatters frames larger than the mbuf data room (MBUF_DATA_SIZE)
+	//over multiple mbufs
+	port_conf.rxmode.jumbo_frame = (IO_MAX_PACKET_SIZE > ETHER_MAX_LEN)? 1 : 0;
 	//port_conf.rxmode.hw_ip_checksum = 1;
 	//port_conf.rx_adv_conf.rss_conf.rss_hf = ETH_RSS_IPV4 | ETH_RSS_IPV6;
 	port_conf.txmode.mq_mode = ETH_MQ_TX_NONE;
@@ -141,7 +144,7 @@ rofl_result_t iface_manager_set_queues(switch_port_t* port, unsigned int core_id
 	tx_conf.tx_thresh.wthresh = TX_WTHRESH;
 	tx_conf.tx_free_thresh = 0; /* Use PMD default values */
 	tx_conf.tx_rs_thresh = 0; /* Use PMD default values */
-	tx_conf.txq_flags = ETH_TXQ_FLAGS_NOMULTSEGS;
+	tx_conf.txq_flags = 0; //Multi-segment (jumbo) frames
 
 	//Check first for the socket CPU id
 	sock_id = rte_eth_dev_socket_id(port_id);
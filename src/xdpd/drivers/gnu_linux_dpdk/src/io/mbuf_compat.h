@@ -0,0 +1,32 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef _MBUF_COMPAT_H_
+#define _MBUF_COMPAT_H_
+
+#include <rte_version.h>
+#include <rte_mbuf.h>
+
+/**
+* @file mbuf_compat.h
+*
+* @brief Accessors to the mbuf fields whose layout changed across DPDK
+* releases. Up to 1.7 the packet fields live in mbuf->pkt; since 1.8 they are
+* members of the mbuf itself (and in_port was renamed to port).
+*
+* The packet and segment lengths are accessed with rte_pktmbuf_pkt_len() and
+* rte_pktmbuf_data_len(), which are (assignable) macros in all the releases.
+*/
+
+#if RTE_VERSION >= RTE_VERSION_NUM(1,8,0,0)
+	#define MBUF_NB_SEGS(m) ((m)->nb_segs)
+	#define MBUF_NEXT(m) ((m)->next)
+	#define MBUF_IN_PORT(m) ((m)->port)
+#else
+	#define MBUF_NB_SEGS(m) ((m)->pkt.nb_segs)
+	#define MBUF_NEXT(m) ((m)->pkt.next)
+	#define MBUF_IN_PORT(m) ((m)->pkt.in_port)
+#endif
+
+#endif //_MBUF_COMPAT_H_
@@ -17,6 +17,11 @@
 #include <rte_errno.h> 
 
 #include <fcntl.h>  
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#endif
 
 //fwd decl
 extern pthread_rwlock_t iface_manager_rwlock;
@@ -31,6 +36,7 @@ unsigned int nf_id = 0;
 */
 void iface_manager_handle_kni_commands()
 {
+#ifndef GNU_LINUX_DPDK_ENABLE_VHOST
 	switch_port_t* port;
 
 	for(int i=0;i<PORT_MANAGER_MAX_PORTS;i++)
@@ -47,9 +53,10 @@ void iface_manager_handle_kni_commands()
 		}
 		pthread_rwlock_unlock(&iface_manager_rwlock);
 	}
-
+#endif
 }
 
+#ifndef GNU_LINUX_DPDK_ENABLE_VHOST
 /* 
 *	Handle an external request to bring up/down a KNI interface
 */
@@ -80,6 +87,174 @@ static int kni_config_network_interface(uint8_t port_id, uint8_t if_up)
 	
 	return !if_up;
 }
+#endif
+
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+/****************************************************************************
+*						vhost-user backend									*
+*****************************************************************************/
+
+//Session thread (vhost-user socket handling)
+static pthread_t vhost_session_thread;
+static bool vhost_initialized = false;
+
+//Must be called with the iface_manager_rwlock held
+static switch_port_t* vhost_get_port(volatile struct virtio_net* dev)
+{
+	switch_port_t* port;
+	nf_port_state_vhost_t* ps;
+
+	for(unsigned int i=0;i<PORT_MANAGER_MAX_PORTS;i++)
+	{
+		port = nf_port_mapping[i];
+		if(!port || port->type != PORT_TYPE_NF_EXTERNAL)
+			continue;
+
+		ps = (nf_port_state_vhost_t*)port->platform_port_state;
+		if(strncmp(ps->path, (const char*)dev->ifname, sizeof(ps->path)) == 0)
+			return port;
+	}
+
+	return NULL;
+}
+
+static void vhost_notify_link(switch_port_t* port, bool link)
+{
+	switch_port_snapshot_t* port_snapshot;
+
+	if(link)
+		port->state &= ~PORT_STATE_LINK_DOWN;
+	else
+		port->state |= PORT_STATE_LINK_DOWN;
+
+	port_snapshot = physical_switch_get_port_snapshot(port->name); 
+	hal_cmm_notify_port_status_changed(port_snapshot);
+}
+
+/*
+*	A virtio peer (VM or virtio-user) connected and set up its virtqueues
+*/
+static int vhost_new_device(struct virtio_net* dev)
+{
+	switch_port_t* port;
+	nf_port_state_vhost_t* ps;
+
+	pthread_rwlock_rdlock(&iface_manager_rwlock);
+
+	port = vhost_get_port(dev);
+	if(!port)
+	{
+		pthread_rwlock_unlock(&iface_manager_rwlock);
+		ROFL_ERR(DRIVER_NAME"[port_manager] vhost-user device on unknown socket '%s'\n", dev->ifname);
+		return -1;
+	}
+
+	ps = (nf_port_state_vhost_t*)port->platform_port_state;
+
+	//Lcores poll; no need for guest kicks
+	rte_vhost_enable_guest_notification(dev, VIRTIO_RXQ, 0);
+	rte_vhost_enable_guest_notification(dev, VIRTIO_TXQ, 0);
+
+	dev->flags |= VIRTIO_DEV_RUNNING;
+	ps->dev = dev;
+
+	ROFL_INFO(DRIVER_NAME"[port_manager] vhost-user peer connected to NF port '%s'\n", port->name);
+
+	vhost_notify_link(port, true);
+
+	pthread_rwlock_unlock(&iface_manager_rwlock);
+
+	return 0;
+}
+
+/*
+*	The virtio peer disconnected
+*/
+static void vhost_destroy_device(volatile struct virtio_net* dev)
+{
+	switch_port_t* port;
+	nf_port_state_vhost_t* ps;
+
+	pthread_rwlock_rdlock(&iface_manager_rwlock);
+
+	port = vhost_get_port(dev);
+	if(!port)
+	{
+		pthread_rwlock_unlock(&iface_manager_rwlock);
+		return;
+	}
+
+	ps = (nf_port_state_vhost_t*)port->platform_port_state;
+
+	ps->dev = NULL;
+
+	pthread_rwlock_unlock(&iface_manager_rwlock);
+
+	//Make sure no lcore is still using the virtqueues before they are released
+	//(not holding the lock while waiting for the lcores)
+	processing_sync_cores();
+
+	dev->flags &= ~VIRTIO_DEV_RUNNING;
+
+	//The port may have been removed meanwhile
+	pthread_rwlock_rdlock(&iface_manager_rwlock);
+
+	port = vhost_get_port(dev);
+	if(port)
+	{
+		ROFL_INFO(DRIVER_NAME"[port_manager] vhost-user peer disconnected from NF port '%s'\n", port->name);
+		vhost_notify_link(port, false);
+	}
+
+	pthread_rwlock_unlock(&iface_manager_rwlock);
+}
+
+static void* vhost_session(void* arg)
+{
+	(void)arg;
+
+	//Does not return
+	rte_vhost_driver_session_start();
+
+	return NULL;
+}
+
+rofl_result_t nf_iface_manager_vhost_init()
+{
+	static struct virtio_net_device_ops ops;
+
+	if(vhost_initialized)
+		return ROFL_SUCCESS;
+
+	if(mkdir(GNU_LINUX_DPDK_VHOST_SOCKET_DIR, 0755) < 0 && errno != EEXIST)
+	{
+		ROFL_ERR(DRIVER_NAME"[port_manager] Cannot create vhost-user socket directory '%s': %s\n", GNU_LINUX_DPDK_VHOST_SOCKET_DIR, strerror(errno));
+		return ROFL_FAILURE;
+	}
+
+	memset(&ops, 0, sizeof(ops));
+	ops.new_device = vhost_new_device;
+	ops.destroy_device = vhost_destroy_device;
+
+	if(rte_vhost_driver_callback_register(&ops) < 0)
+	{
+		ROFL_ERR(DRIVER_NAME"[port_manager] Cannot register vhost-user callbacks\n");
+		return ROFL_FAILURE;
+	}
+
+	if(pthread_create(&vhost_session_thread, NULL, vhost_session, NULL) != 0)
+	{
+		ROFL_ERR(DRIVER_NAME"[port_manager] Cannot launch vhost-user session thread\n");
+		return ROFL_FAILURE;
+	}
+
+	vhost_initialized = true;
+
+	ROFL_INFO(DRIVER_NAME"[port_manager] vhost-user backend initialized; sockets under '%s'\n", GNU_LINUX_DPDK_VHOST_SOCKET_DIR);
+
+	return ROFL_SUCCESS;
+}
+#endif //GNU_LINUX_DPDK_ENABLE_VHOST
 
 /****************************************************************************
 *						Funtions specific for NF ports						*
@@ -165,6 +340,7 @@ static switch_port_t* configure_nf_port_dpdk(const char *nf_name, const char *nf
 	return port;
 }
 
+#ifndef GNU_LINUX_DPDK_ENABLE_VHOST
 //Initializes the pipeline structure and launches the (KNI) NF port 
 static switch_port_t* configure_nf_port_kni(const char *nf_name, const char *nf_port)
 {
@@ -215,7 +391,7 @@ static switch_port_t* configure_nf_port_kni(const char *nf_name, const char *nf_
 	memset(&ops, 0, sizeof(ops));
 	
 	sprintf(conf.name,"%s", nf_port);
-	conf.mbuf_size = IO_MAX_PACKET_SIZE;
+	conf.mbuf_size = MBUF_DATA_SIZE;
 
 	ops.port_id = nf_id;
 	ops.config_network_if = kni_config_network_interface;
@@ -243,6 +419,74 @@ static switch_port_t* configure_nf_port_kni(const char *nf_name, const char *nf_
 
 	return port;
 }
+#else
+//Initializes the pipeline structure and registers the (vhost-user) NF port socket
+static switch_port_t* configure_nf_port_vhost(const char *nf_name, const char *nf_port)
+{
+	switch_port_t* port;
+	
+	//Initialize pipeline port
+	port = switch_port_init((char*)nf_port, false, PORT_TYPE_NF_EXTERNAL, PORT_STATE_LINK_DOWN);
+	if(!port)
+		return NULL; 
+
+	//Generate port state
+	nf_port_state_vhost_t* ps = (nf_port_state_vhost_t*)rte_malloc(NULL,sizeof(nf_port_state_vhost_t),0);
+	
+	if(!ps)
+	{
+		switch_port_destroy(port);
+		return NULL;
+	}
+	memset(ps, 0, sizeof(*ps));
+	
+	//Create rofl-pipeline queue state	
+	if(switch_port_add_queue(port, 0, (char*)&nf_port, IO_IFACE_MAX_PKT_BURST, 0, 0) != ROFL_SUCCESS)
+	{
+		ROFL_ERR(DRIVER_NAME"[port_manager] Cannot configure queues on device (pipeline): %s\n", port->name);
+		assert(0);
+		return NULL;
+	}
+		
+	//Add port_tx_nf_lcore_queue
+	port_tx_nf_lcore_queue[nf_id] = rte_ring_lookup (port->name);
+	if(!port_tx_nf_lcore_queue[nf_id])
+		port_tx_nf_lcore_queue[nf_id] = rte_ring_create(port->name, IO_TX_LCORE_QUEUE_SLOTS , SOCKET_ID_ANY, RING_F_SC_DEQ);
+
+	if(unlikely(port_tx_nf_lcore_queue[nf_id] == NULL ))
+	{
+		ROFL_ERR(DRIVER_NAME"[iface_manager] Cannot create rte_ring for queue on device: %s\n", port->name);
+		assert(0);
+		return NULL;
+	}	
+
+	//Register the socket; the peer (VM or virtio-user) connects to it
+	snprintf(ps->path, sizeof(ps->path), "%s/%s", GNU_LINUX_DPDK_VHOST_SOCKET_DIR, nf_port);
+	unlink(ps->path); //Stale socket of a previous run
+
+	if(rte_vhost_driver_register(ps->path) < 0)
+	{
+		ROFL_ERR(DRIVER_NAME"[port_manager] Cannot register vhost-user socket '%s' for port: %s\n", ps->path, nf_port);
+		rte_free(ps);
+		switch_port_destroy(port);
+		return NULL;
+	}
+
+	ps->dev = NULL;
+	ps->nf_id = nf_id;
+	ps->scheduled = false;
+	port->platform_port_state = (platform_port_state_t*)ps;
+	
+	//Set the port in the nf_port_mapping
+	nf_port_mapping[nf_id] = port;
+	
+	nf_id++;
+	
+	ROFL_INFO(DRIVER_NAME"[port_manager] Created (NF) vhost-user port '%s' (socket: %s)\n", nf_port, ps->path);
+
+	return port;
+}
+#endif //GNU_LINUX_DPDK_ENABLE_VHOST
 
 rofl_result_t iface_manager_create_nf_port(const char *nf_name, const char *nf_port, port_type_t nf_port_type)
 {
@@ -260,11 +504,19 @@ rofl_result_t iface_manager_create_nf_port(const char *nf_name, const char *nf_p
 	}
 	else if(nf_port_type == PORT_TYPE_NF_EXTERNAL)
 	{
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+		if(! ( port = configure_nf_port_vhost(nf_name,nf_port) ) )
+		{
+			ROFL_ERR(DRIVER_NAME"[port_manager] Unable to initialize vhost-user NF port %s\n", nf_port);
+			return ROFL_FAILURE;
+		}
+#else
 		if(! ( port = configure_nf_port_kni(nf_name,nf_port) ) )
 		{
 			ROFL_ERR(DRIVER_NAME"[port_manager] Unable to initialize KNI NF port %s\n", nf_port);
 			return ROFL_FAILURE;
 		}
+#endif
 	}
 	
 	//Add port to the pipeline
@@ -308,12 +560,23 @@ rofl_result_t iface_manager_destroy_nf_port(const char *port_name)
 	}
 	else if(port->type == PORT_TYPE_NF_EXTERNAL)
 	{
-		nf_port_state_kni_t *port_state = (nf_port_state_kni_t*)port->platform_port_state;
+		nf_port_state_external_t *port_state = (nf_port_state_external_t*)port->platform_port_state;
 
 		nf_port_mapping[port_state->nf_id] = NULL;
 		
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+		port_state->dev = NULL;
+		processing_sync_cores();
+
+		//Closes the connection (if any) and removes the socket. The lock is
+		//released, since it may call vhost_destroy_device() from this thread
+		pthread_rwlock_unlock(&iface_manager_rwlock);
+		rte_vhost_driver_unregister(port_state->path);
+		pthread_rwlock_wrlock(&iface_manager_rwlock);
+#else
 		rte_kni_release(port_state->kni);	
 		port_state->kni = NULL;
+#endif
 	
 		if(physical_switch_remove_port(port_name) != ROFL_SUCCESS)
 		{
@@ -335,6 +598,12 @@ rofl_result_t nf_iface_manager_bring_up_port(switch_port_t* port)
 {
 	if(port->type == PORT_TYPE_NF_SHMEM)
 		return ROFL_SUCCESS;
+
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+	//vhost-user: the link state follows the peer connection
+	if(port->type == PORT_TYPE_NF_EXTERNAL)
+		return ROFL_SUCCESS;
+#endif
 		
 	if(port->type == PORT_TYPE_NF_EXTERNAL)
 	{
@@ -385,6 +654,12 @@ rofl_result_t nf_iface_manager_bring_down_port(switch_port_t* port)
 
 	if(port->type == PORT_TYPE_NF_SHMEM)
 		return ROFL_SUCCESS;
+
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+	//vhost-user: the link state follows the peer connection
+	if(port->type == PORT_TYPE_NF_EXTERNAL)
+		return ROFL_SUCCESS;
+#endif
 		
 	if(port->type == PORT_TYPE_NF_EXTERNAL)
 	{
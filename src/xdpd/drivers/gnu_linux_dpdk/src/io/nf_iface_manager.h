@@ -18,6 +18,9 @@
 #include <rte_ring.h>
 #include <rte_launch.h>
 #include <rte_kni.h>
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+#include <rte_virtio_net.h>
+#endif
 #include <rofl/datapath/pipeline/physical_switch.h>
 #include <rofl/datapath/pipeline/common/datapacket.h>
 #include <rofl/datapath/pipeline/openflow/of_switch.h>
@@ -53,6 +56,14 @@ ROFL_BEGIN_DECLS
 */
 void iface_manager_handle_kni_commands(void);
 
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+/**
+* Initialize the vhost-user backend (device callbacks and session thread).
+* Must be called once, before creating any EXTERNAL NF port
+*/
+rofl_result_t nf_iface_manager_vhost_init(void);
+#endif
+
 /**
  * @brief: used to prevent seg fault when a NF DPDK KNI port is descheduled
  */
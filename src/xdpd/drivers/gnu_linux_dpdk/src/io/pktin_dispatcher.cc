@@ -1,131 +1,263 @@
 #include "pktin_dispatcher.h"
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
 #include <rofl/common/utils/c_logger.h>
+#include <rofl/datapath/pipeline/physical_switch.h>
 #include <rofl/datapath/hal/openflow/openflow1x/of1x_cmm.h>
 
 #include "bufferpool.h"
 #include "datapacket_storage.h"
 #include "dpdk_datapacket.h"
 
-sem_t pktin_sem;
-struct rte_ring* pkt_ins;
+int pktin_notify_fd = -1;
+volatile bool pktin_dispatcher_sleeping = false;
 bool keep_on_pktins;
-bool destroying_sw;
+static int pktin_epfd = -1;
 static pthread_t pktin_thread;
 static sem_t pktin_drained;
 static pthread_mutex_t drain_mutex=PTHREAD_MUTEX_INITIALIZER;
 
+//LSIs served (slots set on register, cleared by the dispatcher once drained)
+static of_switch_t* volatile pktin_lsis[PHYSICAL_SWITCH_MAX_LS] = {0};
+
+//LSI to be drained; set by wait_pktin_draining()
+static of_switch_t* volatile draining_sw = NULL;
+
 using namespace xdpd::gnu_linux;
 
-//Process packet_ins
-static void* process_packet_ins(void* param){
+//Send a PKT_IN to the CMM
+static void dispatch_packet_in(datapacket_t* pkt){
 
-	datapacket_t* pkt;
 	datapacket_dpdk_t* pkt_dpdk;
 	hal_result_t rv;
 	storeid id;
 	of1x_switch_t* sw;	
 	datapacket_storage* dps;
 	struct rte_mbuf* mbuf;
-	int drain_credits = -1; 
 	packet_matches_t matches;
 
-	//prepare timeout
-	struct timespec timeout;
+	//Recover platform state
+	pkt_dpdk = (datapacket_dpdk_t*)pkt->platform_state;
+	mbuf = ((datapacket_dpdk_t*)pkt->platform_state)->mbuf;
+	sw = (of1x_switch_t*)pkt->sw;
+	dps = ((switch_platform_state_t*)pkt->sw->platform_state)->storage;
 
-	while(likely(keep_on_pktins)){
+	ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] Processing PKT_IN for packet(%p), mbuf %p, switch %p\n", pkt, mbuf, sw);
 
-		if(destroying_sw == true){
-			if(drain_credits == -1){
-				//Recover the number of credits that need to be decremented.
-				while(sem_getvalue(&pktin_sem, &drain_credits) != 0);	
-			}
-
-			if(drain_credits == 0){
-				//We have all credits drained
-				//Reset the drain_credits flag and destroying_sw
-				drain_credits = -1;
-				destroying_sw = false;		
-	
-				//Wake up the caller of wait_pktin_draining() 
-				sem_post(&pktin_drained);
-			}
-		}
-		
-		//Wait for incomming pkts
-		clock_gettime(CLOCK_REALTIME, &timeout);
-    		timeout.tv_sec += 1; 
-		if( sem_timedwait(&pktin_sem, &timeout)  == ETIMEDOUT )
-			continue;	
-
-		//Dequeue
-		if(rte_ring_sc_dequeue(pkt_ins, (void**)&pkt) != 0)
-			continue;
+	//The CMM copies the frame from a contiguous buffer; linearize multi-segment frames
+	if(unlikely(linearize_datapacket_dpdk(pkt_dpdk) != ROFL_SUCCESS)){
+		ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] PKT_IN for packet(%p) could not be linearized. Dropping..\n",pkt);
 
-		if(drain_credits > 0)
-			drain_credits--;
+		//Return mbuf to the pool
+		rte_pktmbuf_free(mbuf);
 
-		//Recover platform state
-		pkt_dpdk = (datapacket_dpdk_t*)pkt->platform_state;
-		mbuf = ((datapacket_dpdk_t*)pkt->platform_state)->mbuf;
-		sw = (of1x_switch_t*)pkt->sw;
-		dps = (datapacket_storage*)pkt->sw->platform_state;
+		//Return to the bufferpool
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+	mbuf = pkt_dpdk->mbuf;
 
-		ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] Processing PKT_IN for packet(%p), mbuf %p, switch %p\n", pkt, mbuf, sw);
-		//Store packet in the storage system. Packet is NOT returned to the bufferpool
-		id = dps->store_packet(pkt);
+	//Store packet in the storage system. Packet is NOT returned to the bufferpool
+	id = dps->store_packet(pkt);
 
-		if(unlikely(id == datapacket_storage::ERROR)){
-			ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] PKT_IN for packet(%p) could not be stored in the storage. Dropping..\n",pkt);
+	if(unlikely(id == datapacket_storage::ERROR)){
+		ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] PKT_IN for packet(%p) could not be stored in the storage. Dropping..\n",pkt);
 
-			//Return mbuf to the pool
-			rte_pktmbuf_free(mbuf);
+		//Return mbuf to the pool
+		rte_pktmbuf_free(mbuf);
 
-			//Return to the bufferpool
-			bufferpool::release_buffer(pkt);
-			continue;
+		//Return to the bufferpool
+		bufferpool::release_buffer(pkt);
+		return;
+	}
+
+	//Fill matches
+	fill_packet_matches(pkt, &matches);
+
+	//Process packet in
+	rv = hal_cmm_process_of1x_packet_in(sw->dpid, 
+					pkt_dpdk->pktin_table_id, 	
+					pkt_dpdk->pktin_reason, 	
+					pkt_dpdk->clas_state.port_in, 
+					id, 	
+					pkt->__cookie,
+					get_buffer_dpdk(pkt_dpdk), 
+					pkt_dpdk->pktin_send_len, 
+					get_buffer_length_dpdk(pkt_dpdk),
+					&matches
+			);
+
+	if( rv != HAL_SUCCESS ){
+		ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] PKT_IN for packet(%p) could not be sent to sw:%s controller. Dropping..\n",pkt,sw->name);
+		//Take packet out from the storage
+		pkt = dps->get_packet(id);
+
+		//Return mbuf to the pool
+		rte_pktmbuf_free(mbuf);
+
+		//Return to the bufferpool
+		bufferpool::release_buffer(pkt);
+	}
+}
+
+
+//Drop a PKT_IN (dispatcher not running)
+static void drop_packet_in(datapacket_t* pkt){
+	rte_pktmbuf_free(((datapacket_dpdk_t*)pkt->platform_state)->mbuf);
+	bufferpool::release_buffer(pkt);
+}
+
+//Dequeue and dispatch (or drop) up to IO_PKT_IN_BURST PKT_INs of an LSI
+static inline unsigned int process_sw_packet_ins(of_switch_t* sw, bool dispatch){
+
+	unsigned int i, burst_len;
+	datapacket_t* pkts[IO_PKT_IN_BURST];
+	switch_platform_state_t* ls_int = (switch_platform_state_t*)sw->platform_state;
+
+	burst_len = rte_ring_sc_dequeue_burst(ls_int->pkt_in_queue, (void**)pkts, IO_PKT_IN_BURST);
+
+	for(i=0;i<burst_len;++i){
+		if(likely(dispatch))
+			dispatch_packet_in(pkts[i]);
+		else
+			drop_packet_in(pkts[i]);
+	}
+
+	return burst_len;
+}
+
+//Process all the pending PKT_INs of the LSI and stop serving it
+static void drain_sw_packet_ins(of_switch_t* sw, bool dispatch){
+
+	switch_platform_state_t* ls_int = (switch_platform_state_t*)sw->platform_state;
+
+	while(process_sw_packet_ins(sw, dispatch) != 0);
+
+	pktin_lsis[ls_int->pkt_in_slot] = NULL;
+}
+
+//Whether there is work for the dispatcher
+static inline bool pktin_pending(void){
+
+	unsigned int i;
+	of_switch_t* sw;
+
+	if(draining_sw != NULL)
+		return true;
+
+	for(i=0;i<PHYSICAL_SWITCH_MAX_LS;++i){
+		sw = pktin_lsis[i];
+		if(sw && !rte_ring_empty(((switch_platform_state_t*)sw->platform_state)->pkt_in_queue))
+			return true;
+	}
+
+	return false;
+}
+
+//Process packet_ins
+static void* process_packet_ins(void* param){
+
+	int ret;
+	unsigned int i, slot, next = 0, processed;
+	uint64_t c;
+	of_switch_t* sw;
+	struct epoll_event event;
+
+	while(likely(keep_on_pktins)){
+
+		//LSI being destroyed; drain it and wake up the caller of wait_pktin_draining()
+		if(unlikely(draining_sw != NULL)){
+			drain_sw_packet_ins(draining_sw, true);
+			draining_sw = NULL;
+			sem_post(&pktin_drained);
 		}
 
-		//Fill matches
-		fill_packet_matches(pkt, &matches);
-
-		//Process packet in
-		rv = hal_cmm_process_of1x_packet_in(sw->dpid, 
-						pkt_dpdk->pktin_table_id, 	
-						pkt_dpdk->pktin_reason, 	
-						pkt_dpdk->clas_state.port_in, 
-						id, 	
-						pkt->__cookie,
-						get_buffer_dpdk(pkt_dpdk), 
-						pkt_dpdk->pktin_send_len, 
-						get_buffer_length_dpdk(pkt_dpdk),
-						&matches
-				);
-
-		if( rv != HAL_SUCCESS ){
-			ROFL_DEBUG(DRIVER_NAME"[pktin_dispatcher] PKT_IN for packet(%p) could not be sent to sw:%s controller. Dropping..\n",pkt,sw->name);
-			//Take packet out from the storage
-			pkt = dps->get_packet(id);
-
-			//Return mbuf to the pool
-			rte_pktmbuf_free(mbuf);
-
-			//Return to the bufferpool
-			bufferpool::release_buffer(pkt);
+		//Round-robin over the LSIs, a burst per LSI; a busy LSI cannot starve the rest
+		processed = 0;
+		for(i=0;i<PHYSICAL_SWITCH_MAX_LS;++i){
+			slot = (next+i) % PHYSICAL_SWITCH_MAX_LS;
+			sw = pktin_lsis[slot];
+			if(sw)
+				processed += process_sw_packet_ins(sw, true);
 		}
+		next = (next+1) % PHYSICAL_SWITCH_MAX_LS;
+
+		if(processed)
+			continue;
+
+		//Idle; sleep until a producer (or a timeout) wakes us up.
+		//Re-check after publishing the flag, to avoid losing wakeups
+		pktin_dispatcher_sleeping = true;
+		__sync_synchronize();
+
+		if(!pktin_pending())
+			epoll_wait(pktin_epfd, &event, 1, IO_PKT_IN_IDLE_TIMEOUT_MS);
+
+		pktin_dispatcher_sleeping = false;
+
+		//Clear the eventfd (non-blocking)
+		ret = read(pktin_notify_fd, &c, sizeof(c));
+		(void)ret;
 	}
 
 	return NULL;
 }
 
+rofl_result_t pktin_dispatcher_register_sw(of_switch_t* sw){
+
+	unsigned int slot;
+	char name[RTE_RING_NAMESIZE];
+	struct rte_ring* ring;
+	switch_platform_state_t* ls_int = (switch_platform_state_t*)sw->platform_state;
+
+	//Serialize with wait_pktin_draining
+	pthread_mutex_lock(&drain_mutex);
+
+	for(slot=0; slot<PHYSICAL_SWITCH_MAX_LS && pktin_lsis[slot] != NULL; ++slot);
+
+	if(slot == PHYSICAL_SWITCH_MAX_LS){
+		pthread_mutex_unlock(&drain_mutex);
+		ROFL_ERR(DRIVER_NAME"[pktin_dispatcher] No PKT_IN slots available for switch %s\n", sw->name);
+		return ROFL_FAILURE;
+	}
+
+	//rte_rings cannot be destroyed; rings are bound to the slot and reused
+	snprintf(name, RTE_RING_NAMESIZE, "PKT_IN_RING_%u", slot);
+
+	ring = rte_ring_lookup(name);
+	if(!ring)
+		ring = rte_ring_create(name, IO_PKT_IN_LSI_QUEUE_SLOTS, SOCKET_ID_ANY, RING_F_SC_DEQ);
+
+	if(!ring){
+		pthread_mutex_unlock(&drain_mutex);
+		ROFL_ERR(DRIVER_NAME"[pktin_dispatcher] Unable to create PKT_INs ring queue for switch %s\n", sw->name);
+		return ROFL_FAILURE;
+	}
+
+	ls_int->pkt_in_queue = ring;
+	ls_int->pkt_in_slot = slot;
+
+	//Publish
+	__sync_synchronize();
+	pktin_lsis[slot] = sw;
+
+	pthread_mutex_unlock(&drain_mutex);
+
+	return ROFL_SUCCESS;
+}
+
 void wait_pktin_draining(of_switch_t* sw){
 
+	int ret;
+	uint64_t c=1;
+
 	//
 	// Here we have to make sure that we are not returning
 	// until all the PKT_INs belonging to the LSI have been
 	// processed (dropped by the CMM)
 	//
-	// Note that *no more packets* will be enqueued in the global
-	// PKT_IN queue, since ports shall be descheduled already.
+	// Note that *no more packets* will be enqueued in the
+	// PKT_IN queue of the LSI, since ports shall be descheduled already.
 	//
 	// Strategy is just to make sure all current pending PKT_INs
 	// are processed and return
@@ -134,10 +266,20 @@ void wait_pktin_draining(of_switch_t* sw){
 	//Serialize calls to wait_pktin_draining
 	pthread_mutex_lock(&drain_mutex);
 
-	//Signal PKT_IN thread that should unblock us when all current credits
-	//have been drained 
-	destroying_sw = true;
-	sem_wait(&pktin_drained);
+	if(keep_on_pktins){
+		//Signal PKT_IN thread that should unblock us when the LSI
+		//queue has been drained
+		draining_sw = sw;
+		__sync_synchronize();
+
+		ret = write(pktin_notify_fd, &c, sizeof(c));
+		(void)ret;
+
+		sem_wait(&pktin_drained);
+	}else{
+		//Dispatcher already stopped; release the pending ones
+		drain_sw_packet_ins(sw, false);
+	}
 	
 	//Serialize calls to wait_pktin_draining
 	pthread_mutex_unlock(&drain_mutex);
@@ -146,28 +288,36 @@ void wait_pktin_draining(of_switch_t* sw){
 // Launch pkt in thread
 rofl_result_t pktin_dispatcher_init(){
 
+	struct epoll_event event;
+
 	keep_on_pktins = true;
 
-	//Syncrhonization between I/O threads and PKT_IN thread
-	if(sem_init(&pktin_sem, 0,0) < 0){
-		return ROFL_FAILURE;
-	}	
-	
 	//Synchronization between PKT_IN thread and mgmt thread
 	if(sem_init(&pktin_drained, 0,0) < 0){
 		return ROFL_FAILURE;
 	}
 
-	//PKT_IN queue
-	pkt_ins = rte_ring_create("PKT_IN_RING", IO_PKT_IN_STORAGE_MAX_BUF, SOCKET_ID_ANY, 0x0);
-	
-	if(!pkt_ins){
-		ROFL_ERR(DRIVER_NAME"[pktin_dispatcher] Unable to create PKT_INs ring queue\n");
+	//Wake up of the PKT_IN thread (I/O threads and mgmt thread)
+	pktin_notify_fd = eventfd(0, EFD_NONBLOCK);
+	pktin_epfd = epoll_create(1);
+
+	if(pktin_notify_fd < 0 || pktin_epfd < 0){
+		ROFL_ERR(DRIVER_NAME"[pktin_dispatcher] Unable to create PKT_IN eventfd/epoll, errno(%d): %s\n", errno, strerror(errno));
+		return ROFL_FAILURE;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = pktin_notify_fd;
+
+	if(epoll_ctl(pktin_epfd, EPOLL_CTL_ADD, pktin_notify_fd, &event) < 0){
+		ROFL_ERR(DRIVER_NAME"[pktin_dispatcher] epoll_ctl failed, errno(%d): %s\n", errno, strerror(errno));
 		return ROFL_FAILURE;
 	}
 
-	//Reset synchronization flag 
-	destroying_sw = false;	
+	//Reset synchronization flags
+	draining_sw = NULL;
+	pktin_dispatcher_sleeping = false;
 
 	//Launch thread
 	//XXX: use rte?
@@ -181,15 +331,22 @@ rofl_result_t pktin_dispatcher_init(){
 
 //Stop and destroy packet in dispatcher
 rofl_result_t pktin_dispatcher_destroy(){
+
+	int ret;
+	uint64_t c=1;
 	
 	keep_on_pktins = false;
+
+	//Wake up the thread and wait for it to stop
+	ret = write(pktin_notify_fd, &c, sizeof(c));
+	(void)ret;
 	pthread_join(pktin_thread,NULL);
+
+	close(pktin_epfd);
+	close(pktin_notify_fd);
+	pktin_epfd = pktin_notify_fd = -1;
 	
-	//Wait for thread to stop
-	//XXX: use rte?
-	
-	//Destroy ring?
-	//XXX: not available??
+	//Per LSI rings are released (drained) in wait_pktin_draining
 	
 	return ROFL_SUCCESS;
 }
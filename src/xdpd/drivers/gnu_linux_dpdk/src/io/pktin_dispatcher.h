@@ -31,8 +31,10 @@
 #include <rte_spinlock.h>
 #include <rte_ring.h>
 
-extern sem_t pktin_sem;
-extern struct rte_ring* pkt_ins;
+#include "../processing/ls_internal_state.h"
+
+extern int pktin_notify_fd;
+extern volatile bool pktin_dispatcher_sleeping;
 extern bool keep_on_pktins;
 
 //C++ extern C
@@ -48,24 +50,49 @@ rofl_result_t pktin_dispatcher_init(void);
 */
 rofl_result_t pktin_dispatcher_destroy(void);
 
+/**
+* Attach the PKT_IN queue of the LSI (platform state must be allocated)
+* and start dispatching its PKT_INs
+*/
+rofl_result_t pktin_dispatcher_register_sw(of_switch_t* sw);
 
 /**
-* Waits until all PKT_INs for the switch are drained
+* Waits until all PKT_INs for the switch are drained, and stops
+* dispatching PKT_INs for the LSI.
 * Note that *before* this function is called, NO more PKT_INs
 * shall be enqueued for that LSI.
 */
 void wait_pktin_draining(of_switch_t* sw);
 
 /**
-* Enqueue packet in the packet_ins queue
+* Wake up the PKT_IN dispatcher, if it is sleeping
+*/
+inline void notify_pktin_dispatcher(void){
+	int ret;
+	uint64_t c=1;
+
+	//Order the enqueue with respect to the read of the flag
+	__sync_synchronize();
+
+	//Only the first producer after the dispatcher went to sleep writes
+	if( unlikely(pktin_dispatcher_sleeping) && __sync_bool_compare_and_swap(&pktin_dispatcher_sleeping, true, false) ){
+		ret = write(pktin_notify_fd, &c, sizeof(c));
+		(void)ret;
+	}
+}
+
+/**
+* Enqueue packet in the packet_ins queue of the LSI
 */
 inline rofl_result_t enqueue_pktin(datapacket_t* pkt){
 
-	if( unlikely( rte_ring_mp_enqueue(pkt_ins, pkt) != 0 ) ){
+	xdpd::gnu_linux::switch_platform_state_t* ls_int = (xdpd::gnu_linux::switch_platform_state_t*)pkt->sw->platform_state;
+
+	if( unlikely( rte_ring_mp_enqueue(ls_int->pkt_in_queue, pkt) != 0 ) ){
 		return ROFL_FAILURE;
 	}	
 	
-	sem_post(&pktin_sem);
+	notify_pktin_dispatcher();
 	return ROFL_SUCCESS;
 }
 
@@ -110,4 +110,47 @@ struct nf_port_state_kni
 
 typedef struct nf_port_state_kni nf_port_state_kni_t;  
 
+struct virtio_net;
+
+/**
+* @brief Represent the state of a vhost-user NF port
+*/
+struct nf_port_state_vhost
+{
+	/**
+	*	@brief: virtio device; NULL while no peer (virtio)
+	*		is connected to the socket
+	*/
+	struct virtio_net* volatile dev;
+
+	/**
+	*	@brief: unix socket path (sun_path)
+	*/
+	char path[108];
+
+	/**
+	* @brief Core attachement information
+	*/
+	bool scheduled;
+	unsigned int core_id;
+	unsigned int core_port_slot;
+	
+	/**
+	* @brief Identifier of the NF port
+	*/
+	unsigned int nf_id;
+	
+}__rte_cache_aligned;
+
+typedef struct nf_port_state_vhost nf_port_state_vhost_t;
+
+/**
+* State of the EXTERNAL NF ports (KNI or vhost-user)
+*/
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+typedef nf_port_state_vhost_t nf_port_state_external_t;
+#else
+typedef nf_port_state_kni_t nf_port_state_external_t;
+#endif
+
 #endif //_PORT_STATE_H_
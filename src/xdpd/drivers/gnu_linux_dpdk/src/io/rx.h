@@ -33,6 +33,9 @@
 //Now include pp headers
 #include <rofl/datapath/pipeline/openflow/of_switch_pp.h>
 
+//MBUF pools (vhost-user RX)
+extern struct rte_mempool* direct_pools[MAX_CPU_SOCKETS];
+
 namespace xdpd {
 namespace gnu_linux_dpdk {
 
@@ -42,19 +45,14 @@ namespace gnu_linux_dpdk {
 
 
 /*
-* Processes RX in a specific port. The function will process up to MAX_BURST_SIZE 
+* Read a burst from a port
+* @return number of packets read
 */
-inline void
-process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkts_burst, datapacket_t* pkt, datapacket_dpdk_t* pkt_state){
-	
-	unsigned int i, burst_len = 0;
-	of_switch_t* sw = port->attached_sw;
-	struct rte_mbuf* mbuf;
-	datapacket_dpdk_t* pkt_dpdk = pkt_state;
+inline unsigned int
+read_port_rx_burst(switch_port_t* port, struct rte_mbuf** pkts_burst){
+
+	unsigned int burst_len = 0;
 
-	if(unlikely(port->drop_received)) //Ignore if port is marked as "drop received"
-		return;
-		
 	//Read a burst
 #ifdef GNU_LINUX_DPDK_ENABLE_NF	
 	if(port->type == PORT_TYPE_NF_SHMEM) 
@@ -65,6 +63,16 @@ process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkt
 	}
 	else if(port->type == PORT_TYPE_NF_EXTERNAL)
 	{		
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+		//vhost-user NF port - pkts copied from the TX virtqueue of the peer
+		nf_port_state_vhost_t* port_state = (nf_port_state_vhost_t*)port->platform_port_state;
+		struct virtio_net* dev = port_state->dev;
+
+		if(unlikely(dev == NULL)) //No peer connected
+			return 0;
+
+		burst_len = rte_vhost_dequeue_burst(dev, VIRTIO_TXQ, direct_pools[rte_socket_id()], pkts_burst, IO_IFACE_MAX_PKT_BURST);
+#else
 		//KNI NF port - pkts received through a KNI interface
 		nf_port_state_kni *port_state = (nf_port_state_kni_t*)port->platform_port_state;
 		assert(port_state->kni != NULL);
@@ -74,6 +82,7 @@ process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkt
 #if DEBUG
 		if(burst_len != 0)
 		{
+			unsigned int i;
 			ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io] Read burst from %s (%u pkts)\n", port->name, burst_len);
 	
 			for(i=0;i<burst_len;i++)
@@ -85,6 +94,7 @@ process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkt
 			}	
 		}
 #endif
+#endif //GNU_LINUX_DPDK_ENABLE_VHOST
 	}else
 #endif
 	{
@@ -93,69 +103,109 @@ process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkt
 		burst_len = rte_eth_rx_burst(port_id, 0, pkts_burst, IO_IFACE_MAX_PKT_BURST);
 	}
 
-	//ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io] Read burst from %s (%u pkts)\n", port->name, burst_len);
+	return burst_len;
+}
 
-	//Prefetch
-	if( burst_len )
-		rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[0], void *));
+/*
+* Classify and process (pipeline) a packet received in port
+*/
+inline void
+process_pkt_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf* mbuf, datapacket_t* pkt, datapacket_dpdk_t* pkt_state){
 
-	//Process them 
-	for(i=0;i<burst_len;++i){
-		mbuf = pkts_burst[i];		
+	of_switch_t* sw = port->attached_sw;
+	datapacket_dpdk_t* pkt_dpdk = pkt_state;
 
 #ifdef DEBUG	
-		if(unlikely(sw == NULL)){
+	if(unlikely(sw == NULL)){
+		rte_pktmbuf_free(mbuf);
+		return;
+	}
+#endif
+
+	//Multi-segment (jumbo) frames; headers must be within the first segment
+	if(unlikely(MBUF_NB_SEGS(mbuf) > 1) && unlikely(rte_pktmbuf_data_len(mbuf) < IO_MIN_FIRST_SEG_LEN)){
+		struct rte_mbuf* linear = linearize_mbuf_dpdk(mbuf);
+
+		if(unlikely(!linear)){
+			ROFL_DEBUG(DRIVER_NAME"[io][%s] Unable to linearize multi-segment frame (%u bytes); dropping\n", port->name, rte_pktmbuf_pkt_len(mbuf));
 			rte_pktmbuf_free(mbuf);
-			continue;
+			return;
 		}
-#endif
+		mbuf = linear;
+	}
 
-		//set mbuf pointer in the state so that it can be recovered afterwards when going
-		//out from the pipeline
-		pkt_state->mbuf = mbuf;
+	//set mbuf pointer in the state so that it can be recovered afterwards when going
+	//out from the pipeline
+	pkt_state->mbuf = mbuf;
 
-		//Increment port RX statistics
+	//Increment port RX statistics
 #ifdef GNU_LINUX_DPDK_ENABLE_NF
-		if(port->type != PORT_TYPE_PHYSICAL){
-			port->stats.rx_packets++;
-			port->stats.rx_bytes += mbuf->pkt.pkt_len;
-		}
+	if(port->type != PORT_TYPE_PHYSICAL){
+		port->stats.rx_packets++;
+		port->stats.rx_bytes += rte_pktmbuf_pkt_len(mbuf);
+	}
 #endif
 
-		//We only support nb_segs == 1. TODO: can it be that NICs send us pkts with more than one segment?
-		assert(mbuf->pkt.nb_segs == 1);
-
-		//tmp_port is used to avoid to repeat code for both kinds of port
-		//(note that the port_mapping used is different
-		switch_port_t *tmp_port;
+	//tmp_port is used to avoid to repeat code for both kinds of port
+	//(note that the port_mapping used is different
+	switch_port_t *tmp_port;
 #ifdef GNU_LINUX_DPDK_ENABLE_NF	
-		if(port->type == PORT_TYPE_NF_SHMEM) {
-			tmp_port = port;
-		}
-		else if(port->type == PORT_TYPE_NF_EXTERNAL) {
-			tmp_port=port;
-		}else
+	if(port->type == PORT_TYPE_NF_SHMEM) {
+		tmp_port = port;
+	}
+	else if(port->type == PORT_TYPE_NF_EXTERNAL) {
+		tmp_port=port;
+	}else
 #endif
-		{
-			tmp_port = phy_port_mapping[mbuf->pkt.in_port];
-		}
+	{
+		tmp_port = phy_port_mapping[MBUF_IN_PORT(mbuf)];
+	}
 
-		if(unlikely(!tmp_port)){
-			//Not attached
-			rte_pktmbuf_free(mbuf);
-			continue;
-		}
+	if(unlikely(!tmp_port)){
+		//Not attached
+		rte_pktmbuf_free(mbuf);
+		return;
+	}
+
+	//Init&classify	
+	init_datapacket_dpdk(pkt_dpdk, mbuf, sw, tmp_port->of_port_num, 0, true, false);
 
-		//Init&classify	
-		init_datapacket_dpdk(pkt_dpdk, mbuf, sw, tmp_port->of_port_num, 0, true, false);
+	//Send to process
+	of_process_packet_pipeline(core_id, sw, pkt);
+}
+
+/*
+* Processes RX in a specific port. The function will process up to MAX_BURST_SIZE 
+* @return number of packets read
+*/
+inline unsigned int
+process_port_rx(unsigned int core_id, switch_port_t* port, struct rte_mbuf** pkts_burst, datapacket_t* pkt, datapacket_dpdk_t* pkt_state){
 	
+	unsigned int i, burst_len;
+
+	if(unlikely(port->drop_received)) //Ignore if port is marked as "drop received"
+		return 0;
+
+	//Read a burst
+	burst_len = read_port_rx_burst(port, pkts_burst);
+
+	//ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io] Read burst from %s (%u pkts)\n", port->name, burst_len);
+
+	//Prefetch
+	if( burst_len )
+		rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[0], void *));
+
+	//Process them 
+	for(i=0;i<burst_len;++i){
+
 		//Prefetch next pkt
 		if( (i+1) < burst_len )
 			rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[i+1], void *));
 
-		//Send to process
-		of_process_packet_pipeline(core_id, sw, pkt);
+		process_pkt_rx(core_id, port, pkts_burst[i], pkt, pkt_state);
 	}	
+
+	return burst_len;
 }
 
 }// namespace xdpd::gnu_linux_dpdk 
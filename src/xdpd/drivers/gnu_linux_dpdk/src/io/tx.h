@@ -235,7 +235,7 @@ transmit_kni_nf_port_burst(switch_port_t* port, unsigned int port_id, struct rte
 }
 
 inline void
-flush_kni_nf_port_burst(switch_port_t* port, unsigned int port_id, struct mbuf_burst* queue)
+flush_external_nf_port_burst(switch_port_t* port, unsigned int port_id, struct mbuf_burst* queue)
 {
 	unsigned ret;
 
@@ -243,16 +243,16 @@ flush_kni_nf_port_burst(switch_port_t* port, unsigned int port_id, struct mbuf_b
 		return;
 	}
 		
-	assert((nf_port_state_kni_t*)port->platform_port_state != NULL);
+	assert((nf_port_state_external_t*)port->platform_port_state != NULL);
 	
-	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][KNI] Trying to flush burst(enqueue in lcore ring) on KNI port %s\n", port->name, queue->len);
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][NF] Trying to flush burst(enqueue in lcore ring) on EXTERNAL port %s\n", port->name, queue->len);
 	
 	
 	ret = rte_ring_mp_enqueue_burst(port_tx_nf_lcore_queue[port_id], (void **)queue->burst, queue->len);
 						
 	//XXX port_statistics[port].tx += ret;
 	
-	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][KNI] --- Flushed %u pkts, on KNI port %s\n", port_id, ret, port->name);
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][NF] --- Flushed %u pkts, on EXTERNAL port %s\n", port_id, ret, port->name);
 	
 	if (unlikely(ret < queue->len)) 
 	{
@@ -267,7 +267,7 @@ flush_kni_nf_port_burst(switch_port_t* port, unsigned int port_id, struct mbuf_b
 }
 
 inline void 
-tx_pkt_kni_nf_port(switch_port_t* port, datapacket_t* pkt)
+tx_pkt_external_nf_port(switch_port_t* port, datapacket_t* pkt)
 {
 	struct rte_mbuf* mbuf;
 	struct mbuf_burst* pkt_burst;
@@ -275,7 +275,7 @@ tx_pkt_kni_nf_port(switch_port_t* port, datapacket_t* pkt)
 
 	//Get mbuf pointer
 	mbuf = ((datapacket_dpdk_t*)pkt->platform_state)->mbuf;
-	port_id = ((nf_port_state_kni_t*)port->platform_port_state)->nf_id;
+	port_id = ((nf_port_state_external_t*)port->platform_port_state)->nf_id;
 	
 #ifdef DEBUG
 	if(unlikely(!mbuf)){
@@ -283,6 +283,15 @@ tx_pkt_kni_nf_port(switch_port_t* port, datapacket_t* pkt)
 		return;
 	}
 #endif
+
+#ifndef GNU_LINUX_DPDK_ENABLE_VHOST
+	//KNI only handles single segment frames (up to MBUF_DATA_SIZE)
+	if(unlikely(!rte_pktmbuf_is_contiguous(mbuf))){
+		ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][KNI] Dropping multi-segment frame (%u bytes) on KNI port %s\n", rte_pktmbuf_pkt_len(mbuf), port->name);
+		rte_pktmbuf_free(mbuf);
+		return;
+	}
+#endif
 	
 	//Recover core task
 	core_tasks_t* tasks = &processing_core_tasks[rte_lcore_id()];
@@ -310,7 +319,7 @@ tx_pkt_kni_nf_port(switch_port_t* port, datapacket_t* pkt)
 	{ 
 		//If buffer is full or mgmt core
 		pkt_burst->len = len;
-		flush_kni_nf_port_burst(port, port_id, pkt_burst);
+		flush_external_nf_port_burst(port, port_id, pkt_burst);
 		return;
 	}
 
@@ -319,6 +328,42 @@ tx_pkt_kni_nf_port(switch_port_t* port, datapacket_t* pkt)
 	return;
 }
 
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+/*
+*	vhost-user
+*/
+
+inline void
+transmit_vhost_nf_port_burst(switch_port_t* port, unsigned int port_id, struct rte_mbuf** burst)
+{
+	unsigned int i, ret, len, bytes;
+	nf_port_state_vhost_t* port_state = (nf_port_state_vhost_t*)port->platform_port_state;
+	struct virtio_net* dev = port_state->dev;
+
+	//Dequeue a burst from the TX ring
+	len = rte_ring_mc_dequeue_burst(port_tx_nf_lcore_queue[port_id], (void **)burst, IO_IFACE_MAX_PKT_BURST);
+
+	if(len == 0)
+		return;
+
+	//Copy the burst to the RX virtqueue of the peer (if connected)
+	ret = likely(dev != NULL)? rte_vhost_enqueue_burst(dev, VIRTIO_RXQ, burst, len) : 0;
+
+	ROFL_DEBUG_VERBOSE(DRIVER_NAME"[io][vhost] Transmited %u pkts (out of %u), on port %s\n", ret, len, port->name);
+
+	//Frames are copied; release all the mbufs
+	for(i=0, bytes=0; i<len; ++i){
+		if(i < ret)
+			bytes += rte_pktmbuf_pkt_len(burst[i]);
+		rte_pktmbuf_free(burst[i]);
+	}
+
+	port->stats.tx_packets += ret;
+	port->stats.tx_bytes += bytes;
+	port->stats.tx_dropped += len - ret;
+}
+#endif //GNU_LINUX_DPDK_ENABLE_VHOST
+
 #endif //GNU_LINUX_DPDK_ENABLE_NF
 
 /****************************************************************************
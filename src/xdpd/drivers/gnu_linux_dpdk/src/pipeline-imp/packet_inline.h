@@ -142,17 +142,13 @@ STATIC_PACKET_INLINE__ datapacket_t* platform_packet_replicate__(datapacket_t* p
 #ifndef DISABLE_SOFT_CLONE
 	if( hard_clone ){
 #endif
-		mbuf = rte_pktmbuf_alloc(direct_pools[rte_socket_id()]);
+		//Copy segment by segment (multi-segment frames)
+		mbuf = copy_mbuf_dpdk(mbuf_origin, direct_pools[rte_socket_id()]);
 		
 		if(unlikely(mbuf == NULL)){	
-			ROFL_DEBUG("Replicate packet; could not hard clone pkt(%p). rte_pktmbuf_clone failed. errno: %d - %s\n", pkt_replica, rte_errno, rte_strerror(rte_errno));
+			ROFL_DEBUG("Replicate packet; could not hard clone pkt(%p). copy_mbuf_dpdk failed. errno: %d - %s\n", pkt_replica, rte_errno, rte_strerror(rte_errno));
 			goto PKT_REPLICATE_ERROR;
 		}
-		if(unlikely( rte_pktmbuf_append(mbuf, rte_pktmbuf_pkt_len(mbuf_origin)) == NULL)){
-			ROFL_DEBUG("Replicate packet(hard); could not perform rte_pktmbuf_append pkt(%p). rte_pktmbuf_clone failed\n", pkt_replica);
-			goto PKT_REPLICATE_ERROR;
-		}
-		rte_memcpy(rte_pktmbuf_mtod(mbuf, uint8_t*), rte_pktmbuf_mtod(mbuf_origin, uint8_t*),  rte_pktmbuf_pkt_len(mbuf_origin));
 		assert( rte_pktmbuf_pkt_len(mbuf) == rte_pktmbuf_pkt_len(mbuf_origin) );
 
 #ifndef DISABLE_SOFT_CLONE
@@ -252,9 +248,9 @@ static inline void output_single_packet(datapacket_t* pkt, datapacket_dpdk_t* pa
 		}else if(port->type == PORT_TYPE_NF_EXTERNAL)
 		{
 			/*
-			* KNI NF port
+			* EXTERNAL NF port (KNI or vhost-user)
 			*/
-			xdpd::gnu_linux_dpdk::tx_pkt_kni_nf_port(port, pkt);
+			xdpd::gnu_linux_dpdk::tx_pkt_external_nf_port(port, pkt);
 		}
 #endif		
 		else{
@@ -294,6 +290,13 @@ STATIC_PACKET_INLINE__ void platform_packet_output(datapacket_t* pkt, switch_por
 	pack = (datapacket_dpdk_t*) (pkt->platform_state);
 	assert(pack != NULL);
 
+	//L4 checksums span the payload; multi-segment frames are linearized first
+	if(unlikely(l4_checksum_needs_linearization_dpdk(pack)) && unlikely(linearize_datapacket_dpdk(pack) != ROFL_SUCCESS)){
+		ROFL_DEBUG("Could not linearize packet(%p) to recalculate checksums. Dropping...\n", pkt);
+		platform_packet_drop(pkt);
+		return;
+	}
+
 	//Recalculate checksums
 	calculate_checksums_in_software(pkt);
 
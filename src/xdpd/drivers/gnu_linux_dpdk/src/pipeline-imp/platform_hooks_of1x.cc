@@ -44,10 +44,19 @@ rofl_result_t platform_post_init_of1x_switch(of1x_switch_t* sw){
 
 	unsigned int i;
 
-	sw->platform_state = (of_switch_platform_state_t*)new datapacket_storage( IO_PKT_IN_STORAGE_MAX_BUF, IO_PKT_IN_STORAGE_EXPIRATION_S); // todo make this value configurable
+	switch_platform_state_t* ls_int = new switch_platform_state_t;
 
-	if(unlikely(!sw->platform_state))
+	ls_int->storage = new datapacket_storage( IO_PKT_IN_STORAGE_MAX_BUF, IO_PKT_IN_STORAGE_EXPIRATION_S); // todo make this value configurable
+	pktin_policer_init(&ls_int->policer);
+	sw->platform_state = (of_switch_platform_state_t*)ls_int;
+
+	//Attach the PKT_IN queue
+	if(unlikely(pktin_dispatcher_register_sw((of_switch_t*)sw) != ROFL_SUCCESS)){
+		delete ls_int->storage;
+		delete ls_int;
+		sw->platform_state = NULL;
 		return ROFL_FAILURE;
+	}
 
 	//Set number of buffers
 	sw->pipeline.num_of_buffers = IO_PKT_IN_STORAGE_MAX_BUF;
@@ -87,7 +96,10 @@ rofl_result_t platform_pre_destroy_of1x_switch(of1x_switch_t* sw){
 	
 	ROFL_DEBUG(DRIVER_NAME"Remaining PKT_INs for switch 0x%llx(%p) drained!\n", (long long unsigned int)sw->dpid, sw);
 
-	delete (datapacket_storage*)sw->platform_state;
+	switch_platform_state_t* ls_int = (switch_platform_state_t*)sw->platform_state;
+
+	delete ls_int->storage;
+	delete ls_int;
 	return ROFL_SUCCESS;
 }
 
@@ -110,6 +122,17 @@ void platform_of1x_packet_in(const of1x_switch_t* sw, uint8_t table_id, datapack
 
 	dpkt = (datapacket_dpdk_t*)pkt->platform_state;
 
+	//Police before detaching (copying) the packet
+	if(unlikely(pktin_policer_filter(&((switch_platform_state_t*)sw->platform_state)->policer))){
+		ROFL_DEBUG("PKT_IN for packet(%p) exceeds the configured rate. Dropping...\n", pkt);
+
+		//Non-detached packets are still owned by the pipeline
+		if(!dpkt->packet_in_bufferpool)
+			return;
+		detached_pkt = pkt;
+		goto PKT_IN_ERROR;
+	}
+
 	if(!dpkt->packet_in_bufferpool)
 		detached_pkt = platform_packet_detach__(pkt);
 	else
@@ -0,0 +1,40 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef LS_INTERNAL_STATE_H_
+#define LS_INTERNAL_STATE_H_
+
+#include "../config.h"
+#include <rte_config.h>
+#include <rte_ring.h>
+#include "../io/datapacket_storage.h"
+#include "../util/pktin_policer.h"
+
+/**
+* @file ls_internal_state.h
+* @brief Implements the internal (platform state) logical switch
+* state (DPDK version)
+*/
+
+namespace xdpd {
+namespace gnu_linux {
+
+typedef struct switch_platform_state {
+	//PKT_IN queue (MP enqueue from the lcores, SC dequeue from the PKT_IN dispatcher)
+	struct rte_ring* pkt_in_queue;
+
+	//Slot in the PKT_IN dispatcher
+	unsigned int pkt_in_slot;
+
+	//PKT_IN policer (applied by the lcores, before detaching and enqueuing)
+	pktin_policer_t policer;
+
+	//Packet storage pointer
+	datapacket_storage* storage;
+}switch_platform_state_t;
+
+}// namespace xdpd::gnu_linux
+}// namespace xdpd
+
+#endif /* LS_INTERNAL_STATE_H_ */
@@ -4,11 +4,17 @@
 #include <rte_spinlock.h>
 #include <sstream>
 #include <iomanip>
+#include <unistd.h>
+#include <sys/prctl.h>
+#ifdef PROCESSING_IDLE_FREQ_SCALING
+	#include <rte_power.h>
+#endif
 
 #include "assert.h"
 #include "../util/compiler_assert.h"
 #include "../io/rx.h"
 #include "../io/tx.h"
+#include "../io/flow_hash.h"
 
 #include "../io/port_state.h"
 #include "../io/iface_manager.h"
@@ -17,6 +23,12 @@
 //Pool sizes
 extern unsigned int mbuf_pool_size;
 
+//Number of RX cores (pipeline mode)
+extern unsigned int pipeline_rx_cores;
+
+//Max sleep of the idle backoff (0 busy polling)
+extern unsigned int idle_max_sleep_us;
+
 //Wrong CPU socket overhead weight
 #define WRONG_CPU_SOCK_OH 0x80000000;
 #define POOL_MAX_LEN_NAME 32
@@ -31,11 +43,79 @@ static rte_spinlock_t mutex;
 core_tasks_t processing_core_tasks[RTE_MAX_LCORE];
 unsigned int total_num_of_phy_ports = 0;
 unsigned int total_num_of_nf_ports = 0;
-unsigned int running_hash = 0;
+volatile unsigned int running_hash = 0;
+
+//Pipeline mode; 0 workers in run-to-completion mode
+static unsigned int workers[PROCESSING_MAX_WORKERS];
+static unsigned int num_of_workers = 0;
+
+//in_port of the packets of NF ports
+COMPILER_ASSERT(INVALID_processing_max_ports_nf_in_port, (PROCESSING_MAX_PORTS <= PROCESSING_NF_IN_PORT_FLAG) );
 
 
 struct rte_mempool* direct_pools[MAX_CPU_SOCKETS];
 struct rte_mempool* indirect_pools[MAX_CPU_SOCKETS];
+struct rte_mempool* jumbo_pools[MAX_CPU_SOCKETS];
+
+/*
+* Assign the roles of the pipeline mode to the available cores; the first
+* pipeline_rx_cores cores are RX cores, and the rest workers
+*/
+static rofl_result_t processing_init_pipeline(void){
+
+	unsigned int i, num_of_rx_cores = 0;
+	char ring_name[POOL_MAX_LEN_NAME];
+	core_tasks_t* core_task;
+
+	for(i=0; i < RTE_MAX_LCORE; ++i){
+		core_task = &processing_core_tasks[i];
+
+		if(!core_task->available)
+			continue;
+
+		if(num_of_rx_cores < pipeline_rx_cores){
+			core_task->role = PROCESSING_CORE_RX;
+			num_of_rx_cores++;
+			continue;
+		}
+
+		if(num_of_workers == PROCESSING_MAX_WORKERS){
+			ROFL_ERR(DRIVER_NAME"[processing] WARNING: Reached PROCESSING_MAX_WORKERS(%u); core %u will not be used\n", PROCESSING_MAX_WORKERS, i);
+			core_task->available = false;
+			continue;
+		}
+
+		core_task->role = PROCESSING_CORE_WORKER;
+		workers[num_of_workers++] = i;
+	}
+
+	if(num_of_workers == 0){
+		ROFL_ERR(DRIVER_NAME"[processing] WARNING: No cores left for the workers of the pipeline mode (%u RX cores requested). Falling back to run-to-completion mode\n", pipeline_rx_cores);
+		for(i=0; i < RTE_MAX_LCORE; ++i)
+			processing_core_tasks[i].role = PROCESSING_CORE_RTC;
+		return ROFL_SUCCESS;
+	}
+
+	ROFL_INFO(DRIVER_NAME"[processing] Pipeline mode: %u RX cores, %u workers\n", num_of_rx_cores, num_of_workers);
+
+	//Create the rings and launch the workers
+	for(i=0; i < num_of_workers; ++i){
+		core_task = &processing_core_tasks[workers[i]];
+
+		snprintf(ring_name, POOL_MAX_LEN_NAME, "worker_ring_%u", workers[i]);
+		core_task->worker_ring = rte_ring_create(ring_name, PROCESSING_WORKER_RING_SLOTS, rte_lcore_to_socket_id(workers[i]), RING_F_SC_DEQ);
+
+		if(!core_task->worker_ring){
+			ROFL_ERR(DRIVER_NAME"[processing] Unable to create ring %s\n", ring_name);
+			return ROFL_FAILURE;
+		}
+
+		if( rte_eal_remote_launch(processing_worker_process_packets, NULL, workers[i]) < 0)
+			rte_panic("Unable to launch worker core %u!", workers[i]);
+	}
+
+	return ROFL_SUCCESS;
+}
 
 /*
 * Initialize data structures for processing to work
@@ -51,6 +131,7 @@ rofl_result_t processing_init(void){
 	//Cleanup
 	memset(direct_pools, 0, sizeof(direct_pools));
 	memset(indirect_pools, 0, sizeof(indirect_pools));
+	memset(jumbo_pools, 0, sizeof(jumbo_pools));
 	memset(processing_core_tasks,0,sizeof(core_tasks_t)*RTE_MAX_LCORE);
 
 	//Initialize basics
@@ -68,6 +149,13 @@ rofl_result_t processing_init(void){
 			if(i != config->master_lcore){
 				processing_core_tasks[i].available = true;
 				ROFL_DEBUG(DRIVER_NAME"[processing] Marking core %u as available\n",i);
+
+#ifdef PROCESSING_IDLE_FREQ_SCALING
+				if(rte_power_init(i) == 0)
+					processing_core_tasks[i].power_enabled = true;
+				else
+					ROFL_ERR(DRIVER_NAME"[processing] WARNING: Unable to initialize the frequency scaling of core %u; idle frequency scaling disabled for the core\n", i);
+#endif
 			}
 
 			//Recover CPU socket for the lcore
@@ -93,6 +181,24 @@ rofl_result_t processing_init(void){
 				if (direct_pools[sock_id] == NULL)
 					rte_panic("Cannot init direct mbuf pool for CPU socket: %u\n", sock_id);
 
+				/**
+				*  create the jumbo mbuf pool (linearized frames) for that socket id
+				*/
+				snprintf (pool_name, POOL_MAX_LEN_NAME, "pool_jumbo_%u", sock_id);
+				ROFL_INFO(DRIVER_NAME"[processing] Creating %s with #mbufs %u for CPU socket %u\n", pool_name, DEFAULT_NB_JUMBO_MBUF, sock_id);
+
+				jumbo_pools[sock_id] = rte_mempool_create(
+					pool_name,
+					DEFAULT_NB_JUMBO_MBUF,
+					JUMBO_MBUF_SIZE, 32,
+					sizeof(struct rte_pktmbuf_pool_private),
+					rte_pktmbuf_pool_init, NULL,
+					rte_pktmbuf_init, NULL,
+					sock_id, 0);
+
+				if (jumbo_pools[sock_id] == NULL)
+					rte_panic("Cannot init jumbo mbuf pool for CPU socket: %u\n", sock_id);
+
 //Softclonning is disabled
 #if 0
 				snprintf (pool_name, POOL_MAX_LEN_NAME, "pool_indirect_%u", sock_id);
@@ -117,6 +223,10 @@ rofl_result_t processing_init(void){
 		}
 	}
 
+	//Pipeline mode
+	if(pipeline_rx_cores && processing_init_pipeline() != ROFL_SUCCESS)
+		return ROFL_FAILURE;
+
 	//Print the status of the cores
 	processing_dump_core_states();
 
@@ -141,6 +251,13 @@ rofl_result_t processing_destroy(void){
 			//Join core
 			rte_eal_wait_lcore(i);
 		}
+
+#ifdef PROCESSING_IDLE_FREQ_SCALING
+		if(processing_core_tasks[i].power_enabled){
+			rte_power_exit(i);
+			processing_core_tasks[i].power_enabled = false;
+		}
+#endif
 	}
 	return ROFL_SUCCESS;
 }
@@ -155,16 +272,352 @@ static void processing_wait_for_cores_to_sync(){
 			while(processing_core_tasks[i].running_hash != running_hash);
 		}	
 	}
+
+	if(!num_of_workers)
+		return;
+
+	//Pipeline mode: workers might have synced before the RX cores stopped
+	//enqueuing with the previous state. A second round makes sure that they
+	//have processed all those packets (see processing_worker_process_packets())
+	running_hash++;
+
+	for(i=0;i<RTE_MAX_LCORE;++i){
+		if(processing_core_tasks[i].active){
+			while(processing_core_tasks[i].running_hash != running_hash);
+		}	
+	}
 }
 
-int processing_core_process_packets(void* not_used){
+/*
+* Wait for all the active cores to complete their current iteration
+*/
+void processing_sync_cores(void){
+
+	rte_spinlock_lock(&mutex);
+
+	//Increment the hash counter
+	running_hash++;
+
+	//Wait for all the active cores to sync
+	processing_wait_for_cores_to_sync();
+
+	rte_spinlock_unlock(&mutex);
+}
+
+//
+//Idle backoff
+//
+
+/*
+* Reset the idle backoff state; called when a core loop starts
+*/
+static inline void processing_idle_init(core_tasks_t* tasks){
+
+	tasks->idle_polls = 0;
+	tasks->idle_sleep_us = 0;
+
+	//Sleeps of a few us; default timer slack is 50us
+	if(idle_max_sleep_us)
+		prctl(PR_SET_TIMERSLACK, 1000UL);
+}
+
+/*
+* Adaptive idle backoff; called on every iteration of the core loops without
+* packets. Spins, then pauses, and then sleeps (doubling up to
+* idle_max_sleep_us)
+*/
+static inline void processing_idle_backoff(core_tasks_t* tasks, unsigned int core_id){
+
+	if(tasks->idle_polls < PROCESSING_IDLE_POLLS_BEFORE_BACKOFF*2){
+		tasks->idle_polls++;
+
+		//Leave the pipeline to the sibling hyperthread
+		if(tasks->idle_polls > PROCESSING_IDLE_POLLS_BEFORE_BACKOFF)
+			rte_pause();
+		return;
+	}
+
+	if(tasks->idle_sleep_us == 0){
+#ifdef PROCESSING_IDLE_FREQ_SCALING
+		if(tasks->power_enabled)
+			rte_power_freq_min(core_id);
+#endif
+		tasks->idle_sleep_us = 1;
+	}else if(tasks->idle_sleep_us < idle_max_sleep_us){
+		tasks->idle_sleep_us = RTE_MIN(tasks->idle_sleep_us*2, idle_max_sleep_us);
+	}
 
-	unsigned int i, l, core_id;
+	tasks->backoffs++;
+	usleep(tasks->idle_sleep_us);
+}
+
+/*
+* Leave the idle backoff (packets received)
+*/
+static inline void processing_idle_exit(core_tasks_t* tasks, unsigned int core_id){
+
+#ifdef PROCESSING_IDLE_FREQ_SCALING
+	if(tasks->idle_sleep_us && tasks->power_enabled)
+		rte_power_freq_max(core_id);
+#endif
+	tasks->idle_polls = 0;
+	tasks->idle_sleep_us = 0;
+}
+
+/*
+* Flush the TX bursts of the core to the ports, and transmit the ports owned
+*/
+static inline void processing_drain_tx(core_tasks_t* tasks, unsigned int core_id, struct rte_mbuf** pkt_burst){
+
+	unsigned int i, l;
 	int j;
 	bool own_port;
+	port_queues_t* port_queues;	
+
+	//Handle physical ports
+	for(i=0, l=0; l<total_num_of_phy_ports && likely(i<PROCESSING_MAX_PORTS) ; ++i){
+		
+		if(!tasks->phy_ports[i].present)
+			continue;
+			
+		l++;
+	
+		//make code readable
+		port_queues = &tasks->phy_ports[i];
+		
+		//Check whether is our port (we have to also transmit TX queues)				
+		own_port = (port_queues->core_id == core_id);
+				
+		//Flush (enqueue them in the RX/TX port lcore)
+		for( j=(IO_IFACE_NUM_QUEUES-1); j >=0 ; j-- ){
+			flush_port_queue_tx_burst(phy_port_mapping[i], i, &port_queues->tx_queues_burst[j], j);
+			
+			if(own_port)	
+				transmit_port_queue_tx_burst(i, j, pkt_burst);
+		}
+	}
+
+#ifdef GNU_LINUX_DPDK_ENABLE_NF			
+	//handle NF ports
+	for(i=0, l=0; l<total_num_of_nf_ports && likely(i<PROCESSING_MAX_PORTS) ; ++i)
+	{	
+		if(!tasks->nf_ports[i].present)
+			continue;
+			
+		l++;
+		
+		if(nf_port_mapping[i]->type == PORT_TYPE_NF_EXTERNAL)
+		{
+			//make code readable
+			port_queues = &tasks->nf_ports[i];
+		
+			//Check whether is our port (we have to also transmit TX queues)				
+			own_port = (port_queues->core_id == core_id);
+				
+			flush_external_nf_port_burst(nf_port_mapping[i], i, &port_queues->tx_queues_burst[0]);
+		
+			if(own_port){
+#ifdef GNU_LINUX_DPDK_ENABLE_VHOST
+				transmit_vhost_nf_port_burst(nf_port_mapping[i],i, pkt_burst);
+#else
+				transmit_kni_nf_port_burst(nf_port_mapping[i],i, pkt_burst);
+#endif
+			}
+		}
+#ifdef ENABLE_DPDK_SECONDARY_SEMAPHORE
+		else
+		{
+			assert(nf_port_mapping[i]->type == PORT_TYPE_NF_SHMEM);
+			flush_dpdk_nf_port(nf_port_mapping[i]);
+		}				
+#endif
+	}
+#endif
+}
+
+/*
+* Pipeline mode: read a burst from the port, and distribute it to the workers
+* by flow
+* @return number of packets read
+*/
+static inline unsigned int processing_distribute_port_rx(switch_port_t* port, struct rte_mbuf** pkts_burst){
+
+	unsigned int i, w, ret, burst_len;
+	uint8_t nf_in_port = 0;
+	struct rte_mbuf* mbuf;
+	struct mbuf_burst worker_bursts[PROCESSING_MAX_WORKERS];
+
+	if(unlikely(port->drop_received)) //Ignore if port is marked as "drop received"
+		return 0;
+
+	burst_len = read_port_rx_burst(port, pkts_burst);
+	if(burst_len == 0)
+		return 0;
+
+#ifdef GNU_LINUX_DPDK_ENABLE_NF
+	//Packets of NF ports are tagged, so that the workers can recover the port
+	if(port->type == PORT_TYPE_NF_SHMEM)
+		nf_in_port = PROCESSING_NF_IN_PORT_FLAG | ((nf_port_state_dpdk_t*)port->platform_port_state)->nf_id;
+	else if(port->type == PORT_TYPE_NF_EXTERNAL)
+		nf_in_port = PROCESSING_NF_IN_PORT_FLAG | ((nf_port_state_external_t*)port->platform_port_state)->nf_id;
+#endif
+
+	for(w=0; w<num_of_workers; ++w)
+		worker_bursts[w].len = 0;
+
+	rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[0], void *));
+
+	//Same flow, same worker
+	for(i=0;i<burst_len;++i){
+		mbuf = pkts_burst[i];
+
+		if( (i+1) < burst_len )
+			rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[i+1], void *));
+
+		if(nf_in_port)
+			MBUF_IN_PORT(mbuf) = nf_in_port;
+
+		w = ((uint64_t)flow_hash_symmetric(mbuf)*num_of_workers) >> 32;
+		worker_bursts[w].burst[worker_bursts[w].len++] = mbuf;
+	}
+
+	for(w=0; w<num_of_workers; ++w){
+		if(worker_bursts[w].len == 0)
+			continue;
+
+		ret = rte_ring_mp_enqueue_burst(processing_core_tasks[workers[w]].worker_ring, (void **)worker_bursts[w].burst, worker_bursts[w].len);
+
+		//Worker overloaded; drop
+		for(; ret < worker_bursts[w].len; ++ret)
+			rte_pktmbuf_free(worker_bursts[w].burst[ret]);
+	}
+
+	return burst_len;
+}
+
+/*
+* Pipeline mode: process (pipeline) up to max packets distributed to the worker
+* @return number of packets processed
+*/
+static inline unsigned int processing_worker_process_burst(unsigned int core_id, core_tasks_t* tasks, struct rte_mbuf** pkts_burst, unsigned int max, datapacket_t* pkt, datapacket_dpdk_t* pkt_state){
+
+	unsigned int i, burst_len;
+	uint8_t in_port;
+	struct rte_mbuf* mbuf;
+	switch_port_t* port;
+
+	burst_len = rte_ring_sc_dequeue_burst(tasks->worker_ring, (void **)pkts_burst, max);
+
+	if( burst_len )
+		rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[0], void *));
+
+	for(i=0;i<burst_len;++i){
+		mbuf = pkts_burst[i];
+
+		if( (i+1) < burst_len )
+			rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[i+1], void *));
+
+		//Recover the port
+		in_port = MBUF_IN_PORT(mbuf);
+#ifdef GNU_LINUX_DPDK_ENABLE_NF
+		if(in_port & PROCESSING_NF_IN_PORT_FLAG)
+			port = nf_port_mapping[in_port & ~PROCESSING_NF_IN_PORT_FLAG];
+		else
+#endif
+			port = phy_port_mapping[in_port];
+
+		if(unlikely(!port) || unlikely(!port->attached_sw)){
+			//Not attached (anymore)
+			rte_pktmbuf_free(mbuf);
+			continue;
+		}
+
+		process_pkt_rx(core_id, port, mbuf, pkt, pkt_state);
+	}
+
+	return burst_len;
+}
+
+/*
+* Pipeline mode: packet processing routine for worker cores
+*/
+int processing_worker_process_packets(void* not_used){
+
+	unsigned int core_id, hash, burst_len = 0, pending;
+	uint64_t prev_tsc = 0, now_tsc;
+	struct rte_mbuf* pkt_burst[IO_IFACE_MAX_PKT_BURST]={0};
+	struct rte_mbuf* work_burst[IO_IFACE_MAX_PKT_BURST];
+	core_tasks_t* tasks = &processing_core_tasks[rte_lcore_id()];
+
+	//Time to drain in tics	
+	const uint64_t drain_tsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * IO_BURST_TX_DRAIN_US;
+
+	//Own core
+	core_id = rte_lcore_id();  
+
+	//Parsing and pipeline extra state
+	datapacket_t pkt;
+	datapacket_dpdk_t* pkt_state = create_datapacket_dpdk(&pkt);
+
+	//Init values and assign
+	pkt.platform_state = (platform_datapacket_state_t*)pkt_state;
+	pkt_state->mbuf = NULL;
+
+	//Set flag to active
+	tasks->active = true;
+	processing_idle_init(tasks);
+
+	while(likely(tasks->active)){
+
+		//Current running_hash
+		hash = running_hash;
+
+		if(unlikely(tasks->running_hash != hash)){
+			//Process the packets enqueued before the new state, before acknowledging it
+			pending = rte_ring_count(tasks->worker_ring);
+			while(pending){
+				burst_len = processing_worker_process_burst(core_id, tasks, work_burst, RTE_MIN(pending, (unsigned int)IO_IFACE_MAX_PKT_BURST), &pkt, pkt_state);
+				if(burst_len == 0)
+					break;
+				pending -= burst_len;
+			}
+		}
+
+		//Drain TX periodically, when idle and before acknowledging a new running_hash
+		now_tsc = rte_rdtsc();
+		if(burst_len == 0 || unlikely(now_tsc - prev_tsc > drain_tsc) || unlikely(tasks->running_hash != hash)){
+			processing_drain_tx(tasks, core_id, pkt_burst);
+			prev_tsc = now_tsc;
+		}
+
+		//Update running_hash
+		tasks->running_hash = hash;
+
+		//Process the packets distributed by the RX cores
+		burst_len = processing_worker_process_burst(core_id, tasks, work_burst, IO_IFACE_MAX_PKT_BURST, &pkt, pkt_state);
+		if(burst_len){
+			tasks->busy_cycles += rte_rdtsc() - now_tsc;
+			if(unlikely(tasks->idle_polls != 0))
+				processing_idle_exit(tasks, core_id);
+		}else{
+			if(idle_max_sleep_us)
+				processing_idle_backoff(tasks, core_id);
+			tasks->idle_cycles += rte_rdtsc() - now_tsc;
+		}
+	}
+
+	tasks->active = false;
+	destroy_datapacket_dpdk(pkt_state);
+
+	return (int)ROFL_SUCCESS; 
+}
+
+int processing_core_process_packets(void* not_used){
+
+	unsigned int i, core_id, hash, burst_len, iter_pkts;
 	switch_port_t* port;
 	port_queues_t* port_queues;	
-        uint64_t diff_tsc, prev_tsc;
+        uint64_t diff_tsc, prev_tsc, rx_tsc, now_tsc, iter_tsc;
 	struct rte_mbuf* pkt_burst[IO_IFACE_MAX_PKT_BURST]={0};
 	core_tasks_t* tasks = &processing_core_tasks[rte_lcore_id()];
 
@@ -188,82 +641,63 @@ int processing_core_process_packets(void* not_used){
 	//Last drain tsc
 	prev_tsc = 0;
 
+	processing_idle_init(tasks);
+
 	while(likely(tasks->active)){
 
-		//Update running_hash
-		tasks->running_hash = running_hash;
+		//Current running_hash
+		hash = running_hash;
 
 		//Calc diff
 		diff_tsc = prev_tsc - rte_rdtsc();  
 
-		//Drain TX if necessary	
-		if(unlikely(diff_tsc > drain_tsc)){
-		
-			//Handle physical ports
-			for(i=0, l=0; l<total_num_of_phy_ports && likely(i<PROCESSING_MAX_PORTS) ; ++i){
-				
-				if(!tasks->phy_ports[i].present)
-					continue;
-					
-				l++;
-	
-				//make code readable
-				port_queues = &tasks->phy_ports[i];
-				
-				//Check whether is our port (we have to also transmit TX queues)				
-				own_port = (port_queues->core_id == core_id);
-						
-				//Flush (enqueue them in the RX/TX port lcore)
-				for( j=(IO_IFACE_NUM_QUEUES-1); j >=0 ; j-- ){
-					flush_port_queue_tx_burst(phy_port_mapping[i], i, &port_queues->tx_queues_burst[j], j);
-					
-					if(own_port)	
-						transmit_port_queue_tx_burst(i, j, pkt_burst);
-				}
-			}
+		//Drain TX if necessary. Always drain before acknowledging a new
+		//running_hash, so that the packets processed with the previous state
+		//are already in the port rings (port migrations keep packet order)
+		if(unlikely(diff_tsc > drain_tsc) || unlikely(tasks->running_hash != hash))
+			processing_drain_tx(tasks, core_id, pkt_burst);
 
-#ifdef GNU_LINUX_DPDK_ENABLE_NF			
-			//handle NF ports
-			for(i=0, l=0; l<total_num_of_nf_ports && likely(i<PROCESSING_MAX_PORTS) ; ++i)
-			{	
-				if(!tasks->nf_ports[i].present)
-					continue;
-					
-				l++;
-				
-				if(nf_port_mapping[i]->type == PORT_TYPE_NF_EXTERNAL)
-				{
-					//make code readable
-					port_queues = &tasks->nf_ports[i];
-				
-					//Check whether is our port (we have to also transmit TX queues)				
-					own_port = (port_queues->core_id == core_id);
-						
-					flush_kni_nf_port_burst(nf_port_mapping[i], i, &port_queues->tx_queues_burst[0]);
-				
-					if(own_port)		
-						transmit_kni_nf_port_burst(nf_port_mapping[i],i, pkt_burst);
-				}
-#ifdef ENABLE_DPDK_SECONDARY_SEMAPHORE
-				else
-				{
-					assert(nf_port_mapping[i]->type == PORT_TYPE_NF_SHMEM);
-					flush_dpdk_nf_port(nf_port_mapping[i]);
-				}				
-#endif
-			}
-#endif
-		}
+		//Update running_hash
+		tasks->running_hash = hash;
 		
 		//Process RX
+		iter_pkts = 0;
+		iter_tsc = rx_tsc = rte_rdtsc();
 		for(i=0;i<tasks->num_of_rx_ports;++i)
 		{
 			port = tasks->port_list[i];
 			if(likely(port != NULL) && likely(port->up)){ //This CAN happen while deschedulings
-				//Process RX&pipeline 
-				process_port_rx(core_id, port, pkt_burst, &pkt, pkt_state);
+				//Process RX&pipeline (or distribute to the workers)
+				if(tasks->role == PROCESSING_CORE_RX)
+					burst_len = processing_distribute_port_rx(port, pkt_burst);
+				else
+					burst_len = process_port_rx(core_id, port, pkt_burst, &pkt, pkt_state);
+
+				//Account the load (used to rebalance the ports)
+				now_tsc = rte_rdtsc();
+				if(burst_len){
+					iter_pkts += burst_len;
+					tasks->busy_cycles += now_tsc - rx_tsc;
+
+					if(port->type == PORT_TYPE_PHYSICAL){
+						port_queues = &tasks->phy_ports[((dpdk_port_state_t*)port->platform_port_state)->port_id];
+						port_queues->rx_pkts += burst_len;
+						port_queues->rx_cycles += now_tsc - rx_tsc;
+					}
+				}
+				rx_tsc = now_tsc;
 			}
 		}
+
+		//Adaptive idle backoff
+		if(iter_pkts){
+			if(unlikely(tasks->idle_polls != 0))
+				processing_idle_exit(tasks, core_id);
+		}else{
+			if(idle_max_sleep_us)
+				processing_idle_backoff(tasks, core_id);
+			tasks->idle_cycles += rte_rdtsc() - iter_tsc;
+		}
 	}
 	
 	tasks->active = false;
@@ -277,6 +711,47 @@ int processing_core_process_packets(void* not_used){
 //Port scheduling
 //
 
+//Set the back reference to the slot of the port in the port_list of its core
+static inline rofl_result_t processing_set_port_slot(switch_port_t* port, unsigned int slot){
+
+	switch(port->type){
+		case PORT_TYPE_PHYSICAL: 
+			((dpdk_port_state_t*)port->platform_port_state)->core_port_slot = slot;
+			break;
+		case PORT_TYPE_NF_SHMEM:	
+			((nf_port_state_dpdk_t*)port->platform_port_state)->core_port_slot = slot;
+			break;
+		case PORT_TYPE_NF_EXTERNAL:
+			((nf_port_state_external_t*)port->platform_port_state)->core_port_slot = slot;
+			break;
+		default: assert(0); //Can never happen
+			return ROFL_FAILURE;
+	}
+	return ROFL_SUCCESS;
+}
+
+//Remove the port in slot from the port_list of the core. Must be called with
+//the mutex held
+static rofl_result_t processing_remove_port_slot(core_tasks_t* core_task, unsigned int slot){
+
+	unsigned int i;
+
+	//This loop copies from descheduled port, all the rest of the ports
+	//one up, so that list of ports is contiguous (0...N-1)
+	for(i=slot; i<core_task->num_of_rx_ports; i++){
+		core_task->port_list[i] = core_task->port_list[i+1];
+		if(core_task->port_list[i]){
+			if(processing_set_port_slot(core_task->port_list[i], i) != ROFL_SUCCESS)
+				return ROFL_FAILURE;
+		}
+	}
+	
+	//Decrement counter
+	core_task->num_of_rx_ports--;
+
+	return ROFL_SUCCESS;
+}
+
 /*
 * Schedule port. Shedule port to an available core (RR)
 */
@@ -285,6 +760,7 @@ rofl_result_t processing_schedule_port(switch_port_t* port){
 	unsigned int i, *num_of_ports;
 	unsigned int port_id;
 	unsigned int lcore_sel, lcore_sel_load = 0xFFFFFFFF;
+	unsigned int tx_core, tx_core_load = 0xFFFFFFFF;
 	unsigned int socket_id, it_load;
 
 	rte_spinlock_lock(&mutex);
@@ -315,6 +791,7 @@ rofl_result_t processing_schedule_port(switch_port_t* port){
 	//Select core
 	for(i=0, lcore_sel = RTE_MAX_LCORE; i < RTE_MAX_LCORE; ++i){
 		if( processing_core_tasks[i].available &&
+			processing_core_tasks[i].role != PROCESSING_CORE_WORKER &&
 			processing_core_tasks[i].num_of_rx_ports != PROCESSING_MAX_PORTS_PER_CORE){
 
 			it_load = processing_core_tasks[i].num_of_rx_ports;
@@ -362,6 +839,28 @@ rofl_result_t processing_schedule_port(switch_port_t* port){
 
 	ROFL_DEBUG(DRIVER_NAME"[processing] Selected core %u for scheduling port %s(%p)\n", lcore_sel, port->name, port); 
 
+	//Pipeline mode: the TX of the port is owned by the worker with less ports
+	tx_core = lcore_sel;
+	if(num_of_workers){
+		for(i=0; i < num_of_workers; ++i){
+			it_load = processing_core_tasks[workers[i]].num_of_tx_ports;
+
+			if( port->type == PORT_TYPE_PHYSICAL){
+				socket_id = rte_eth_dev_socket_id(((dpdk_port_state_t*)port->platform_port_state)->port_id);
+				if( (socket_id != 0xFFFFFFFF) && (socket_id != rte_lcore_to_socket_id(workers[i])))
+					it_load |= WRONG_CPU_SOCK_OH;
+			}
+
+			if(tx_core_load > it_load){
+				tx_core = workers[i];
+				tx_core_load = it_load;
+			}
+		}
+		processing_core_tasks[tx_core].num_of_tx_ports++;
+
+		ROFL_DEBUG(DRIVER_NAME"[processing] Selected worker core %u for the TX of port %s(%p)\n", tx_core, port->name, port); 
+	}
+
 	num_of_ports = &processing_core_tasks[lcore_sel].num_of_rx_ports;
 
 	//Assign port and exit
@@ -414,7 +913,7 @@ rofl_result_t processing_schedule_port(switch_port_t* port){
 			break;
 		case PORT_TYPE_NF_EXTERNAL:
 		{
-			nf_port_state_kni_t* port_state = (nf_port_state_kni_t*)port->platform_port_state;
+			nf_port_state_external_t* port_state = (nf_port_state_external_t*)port->platform_port_state;
 
 			//Store attachment info (back reference)
 			port_state->core_id = lcore_sel; 
@@ -443,14 +942,14 @@ rofl_result_t processing_schedule_port(switch_port_t* port){
 		switch(port->type){
 			case PORT_TYPE_PHYSICAL: 
 				processing_core_tasks[i].phy_ports[port_id].present = true;
-				processing_core_tasks[i].phy_ports[port_id].core_id = lcore_sel;
+				processing_core_tasks[i].phy_ports[port_id].core_id = tx_core;
 				break;
 				
 #ifdef GNU_LINUX_DPDK_ENABLE_NF			
 			case PORT_TYPE_NF_SHMEM:	
 			case PORT_TYPE_NF_EXTERNAL:
 				processing_core_tasks[i].nf_ports[port_id].present = true;
-				processing_core_tasks[i].nf_ports[port_id].core_id = lcore_sel;
+				processing_core_tasks[i].nf_ports[port_id].core_id = tx_core;
 				break;
 #endif //GNU_LINUX_DPDK_ENABLE_NF			
 		
@@ -517,7 +1016,7 @@ rofl_result_t processing_deschedule_port(switch_port_t* port){
 			break;	
 		case PORT_TYPE_NF_EXTERNAL:
 		{
-			nf_port_state_kni_t* port_state = (nf_port_state_kni_t*)port->platform_port_state;	
+			nf_port_state_external_t* port_state = (nf_port_state_external_t*)port->platform_port_state;	
 		
 			scheduled = &port_state->scheduled;	
 			core_id = &port_state->core_id;	
@@ -538,33 +1037,15 @@ rofl_result_t processing_deschedule_port(switch_port_t* port){
 		return ROFL_FAILURE;
 	}
 	
-	core_tasks_t* core_task = &processing_core_tasks[*core_id];
-
 	rte_spinlock_lock(&mutex);
 
-	//This loop copies from descheduled port, all the rest of the ports
-	//one up, so that list of ports is contiguous (0...N-1)
-	for(i=*core_port_slot; i<core_task->num_of_rx_ports; i++){
-		core_task->port_list[i] = core_task->port_list[i+1];
-		if(core_task->port_list[i]){
-			switch(core_task->port_list[i]->type){
-				case PORT_TYPE_PHYSICAL: 
-					((dpdk_port_state_t*)core_task->port_list[i]->platform_port_state)->core_port_slot = i;
-					break;
-				case PORT_TYPE_NF_SHMEM:	
-					((nf_port_state_dpdk_t*)core_task->port_list[i]->platform_port_state)->core_port_slot = i;
-					break;
-				case PORT_TYPE_NF_EXTERNAL:
-					((nf_port_state_kni_t*)core_task->port_list[i]->platform_port_state)->core_port_slot = i;
-					break;
-				default: assert(0); //Can never happen
-					return ROFL_FAILURE;
-			}
-		}
+	//Ports may be migrated by the rebalancing; recover the core with the mutex held
+	core_tasks_t* core_task = &processing_core_tasks[*core_id];
+
+	if(processing_remove_port_slot(core_task, *core_port_slot) != ROFL_SUCCESS){
+		rte_spinlock_unlock(&mutex);
+		return ROFL_FAILURE;
 	}
-	
-	//Decrement counter
-	core_task->num_of_rx_ports--;
 
 	//There are no more ports, so simply stop core
 	if(core_task->num_of_rx_ports == 0){
@@ -586,11 +1067,17 @@ rofl_result_t processing_deschedule_port(switch_port_t* port){
 		case PORT_TYPE_PHYSICAL: 
 			//Decrement total counter
 			total_num_of_phy_ports--;
+			if(num_of_workers)
+				processing_core_tasks[processing_core_tasks[0].phy_ports[*port_id].core_id].num_of_tx_ports--;
 			break;
 		case PORT_TYPE_NF_SHMEM:	
 		case PORT_TYPE_NF_EXTERNAL:
 			//Decrement total counter
 			total_num_of_nf_ports--;
+#ifdef GNU_LINUX_DPDK_ENABLE_NF			
+			if(num_of_workers)
+				processing_core_tasks[processing_core_tasks[0].nf_ports[*port_id].core_id].num_of_tx_ports--;
+#endif //GNU_LINUX_DPDK_ENABLE_NF			
 			break;
 		
 		default: assert(0); //Can never happen
@@ -636,6 +1123,220 @@ rofl_result_t processing_deschedule_port(switch_port_t* port){
 	return ROFL_SUCCESS;
 }
 
+//
+//Port rebalancing
+//
+
+/*
+* Migrate a (scheduled) physical port to core dst, without reordering its
+* packets. Must be called with the mutex held
+*/
+static rofl_result_t processing_migrate_port(switch_port_t* port, unsigned int dst){
+
+	unsigned int i;
+	dpdk_port_state_t* port_state = (dpdk_port_state_t*)port->platform_port_state;
+	core_tasks_t* src_task = &processing_core_tasks[port_state->core_id];
+	core_tasks_t* dst_task = &processing_core_tasks[dst];
+
+	if(dst_task->num_of_rx_ports == PROCESSING_MAX_PORTS_PER_CORE || dst_task->port_list[dst_task->num_of_rx_ports] != NULL){
+		ROFL_ERR(DRIVER_NAME"[processing] Unable to migrate port %s to core %u; no available port slots\n", port->name, dst);
+		return ROFL_FAILURE;
+	}
+
+	//1st phase: nobody serves the port. Once all the cores have synced, the
+	//source core no longer reads the RX queue nor transmits from the TX rings
+	//of the port, and the packets it had processed are in the TX rings. In
+	//pipeline mode the TX stays with its worker
+	if(processing_remove_port_slot(src_task, port_state->core_port_slot) != ROFL_SUCCESS)
+		return ROFL_FAILURE;
+
+	if(!num_of_workers){
+		for(i=0;i<RTE_MAX_LCORE;++i)
+			processing_core_tasks[i].phy_ports[port_state->port_id].core_id = 0xFFFFFFFF;
+	}
+
+	//Increment the hash counter
+	running_hash++;
+	
+	//Wait for all the active cores to sync
+	processing_wait_for_cores_to_sync();
+
+	//2nd phase: the destination core takes over; the packets pending in the
+	//RX queue and in the TX rings are served in order
+	port_state->core_id = dst;
+	port_state->core_port_slot = dst_task->num_of_rx_ports;
+	dst_task->port_list[dst_task->num_of_rx_ports] = port;
+	dst_task->num_of_rx_ports++;
+
+	if(!num_of_workers){
+		for(i=0;i<RTE_MAX_LCORE;++i)
+			processing_core_tasks[i].phy_ports[port_state->port_id].core_id = dst;
+	}
+
+	//Increment the hash counter
+	running_hash++;
+
+	return ROFL_SUCCESS;
+}
+
+/*
+* Migrate, if worth it, one physical port from the most loaded core
+*/
+void processing_rebalance_ports(void){
+
+	unsigned int i, c, src, dst = RTE_MAX_LCORE, port_id, socket_id;
+	uint64_t now_tsc, period, total, new_max, gain, best_gain = 0;
+	uint64_t core_load[RTE_MAX_LCORE];
+	uint64_t port_load[PROCESSING_MAX_PORTS];
+	core_tasks_t* core_task;
+	switch_port_t *port, *sel_port = NULL;
+	bool first_period;
+
+	//Counters at the end of the previous period
+	static uint64_t last_tsc = 0;
+	static uint64_t last_busy_cycles[RTE_MAX_LCORE];
+	static uint64_t last_port_cycles[PROCESSING_MAX_PORTS];
+
+	rte_spinlock_lock(&mutex);
+
+	now_tsc = rte_rdtsc();
+	period = now_tsc - last_tsc;
+	first_period = (last_tsc == 0);
+	last_tsc = now_tsc;
+
+	//Load of the cores
+	for(c=0, src=RTE_MAX_LCORE; c<RTE_MAX_LCORE; ++c){
+		core_task = &processing_core_tasks[c];
+		core_load[c] = 0;
+
+		if(!core_task->available)
+			continue;
+
+		total = core_task->busy_cycles;
+		core_load[c] = total - last_busy_cycles[c];
+		last_busy_cycles[c] = total;
+		core_task->load = (first_period || !period)? 0 : core_load[c]*100/period;
+
+		//Workers are not serving ports
+		if(core_task->active && core_task->role != PROCESSING_CORE_WORKER && (src == RTE_MAX_LCORE || core_load[c] > core_load[src]))
+			src = c;
+	}
+
+	//Load of the ports (served by any core during the period)
+	for(i=0; i<PROCESSING_MAX_PORTS; ++i){
+		for(c=0, total=0; c<RTE_MAX_LCORE; ++c){
+			if(processing_core_tasks[c].available)
+				total += processing_core_tasks[c].phy_ports[i].rx_cycles;
+		}
+		port_load[i] = total - last_port_cycles[i];
+		last_port_cycles[i] = total;
+	}
+
+	//Only rebalance busy cores, and if the load can be split
+	if(first_period || src == RTE_MAX_LCORE || processing_core_tasks[src].num_of_rx_ports < 2 || core_load[src]*100 < period*PROCESSING_REBALANCE_MIN_LOAD){
+		rte_spinlock_unlock(&mutex);
+		return;
+	}
+
+	//Select the (port, core) that reduces the most the load of the source
+	//core, that is the max load of both after the migration
+	core_task = &processing_core_tasks[src];
+	for(i=0; i<core_task->num_of_rx_ports; ++i){
+		port = core_task->port_list[i];
+
+		if(!port || port->type != PORT_TYPE_PHYSICAL)
+			continue;
+
+		port_id = ((dpdk_port_state_t*)port->platform_port_state)->port_id;
+		if(port_load[port_id] > core_load[src])
+			continue;
+
+		socket_id = rte_eth_dev_socket_id(port_id);
+
+		for(c=0; c<RTE_MAX_LCORE; ++c){
+			if(c == src || !processing_core_tasks[c].available || processing_core_tasks[c].role == PROCESSING_CORE_WORKER || processing_core_tasks[c].num_of_rx_ports == PROCESSING_MAX_PORTS_PER_CORE)
+				continue;
+
+			//Never migrate to a core in another CPU socket
+			if( (socket_id != 0xFFFFFFFF) && (socket_id != rte_lcore_to_socket_id(c)))
+				continue;
+
+			new_max = RTE_MAX(core_load[src] - port_load[port_id], core_load[c] + port_load[port_id]);
+			if(new_max >= core_load[src])
+				continue;
+
+			gain = core_load[src] - new_max;
+			if(gain > best_gain){
+				best_gain = gain;
+				sel_port = port;
+				dst = c;
+			}
+		}
+	}
+
+	if(!sel_port || best_gain*100 < period*PROCESSING_REBALANCE_MIN_GAIN){
+		rte_spinlock_unlock(&mutex);
+		return;
+	}
+
+	ROFL_INFO(DRIVER_NAME"[processing] Rebalancing: migrating port %s from core %u (load %u%%) to core %u (load %u%%)\n", sel_port->name, src, processing_core_tasks[src].load, dst, processing_core_tasks[dst].load);
+
+	if(processing_migrate_port(sel_port, dst) != ROFL_SUCCESS){
+		rte_spinlock_unlock(&mutex);
+		return;
+	}
+
+	rte_spinlock_unlock(&mutex);
+
+	if(!processing_core_tasks[dst].active){
+		if(rte_eal_get_lcore_state(dst) != WAIT){
+			assert(0);
+			rte_panic("Core status corrupted!");
+		}
+		
+		ROFL_DEBUG(DRIVER_NAME"[processing] Launching core %u due to the migration of port %p\n", dst, sel_port);
+
+		if( rte_eal_remote_launch(processing_core_process_packets, NULL, dst) < 0)
+			rte_panic("Unable to launch core %u! Status was NOT wait (race-condition?)", dst);
+	}
+
+	//Print the status of the cores
+	processing_dump_core_states();
+}
+
+/*
+* Update the idle cycles (%) of the cores in the last period
+*/
+void processing_update_core_idle(void){
+
+	unsigned int i;
+	uint64_t now_tsc, period, total;
+	core_tasks_t* core_task;
+
+	//Counters at the end of the previous period
+	static uint64_t last_tsc = 0;
+	static uint64_t last_idle_cycles[RTE_MAX_LCORE];
+
+	now_tsc = rte_rdtsc();
+	period = now_tsc - last_tsc;
+
+	for(i=0; i<RTE_MAX_LCORE; ++i){
+		core_task = &processing_core_tasks[i];
+
+		if(!core_task->available)
+			continue;
+
+		total = core_task->idle_cycles;
+		if(!core_task->active)
+			core_task->idle = 100;
+		else if(last_tsc && period)
+			core_task->idle = RTE_MIN((total - last_idle_cycles[i])*100/period, (uint64_t)100);
+		last_idle_cycles[i] = total;
+	}
+
+	last_tsc = now_tsc;
+}
+
 /*
 * Dump core state
 */
@@ -697,7 +1398,21 @@ void processing_dump_core_states(void){
 				break;
 		}
 
+		switch(core_task->role){
+			case PROCESSING_CORE_RX:
+				ss << ", processing: RX";
+				break;
+			case PROCESSING_CORE_WORKER:
+				ss << ", processing: WORKER ("<<core_task->num_of_tx_ports<<" TX ports)";
+				break;
+			default:
+				ss << ", processing: RTC";
+				break;
+		}
+
 		ss << " Load factor: "<< std::fixed << std::setprecision(3) << (float)core_task->num_of_rx_ports/PROCESSING_MAX_PORTS_PER_CORE;
+		ss << ", measured load: "<< core_task->load << "%";
+		ss << ", idle: "<< core_task->idle << "%";
 		ss << ", serving ports: [";
 		for(j=0;j<core_task->num_of_rx_ports;++j){
 			if(core_task->port_list[j] == NULL){
@@ -22,6 +22,11 @@
 
 #define PROCESSING_MAX_PORTS_PER_CORE 32
 #define PROCESSING_MAX_PORTS 128 
+#define PROCESSING_MAX_WORKERS 16
+
+//Pipeline mode: flag in the in_port (MBUF_IN_PORT()) of the packets received from NF
+//ports (in_port = flag | nf_id), so that the workers can recover the port
+#define PROCESSING_NF_IN_PORT_FLAG 0x80
 
 //Burst definition(queue)
 struct mbuf_burst {
@@ -35,16 +40,52 @@ typedef struct port_queues{
 	bool present; //signals that it is present AND is attached (usable by I/O subsytem)
 	unsigned int core_id; //core id serving RX/TX on this port
 	struct mbuf_burst tx_queues_burst[IO_IFACE_NUM_QUEUES];
+
+	//RX load of the port while served by this core (only written by this core)
+	volatile uint64_t rx_pkts;
+	volatile uint64_t rx_cycles; //cycles spent on RX bursts with packets
 }port_queues_t;
 
+/**
+* Role of a core
+*/
+typedef enum processing_core_role{
+	PROCESSING_CORE_RTC = 0,	//Run-to-completion: RX, pipeline and TX of its ports
+	PROCESSING_CORE_RX,		//Pipeline mode: RX of its ports, distributed to the workers
+	PROCESSING_CORE_WORKER,		//Pipeline mode: pipeline, and TX of the ports assigned
+}processing_core_role_t;
+
 /**
 * Core task list
 */
 typedef struct core_tasks{
 	bool available;
 	bool active;
+	processing_core_role_t role;
 	unsigned int num_of_rx_ports;
 	volatile unsigned int running_hash;
+
+	//Cycles spent on RX bursts with packets, for all ports (only written by the core)
+	volatile uint64_t busy_cycles;
+
+	//Load (% of cycles) measured in the last rebalancing period
+	unsigned int load;
+
+	//Idle backoff state
+	unsigned int idle_polls;
+	unsigned int idle_sleep_us;
+	bool power_enabled;
+
+	//Cycles spent in iterations without packets (including the backoff),
+	//number of sleeps and idle cycles (%) measured in the last period
+	volatile uint64_t idle_cycles;
+	volatile uint64_t backoffs;
+	unsigned int idle;
+
+	//Workers only; packets distributed by the RX cores, and number of ports
+	//transmitted by this core
+	struct rte_ring* worker_ring;
+	unsigned int num_of_tx_ports;
 	
 	switch_port_t* port_list[PROCESSING_MAX_PORTS_PER_CORE]; //active ports MUST be on the very beginning of the array, contiguously.
 	
@@ -77,7 +118,7 @@ extern unsigned int total_num_of_nf_ports;
 /**
 * Running hash
 */
-extern unsigned int running_hash; 
+extern volatile unsigned int running_hash; 
 
 
 //C++ extern C
@@ -115,11 +156,33 @@ rofl_result_t processing_deschedule_port(switch_port_t* port);
 rofl_result_t processing_deschedule_nf_port(switch_port_t* port);
 
 
+/**
+* Migrate, if worth it, one physical port from the most loaded core to a less
+* loaded one, based on the RX load measured since the last call
+*/
+void processing_rebalance_ports(void);
+
+/**
+* Wait for all the active cores to complete their current iteration (e.g. to
+* make sure they are no longer using a resource that is being released)
+*/
+void processing_sync_cores(void);
+
 /**
 * Packet processing routine for cores 
 */
 int processing_core_process_packets(void*);
 
+/**
+* Packet processing routine for worker cores (pipeline mode)
+*/
+int processing_worker_process_packets(void*);
+
+/**
+* Update the idle cycles (%) of the cores, measured since the last call
+*/
+void processing_update_core_idle(void);
+
 /**
 * Dump core state
 */
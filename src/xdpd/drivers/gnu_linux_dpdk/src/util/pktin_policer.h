@@ -0,0 +1 @@
+../../../gnu_linux/src/util/pktin_policer.h
\ No newline at end of file
@@ -0,0 +1,66 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HAL_FLOWS_EXT_H
+#define HAL_FLOWS_EXT_H
+
+#include <stdint.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/hal/driver.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_statistics.h>
+
+/**
+* @file hal_flows_ext.h
+*
+* @brief Optional (xDPD specific) HAL calls to list the flow entries of a
+* logical switch page by page.
+*
+* These calls are not part of the ROFL-HAL; drivers MAY implement them.
+* They are declared weak, so the callers MUST check that the symbol
+* is defined (non NULL) before calling it.
+*/
+
+//Any priority
+#define HAL_FLOW_STATS_PAGE_ANY_PRIORITY -1
+
+/**
+* Page of a flow entry listing
+*/
+typedef struct hal_flow_stats_page{
+	//Only entries with this exact priority (HAL_FLOW_STATS_PAGE_ANY_PRIORITY disables it)
+	int32_t priority;
+
+	//Skip the first offset matching entries and return at most limit (0 unlimited)
+	uint64_t offset;
+	uint64_t limit;
+
+	//Out: number of matching entries (all pages)
+	uint64_t total;
+}hal_flow_stats_page_t;
+
+//C++ extern C
+ROFL_BEGIN_DECLS
+
+/**
+* @brief Recovers the flow stats of a page of the flow entries matching
+* the filter (optional). Same filtering semantics as
+* hal_driver_of1x_get_flow_stats(), but only the entries of the page are
+* copied into the message; the rest are only counted (page->total).
+* @ingroup of1x_driver_async_event_processing
+*
+* @param dpid 		Datapath ID of the switch
+* @param table_id 	Table id to get the flows of (or OF1X_FLOW_TABLE_ALL)
+* @param cookie	Cookie to be applied
+* @param cookie_mask	Mask for the cookie
+* @param out_port 	Out port that entry must include
+* @param out_group 	Out group that entry must include
+* @param matches	Matches (non-strict)
+* @param page		Priority and page to list; total is filled in
+*/
+of1x_stats_flow_msg_t* hal_driver_of1x_get_flow_stats_page(uint64_t dpid, uint8_t table_id, uint64_t cookie, uint64_t cookie_mask, uint32_t out_port, uint32_t out_group, of1x_match_group_t *const matches, hal_flow_stats_page_t* page) __attribute__((weak));
+
+//C++ extern C
+ROFL_END_DECLS
+
+#endif /* HAL_FLOWS_EXT_H_ */
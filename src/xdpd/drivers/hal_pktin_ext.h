@@ -0,0 +1,43 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HAL_PKTIN_EXT_H
+#define HAL_PKTIN_EXT_H
+
+#include <stdint.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/hal/driver.h>
+
+/**
+* @file hal_pktin_ext.h
+*
+* @brief Optional (xDPD specific) HAL calls to police PKT_IN events
+* in the datapath.
+*
+* These calls are not part of the ROFL-HAL; drivers MAY implement them.
+* They are declared weak, so the callers MUST check that the symbol
+* is defined (non NULL) before calling it.
+*/
+
+//Disables the policer
+#define HAL_PKT_IN_POLICER_DISABLED 0
+
+//C++ extern C
+ROFL_BEGIN_DECLS
+
+/**
+* @brief Configure the PKT_IN policer of a logical switch (optional). PKT_INs
+* exceeding max_rate are dropped by the driver before being queued or stored.
+* Policers are disabled when the switch is created.
+* @ingroup hal_driver_management
+*
+* @param dpid Datapath ID of the switch
+* @param max_rate Maximum rate in PKT_IN/s, or HAL_PKT_IN_POLICER_DISABLED
+*/
+hal_result_t hal_driver_reconfigure_pkt_in_policer(uint64_t dpid, const int max_rate) __attribute__((weak));
+
+//C++ extern C
+ROFL_END_DECLS
+
+#endif /* HAL_PKTIN_EXT_H_ */
@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HAL_PKTOUT_EXT_H
+#define HAL_PKTOUT_EXT_H
+
+#include <stdint.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/hal/driver.h>
+
+/**
+* @file hal_pktout_ext.h
+*
+* @brief Optional (xDPD specific) HAL calls for drivers that process
+* PACKET_OUTs asynchronously.
+*
+* These calls are not part of the ROFL-HAL; drivers MAY implement them.
+* They are declared weak, so the callers MUST check that the symbol
+* is defined (non NULL) before calling it.
+*/
+
+//C++ extern C
+ROFL_BEGIN_DECLS
+
+/**
+* @brief Process all the PACKET_OUTs of a logical switch accepted so far
+* (hal_driver_of1x_process_packet_out()) before returning. Must be called
+* before replying to a BARRIER_REQUEST.
+* @ingroup of1x_driver_async_event_processing
+*
+* @param dpid Datapath ID of the switch
+*/
+hal_result_t hal_driver_of1x_flush_packet_outs(uint64_t dpid) __attribute__((weak));
+
+//C++ extern C
+ROFL_END_DECLS
+
+#endif /* HAL_PKTOUT_EXT_H_ */
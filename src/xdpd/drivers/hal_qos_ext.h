@@ -0,0 +1,61 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HAL_QOS_EXT_H
+#define HAL_QOS_EXT_H
+
+#include <stdint.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/hal/driver.h>
+
+/**
+* @file hal_qos_ext.h
+*
+* @brief Optional (xDPD specific) HAL calls to configure the egress
+* scheduling of the port (output) queues.
+*
+* These calls are not part of the ROFL-HAL; drivers MAY implement them.
+* They are declared weak, so the callers MUST check that the symbol
+* is defined (non NULL) before calling it.
+*/
+
+//Rates are expressed, as in the OpenFlow queue properties, in 1/10 of a
+//percent of the port speed. 0 or any value above this one disables the rate
+#define HAL_PORT_QUEUE_MAX_RATE 1000
+
+/**
+* Egress scheduling configuration of a port queue
+*/
+typedef struct hal_port_queue_conf{
+	//Strict priority class; the queues of higher classes are served first
+	uint8_t priority;
+
+	//DRR weight of the queue among the queues of the same class (>0)
+	uint16_t weight;
+
+	//Guaranteed rate (served before any other traffic, regardless of the class)
+	uint16_t min_rate;
+
+	//Maximum rate (shaping)
+	uint16_t max_rate;
+}hal_port_queue_conf_t;
+
+//C++ extern C
+ROFL_BEGIN_DECLS
+
+/**
+* @brief Configure the egress scheduling of a port queue (optional). The
+* min_rate and max_rate are also reported as the OpenFlow queue properties.
+* @ingroup port_management
+*
+* @param name Port system name
+* @param queue_id Queue id
+* @param conf Queue configuration
+*/
+hal_result_t hal_driver_configure_port_queue(const char* name, uint32_t queue_id, const hal_port_queue_conf_t* conf) __attribute__((weak));
+
+//C++ extern C
+ROFL_END_DECLS
+
+#endif /* HAL_QOS_EXT_H_ */
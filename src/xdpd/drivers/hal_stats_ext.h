@@ -0,0 +1,159 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef HAL_STATS_EXT_H
+#define HAL_STATS_EXT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rofl_datapath.h>
+#include <rofl/datapath/hal/driver.h>
+
+/**
+* @file hal_stats_ext.h
+*
+* @brief Optional (xDPD specific) HAL calls to retrieve driver internal
+* statistics.
+*
+* These calls are not part of the ROFL-HAL; drivers MAY implement them.
+* They are declared weak, so the callers MUST check that the symbol
+* is defined (non NULL) before calling it.
+*/
+
+//Max number of stages
+#define HAL_STAGE_LATENCY_MAX_STAGES 16
+
+//Max length of a stage name
+#define HAL_STAGE_LATENCY_NAME_LEN 32
+
+//Number of histogram buckets
+#define HAL_STAGE_LATENCY_BUCKETS 32
+
+/**
+* Latency of a packet processing stage
+*/
+typedef struct hal_stage_latency{
+	//Stage name
+	char name[HAL_STAGE_LATENCY_NAME_LEN];
+
+	//Number of (sampled) packets that went through the stage
+	uint64_t samples;
+
+	//Number of (sampled) packets dropped in the stage
+	uint64_t dropped;
+
+	//Sum and max (ns)
+	uint64_t sum_ns;
+	uint64_t max_ns;
+
+	//Histogram; see hal_stage_latency_snapshot_t
+	uint64_t buckets[HAL_STAGE_LATENCY_BUCKETS];
+}hal_stage_latency_t;
+
+/**
+* Snapshot of the latency histograms of the packet processing stages of the driver.
+* All the counters are cumulative since the driver was initialized.
+*/
+typedef struct hal_stage_latency_snapshot{
+	//1 out of sampling packets is measured (0: disabled)
+	uint32_t sampling;
+
+	//Number of valid stages
+	uint32_t num_of_stages;
+
+	//Upper bound (ns, excluded) of every bucket of the histograms. The lower
+	//bound of the bucket i is the upper bound of bucket i-1 (0 for the first one).
+	//The last bucket is not upper bounded.
+	uint64_t bucket_upper_ns[HAL_STAGE_LATENCY_BUCKETS];
+
+	hal_stage_latency_t stages[HAL_STAGE_LATENCY_MAX_STAGES];
+}hal_stage_latency_snapshot_t;
+
+/**
+* Upper bound (ns) of the bucket that holds the p (0..1) percentile of a stage.
+* Returns the max if the percentile falls in the last (unbounded) bucket and 0
+* if there are no samples.
+*/
+static inline uint64_t hal_stage_latency_percentile(const hal_stage_latency_snapshot_t* snapshot, const hal_stage_latency_t* stage, double p){
+	unsigned int i;
+	uint64_t acc = 0;
+
+	if(stage->samples == 0)
+		return 0;
+
+	for(i=0; i<HAL_STAGE_LATENCY_BUCKETS-1; ++i){
+		acc += stage->buckets[i];
+		if(acc >= p*stage->samples)
+			return (snapshot->bucket_upper_ns[i] < stage->max_ns)? snapshot->bucket_upper_ns[i] : stage->max_ns;
+	}
+	return stage->max_ns;
+}
+
+//Max number of cores
+#define HAL_CORE_IDLE_MAX_CORES 128
+
+/**
+* Idle cycles of a packet processing core
+*/
+typedef struct hal_core_idle{
+	uint32_t core_id;
+	uint32_t socket_id;
+
+	//Core is polling (processing packets)
+	bool active;
+
+	//Idle cycles (%) in the last measurement period; 100 if not active
+	uint32_t idle_pct;
+
+	//Cycles spent in iterations without packets (including the idle
+	//backoff) and with packets
+	uint64_t idle_cycles;
+	uint64_t busy_cycles;
+
+	//Number of times the core backed off (slept) while idle
+	uint64_t backoffs;
+}hal_core_idle_t;
+
+/**
+* Snapshot of the idle cycles of the packet processing cores of the driver.
+* Cycle counters are cumulative since the driver was initialized.
+*/
+typedef struct hal_core_idle_snapshot{
+	//Frequency of the cycle counters (Hz)
+	uint64_t cycles_hz;
+
+	//Measurement period of idle_pct (ms)
+	uint32_t period_ms;
+
+	//Number of valid cores
+	uint32_t num_of_cores;
+
+	hal_core_idle_t cores[HAL_CORE_IDLE_MAX_CORES];
+}hal_core_idle_snapshot_t;
+
+//C++ extern C
+ROFL_BEGIN_DECLS
+
+/**
+* @brief Retrieve the latency histograms of the packet processing stages
+* of the driver (optional)
+* @ingroup hal_driver_management
+*
+* @param snapshot Snapshot to be filled in
+*/
+hal_result_t hal_driver_get_stage_latency(hal_stage_latency_snapshot_t* snapshot) __attribute__((weak));
+
+/**
+* @brief Retrieve the idle cycles of the packet processing cores of the
+* driver (optional)
+* @ingroup hal_driver_management
+*
+* @param snapshot Snapshot to be filled in
+*/
+hal_result_t hal_driver_get_core_idle(hal_core_idle_snapshot_t* snapshot) __attribute__((weak));
+
+//C++ extern C
+ROFL_END_DECLS
+
+#endif /* HAL_STATS_EXT_H_ */
@@ -250,8 +250,11 @@ hal_result_t hal_driver_of1x_process_packet_out(uint64_t dpid, uint32_t buffer_i
 		//Mark as pkt out (ignore counters, slow path)	
 		TM_STAMP_PKT_OUT(pkt);
 
-		//Initialize the packet and copy
-		((datapacketx86*)pkt->platform_state)->init(buffer, buffer_size, lsw, in_port, 0, true);
+		//Initialize the packet and copy (jumbo frames may not find a buffer)
+		if(((datapacketx86*)pkt->platform_state)->init(buffer, buffer_size, lsw, in_port, 0, true) != ROFL_SUCCESS){
+			bufferpool::release_buffer(pkt);
+			return HAL_FAILURE; /* TODO: add specific error */
+		}
 		pkt->sw = lsw;
 	}
 
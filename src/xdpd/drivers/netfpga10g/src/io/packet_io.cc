@@ -30,7 +30,10 @@ void netpfga_io_read_from_port(switch_port_t* port){
 	//ROFL_DEBUG(" read size %d \n",header.len);
 
 	
-	pack->init((uint8_t*)packet, header.len, port->attached_sw, port->of_port_num, 0, true, false);
+	if(pack->init((uint8_t*)packet, header.len, port->attached_sw, port->of_port_num, 0, true, false) != ROFL_SUCCESS){
+		bufferpool::release_buffer(pkt);
+		return;
+	}
 
 	//ROFL_DEBUG(" packet_io.cc buffer %p \n",pack->get_buffer());
 
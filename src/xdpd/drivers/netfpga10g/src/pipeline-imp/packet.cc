@@ -35,14 +35,15 @@
 using namespace xdpd::gnu_linux;
 
 /* Cloning of the packet */
-void clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
+rofl_result_t clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
 
 	//Initialize buffer
 	datapacketx86 *pack_src = (datapacketx86*)src->platform_state;
 	datapacketx86 *pack_dst = (datapacketx86*)dst->platform_state;
 	
-	//Initialize the buffer and copy but do not classify
-	pack_dst->init(pack_src->get_buffer(), pack_src->get_buffer_length(), pack_src->lsw, pack_src->clas_state.port_in, pack_src->clas_state.phy_port_in, false, true);
+	//Initialize the buffer and copy but do not classify (jumbo frames may not find a buffer)
+	if(pack_dst->init(pack_src->get_buffer(), pack_src->get_buffer_length(), pack_src->lsw, pack_src->clas_state.port_in, pack_src->clas_state.phy_port_in, false, true) != ROFL_SUCCESS)
+		return ROFL_FAILURE;
 
 	//Copy output_queue
 	pack_dst->output_queue = pack_src->output_queue;
@@ -52,6 +53,8 @@ void clone_pkt_contents(datapacket_t* src, datapacket_t* dst){
 	pack_dst->clas_state.port_in = pack_src->clas_state.port_in;
 	pack_dst->clas_state.phy_port_in = pack_src->clas_state.phy_port_in;
 	pack_dst->clas_state.calculate_checksums_in_sw = pack_src->clas_state.calculate_checksums_in_sw;
+
+	return ROFL_SUCCESS;
 }
 
 void platform_packet_set_queue(datapacket_t* pkt, uint32_t queue)
@@ -100,7 +103,11 @@ datapacket_t* platform_packet_replicate(datapacket_t* pkt){
 	copy->sw = pkt->sw;
 
 	//Clone contents
-	clone_pkt_contents(pkt,copy);
+	if(clone_pkt_contents(pkt,copy) != ROFL_SUCCESS){
+		bufferpool::release_buffer(copy);
+		return NULL;
+	}
+
 	return copy;	
 }
 
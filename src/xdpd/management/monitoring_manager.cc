@@ -8,3 +8,31 @@ using namespace rofl;
 monitoring_snapshot_state_t* monitoring_manager::get_monitoring_snapshot(uint64_t last_rev){
 	return hal_driver_get_monitoring_snapshot(last_rev);
 }
+
+bool monitoring_manager::get_stage_latency(hal_stage_latency_snapshot_t* snapshot){
+
+	//Optional HAL call
+	if(!hal_driver_get_stage_latency)
+		return false;
+
+	if(hal_driver_get_stage_latency(snapshot) != HAL_SUCCESS){
+		ROFL_ERR("[xdpd][monitoring_manager] Unable to retrieve the stage latency histograms from the driver\n");
+		throw eMonitoringUnknownError();
+	}
+
+	return true;
+}
+
+bool monitoring_manager::get_core_idle(hal_core_idle_snapshot_t* snapshot){
+
+	//Optional HAL call
+	if(!hal_driver_get_core_idle)
+		return false;
+
+	if(hal_driver_get_core_idle(snapshot) != HAL_SUCCESS){
+		ROFL_ERR("[xdpd][monitoring_manager] Unable to retrieve the idle cycles of the cores from the driver\n");
+		throw eMonitoringUnknownError();
+	}
+
+	return true;
+}
@@ -10,6 +10,7 @@
 #include <rofl_datapath.h>
 #include <rofl/common/croflexception.h>
 #include <rofl/datapath/hal/driver.h>
+#include "../drivers/hal_stats_ext.h"
 
 /**
 * @file monitoring_manager.h
@@ -40,6 +41,20 @@ public:
 	*/
 	static monitoring_snapshot_state_t* get_monitoring_snapshot(uint64_t last_rev);
 
+	/**
+	* Retrieve the latency histograms of the packet processing stages of the driver
+	*
+	* @return false if the driver does not support it
+	*/
+	static bool get_stage_latency(hal_stage_latency_snapshot_t* snapshot);
+
+	/**
+	* Retrieve the idle cycles of the packet processing cores of the driver
+	*
+	* @return false if the driver does not support it
+	*/
+	static bool get_core_idle(hal_core_idle_snapshot_t* snapshot);
+
 private:
 	
 };
@@ -21,6 +21,11 @@ using namespace rofl;
 #define VIF_LINK "link"
 #define VIF_LSI "lsi"
 #define VIF_DESCRIPTION "description"
+#define QOS_QUEUE "queue"
+#define QOS_PRIORITY "priority"
+#define QOS_WEIGHT "weight"
+#define QOS_MIN_RATE "min-rate"
+#define QOS_MAX_RATE "max-rate"
 
 
 interfaces_scope::interfaces_scope(scope* parent):scope("interfaces", parent, false){
@@ -32,6 +37,7 @@ interfaces_scope::interfaces_scope(scope* parent):scope("interfaces", parent, fa
 	//Subscopes are logical switch elements so will be captured on pre_validate hook
 	register_priority_subscope(new nf_scope(this), 2, false);	
 	register_subscope(new virtual_ifaces_scope(this));	
+	register_subscope(new qos_ifaces_scope(this));
 	
 
 }
@@ -155,3 +161,80 @@ void virtual_ifaces_scope::post_validate(libconfig::Setting& setting, bool dry_r
 		throw eConfParseError(); 	
 	}
 }
+
+qos_ifaces_scope::qos_ifaces_scope(scope* parent):scope("qos", parent, false){
+	
+}
+
+/*
+* Read an optional integer parameter of a queue and check its range
+*/
+static int get_qos_param(libconfig::Setting& queue, const char* name, int def, int min, int max){
+
+	int value = def;
+
+	if(queue.exists(name) && !queue.lookupValue(name, value)){
+		ROFL_ERR(CONF_PLUGIN_ID "%s: invalid '%s' value; must be an integer.\n", queue.getPath().c_str(), name);
+		throw eConfParseError(); 	
+	}
+
+	if(value < min || value > max){
+		ROFL_ERR(CONF_PLUGIN_ID "%s: invalid '%s' value %d; valid range is [%d, %d].\n", queue.getPath().c_str(), name, value, min, max);
+		throw eConfParseError(); 	
+	}
+
+	return value;
+}
+
+void qos_ifaces_scope::post_validate(libconfig::Setting& setting, bool dry_run){
+
+	hal_port_queue_conf_t conf;
+	unsigned int queue_id;
+
+	//One list of queues per port
+ 	for(int i = 0; i<setting.getLength(); ++i){
+
+		std::string port = setting[i].getName();
+
+		//Check for port existance		
+		if(port_manager::exists(port) == false){
+			ROFL_ERR(CONF_PLUGIN_ID "%s: attempting to configure the queues of an invalid port '%s'. Port does not exist!\n", setting.getPath().c_str(), port.c_str());
+			throw eConfParseError(); 	
+		}
+
+		if(!setting[i].isList()){
+			ROFL_ERR(CONF_PLUGIN_ID "%s: malformed queue list of port '%s'. Must be a list of queues: ( { %s=0; ... }, ... )\n", setting.getPath().c_str(), port.c_str(), QOS_QUEUE);
+			throw eConfParseError(); 	
+		}
+
+		for(int j = 0; j<setting[i].getLength(); ++j){
+			libconfig::Setting& queue = setting[i][j];
+
+			if(!queue.exists(QOS_QUEUE)){
+				ROFL_ERR(CONF_PLUGIN_ID "%s: missing '%s' mandatory parameter.\n", queue.getPath().c_str(), QOS_QUEUE);
+				throw eConfParseError(); 	
+			}
+
+			queue_id = get_qos_param(queue, QOS_QUEUE, 0, 0, 255);
+			conf.priority = get_qos_param(queue, QOS_PRIORITY, 0, 0, 255);
+			conf.weight = get_qos_param(queue, QOS_WEIGHT, 10, 1, 0xFFFF);
+			conf.min_rate = get_qos_param(queue, QOS_MIN_RATE, 0, 0, HAL_PORT_QUEUE_MAX_RATE);
+			conf.max_rate = get_qos_param(queue, QOS_MAX_RATE, 0, 0, HAL_PORT_QUEUE_MAX_RATE);
+
+			if(conf.min_rate && conf.max_rate && conf.min_rate > conf.max_rate){
+				ROFL_ERR(CONF_PLUGIN_ID "%s: '%s' cannot be higher than '%s'.\n", queue.getPath().c_str(), QOS_MIN_RATE, QOS_MAX_RATE);
+				throw eConfParseError(); 	
+			}
+
+			if(dry_run)
+				continue;
+
+			try{
+				port_manager::configure_queue(port, queue_id, conf);
+			}catch(...){
+				ROFL_ERR(CONF_PLUGIN_ID "%s: unable to configure queue %u of port '%s'. Invalid queue or unsupported by the driver.\n", queue.getPath().c_str(), queue_id, port.c_str());
+				throw eConfParseError(); 	
+			}
+		}
+	}
+}
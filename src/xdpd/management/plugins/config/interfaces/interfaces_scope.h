@@ -39,6 +39,16 @@ protected:
 	virtual void post_validate(libconfig::Setting& setting, bool dry_run);
 };
 
+class qos_ifaces_scope:public scope {
+	
+public:
+	qos_ifaces_scope(scope* parent);
+		
+protected:
+	
+	virtual void post_validate(libconfig::Setting& setting, bool dry_run);
+};
+
 }// namespace xdpd 
 
 #endif /* CONFIG_INTERFACES_PLUGIN_H_ */
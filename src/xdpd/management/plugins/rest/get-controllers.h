@@ -20,6 +20,8 @@ namespace get{
 	void system_info(const http::server::request &, http::server::reply &, boost::cmatch&);
 	void list_plugins(const http::server::request &, http::server::reply &, boost::cmatch&);
 	void list_matching_algorithms(const http::server::request &, http::server::reply &, boost::cmatch&);
+	void stage_latency(const http::server::request &, http::server::reply &, boost::cmatch&);
+	void core_idle(const http::server::request &, http::server::reply &, boost::cmatch&);
 
 	/**
 	* LSI
@@ -49,7 +49,9 @@ void index(const http::server::request &req, http::server::reply &rep, boost::cm
 	//GET
 	html << "<li><b><a href=\"/info/system\">/info/system</a></b>: general system information" << std::endl;
 	html << "<li><b><a href=\"/info/plugins\">/info/plugins</a></b>: list of compiled-in plugins" << std::endl;
-	html << "<li><b><a href=\"/info/matching-algorithms\">/info/matching-algorithms</a></b>: list available OF table matching algorithms<br>" << std::endl;
+	html << "<li><b><a href=\"/info/matching-algorithms\">/info/matching-algorithms</a></b>: list available OF table matching algorithms" << std::endl;
+	html << "<li><b><a href=\"/info/latency\">/info/latency</a></b>: (sampled) latency histograms of the driver packet processing stages<br>" << std::endl;
+	html << "<li><b><a href=\"/info/cores\">/info/cores</a></b>: idle cycles (headroom) of the driver packet processing cores<br>" << std::endl;
 	html << "<li><b><a href=\"/info/ports\">/info/ports</a></b>: list of available ports" << std::endl;
 	html << "<li><b>/info/port/&lt;port_name&gt;</b>: show port information<br>" << std::endl;
 	html << "<li><b><a href=\"/info/lsis\">/info/lsis</a></b>: list of logical switch instances(LSIs)" << std::endl;
@@ -72,6 +72,8 @@ static void srvthread (){
 		handler.register_get_path("/info/system", boost::bind(controllers::get::system_info, _1, _2, _3));
 		handler.register_get_path("/info/plugins", boost::bind(controllers::get::list_plugins, _1, _2, _3));
 		handler.register_get_path("/info/matching-algorithms", boost::bind(controllers::get::list_matching_algorithms, _1, _2, _3));
+		handler.register_get_path("/info/latency", boost::bind(controllers::get::stage_latency, _1, _2, _3));
+		handler.register_get_path("/info/cores", boost::bind(controllers::get::core_idle, _1, _2, _3));
 
 		//Ports
 		handler.register_get_path("/info/ports", boost::bind(controllers::get::list_ports, _1, _2, _3));
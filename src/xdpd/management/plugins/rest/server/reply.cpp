@@ -10,6 +10,7 @@
 
 #include "reply.hpp"
 #include <string>
+#include <cstdio>
 #include <boost/lexical_cast.hpp>
 
 namespace http {
@@ -17,37 +18,37 @@ namespace http {
 
     namespace status_strings {
       const std::string ok =
-        "HTTP/1.0 200 OK\r\n";
+        "HTTP/1.1 200 OK\r\n";
       const std::string created =
-        "HTTP/1.0 201 Created\r\n";
+        "HTTP/1.1 201 Created\r\n";
       const std::string accepted =
-        "HTTP/1.0 202 Accepted\r\n";
+        "HTTP/1.1 202 Accepted\r\n";
       const std::string no_content =
-        "HTTP/1.0 204 No Content\r\n";
+        "HTTP/1.1 204 No Content\r\n";
       const std::string multiple_choices =
-        "HTTP/1.0 300 Multiple Choices\r\n";
+        "HTTP/1.1 300 Multiple Choices\r\n";
       const std::string moved_permanently =
-        "HTTP/1.0 301 Moved Permanently\r\n";
+        "HTTP/1.1 301 Moved Permanently\r\n";
       const std::string moved_temporarily =
-        "HTTP/1.0 302 Moved Temporarily\r\n";
+        "HTTP/1.1 302 Moved Temporarily\r\n";
       const std::string not_modified =
-        "HTTP/1.0 304 Not Modified\r\n";
+        "HTTP/1.1 304 Not Modified\r\n";
       const std::string bad_request =
-        "HTTP/1.0 400 Bad Request\r\n";
+        "HTTP/1.1 400 Bad Request\r\n";
       const std::string unauthorized =
-        "HTTP/1.0 401 Unauthorized\r\n";
+        "HTTP/1.1 401 Unauthorized\r\n";
       const std::string forbidden =
-        "HTTP/1.0 403 Forbidden\r\n";
+        "HTTP/1.1 403 Forbidden\r\n";
       const std::string not_found =
-        "HTTP/1.0 404 Not Found\r\n";
+        "HTTP/1.1 404 Not Found\r\n";
       const std::string internal_server_error =
-        "HTTP/1.0 500 Internal Server Error\r\n";
+        "HTTP/1.1 500 Internal Server Error\r\n";
       const std::string not_implemented =
-        "HTTP/1.0 501 Not Implemented\r\n";
+        "HTTP/1.1 501 Not Implemented\r\n";
       const std::string bad_gateway =
-        "HTTP/1.0 502 Bad Gateway\r\n";
+        "HTTP/1.1 502 Bad Gateway\r\n";
       const std::string service_unavailable =
-        "HTTP/1.0 503 Service Unavailable\r\n";
+        "HTTP/1.1 503 Service Unavailable\r\n";
 
       boost::asio::const_buffer to_buffer(reply::status_type status)
       {
@@ -94,9 +95,27 @@ namespace http {
     namespace misc_strings {
       const char name_value_separator[] = { ':', ' ' };
       const char crlf[] = { '\r', '\n' };
+      const char last_chunk[] = { '0', '\r', '\n', '\r', '\n' };
     } // namespace misc_strings
 
+    void reply::reset()
+    {
+      status = ok;
+      headers.clear();
+      content.clear();
+      content_producer.clear();
+      chunk_.clear();
+      last_chunk_ = false;
+    }
+
     std::vector<boost::asio::const_buffer> reply::to_buffers()
+    {
+      std::vector<boost::asio::const_buffer> buffers = header_buffers();
+      buffers.push_back(boost::asio::buffer(content));
+      return buffers;
+    }
+
+    std::vector<boost::asio::const_buffer> reply::header_buffers()
     {
       std::vector<boost::asio::const_buffer> buffers;
       buffers.push_back(status_strings::to_buffer(status));
@@ -109,10 +128,53 @@ namespace http {
         buffers.push_back(boost::asio::buffer(misc_strings::crlf));
       }
       buffers.push_back(boost::asio::buffer(misc_strings::crlf));
-      buffers.push_back(boost::asio::buffer(content));
       return buffers;
     }
 
+    bool reply::next_chunk()
+    {
+      char size[32];
+
+      chunk_.clear();
+      last_chunk_ = !content_producer(chunk_);
+
+      snprintf(size, sizeof(size), "%lx\r\n", (unsigned long)chunk_.size());
+      chunk_size_ = size;
+
+      return !last_chunk_;
+    }
+
+    std::vector<boost::asio::const_buffer> reply::chunk_buffers()
+    {
+      std::vector<boost::asio::const_buffer> buffers;
+
+      // A zero sized chunk would terminate the body
+      if (!chunk_.empty())
+      {
+        buffers.push_back(boost::asio::buffer(chunk_size_));
+        buffers.push_back(boost::asio::buffer(chunk_));
+        buffers.push_back(boost::asio::buffer(misc_strings::crlf));
+      }
+      if (last_chunk_)
+        buffers.push_back(boost::asio::buffer(misc_strings::last_chunk));
+      return buffers;
+    }
+
+    void reply::flatten()
+    {
+      if (!content_producer)
+        return;
+
+      while (content_producer(content))
+        ;
+      content_producer.clear();
+
+      header h;
+      h.name = "Content-Length";
+      h.value = boost::lexical_cast<std::string>(content.size());
+      headers.push_back(h);
+    }
+
     namespace stock_replies {
       const char ok[] = "";
       const char created[] =
@@ -236,6 +298,7 @@ namespace http {
     reply reply::stock_reply(reply::status_type status)
     {
       reply rep;
+      rep.reset();
       rep.status = status;
       rep.content = stock_replies::to_string(status);
       rep.headers.resize(2);
@@ -14,6 +14,7 @@
 #include <string>
 #include <vector>
 #include <boost/asio.hpp>
+#include <boost/function.hpp>
 #include "header.hpp"
 
 namespace http {
@@ -49,13 +50,48 @@ namespace http {
       /// The content to be sent in the reply.
       std::string content;
 
+      /// Optional content producer. If set, content is ignored and the reply
+      /// body is generated incrementally: each invocation appends the next
+      /// piece of the body to the string and returns false once the body is
+      /// complete. The reply is then sent using chunked transfer encoding.
+      boost::function<bool(std::string&)> content_producer;
+
+      /// Reset the reply so that it can be reused for the next request of the
+      /// connection. Already allocated buffers are kept.
+      void reset();
+
       /// Convert the reply into a vector of buffers. The buffers do not own the
       /// underlying memory blocks, therefore the reply object must remain valid and
       /// not be changed until the write operation has completed.
       std::vector<boost::asio::const_buffer> to_buffers();
 
+      /// Convert the status line and the headers only into a vector of buffers.
+      std::vector<boost::asio::const_buffer> header_buffers();
+
+      /// Invoke the content producer to generate the next chunk. Returns false
+      /// if this was the last chunk of the body.
+      bool next_chunk();
+
+      /// Convert the last generated chunk into a vector of buffers, using
+      /// the chunked transfer encoding framing.
+      std::vector<boost::asio::const_buffer> chunk_buffers();
+
+      /// Run the content producer to completion and store the result in
+      /// content, for clients not supporting chunked transfer encoding.
+      void flatten();
+
       /// Get a stock reply.
       static reply stock_reply(status_type status);
+
+    private:
+      /// Last chunk generated by the content producer.
+      std::string chunk_;
+
+      /// Chunk size line of the last generated chunk.
+      std::string chunk_size_;
+
+      /// Whether the last generated chunk is the final one.
+      bool last_chunk_;
     };
 
   } // namespace server
@@ -60,7 +60,8 @@ void rest_handler::operator()(const request& req, reply& rep){
 	std::string request_path;
 	RestFuncT func;
 
-	if (!file_handler::url_decode(req.uri, request_path)){
+	//Query string is not part of the route
+	if (!file_handler::url_decode(req.uri.substr(0, req.uri.find('?')), request_path)){
 		rep = reply::stock_reply(reply::bad_request);
 		return;
 	}
@@ -109,6 +110,42 @@ void rest_handler::operator()(const request& req, reply& rep){
 
 }
 
+bool rest_handler::parse_query(const request& req, std::map<std::string, std::string>& params){
+
+	std::string::size_type pos, end, eq;
+	std::string key, value;
+
+	params.clear();
+
+	pos = req.uri.find('?');
+	if(pos == std::string::npos)
+		return true;
+
+	for(++pos; pos < req.uri.size(); pos = end+1){
+		end = req.uri.find('&', pos);
+		if(end == std::string::npos)
+			end = req.uri.size();
+
+		eq = req.uri.find('=', pos);
+		if(eq == std::string::npos || eq > end)
+			eq = end;
+
+		if(!file_handler::url_decode(req.uri.substr(pos, eq-pos), key))
+			return false;
+		if(eq < end){
+			if(!file_handler::url_decode(req.uri.substr(eq+1, end-eq-1), value))
+				return false;
+		}else{
+			value.clear();
+		}
+
+		if(!key.empty())
+			params[key] = value;
+	}
+
+	return true;
+}
+
 void rest_handler::register_get_path(std::string path, RestFuncT func){
 	get_handlers[path] = func;
 }
@@ -30,6 +30,9 @@ public:
 	void register_put_path(std::string path, RestFuncT f);
 	void register_delete_path(std::string path, RestFuncT f);
 
+	//Decode the query string of the request URI (e.g. ?limit=10&offset=20)
+	static bool parse_query(const request& req, std::map<std::string, std::string>& params);
+
 private:
 	RestFuncT get_handler(std::map<std::string, RestFuncT>& handler_map, std::string& req_path, boost::cmatch& grps);
 
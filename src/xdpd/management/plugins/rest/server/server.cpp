@@ -9,16 +9,23 @@
 //
 
 #include "server.hpp"
+#include <boost/bind.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include "request.hpp"
 #include "reply.hpp"
 
 namespace http {
   namespace server {
 
+    const long server::default_keepalive_timeout_s;
+    const std::size_t server::keepalive_max_requests;
+
     server::server(boost::asio::io_service& io_service,
         const std::string& address, const std::string& port,
-        boost::function<void(const request&, reply&)> request_handler)
-      : request_handler_(request_handler)
+        boost::function<void(const request&, reply&)> request_handler,
+        long keepalive_timeout_s)
+      : request_handler_(request_handler),
+        keepalive_timeout_s_(keepalive_timeout_s)
     {
       tcp::resolver resolver(io_service);
       tcp::resolver::query query(address, port);
@@ -65,48 +72,97 @@ namespace http {
             // The child exits the loop and processes the connection.
           } while (is_parent());
 
-          // Create the objects needed to receive a request on the connection.
+          // Create the objects needed to receive requests on the connection.
+          // They are reused by all the requests of a persistent connection.
           buffer_.reset(new boost::array<char, 8192>);
           request_.reset(new request);
-
-          // Loop until a complete request (or an invalid one) has been received.
-          do
-          {
-            // Receive some more data. When control resumes at the following line,
-            // the ec and length parameters reflect the result of the asynchronous
-            // operation.
-            yield socket_->async_read_some(boost::asio::buffer(*buffer_), *this);
-
-            // Parse the data we just received.
-            boost::tie(valid_request_, boost::tuples::ignore)
-              = request_parser_.parse(*request_,
-                  buffer_->data(), buffer_->data() + length);
-
-            // An indeterminate result means we need more data, so keep looping.
-          } while (boost::indeterminate(valid_request_));
-
-          // Create the reply object that will be sent back to the client.
           reply_.reset(new reply);
+          timer_.reset(new boost::asio::deadline_timer(socket_->get_io_service()));
+          buffer_begin_ = buffer_end_ = 0;
+          served_ = 0;
 
-          if (valid_request_)
-          {
-            // A valid request was received. Call the user-supplied function object
-            // to process the request and compose a reply.
-            request_handler_(*request_, *reply_);
-          }
-          else
+          // Loop over the requests of the connection.
+          do
           {
-            // The request was invalid.
-            *reply_ = reply::stock_reply(reply::bad_request);
-          }
-
-          // Send the reply back to the client.
-          yield boost::asio::async_write(*socket_, reply_->to_buffers(), *this);
+            request_parser_ = request_parser();
+            valid_request_ = boost::indeterminate;
+
+            // Pipelined requests may already be (partially) in the buffer.
+            if (buffer_begin_ < buffer_end_)
+              parse_buffered();
+
+            // Loop until a complete request (or an invalid one) has been received.
+            while (boost::indeterminate(valid_request_))
+            {
+              // Close the connection if the client stays idle for too long.
+              timer_->expires_from_now(
+                  boost::posix_time::seconds(keepalive_timeout_s_));
+              timer_->async_wait(boost::bind(&server::handle_idle_timeout,
+                    socket_, boost::asio::placeholders::error));
+
+              // Receive some more data. When control resumes at the following line,
+              // the ec and length parameters reflect the result of the asynchronous
+              // operation.
+              yield socket_->async_read_some(boost::asio::buffer(*buffer_), *this);
+              timer_->cancel();
+
+              // Parse the data we just received.
+              buffer_begin_ = 0;
+              buffer_end_ = length;
+              parse_buffered();
+
+              // An indeterminate result means we need more data, so keep looping.
+            }
+
+            // Reset the reply object that will be sent back to the client.
+            reply_->reset();
+
+            if (valid_request_)
+            {
+              // A valid request was received. Call the user-supplied function object
+              // to process the request and compose a reply.
+              request_handler_(*request_, *reply_);
+            }
+            else
+            {
+              // The request was invalid.
+              *reply_ = reply::stock_reply(reply::bad_request);
+            }
+
+            ++served_;
+            keep_alive_ = keep_alive();
+            prepare_reply();
+
+            if (!reply_->content_producer)
+            {
+              // Send the reply back to the client.
+              yield boost::asio::async_write(*socket_, reply_->to_buffers(), *this);
+            }
+            else
+            {
+              // Send the headers, followed by the body chunk by chunk.
+              yield boost::asio::async_write(*socket_, reply_->header_buffers(), *this);
+              do
+              {
+                more_chunks_ = reply_->next_chunk();
+                yield boost::asio::async_write(*socket_, reply_->chunk_buffers(), *this);
+              } while (more_chunks_);
+            }
+
+            // Keep on serving requests if the connection is persistent.
+          } while (keep_alive_);
 
           // Initiate graceful connection closure.
           socket_->shutdown(tcp::socket::shutdown_both, ec);
         }
       }
+      else if (timer_)
+      {
+        // A read or write of the connection failed (or the peer closed it). The
+        // idle timer may still be armed; it must not fire on the torn down
+        // connection.
+        close_connection();
+      }
 
       // If an error occurs then the coroutine is not reentered. Consequently, no
       // new asynchronous operations are started. This means that all shared_ptr
@@ -117,5 +173,82 @@ namespace http {
     // Disable the pseudo-keywords reenter, yield and fork.
     #include <boost/asio/unyield.hpp>
 
+    void server::parse_buffered()
+    {
+      char* begin = buffer_->data() + buffer_begin_;
+      char* end = buffer_->data() + buffer_end_;
+
+      boost::tie(valid_request_, begin)
+        = request_parser_.parse(*request_, begin, end);
+
+      buffer_begin_ = begin - buffer_->data();
+    }
+
+    bool server::keep_alive() const
+    {
+      if (!valid_request_ || served_ >= keepalive_max_requests)
+        return false;
+
+      // HTTP/1.1 connections are persistent unless stated otherwise. HTTP/1.0
+      // connections only if the client explicitly asks for it.
+      bool persistent = request_->http_version_major > 1
+        || (request_->http_version_major == 1 && request_->http_version_minor >= 1);
+
+      for (std::size_t i = 0; i < request_->headers.size(); ++i)
+      {
+        if (!boost::algorithm::iequals(request_->headers[i].name, "Connection"))
+          continue;
+        if (boost::algorithm::iequals(request_->headers[i].value, "close"))
+          persistent = false;
+        else if (boost::algorithm::iequals(request_->headers[i].value, "keep-alive"))
+          persistent = true;
+      }
+
+      return persistent;
+    }
+
+    void server::prepare_reply()
+    {
+      header h;
+
+      if (reply_->content_producer)
+      {
+        if (request_->http_version_major == 1 && request_->http_version_minor == 0)
+        {
+          // HTTP/1.0 clients don't understand chunked transfer encoding.
+          reply_->flatten();
+        }
+        else
+        {
+          h.name = "Transfer-Encoding";
+          h.value = "chunked";
+          reply_->headers.push_back(h);
+        }
+      }
+
+      h.name = "Connection";
+      h.value = keep_alive_ ? "keep-alive" : "close";
+      reply_->headers.push_back(h);
+    }
+
+    void server::close_connection()
+    {
+      boost::system::error_code ignored_ec;
+
+      timer_->cancel(ignored_ec);
+      socket_->close(ignored_ec);
+    }
+
+    void server::handle_idle_timeout(boost::shared_ptr<tcp::socket> socket,
+        const boost::system::error_code& ec)
+    {
+      // The timer is cancelled (operation_aborted) when data arrives in time.
+      if (!ec)
+      {
+        boost::system::error_code ignored_ec;
+        socket->close(ignored_ec);
+      }
+    }
+
   } // namespace server
 } // namespace http
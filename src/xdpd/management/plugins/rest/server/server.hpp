@@ -16,6 +16,7 @@
 #include <boost/array.hpp>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/logic/tribool.hpp>
 #include "request_parser.hpp"
 
 namespace http {
@@ -30,9 +31,14 @@ namespace http {
     public:
       /// Construct the server to listen on the specified TCP address and port, and
       /// serve up files from the given directory.
+      /// Idle persistent connections are closed after keepalive_timeout_s seconds.
       explicit server(boost::asio::io_service& io_service,
           const std::string& address, const std::string& port,
-          boost::function<void(const request&, reply&)> request_handler);
+          boost::function<void(const request&, reply&)> request_handler,
+          long keepalive_timeout_s = default_keepalive_timeout_s);
+
+      /// Seconds an idle persistent connection is kept open (default).
+      static const long default_keepalive_timeout_s = 15;
 
       /// Perform work associated with the server.
       void operator()(
@@ -42,6 +48,25 @@ namespace http {
     private:
       typedef boost::asio::ip::tcp tcp;
 
+      /// Maximum number of requests served over a single connection.
+      static const std::size_t keepalive_max_requests = 1000;
+
+      /// Parse the unconsumed data of the buffer.
+      void parse_buffered();
+
+      /// Whether the connection can be kept open after the current request.
+      bool keep_alive() const;
+
+      /// Add the connection management and transfer encoding headers.
+      void prepare_reply();
+
+      /// Cancel the idle timer and close the connection (read/write errors).
+      void close_connection();
+
+      /// Close the connection if the idle timer expired.
+      static void handle_idle_timeout(boost::shared_ptr<tcp::socket> socket,
+          const boost::system::error_code& ec);
+
       /// The user-supplied handler for all incoming requests.
       boost::function<void(const request&, reply&)> request_handler_;
 
@@ -51,9 +76,28 @@ namespace http {
       /// The current connection from a client.
       boost::shared_ptr<tcp::socket> socket_;
 
-      /// Buffer for incoming data.
+      /// Buffer for incoming data. Reused by all the requests of the connection.
       boost::shared_ptr<boost::array<char, 8192> > buffer_;
 
+      /// Unconsumed (pipelined) data in the buffer, [buffer_begin_, buffer_end_).
+      std::size_t buffer_begin_;
+      std::size_t buffer_end_;
+
+      /// Seconds an idle persistent connection is kept open.
+      long keepalive_timeout_s_;
+
+      /// Idle timer of the connection.
+      boost::shared_ptr<boost::asio::deadline_timer> timer_;
+
+      /// Number of requests served in the connection.
+      std::size_t served_;
+
+      /// Whether the connection is kept open after the current reply.
+      bool keep_alive_;
+
+      /// Whether there are more chunks to be sent for the current reply.
+      bool more_chunks_;
+
       /// The incoming request.
       boost::shared_ptr<request> request_;
 
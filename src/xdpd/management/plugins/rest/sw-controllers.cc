@@ -2,10 +2,16 @@
 
 #include <boost/asio.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
 
 
 #include "server/request.hpp"
 #include "server/reply.hpp"
+#include "server/rest_handler.hpp"
 #include "json_spirit/json_spirit.h"
 
 #include "delete-controllers.h"
@@ -141,13 +147,213 @@ void lsi_detail(const http::server::request &req,
 	rep.content = json_spirit::write(lsi, true);
 }
 
+//Max number of flow entries serialized per chunk
+#define FLOWS_PER_CHUNK 32
+
+//Parse an (optional) numeric query parameter; accepts 0x prefixed values
+static bool get_query_param(const std::map<std::string, std::string>& params, const std::string& name, uint64_t& value){
+
+	std::map<std::string, std::string>::const_iterator it = params.find(name);
+	char* end;
+
+	if(it == params.end())
+		return true;
+
+	if(it->second.empty())
+		return false;
+
+	errno = 0;
+	value = strtoull(it->second.c_str(), &end, 0);
+	return errno == 0 && *end == '\0';
+}
+
+//Parse a MAC address (xx:xx:xx:xx:xx:xx[/mask]); mask defaults to all ones
+static bool get_query_mac(const std::string& str, uint64_t& value, uint64_t& mask){
+
+	unsigned int b[12];
+	char trail;
+	int n = sscanf(str.c_str(), "%2x:%2x:%2x:%2x:%2x:%2x/%2x:%2x:%2x:%2x:%2x:%2x%c",
+				&b[0], &b[1], &b[2], &b[3], &b[4], &b[5],
+				&b[6], &b[7], &b[8], &b[9], &b[10], &b[11], &trail);
+
+	if(!(n == 6 && str.size() == 17) && !(n == 12 && str.size() == 35))
+		return false;
+
+	value = mask = 0x0;
+	for(unsigned int i=0; i<6; ++i){
+		value = (value << 8) | b[i];
+		mask = (mask << 8) | ((n == 12)? b[i+6] : 0xFF);
+	}
+	return true;
+}
+
+//Parse an IPv4 address or prefix (a.b.c.d[/len]) in host byte order
+static bool get_query_ipv4(const std::string& str, uint32_t& value, uint32_t& mask){
+
+	std::string::size_type slash = str.find('/');
+	struct in_addr addr;
+	uint64_t len = 32;
+
+	if(inet_pton(AF_INET, str.substr(0, slash).c_str(), &addr) != 1)
+		return false;
+
+	if(slash != std::string::npos){
+		std::map<std::string, std::string> p;
+		p["len"] = str.substr(slash+1);
+		if(!get_query_param(p, "len", len) || len > 32)
+			return false;
+	}
+
+	value = ntohl(addr.s_addr);
+	mask = (len)? 0xFFFFFFFFU << (32-len) : 0x0;
+	return true;
+}
+
+/*
+* Builds the (non-strict) match filter out of the query parameters
+* in_port, eth_type, eth_src, eth_dst, vlan_vid, ip_proto, ipv4_src,
+* ipv4_dst, tcp_src, tcp_dst, udp_src and udp_dst.
+*/
+static bool get_query_matches(const std::map<std::string, std::string>& params, of1x_flow_entry_t* entry){
+
+	std::map<std::string, std::string>::const_iterator it;
+	uint64_t v, mac, mac_mask;
+	uint32_t ip, ip_mask;
+	of1x_match_t* match;
+
+	for(it = params.begin(); it != params.end(); ++it){
+		const std::string& key = it->first;
+		match = NULL;
+
+		if(key == "eth_src" || key == "eth_dst"){
+			if(!get_query_mac(it->second, mac, mac_mask))
+				return false;
+			match = (key == "eth_src")? of1x_init_eth_src_match(mac, mac_mask) : of1x_init_eth_dst_match(mac, mac_mask);
+		}else if(key == "ipv4_src" || key == "ipv4_dst"){
+			if(!get_query_ipv4(it->second, ip, ip_mask))
+				return false;
+			match = (key == "ipv4_src")? of1x_init_ip4_src_match(ip, ip_mask) : of1x_init_ip4_dst_match(ip, ip_mask);
+		}else if(key == "in_port" || key == "eth_type" || key == "vlan_vid" || key == "ip_proto" ||
+				key == "tcp_src" || key == "tcp_dst" || key == "udp_src" || key == "udp_dst"){
+			v = 0;
+			if(!get_query_param(params, key, v))
+				return false;
+
+			if(key == "in_port"){
+				if(v > 0xFFFFFFFFULL)
+					return false;
+				match = of1x_init_port_in_match(v);
+			}else if(key == "eth_type"){
+				if(v > 0xFFFF)
+					return false;
+				match = of1x_init_eth_type_match(v);
+			}else if(key == "vlan_vid"){
+				if(v > 0xFFF)
+					return false;
+				match = of1x_init_vlan_vid_match(v | rofl::openflow12::OFPVID_PRESENT, 0x1FFF, OF1X_MATCH_VLAN_SPECIFIC);
+			}else if(key == "ip_proto"){
+				if(v > 0xFF)
+					return false;
+				match = of1x_init_ip_proto_match(v);
+			}else{
+				if(v > 0xFFFF)
+					return false;
+				if(key == "tcp_src")
+					match = of1x_init_tcp_src_match(v);
+				else if(key == "tcp_dst")
+					match = of1x_init_tcp_dst_match(v);
+				else if(key == "udp_src")
+					match = of1x_init_udp_src_match(v);
+				else
+					match = of1x_init_udp_dst_match(v);
+			}
+		}
+
+		if(match)
+			of1x_add_match_to_entry(entry, match);
+	}
+
+	return true;
+}
+
+/*
+* Incrementally serializes a page of flow entries (content producer). The
+* state is shared, since the functor is copied around by boost::function.
+*/
+class flow_page_writer{
+
+public:
+	flow_page_writer(unsigned int table_id, uint64_t offset, uint64_t total, uint64_t next_offset, boost::shared_ptr<std::list<flow_entry_snapshot> > flows) : state(new page_state){
+		state->table_id = table_id;
+		state->offset = offset;
+		state->total = total;
+		state->next_offset = next_offset;
+		state->flows = flows;
+		state->it = flows->begin();
+		state->started = false;
+	}
+
+	bool operator()(std::string& chunk){
+		std::stringstream ss;
+		unsigned int i;
+		page_state* s = state.get();
+
+		if(!s->started){
+			ss << "{\n    \"table\" : {\n        \"id\" : " << s->table_id;
+			ss << ",\n        \"offset\" : " << s->offset;
+			ss << ",\n        \"total\" : " << s->total;
+			ss << ",\n        \"flows\" : [";
+			s->started = true;
+		}
+
+		for(i=0; i<FLOWS_PER_CHUNK && s->it != s->flows->end(); ++i, ++s->it){
+			std::stringstream flow;
+			flow << *s->it;
+
+			if(s->it != s->flows->begin())
+				ss << ",";
+			ss << "\n            " << json_spirit::write(json_spirit::Value(flow.str()));
+		}
+
+		if(s->it != s->flows->end()){
+			chunk += ss.str();
+			return true;
+		}
+
+		ss << "\n        ]";
+		if(s->next_offset)
+			ss << ",\n        \"next-offset\" : " << s->next_offset;
+		ss << "\n    }\n}";
+		chunk += ss.str();
+
+		//Release the entries as soon as possible
+		s->flows->clear();
+		return false;
+	}
+
+private:
+	struct page_state{
+		unsigned int table_id;
+		uint64_t offset;
+		uint64_t total;
+		uint64_t next_offset;
+		bool started;
+		boost::shared_ptr<std::list<flow_entry_snapshot> > flows;
+		std::list<flow_entry_snapshot>::const_iterator it;
+	};
+
+	boost::shared_ptr<page_state> state;
+};
+
 void lsi_table_flows(const http::server::request &req,
 						http::server::reply &rep,
 						boost::cmatch& grps){
-	json_spirit::Object wrap;
-	json_spirit::Object table;
 	std::string lsi_name = std::string(grps[1]);
 	std::string tid = std::string(grps[2]);
+	std::map<std::string, std::string> params;
+	uint64_t limit = 0, offset = 0, cookie = 0x0, cookie_mask = 0x0;
+	uint64_t out_port = OF1X_PORT_ANY, priority = 0;
+	flow_entry_filter filter;
 
 	//Check if it exists;
 	if(!switch_manager::exists_by_name(lsi_name)){
@@ -159,6 +365,28 @@ void lsi_table_flows(const http::server::request &req,
 		return;
 	}
 
+	//Parse filters and pagination (?limit=&offset=&cookie=&cookie_mask=&out_port=&priority=&<match fields>)
+	of1x_flow_entry_t* match_entry = of1x_init_flow_entry(false);
+	if(!match_entry){
+		rep.status = http::server::reply::internal_server_error;
+		return;
+	}
+
+	if(!http::server::rest_handler::parse_query(req, params) ||
+		!get_query_param(params, "limit", limit) ||
+		!get_query_param(params, "offset", offset) ||
+		!get_query_param(params, "cookie", cookie) ||
+		!get_query_param(params, "cookie_mask", cookie_mask) ||
+		!get_query_param(params, "out_port", out_port) ||
+		!get_query_param(params, "priority", priority) ||
+		out_port > 0xFFFFFFFFULL || priority > 0xFFFF ||
+		!get_query_matches(params, match_entry)){
+		of1x_destroy_flow_entry(match_entry);
+		rep.content = "Invalid query parameters. Valid ones: limit, offset, cookie, cookie_mask, out_port, priority, in_port, eth_type, eth_src, eth_dst, vlan_vid, ip_proto, ipv4_src, ipv4_dst, tcp_src, tcp_dst, udp_src and udp_dst";
+		rep.status = http::server::reply::bad_request;
+		return;
+	}
+
 	//Check if table exists
 	std::istringstream reader(tid);
 	unsigned int id;
@@ -170,6 +398,7 @@ void lsi_table_flows(const http::server::request &req,
 
 	//Check if table id is valid
 	if(snapshot.num_of_tables <= id){
+		of1x_destroy_flow_entry(match_entry);
 		//Throw 404
 		std::stringstream ss;
 		ss << "Invalid table id: '"<< id << "' for lsi: '"<< lsi_name <<"'. Valid tables: 0-"<<snapshot.num_of_tables-1;
@@ -178,24 +407,33 @@ void lsi_table_flows(const http::server::request &req,
 		return;
 	}
 
-	//Get flows
-	std::list<flow_entry_snapshot> flows;
-	std::list<std::string> flows_str;
-	switch_manager::get_switch_table_flows(dpid, id, flows);
-	std::list<flow_entry_snapshot>::const_iterator it;
-	for(it=flows.begin(); it != flows.end(); ++it){
-		std::stringstream ss;
-		ss << *it;
-		flows_str.push_back(ss.str());
+	//Get the page (filtering and paging is done by switch_manager/the pipeline)
+	filter.cookie = cookie;
+	filter.cookie_mask = cookie_mask;
+	filter.out_port = out_port;
+	if(params.find("priority") != params.end())
+		filter.priority = priority;
+	filter.matches = &match_entry->matches;
+	filter.offset = offset;
+	filter.limit = limit;
+
+	uint64_t total = 0;
+	boost::shared_ptr<std::list<flow_entry_snapshot> > flows(new std::list<flow_entry_snapshot>);
+	try{
+		switch_manager::get_switch_table_flows(dpid, id, *flows, filter, &total);
+	}catch(...){
+		of1x_destroy_flow_entry(match_entry);
+		throw;
 	}
+	of1x_destroy_flow_entry(match_entry);
 
-	table.push_back(json_spirit::Pair("id", (uint64_t)id));
-	json_spirit::Value flows_(flows_str.begin(), flows_str.end());
-	table.push_back(json_spirit::Pair("flows", flows_));
+	uint64_t next_offset = (limit && offset+limit < total)? offset+limit : 0;
 
-	//Wrap
-	wrap.push_back(json_spirit::Pair("table", table));
-	rep.content = json_spirit::write(wrap, true);
+	//Serialize incrementally (chunked)
+	rep.content_producer = flow_page_writer(id, offset, total, next_offset, flows);
+	rep.headers.resize(1);
+	rep.headers[0].name = "Content-Type";
+	rep.headers[0].value = "application/json";
 }
 
 void lsi_groups(const http::server::request &req,
@@ -16,6 +16,7 @@
 #include "../../plugin_manager.h"
 #include "../../switch_manager.h"
 #include "../../system_manager.h"
+#include "../../monitoring_manager.h"
 
 namespace xdpd{
 namespace controllers{
@@ -83,6 +84,115 @@ void list_matching_algorithms(const http::server::request &req, http::server::re
 	rep.content = json_spirit::write(mas, true);
 }
 
+//
+// Stage latency
+//
+void stage_latency(const http::server::request &req, http::server::reply &rep, boost::cmatch& grps){
+
+	unsigned int i, j;
+	hal_stage_latency_snapshot_t snapshot;
+	json_spirit::Object latency;
+	json_spirit::Object wrap;
+	json_spirit::Array stages;
+
+	try{
+		if(!monitoring_manager::get_stage_latency(&snapshot)){
+			rep.content = "Stage latency measurements not supported by the driver";
+			rep.status = http::server::reply::not_implemented;
+			return;
+		}
+	}catch(...){
+		//Something went wrong
+		rep.content = "Unable to retrieve the stage latency measurements";
+		rep.status = http::server::reply::internal_server_error;
+		return;
+	}
+
+	latency.push_back(json_spirit::Pair("sampling", (uint64_t)snapshot.sampling));
+
+	for(i=0;i<snapshot.num_of_stages && i<HAL_STAGE_LATENCY_MAX_STAGES;++i){
+		json_spirit::Object s;
+		json_spirit::Array hist;
+		const hal_stage_latency_t* stage = &snapshot.stages[i];
+
+		s.push_back(json_spirit::Pair("name", std::string(stage->name)));
+		s.push_back(json_spirit::Pair("samples", stage->samples));
+		s.push_back(json_spirit::Pair("dropped", stage->dropped));
+		s.push_back(json_spirit::Pair("avg-ns", (stage->samples)? stage->sum_ns/stage->samples : (uint64_t)0));
+		s.push_back(json_spirit::Pair("p50-ns", hal_stage_latency_percentile(&snapshot, stage, 0.5)));
+		s.push_back(json_spirit::Pair("p99-ns", hal_stage_latency_percentile(&snapshot, stage, 0.99)));
+		s.push_back(json_spirit::Pair("p99.9-ns", hal_stage_latency_percentile(&snapshot, stage, 0.999)));
+		s.push_back(json_spirit::Pair("max-ns", stage->max_ns));
+
+		//Non-empty buckets only; the last one is not upper bounded
+		for(j=0;j<HAL_STAGE_LATENCY_BUCKETS;++j){
+			if(!stage->buckets[j])
+				continue;
+			json_spirit::Object b;
+			if(j < HAL_STAGE_LATENCY_BUCKETS-1)
+				b.push_back(json_spirit::Pair("lt-ns", snapshot.bucket_upper_ns[j]));
+			else
+				b.push_back(json_spirit::Pair("lt-ns", "inf"));
+			b.push_back(json_spirit::Pair("count", stage->buckets[j]));
+			hist.push_back(b);
+		}
+		s.push_back(json_spirit::Pair("histogram", hist));
+
+		stages.push_back(s);
+	}
+	latency.push_back(json_spirit::Pair("stages", stages));
+
+	wrap.push_back(json_spirit::Pair("latency", latency));
+	rep.content = json_spirit::write(wrap, true);
+}
+
+//
+// Core idle cycles
+//
+void core_idle(const http::server::request &req, http::server::reply &rep, boost::cmatch& grps){
+
+	unsigned int i;
+	hal_core_idle_snapshot_t snapshot;
+	json_spirit::Object idle;
+	json_spirit::Object wrap;
+	json_spirit::Array cores;
+
+	try{
+		if(!monitoring_manager::get_core_idle(&snapshot)){
+			rep.content = "Core idle measurements not supported by the driver";
+			rep.status = http::server::reply::not_implemented;
+			return;
+		}
+	}catch(...){
+		//Something went wrong
+		rep.content = "Unable to retrieve the core idle measurements";
+		rep.status = http::server::reply::internal_server_error;
+		return;
+	}
+
+	idle.push_back(json_spirit::Pair("cycles-hz", snapshot.cycles_hz));
+	idle.push_back(json_spirit::Pair("period-ms", (uint64_t)snapshot.period_ms));
+
+	for(i=0;i<snapshot.num_of_cores && i<HAL_CORE_IDLE_MAX_CORES;++i){
+		json_spirit::Object c;
+		const hal_core_idle_t* core = &snapshot.cores[i];
+
+		c.push_back(json_spirit::Pair("core", (uint64_t)core->core_id));
+		c.push_back(json_spirit::Pair("socket", (uint64_t)core->socket_id));
+		c.push_back(json_spirit::Pair("active", core->active));
+		c.push_back(json_spirit::Pair("idle-pct", (uint64_t)core->idle_pct));
+		c.push_back(json_spirit::Pair("idle-cycles", core->idle_cycles));
+		c.push_back(json_spirit::Pair("busy-cycles", core->busy_cycles));
+		c.push_back(json_spirit::Pair("backoffs", core->backoffs));
+
+		cores.push_back(c);
+	}
+	idle.push_back(json_spirit::Pair("cores", cores));
+
+	wrap.push_back(json_spirit::Pair("idle", idle));
+	rep.content = json_spirit::write(wrap, true);
+}
+
 } //namespace get
 } //namespace controllers
 } //namespace xdpd
@@ -7,9 +7,8 @@ using namespace rofl;
 using namespace xdpd;
 
 pthread_mutex_t port_manager::mutex = PTHREAD_MUTEX_INITIALIZER; //Serialize operations 
-pthread_rwlock_t port_manager::rwlock = PTHREAD_RWLOCK_INITIALIZER; //Used to protect the vlink cache 
-std::map<std::string, std::string> port_manager::vlinks;
-std::set<std::string> port_manager::blacklisted;
+registry<std::string, std::string> port_manager::vlinks; //Read lock-free from the notifications 
+registry<std::string, bool> port_manager::blacklisted;
 
 bool port_manager::exists(std::string& port_name){
 	return hal_driver_port_exists(port_name.c_str());
@@ -17,29 +16,15 @@ bool port_manager::exists(std::string& port_name){
 
 //vlinks
 bool port_manager::is_vlink(std::string& port_name){
-	return port_manager::vlinks.find(port_name) != port_manager::vlinks.end();
+	return vlinks.contains(port_name);
 }
 
 std::string port_manager::get_vlink_pair(std::string& port_name){
 
-	std::map<std::string, std::string>::iterator it;
 	std::string pair;
 
-	//Make sure iterator is readable all along	
-	pthread_rwlock_rdlock(&port_manager::rwlock);
-	
-	it = port_manager::vlinks.find(port_name);
-	
-
-	if ( it == port_manager::vlinks.end()){
-		pthread_rwlock_unlock(&port_manager::rwlock);
+	if(!vlinks.find(port_name, pair))
 		throw ePmInvalidPort();
-	}
-	
-	//Store the pair and release
-	pair = it->second;
-
-	pthread_rwlock_unlock(&port_manager::rwlock);
 
 	return pair; 
 }
@@ -87,11 +72,20 @@ void port_manager::get_port_info(const std::string& name, port_snapshot& snapsho
 //Blacklisting
 //
 std::set<std::string> port_manager::get_blacklisted_port_names(void){
-	return blacklisted;
+
+	std::set<std::string> names;
+	unsigned int idx = blacklisted.read_lock();
+
+	for(registry<std::string, bool>::map_t::const_iterator it = blacklisted.get().begin(); it != blacklisted.get().end(); ++it)
+		names.insert(it->first);
+
+	blacklisted.read_unlock(idx);
+
+	return names;
 }
 
 bool port_manager::is_blacklisted(std::string& port_name){
-	return blacklisted.find(port_name) != blacklisted.end();
+	return blacklisted.contains(port_name);
 }
 
 void port_manager::blacklist(std::string& port_name){
@@ -112,11 +106,12 @@ void port_manager::blacklist(std::string& port_name){
 	//First check if it is attached
 	if(is_attached(port_name)){
 		ROFL_ERR("[xdpd][port_manager] ERROR: attempting to blacklist port %s which is attached to an LSI\n", port_name.c_str());
+		pthread_mutex_unlock(&port_manager::mutex);
 		throw ePmInvalidPort(); 	
 	}
 	
 	//Add it to the list
-	blacklisted.insert(port_name);
+	blacklisted.insert(port_name, true);
 	
 	//Release mutex	
 	pthread_mutex_unlock(&port_manager::mutex);
@@ -209,6 +204,33 @@ void port_manager::bring_down(std::string& name){
 	ROFL_DEBUG("[xdpd][port_manager] Port %s brought administratively down\n", name.c_str());
 }
 
+void port_manager::configure_queue(std::string& name, unsigned int queue_id, const hal_port_queue_conf_t& conf){
+
+	hal_result_t result;
+
+	//Optional driver API
+	if(!hal_driver_configure_port_queue){
+		ROFL_ERR("[xdpd][port_manager] The driver does not support the configuration of port queues\n");
+		throw ePmUnknownError();
+	}
+
+	pthread_mutex_lock(&port_manager::mutex);
+
+	//Check port existance
+	if(!exists(name)){
+		pthread_mutex_unlock(&port_manager::mutex);
+		throw ePmInvalidPort();
+	}
+
+	result = hal_driver_configure_port_queue(name.c_str(), queue_id, &conf);
+	pthread_mutex_unlock(&port_manager::mutex);
+
+	if(result != HAL_SUCCESS)
+		throw ePmUnknownError();
+
+	ROFL_DEBUG("[xdpd][port_manager] Port %s queue %u configured\n", name.c_str(), queue_id);
+}
+
 
 //
 //Port attachment/detachment
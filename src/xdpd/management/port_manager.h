@@ -17,6 +17,8 @@
 #include <rofl/common/croflexception.h>
 
 #include "snapshots/port_snapshot.h"
+#include "registry.h"
+#include "../drivers/hal_qos_ext.h"
 
 /**
 * @file port_manager.h
@@ -122,6 +124,12 @@ public:
 	*/
 	static void bring_down(std::string& name);
 
+	/**
+	* Configure the egress scheduling (priority, weight, min/max rates) of
+	* an output queue of the port. Requires driver support.
+	*/
+	static void configure_queue(std::string& name, unsigned int queue_id, const hal_port_queue_conf_t& conf);
+
 
 	//
 	//Port attachment/detachment
@@ -213,10 +221,8 @@ public:
 			ROFL_INFO("[xdpd][port_manager][%s] removed from the system;\n", port_snapshot->name);
 
 		if(is_vlink(port_name)){
-			//Remove port and pair from the cache
-			pthread_rwlock_wrlock(&port_manager::rwlock);
-			port_manager::vlinks.erase(port_name);
-			pthread_rwlock_unlock(&port_manager::rwlock);
+			//Remove port from the cache
+			vlinks.erase(port_name);
 		}
 	};
 	
@@ -243,30 +249,25 @@ private:
 	//Add port and pair from the cache
 	static void add_vlink(std::string& port1, std::string& port2){
 
-		pthread_rwlock_wrlock(&port_manager::rwlock);
-
-		if ( port_manager::vlinks.find(port1) != port_manager::vlinks.end() || port_manager::vlinks.find(port2) != port_manager::vlinks.end()){
+		//Writers are serialized by port_manager::mutex
+		if(vlinks.contains(port1) || vlinks.contains(port2)){
 			ROFL_INFO("[xdpd][port_manager] Corrupted vlink cache state; vlink %s or %s \n", port1.c_str(), port2.c_str());
 			assert(0);
-			pthread_rwlock_unlock(&port_manager::rwlock);
 			throw ePmUnknownError();
 		}
 	
 		//Add them
-		port_manager::vlinks[port1] = port2;		
-		port_manager::vlinks[port2] = port1;		
-	
-		pthread_rwlock_unlock(&port_manager::rwlock);
+		vlinks.insert(port1, port2);		
+		vlinks.insert(port2, port1);		
 	};
 
 	//Virtual link cache
-	static std::map<std::string, std::string> vlinks;
+	static registry<std::string, std::string> vlinks;
 
 	//List of blacklisted port names
-	static std::set<std::string> blacklisted;
+	static registry<std::string, bool> blacklisted;
 	
 	static pthread_mutex_t mutex;	
-	static pthread_rwlock_t rwlock;
 };
 
 }// namespace xdpd 
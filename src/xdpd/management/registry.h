@@ -0,0 +1,181 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <pthread.h>
+#include <unistd.h>
+#include <tr1/unordered_map>
+
+/**
+* @file registry.h
+*
+* @brief Read-mostly, hash indexed registry
+*/
+
+namespace xdpd {
+
+/**
+* @brief Read-mostly, hash indexed registry (RCU-like)
+* @ingroup cmm_mgmt
+*
+* @description Readers never block nor take any lock; they enter a read-side
+* section (read_lock()/read_unlock()), which only increments a counter, and
+* access the current version of the (immutable) hash map. Writers are
+* serialized, copy the map, publish the new version and wait until all
+* the readers that could still be using the old version have left their
+* section (synchronize()), before releasing it.
+*
+* This also guarantees that an object removed from the registry is not being
+* used by any reader once the removal returns, so that it can safely be
+* destroyed.
+*
+* Writers shall never be called from within a read-side section.
+*/
+template<typename K, typename V>
+class registry{
+
+public:
+	typedef std::tr1::unordered_map<K, V> map_t;
+
+	registry() : current(new map_t()), gen(0){
+		readers[0] = readers[1] = 0;
+		pthread_mutex_init(&mutex, NULL);
+	}
+
+	~registry(){
+		delete current;
+		pthread_mutex_destroy(&mutex);
+	}
+
+	//
+	// Read-side
+	//
+
+	/**
+	* Enter a read-side section. The returned value must be passed to read_unlock()
+	*/
+	inline unsigned int read_lock(void) const{
+		unsigned int idx = gen & 0x1;
+		__sync_fetch_and_add(&readers[idx], 1); //Full barrier
+		return idx;
+	}
+
+	/**
+	* Leave a read-side section
+	*/
+	inline void read_unlock(unsigned int idx) const{
+		__sync_fetch_and_sub(&readers[idx], 1);
+	}
+
+	/**
+	* Get the current version of the map. Only valid within a read-side section.
+	*/
+	inline const map_t& get(void) const{
+		return *current;
+	}
+
+	/**
+	* Lookup an element (read-side section is handled internally)
+	*/
+	inline bool find(const K& key, V& value) const{
+		bool found = false;
+		unsigned int idx = read_lock();
+		typename map_t::const_iterator it = current->find(key);
+
+		if(it != current->end()){
+			value = it->second;
+			found = true;
+		}
+
+		read_unlock(idx);
+		return found;
+	}
+
+	inline bool contains(const K& key) const{
+		bool found;
+		unsigned int idx = read_lock();
+		found = current->find(key) != current->end();
+		read_unlock(idx);
+		return found;
+	}
+
+	//
+	// Write-side
+	//
+
+	/**
+	* Insert or replace an element. Returns once no reader is using the old version.
+	*/
+	void insert(const K& key, const V& value){
+		pthread_mutex_lock(&mutex);
+		map_t* next = new map_t(*current);
+		(*next)[key] = value;
+		publish(next);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	/**
+	* Remove an element. Returns once no reader can still see it.
+	*/
+	void erase(const K& key){
+		pthread_mutex_lock(&mutex);
+		if(current->find(key) != current->end()){
+			map_t* next = new map_t(*current);
+			next->erase(key);
+			publish(next);
+		}
+		pthread_mutex_unlock(&mutex);
+	}
+
+	/**
+	* Remove all the elements
+	*/
+	void clear(void){
+		pthread_mutex_lock(&mutex);
+		publish(new map_t());
+		pthread_mutex_unlock(&mutex);
+	}
+
+private:
+	//Current version
+	map_t* volatile current;
+
+	//Grace period generation and readers per generation parity
+	volatile unsigned int gen;
+	mutable volatile unsigned int readers[2];
+
+	//Serialize writers
+	pthread_mutex_t mutex;
+
+	void publish(map_t* next){
+		map_t* old = current;
+
+		__sync_synchronize();
+		current = next;
+
+		synchronize();
+		delete old;
+	}
+
+	/*
+	* Wait for a grace period. The generation is flipped twice, so that readers
+	* that sampled the parity right before a flip are also drained
+	*/
+	void synchronize(void){
+		unsigned int i, idx;
+
+		for(i=0; i<2; ++i){
+			idx = gen & 0x1;
+			__sync_fetch_and_add(&gen, 1); //Full barrier
+			while(readers[idx] != 0)
+				usleep(50); //Calm down
+		}
+	}
+};
+
+}// namespace xdpd
+
+#endif /* REGISTRY_H_ */
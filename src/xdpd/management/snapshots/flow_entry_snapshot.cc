@@ -55,19 +55,31 @@ flow_entry_snapshot::flow_entry_snapshot(of_version_t ver, uint16_t miss_send_le
 
 
 
-rofl_result_t flow_entry_snapshot::map_flow_stats_msg(of_version_t ver, uint16_t miss_send_len, of1x_stats_flow_msg_t* hal_flows, std::list<flow_entry_snapshot>& flows ){
+rofl_result_t flow_entry_snapshot::map_flow_stats_msg(of_version_t ver, uint16_t miss_send_len, of1x_stats_flow_msg_t* hal_flows, std::list<flow_entry_snapshot>& flows, const flow_entry_filter& filter, uint64_t* total){
 
 	of1x_stats_single_flow_msg_t* flow_it;
+	uint64_t num_of_matching = 0;
 
 	try{ 
-		//Translate flows
+		//Translate flows (only the selected page)
 		for(flow_it = hal_flows->flows_head;flow_it;flow_it=flow_it->next){
-			flows.push_back(flow_entry_snapshot(ver, miss_send_len, flow_it));
+			if(filter.priority >= 0 && flow_it->priority != (uint32_t)filter.priority)
+				continue;
+
+			if(num_of_matching >= filter.offset && (!filter.limit || num_of_matching - filter.offset < filter.limit))
+				flows.push_back(flow_entry_snapshot(ver, miss_send_len, flow_it));
+			else if(!total && num_of_matching >= filter.offset)
+				break; //Past the page and the caller does not need the total
+
+			num_of_matching++;
 		}
 	}catch(...){
 		assert(0);
 		return ROFL_FAILURE;
 	}
 
+	if(total)
+		*total = num_of_matching;
+
 	return ROFL_SUCCESS;
 }
@@ -22,6 +22,33 @@
 
 namespace xdpd {
 
+/**
+* @brief Flow entry listing filter and page
+* @ingroup cmm_mgmt
+*/
+class flow_entry_filter {
+
+public:
+	flow_entry_filter() : cookie(0x0), cookie_mask(0x0), out_port(OF1X_PORT_ANY), priority(-1), matches(NULL), offset(0), limit(0){}
+
+	//Cookie value and mask (0x0 disables cookie filtering)
+	uint64_t cookie;
+	uint64_t cookie_mask;
+
+	//Only flows forwarding to out_port (OF1X_PORT_ANY disables it)
+	uint32_t out_port;
+
+	//Only flows with this exact priority (-1 disables it)
+	int32_t priority;
+
+	//Non-strict match filter (NULL matches all); not owned
+	of1x_match_group_t* matches;
+
+	//Page: skip the first offset matching entries, return at most limit (0 unlimited)
+	uint64_t offset;
+	uint64_t limit;
+};
+
 /**
 * @brief C++ flow entry snapshot 
 * @ingroup cmm_mgmt
@@ -36,8 +63,12 @@ public:
 
 	/**
 	* Map a list of flow entries 
+	*
+	* Only the entries of the page (and priority) selected by filter are
+	* translated; total, if not NULL, is set to the number of entries with
+	* a matching priority.
 	*/
-	static rofl_result_t map_flow_stats_msg(of_version_t ver, uint16_t miss_send_len, of1x_stats_flow_msg_t* hal_flows, std::list<flow_entry_snapshot>& flows );
+	static rofl_result_t map_flow_stats_msg(of_version_t ver, uint16_t miss_send_len, of1x_stats_flow_msg_t* hal_flows, std::list<flow_entry_snapshot>& flows, const flow_entry_filter& filter=flow_entry_filter(), uint64_t* total=NULL);
 
  	//Dumping operator
 	friend std::ostream& operator<<(std::ostream& os, const flow_entry_snapshot& f)
@@ -4,6 +4,8 @@
 #include <rofl/datapath/hal/cmm.h>
 #include <rofl/common/utils/c_logger.h>
 #include "port_manager.h"
+#include "../drivers/hal_pktin_ext.h"
+#include "../drivers/hal_flows_ext.h"
 
 //Add here the headers of the version-dependant Openflow switchs 
 #include "../openflow/openflow_switch.h"
@@ -20,11 +22,21 @@ const rofl::caddress_in4 switch_manager::binding_addr = rofl::caddress_in4("0.0.
 const uint16_t switch_manager::binding_port = 6632;
 
 //Static initialization
-std::map<uint64_t, openflow_switch*> switch_manager::switchs;
+registry<uint64_t, openflow_switch*> switch_manager::switchs; //Readers (e.g. notification treatment) never block; deletion waits for them
+registry<std::string, uint64_t> switch_manager::dpids_by_name;
 uint64_t switch_manager::dpid_under_destruction = 0x0;
-pthread_rwlock_t switch_manager::rwlock = PTHREAD_RWLOCK_INITIALIZER; //Used to prevent deletion of a switch during notification treatment (e.g. port_status_changed)
 pthread_mutex_t switch_manager::mutex = PTHREAD_MUTEX_INITIALIZER; //Used to serialize management actions 
 
+//Mirror the PIRL configuration in the datapath PKT_IN policer (if the driver supports it)
+static void configure_pkt_in_policer(uint64_t dpid, const int max_rate){
+
+	if(!hal_driver_reconfigure_pkt_in_policer)
+		return;
+
+	if(hal_driver_reconfigure_pkt_in_policer(dpid, (max_rate == pirl::PIRL_DISABLED)? HAL_PKT_IN_POLICER_DISABLED : max_rate) != HAL_SUCCESS)
+		ROFL_ERR("[xdpd][switch_manager][0x%llx] Unable to configure the datapath PKT_IN policer.\n", (long long unsigned)dpid);
+}
+
 /**
 * Static methods of the manager
 */
@@ -43,18 +55,11 @@ openflow_switch* switch_manager::create_switch(
 	pthread_mutex_lock(&switch_manager::mutex);
 
 	//Check for overlapping names and dpids
-	if(switch_manager::switchs.find(dpid) != switch_manager::switchs.end()){
+	if(switchs.contains(dpid) || dpids_by_name.contains(dpname)){
 		pthread_mutex_unlock(&switch_manager::mutex);
 		throw eOfSmExists();
 	}
 
-	for(std::map<uint64_t, openflow_switch*>::iterator it = switchs.begin(); it != switchs.end(); ++it){
-		if( it->second->dpname.compare(dpname) == 0 ){
-			pthread_mutex_unlock(&switch_manager::mutex);
-			throw eOfSmExists();
-		}
-	}
-
 	//Check if ROFL supports SSL or any other socket type, so that we can send a nice exception
 	if(!rofl::csocket::supports_socket_type(socket_type)){
 		ROFL_ERR("[xdpd][switch_manager] ERROR Unsupported socket type by ROFL, specified in the first connection of switch with dpid: 0x%llx. Perhaps compiled ROFL without SSL support?\n", (long long unsigned int)dpid); 
@@ -93,7 +98,11 @@ openflow_switch* switch_manager::create_switch(
 	}	
 	
 	//Store in the switch list
-	switch_manager::switchs[dpid] = dp;
+	switchs.insert(dpid, dp);
+	dpids_by_name.insert(dpname, dpid);
+
+	//Police PKT_INs in the datapath too, with the (default) PIRL rate
+	configure_pkt_in_policer(dpid, dp->rate_limiter.get_max_rate());
 	
 	pthread_mutex_unlock(&switch_manager::mutex);
 	
@@ -115,7 +124,7 @@ void switch_manager::destroy_switch(uint64_t dpid){
 
 	pthread_mutex_lock(&switch_manager::mutex);
 	
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end()){
+	if(!switchs.contains(dpid)){
 		pthread_mutex_unlock(&switch_manager::mutex);
 		throw eOfSmDoesNotExist();
 	}
@@ -152,15 +161,12 @@ void switch_manager::destroy_switch(uint64_t dpid){
 		}
 	}
 
-	//WRITE lock only the access to the switchs map
-	//during erase	
-	pthread_rwlock_wrlock(&switch_manager::rwlock);
-	
-	//Get switch instance 
-	openflow_switch* dp = switch_manager::switchs[dpid];
-	switch_manager::switchs.erase(dpid);
-
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	//Get switch instance and remove it; once erase() returns
+	//no notification treatment can be using it anymore
+	openflow_switch* dp = NULL;
+	switchs.find(dpid, dp);
+	switchs.erase(dpid);
+	dpids_by_name.erase(dp->dpname);
 
 	//Destroy element
 	delete dp;	
@@ -179,13 +185,16 @@ void switch_manager::destroy_switch(uint64_t dpid){
 //static
 void switch_manager::destroy_all_switches(){
 
-	std::map<uint64_t, openflow_switch*>::iterator it = switchs.begin(), tmp;
-	while( it != switchs.end() ){
-		tmp = it;	
-		it++;
-		destroy_switch(tmp->second->dpid);
-	}
-	switchs.clear();
+	std::list<uint64_t> dpids;
+	unsigned int idx = switchs.read_lock();
+
+	for(registry<uint64_t, openflow_switch*>::map_t::const_iterator it = switchs.get().begin(); it != switchs.get().end(); ++it)
+		dpids.push_back(it->first);
+
+	switchs.read_unlock(idx);
+
+	for(std::list<uint64_t>::iterator it = dpids.begin(); it != dpids.end(); ++it)
+		destroy_switch(*it);
 }
 
 /**
@@ -195,10 +204,16 @@ void switch_manager::destroy_all_switches(){
 std::list<std::string> switch_manager::list_sw_names(void){
 	
 	std::list<std::string> name_list;
+	std::map<uint64_t, std::string> sorted; //By dpid
+	unsigned int idx = switchs.read_lock();
 
-	for(std::map<uint64_t, openflow_switch*>::iterator it = switchs.begin(); it != switchs.end(); ++it) {
-		name_list.push_back(it->second->dpname);
-	}
+	for(registry<uint64_t, openflow_switch*>::map_t::const_iterator it = switchs.get().begin(); it != switchs.get().end(); ++it)
+		sorted[it->first] = it->second->dpname;
+
+	switchs.read_unlock(idx);
+
+	for(std::map<uint64_t, std::string>::iterator it = sorted.begin(); it != sorted.end(); ++it)
+		name_list.push_back(it->second);
 
 	return name_list;
 }
@@ -223,54 +238,18 @@ switch_manager::list_matching_algorithms(of_version_t of_version)
 
 
 bool switch_manager::exists(uint64_t dpid){
-	
-	bool found=true;
-
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
-	
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end())
-		found=false;
-	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
-	
-	return found;
+	return switchs.contains(dpid);
 }
 
 bool switch_manager::exists_by_name(std::string& name){
-	
-	bool found=false;
-
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
-
-	for(std::map<uint64_t, openflow_switch*>::iterator it = switchs.begin(); it != switchs.end(); ++it){
-		if( it->second->dpname == name)
-			found=true;	
-
-	}
-	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
-
-	return found; 
+	return dpids_by_name.contains(name);
 }
 
 uint64_t switch_manager::get_switch_dpid(std::string const& name){
 
 	uint64_t dpid=0x0ULL;
-	bool found=false;
-
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
 
-	for(std::map<uint64_t, openflow_switch*>::iterator it = switchs.begin(); it != switchs.end(); ++it){
-		if( it->second->dpname == name){
-			found=true;
-			dpid = it->second->dpid;
-		}
-
-	}
-	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
-
-	if(found)
+	if(dpids_by_name.find(name, dpid))
 		return dpid;
 	else
 		throw eOfSmDoesNotExist(); 
@@ -279,18 +258,18 @@ uint64_t switch_manager::get_switch_dpid(std::string const& name){
 
 void switch_manager::get_switch_info(uint64_t dpid, openflow_switch_snapshot& snapshot){
 	
-	//Make sure 	
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
+	//Make sure the switch is not destroyed meanwhile
+	unsigned int idx = switchs.read_lock();
 
 	//Recover the switch
 	of_switch_snapshot_t* sw = hal_driver_get_switch_snapshot_by_dpid(dpid);
 	
 	if(!sw){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		throw eOfSmDoesNotExist();
 	}
 
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 	
 	snapshot = openflow_switch_snapshot(sw);
 
@@ -298,45 +277,60 @@ void switch_manager::get_switch_info(uint64_t dpid, openflow_switch_snapshot& sn
 	of_switch_destroy_snapshot(sw);
 }
 
-void switch_manager::get_switch_table_flows(uint64_t dpid, uint8_t table_id /*TODO: Add filtering */, std::list<flow_entry_snapshot>& flows){
+void switch_manager::get_switch_table_flows(uint64_t dpid, uint8_t table_id, std::list<flow_entry_snapshot>& flows, const flow_entry_filter& filter, uint64_t* total){
 
 	of1x_stats_flow_msg_t* hal_flows = NULL;
 	of1x_switch_snapshot_t* sw_snapshot = NULL; 
 	of1x_flow_entry_t* entry = of1x_init_flow_entry(false); //empty matches (all)
+	of1x_match_group_t* matches = (filter.matches)? filter.matches : &entry->matches;
+	hal_flow_stats_page_t page;
+	flow_entry_filter page_filter;
 
-	//Make sure 	
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
+	//Make sure the switch is not destroyed meanwhile
+	unsigned int idx = switchs.read_lock();
 
 	//Recover the switch
 	openflow_switch* sw = __get_switch_by_dpid(dpid);
 	
 	if(!sw){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		throw eOfSmDoesNotExist();
 	}
 
-	//Call HAL
-	hal_flows = hal_driver_of1x_get_flow_stats(dpid, table_id, 0x0, 0x0, OF1X_PORT_ANY, OF1X_GROUP_ANY, &entry->matches);
+	//Call HAL. If the driver supports it, only the entries of the page are
+	//copied (the priority and the page are applied by the driver too)
+	if(hal_driver_of1x_get_flow_stats_page){
+		page.priority = filter.priority;
+		page.offset = filter.offset;
+		page.limit = filter.limit;
+		hal_flows = hal_driver_of1x_get_flow_stats_page(dpid, table_id, filter.cookie, filter.cookie_mask, filter.out_port, OF1X_GROUP_ANY, matches, &page);
+	}else{
+		//Cookie, out_port and match filtering is done by the pipeline
+		hal_flows = hal_driver_of1x_get_flow_stats(dpid, table_id, filter.cookie, filter.cookie_mask, filter.out_port, OF1X_GROUP_ANY, matches);
+		page_filter = filter;
+	}
 	sw_snapshot = (of1x_switch_snapshot_t*)hal_driver_get_switch_snapshot_by_dpid(sw->dpid);
 
 	if(!hal_flows || !sw_snapshot){
 		assert(0);
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		throw eOfSmGeneralError(); 	
 	}
 
 	//Clear original
 	flows.clear();
 
-	//Add translated
-	if(flow_entry_snapshot::map_flow_stats_msg(sw_snapshot->of_ver, sw_snapshot->pipeline.miss_send_len, hal_flows, flows) != ROFL_SUCCESS){
+	//Add translated (only the page is translated)
+	if(flow_entry_snapshot::map_flow_stats_msg(sw_snapshot->of_ver, sw_snapshot->pipeline.miss_send_len, hal_flows, flows, page_filter, (hal_driver_of1x_get_flow_stats_page)? NULL : total) != ROFL_SUCCESS){
 		assert(0);
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		throw eOfSmGeneralError(); 	
 	}
 		
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
+	if(hal_driver_of1x_get_flow_stats_page && total)
+		*total = page.total;
 
 	if(sw_snapshot)
 		of_switch_destroy_snapshot((of_switch_snapshot_t*)sw_snapshot);	
@@ -351,39 +345,39 @@ void switch_manager::get_switch_group_mods(uint64_t dpid, std::list<openflow_gro
 	of1x_stats_group_desc_msg_t* group_table_desc = NULL;
 	of1x_stats_group_msg_t* group_table_stats = NULL;
 	
-	//Make sure 	
-	pthread_rwlock_rdlock(&switch_manager::rwlock);
+	//Make sure the switch is not destroyed meanwhile
+	unsigned int idx = switchs.read_lock();
 
 	//Recover the switch
 	openflow_switch* sw = __get_switch_by_dpid(dpid);
 	
 	if(!sw){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		throw eOfSmDoesNotExist();
 	}
 	
 	group_table_desc = hal_driver_of1x_get_group_desc_stats(dpid);
 	if( !group_table_desc ){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		return;
 	}
 
 	group_table_stats = hal_driver_of1x_get_group_stats(dpid, OF1X_GROUP_ALL);
 	if( !group_table_stats ){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		of1x_destroy_group_desc_stats(group_table_desc);
 		return;
 	 }
 	 
 	if(openflow_group_mod_snapshot::map_group_mods_msg(sw->version, group_table_stats, group_table_desc, group_mods)!= ROFL_SUCCESS){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+		switchs.read_unlock(idx);
 		of1x_destroy_group_desc_stats(group_table_desc);
 		of1x_destroy_stats_group_msg(group_table_stats);
 		assert(0);
 		throw eOfSmGeneralError();
 	}
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 	of1x_destroy_group_desc_stats(group_table_desc);
 	of1x_destroy_stats_group_msg(group_table_stats);
 }
@@ -391,17 +385,18 @@ void switch_manager::get_switch_group_mods(uint64_t dpid, std::list<openflow_gro
 void
 switch_manager::rpc_connect_to_ctl(uint64_t dpid, enum rofl::csocket::socket_type_t socket_type, cparams const& socket_params){
 
-	pthread_rwlock_wrlock(&switch_manager::rwlock);
+	openflow_switch* dp;
+
+	//Serialize with switch destruction
+	pthread_mutex_lock(&switch_manager::mutex);
 	
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end()){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+	if(!switchs.find(dpid, dp)){
+		pthread_mutex_unlock(&switch_manager::mutex);
 		throw eOfSmDoesNotExist();
 	}
 
-	//Get switch instance
-	openflow_switch* dp = switch_manager::switchs[dpid];
 	dp->rpc_connect_to_ctl(socket_type, socket_params);
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	pthread_mutex_unlock(&switch_manager::mutex);
 }
 
 
@@ -409,17 +404,18 @@ switch_manager::rpc_connect_to_ctl(uint64_t dpid, enum rofl::csocket::socket_typ
 void
 switch_manager::rpc_disconnect_from_ctl(uint64_t dpid, enum rofl::csocket::socket_type_t socket_type, cparams const& socket_params){
 
-	pthread_rwlock_wrlock(&switch_manager::rwlock);
+	openflow_switch* dp;
+
+	//Serialize with switch destruction
+	pthread_mutex_lock(&switch_manager::mutex);
 	
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end()){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+	if(!switchs.find(dpid, dp)){
+		pthread_mutex_unlock(&switch_manager::mutex);
 		throw eOfSmDoesNotExist();
 	}
 
-	//Get switch instance
-	openflow_switch* dp = switch_manager::switchs[dpid];
 	dp->rpc_disconnect_from_ctl(socket_type, socket_params);
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	pthread_mutex_unlock(&switch_manager::mutex);
 }
 
 
@@ -429,35 +425,29 @@ switch_manager::rpc_disconnect_from_ctl(uint64_t dpid, enum rofl::csocket::socke
 
 void switch_manager::reconfigure_pirl(uint64_t dpid, const int max_rate){
 
-	pthread_rwlock_wrlock(&switch_manager::rwlock);
+	openflow_switch* dp;
+
+	//Serialize with switch destruction
+	pthread_mutex_lock(&switch_manager::mutex);
 	
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end()){
-		pthread_rwlock_unlock(&switch_manager::rwlock);
+	if(!switchs.find(dpid, dp)){
+		pthread_mutex_unlock(&switch_manager::mutex);
 		throw eOfSmDoesNotExist();
 	}
 
-	//Get switch instance
-	openflow_switch* dp = switch_manager::switchs[dpid];
+	//Note that concurrent PKT_INs may still use the old rate for (at most) a bucket
 	if(max_rate == pirl::PIRL_DISABLED){
 		ROFL_INFO("[xdpd][switch_manager][0x%llx] Disabling PIRL.\n", (long long unsigned)dpid);
 	}else{
 		ROFL_INFO("[xdpd][switch_manager][0x%llx] Enabling and reconfiguring PIRL, with max rate: %d PKT_IN/s.\n", (long long unsigned)dpid, max_rate);
 	}
 	dp->rate_limiter.reconfigure(max_rate);
+	configure_pkt_in_policer(dpid, dp->rate_limiter.get_max_rate());
 
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	pthread_mutex_unlock(&switch_manager::mutex);
 }
 
 
-openflow_switch* switch_manager::__get_switch_by_dpid(uint64_t dpid){
-
-	if (switch_manager::switchs.find(dpid) == switch_manager::switchs.end()){
-		return NULL;
-	}
-
-	return switch_manager::switchs[dpid];
-}
-
 //
 //CMM demux
 //
@@ -466,16 +456,13 @@ rofl_result_t switch_manager::__notify_port_attached(const switch_port_snapshot_
 	
 	rofl_result_t result;
 	openflow_switch* sw;	
+	unsigned int idx;
 
 	if(!port_snapshot || port_snapshot->attached_sw_dpid == dpid_under_destruction)
 		return ROFL_FAILURE;
 
-	while( pthread_rwlock_tryrdlock(&switch_manager::rwlock) != 0 ){
-		//This can happen while destroying the LSI
-		if(port_snapshot->attached_sw_dpid == dpid_under_destruction)
-			return ROFL_FAILURE;
-		usleep(50); //Calm down
-	}
+	//Lock-free; destruction of the switch waits for this section to finish
+	idx = switchs.read_lock();
 
 	sw = switch_manager::__get_switch_by_dpid(port_snapshot->attached_sw_dpid); 
 
@@ -484,7 +471,7 @@ rofl_result_t switch_manager::__notify_port_attached(const switch_port_snapshot_
 	else	
 		result = ROFL_FAILURE;
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
 	return result;	
 }	
@@ -493,16 +480,13 @@ rofl_result_t switch_manager::__notify_port_status_changed(const switch_port_sna
 	
 	rofl_result_t result;
 	openflow_switch* sw;	
+	unsigned int idx;
 
 	if(!port_snapshot || port_snapshot->attached_sw_dpid == dpid_under_destruction)
 		return ROFL_FAILURE;
 
-	while( pthread_rwlock_tryrdlock(&switch_manager::rwlock) != 0 ){
-		//This can happen while destroying the LSI
-		if(port_snapshot->attached_sw_dpid == dpid_under_destruction)
-			return ROFL_FAILURE;
-		usleep(50); //Calm down
-	}
+	//Lock-free; destruction of the switch waits for this section to finish
+	idx = switchs.read_lock();
 
 	sw = switch_manager::__get_switch_by_dpid(port_snapshot->attached_sw_dpid); 
 
@@ -511,7 +495,7 @@ rofl_result_t switch_manager::__notify_port_status_changed(const switch_port_sna
 	else	
 		result = ROFL_FAILURE;
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
 	return result;	
 
@@ -521,16 +505,13 @@ rofl_result_t switch_manager::__notify_port_detached(const switch_port_snapshot_
 	
 	rofl_result_t result;
 	openflow_switch* sw;	
+	unsigned int idx;
 
 	if(!port_snapshot || port_snapshot->attached_sw_dpid == dpid_under_destruction)
 		return ROFL_FAILURE;
 
-	while( pthread_rwlock_tryrdlock(&switch_manager::rwlock) != 0 ){
-		//This can happen while destroying the LSI
-		if(port_snapshot->attached_sw_dpid == dpid_under_destruction)
-			return ROFL_FAILURE;
-		usleep(50); //Calm down
-	}
+	//Lock-free; destruction of the switch waits for this section to finish
+	idx = switchs.read_lock();
 
 	sw = switch_manager::__get_switch_by_dpid(port_snapshot->attached_sw_dpid); 
 
@@ -539,7 +520,7 @@ rofl_result_t switch_manager::__notify_port_detached(const switch_port_snapshot_
 	else	
 		result = ROFL_FAILURE;
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
 	return result;	
 }
@@ -556,16 +537,13 @@ rofl_result_t switch_manager::__process_of1x_packet_in(uint64_t dpid,
 				packet_matches_t* matches){
 	rofl_result_t result;
 	openflow_switch* sw;	
+	unsigned int idx;
 
 	if(dpid == dpid_under_destruction)
 		return ROFL_SUCCESS;
 
-	while( pthread_rwlock_tryrdlock(&switch_manager::rwlock) != 0 ){
-		//This can happen while destroying the LSI
-		if(dpid == dpid_under_destruction)
-			return ROFL_FAILURE;
-		usleep(50); //Calm down
-	}
+	//Lock-free; destruction of the switch waits for this section to finish
+	idx = switchs.read_lock();
 
 	sw = switch_manager::__get_switch_by_dpid(dpid); 
 
@@ -574,7 +552,7 @@ rofl_result_t switch_manager::__process_of1x_packet_in(uint64_t dpid,
 	else	
 		result = ROFL_FAILURE;
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
 	return result;	
 
@@ -586,16 +564,13 @@ rofl_result_t switch_manager::__process_of1x_flow_removed(uint64_t dpid,
 
 	rofl_result_t result;
 	openflow_switch* sw;	
+	unsigned int idx;
 
 	if(dpid == dpid_under_destruction)
 		return ROFL_SUCCESS;
 
-	while( pthread_rwlock_tryrdlock(&switch_manager::rwlock) != 0 ){
-		//This can happen while destroying the LSI
-		if(dpid == dpid_under_destruction)
-			return ROFL_FAILURE;
-		usleep(50); //Calm down
-	}
+	//Lock-free; destruction of the switch waits for this section to finish
+	idx = switchs.read_lock();
 
 	sw = switch_manager::__get_switch_by_dpid(dpid); 
 
@@ -604,7 +579,7 @@ rofl_result_t switch_manager::__process_of1x_flow_removed(uint64_t dpid,
 	else	
 		result = ROFL_FAILURE;
 	
-	pthread_rwlock_unlock(&switch_manager::rwlock);
+	switchs.read_unlock(idx);
 
 	return result;	
 
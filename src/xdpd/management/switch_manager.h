@@ -34,6 +34,8 @@
 #include "snapshots/flow_entry_snapshot.h"
 #include "snapshots/group_mod_snapshot.h"
 
+#include "registry.h"
+
 /**
 * @file switch_manager.h
 * @author Marc Sune<marc.sune (at) bisdn.de>
@@ -145,9 +147,11 @@ public:
 
 	/**
 	* Get list of switch table flow entries currently installed 
-	* @param flows List of flows installed. 
+	* @param flows List of flows installed (only the page selected by filter). 
+	* @param filter Filter and page to be applied
+	* @param total If not NULL, it is filled with the number of entries matching the filter (regardless of the page)
 	*/
-	static void get_switch_table_flows(uint64_t dpid, uint8_t table_id /*TODO: Add filtering */, std::list<flow_entry_snapshot>& flows);
+	static void get_switch_table_flows(uint64_t dpid, uint8_t table_id, std::list<flow_entry_snapshot>& flows, const flow_entry_filter& filter=flow_entry_filter(), uint64_t* total=NULL);
 	
 	/**
 	* Get list of switch group table entries currently installed 
@@ -210,12 +214,19 @@ public:
 private:
 	
 	/* Static members */
-	//Switch container
-	static std::map<uint64_t, openflow_switch*> switchs; 
+	//Switch container (indexed by dpid) and name index
+	static registry<uint64_t, openflow_switch*> switchs; 
+	static registry<std::string, uint64_t> dpids_by_name; 
 	static uint64_t dpid_under_destruction;
 
-	//Shall never be used except for the cmm
-	static openflow_switch* __get_switch_by_dpid(uint64_t dpid);	
+	//Shall only be called within a read-side section of switchs
+	static inline openflow_switch* __get_switch_by_dpid(uint64_t dpid){
+		registry<uint64_t, openflow_switch*>::map_t::const_iterator it = switchs.get().find(dpid);
+
+		if(it == switchs.get().end())
+			return NULL;
+		return it->second;
+	}
 
 	//Default addresses
 	static const rofl::caddress_in4 controller_addr;
@@ -224,7 +235,6 @@ private:
 	static const uint16_t binding_port;
 
 	static pthread_mutex_t mutex;
-	static pthread_rwlock_t rwlock;
 
 };
 
@@ -38,7 +38,11 @@ const unsigned int system_manager::XDPD_DEFAULT_DEBUG_LEVEL=3; //ERROR
 
 const std::string system_manager::XDPD_TEST_RUN_OPT_FULL_NAME="test-config";
 const std::string system_manager::XDPD_EXTRA_PARAMS_OPT_FULL_NAME="extra-params";
+const std::string system_manager::XDPD_OF_THREADS_OPT_FULL_NAME="of-threads";
+const unsigned int system_manager::XDPD_MAX_OF_THREADS=64;
 pthread_t system_manager::ciosrv_thread = 0;
+std::vector<system_manager::of_thread_t> system_manager::of_threads;
+pthread_mutex_t system_manager::of_threads_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 //Handler to stop ciosrv
 void interrupt_handler(int dummy=0) {
@@ -126,6 +130,9 @@ void system_manager::init_command_line_options(){
 	composed_usage << "\t\t\t       ["<<get_driver_code_name()<<"] supported extra parameters: "<<std::endl<< get_driver_usage()<<std::endl<<"\t\t\t\t";
 	env_parser->add_option(coption(true,REQUIRED_ARGUMENT, 'e', XDPD_EXTRA_PARAMS_OPT_FULL_NAME, composed_usage.str(), ""));
 
+	//OpenFlow endpoint threads
+	env_parser->add_option(coption(true, REQUIRED_ARGUMENT, 'o', XDPD_OF_THREADS_OPT_FULL_NAME, "Number of I/O loop threads running the OpenFlow endpoints of the LSIs (0: main I/O loop)", "0"));
+
 	//Test
 	env_parser->add_option(coption(true, NO_ARGUMENT, 't', XDPD_TEST_RUN_OPT_FULL_NAME, "Test configuration only and exit", ""));
 
@@ -239,6 +246,10 @@ void system_manager::init(int argc, char** argv){
 	//Mark as initied. MUST BE here, after the first setting of the logging level has been
 	//done
 	inited = true;
+
+	//Launch the OpenFlow endpoint I/O loops, before any LSI is created
+	if(!is_test_run() && env_parser->is_arg_set(XDPD_OF_THREADS_OPT_FULL_NAME))
+		start_of_threads(atoi(env_parser->get_arg(XDPD_OF_THREADS_OPT_FULL_NAME).c_str()));
 	
 	//Load plugins
 	optind=0;
@@ -253,9 +264,13 @@ void system_manager::init(int argc, char** argv){
 	//Printing nice trace
 	ROFL_INFO("\n[xdpd][system_manager] Shutting down...\n");	
 
-	//Destroy all state
+	//Destroy all state. LSIs (and their endpoints) go first, so that the
+	//endpoint I/O loops still drain the PKT_INs handed off by the driver
 	switch_manager::destroy_all_switches();
 
+	//Stop the OpenFlow endpoint I/O loops
+	stop_of_threads();
+
 	//Call driver to shutdown
 	hal_driver_destroy();
 	
@@ -283,6 +298,92 @@ SYSTEM_MANAGER_CLEANUP:
 
 
 
+//
+// OpenFlow endpoint I/O loop threads
+//
+
+void* system_manager::run_of_thread(void* arg){
+
+	//Run the I/O loop of this thread, until stopped
+	rofl::cioloop::get_loop().run();
+
+	return NULL;
+}
+
+void system_manager::start_of_threads(unsigned int num_of_threads){
+
+	of_thread_t th;
+
+	if(num_of_threads > XDPD_MAX_OF_THREADS){
+		ROFL_ERR("[xdpd][system_manager] Invalid number of OpenFlow endpoint I/O threads %u (max. %u). Using %u.\n", num_of_threads, XDPD_MAX_OF_THREADS, XDPD_MAX_OF_THREADS);
+		num_of_threads = XDPD_MAX_OF_THREADS;
+	}
+
+	pthread_mutex_lock(&of_threads_mutex);
+
+	for(unsigned int i=0; i<num_of_threads; ++i){
+		th.num_of_endpoints = 0;
+		if(pthread_create(&th.tid, NULL, run_of_thread, NULL) != 0){
+			ROFL_ERR("[xdpd][system_manager] ERROR: unable to launch OpenFlow endpoint I/O thread #%u. Continuing with %u...\n", i, (unsigned int)of_threads.size());
+			break;
+		}
+		of_threads.push_back(th);
+	}
+
+	pthread_mutex_unlock(&of_threads_mutex);
+
+	ROFL_INFO("[xdpd][system_manager] Launched %u OpenFlow endpoint I/O threads.\n", (unsigned int)of_threads.size());
+}
+
+void system_manager::stop_of_threads(){
+
+	pthread_mutex_lock(&of_threads_mutex);
+
+	for(std::vector<of_thread_t>::iterator it = of_threads.begin(); it != of_threads.end(); ++it)
+		rofl::cioloop::get_loop(it->tid).stop();
+
+	for(std::vector<of_thread_t>::iterator it = of_threads.begin(); it != of_threads.end(); ++it)
+		pthread_join(it->tid, NULL);
+
+	pthread_mutex_unlock(&of_threads_mutex);
+}
+
+pthread_t system_manager::__acquire_of_thread(){
+
+	pthread_t tid = ciosrv_thread;
+	std::vector<of_thread_t>::iterator it, least;
+
+	pthread_mutex_lock(&of_threads_mutex);
+
+	if(!of_threads.empty()){
+		least = of_threads.begin();
+		for(it = of_threads.begin(); it != of_threads.end(); ++it){
+			if(it->num_of_endpoints < least->num_of_endpoints)
+				least = it;
+		}
+		least->num_of_endpoints++;
+		tid = least->tid;
+	}
+
+	pthread_mutex_unlock(&of_threads_mutex);
+
+	return tid;
+}
+
+void system_manager::__release_of_thread(pthread_t tid){
+
+	pthread_mutex_lock(&of_threads_mutex);
+
+	for(std::vector<of_thread_t>::iterator it = of_threads.begin(); it != of_threads.end(); ++it){
+		if(pthread_equal(it->tid, tid)){
+			it->num_of_endpoints--;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&of_threads_mutex);
+}
+
 //Dumps help
 void system_manager::dump_help(){
 	std::string xdpd_name="xdpd";
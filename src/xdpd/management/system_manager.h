@@ -6,7 +6,9 @@
 #define SYSTEM_MANAGER_H 
 
 #include <list>
+#include <vector>
 #include <stdint.h>
+#include <pthread.h>
 #include <rofl_datapath.h>
 #include <rofl/common/croflexception.h>
 #include <rofl/datapath/hal/driver.h>
@@ -161,8 +163,43 @@ public:
 	* Main ciosrv thread pthread state
 	*/
 	static pthread_t ciosrv_thread;
+
+	//
+	// OpenFlow endpoint I/O loop threads
+	//
+
+	/**
+	* Number of I/O loop threads running the OpenFlow endpoints of the LSIs.
+	* 0 means that endpoints run in the main I/O loop (ciosrv_thread)
+	*/
+	static unsigned int get_num_of_of_threads(void){
+		return of_threads.size();
+	}
+
+	/**
+	* Assign the I/O loop thread (the least loaded one) that will run a new
+	* OpenFlow endpoint. This function shall NEVER by called by management
+	* plugins directly
+	*/
+	static pthread_t __acquire_of_thread(void);
+
+	/**
+	* Release an I/O loop thread assigned by __acquire_of_thread(). This
+	* function shall NEVER by called by management plugins directly
+	*/
+	static void __release_of_thread(pthread_t tid);
+
 private:
 
+	//OpenFlow endpoint I/O loop thread
+	typedef struct of_thread{
+		pthread_t tid;
+		unsigned int num_of_endpoints;
+	}of_thread_t;
+
+	static std::vector<of_thread_t> of_threads;
+	static pthread_mutex_t of_threads_mutex;
+
 	//Prevent double initializations
 	static bool inited;	
 
@@ -186,11 +223,16 @@ private:
 
 	static const std::string XDPD_TEST_RUN_OPT_FULL_NAME;
 	static const std::string XDPD_EXTRA_PARAMS_OPT_FULL_NAME;
+	static const std::string XDPD_OF_THREADS_OPT_FULL_NAME;
+	static const unsigned int XDPD_MAX_OF_THREADS;
 
 	//Other helper internal functions
 	static void init_command_line_options(void);
 	static std::string __get_driver_extra_params(void); 
 	static void dump_help(void); 
+	static void start_of_threads(unsigned int num_of_threads);
+	static void stop_of_threads(void);
+	static void* run_of_thread(void* arg);
 };
 
 }// namespace xdpd 
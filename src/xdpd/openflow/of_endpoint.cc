@@ -1,14 +1,379 @@
 #include "of_endpoint.h"
+#include <rofl/datapath/hal/driver.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_action.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_pipeline.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_statistics.h>
+#include "openflow_switch.h"
 #include "../management/system_manager.h"
 
+//Buffer id of PKT_INs carrying the whole packet (not stored in the driver)
+#define OF1XP_NO_BUFFER	0xffffffff
+
+#ifndef OF1X_DEFAULT_MISS_SEND_LEN
+	#define OF1X_DEFAULT_MISS_SEND_LEN 128
+#endif
+
 using namespace xdpd;
 
 of_endpoint::of_endpoint(
 			rofl::openflow::cofhello_elem_versionbitmap const& versionbitmap,
 			enum rofl::csocket::socket_type_t socket_type,
-			const rofl::cparams& socket_params) :
-				crofbase(versionbitmap, system_manager::ciosrv_thread),
+			const rofl::cparams& socket_params,
+			pthread_t loop_tid) :
+				crofbase(versionbitmap, loop_tid),
 				sw(NULL),
 				versionbitmap(versionbitmap),
 				socket_type(socket_type),
-				socket_params(socket_params) {};
+				socket_params(socket_params),
+				miss_send_len(OF1X_DEFAULT_MISS_SEND_LEN),
+				loop_tid(loop_tid),
+				closing(false),
+				notifying(0),
+				loop_released(false) {
+
+	pthread_mutex_init(&pending_mutex, NULL);
+	pthread_cond_init(&loop_cond, NULL);
+
+	pending_events.reserve(MAX_PENDING_PKT_INS);
+	free_event_slots.reserve(MAX_PENDING_PKT_INS);
+	event_batch.reserve(MAX_PENDING_PKT_INS);
+}
+
+of_endpoint::~of_endpoint(){
+
+	std::vector<pending_event_t*>::iterator it;
+
+	//No-op if already unregistered (it must, see unregister_from_loop())
+	unregister_from_loop();
+
+	//Release the scratch slots
+	pthread_mutex_lock(&pending_mutex);
+	for(it = free_event_slots.begin(); it != free_event_slots.end(); ++it)
+		delete *it;
+	free_event_slots.clear();
+	pthread_mutex_unlock(&pending_mutex);
+
+	pthread_cond_destroy(&loop_cond);
+	pthread_mutex_destroy(&pending_mutex);
+
+	system_manager::__release_of_thread(loop_tid);
+}
+
+pthread_t of_endpoint::system_manager_acquire_of_thread(){
+	return system_manager::__acquire_of_thread();
+}
+
+void of_endpoint::unregister_from_loop(){
+
+	std::vector<pending_event_t*>::iterator it;
+	bool handshake;
+
+	pthread_mutex_lock(&pending_mutex);
+
+	if(closing){
+		pthread_mutex_unlock(&pending_mutex);
+		return;
+	}
+	closing = true;
+
+	//Let the threads waking up the loop finish; no event is notified afterwards
+	while(notifying)
+		pthread_cond_wait(&loop_cond, &pending_mutex);
+
+	//Drop the events not yet processed (the LSI is going away)
+	for(it = pending_events.begin(); it != pending_events.end(); ++it){
+		delete (*it)->flow_removed;
+		(*it)->flow_removed = NULL;
+		free_event_slots.push_back(*it);
+	}
+	pending_events.clear();
+
+	handshake = !pthread_equal(loop_tid, system_manager::ciosrv_thread) && !pthread_equal(loop_tid, pthread_self());
+
+	pthread_mutex_unlock(&pending_mutex);
+
+	if(!handshake)
+		return;
+
+	//The loop handles the events of the endpoint in order, one at a time;
+	//once it gets to this one, it is done with the endpoint
+	notify(rofl::cevent(EVENT_UNREGISTER));
+
+	pthread_mutex_lock(&pending_mutex);
+	while(!loop_released)
+		pthread_cond_wait(&loop_cond, &pending_mutex);
+	pthread_mutex_unlock(&pending_mutex);
+}
+
+//pending_mutex must be held
+of_endpoint::pending_event_t* of_endpoint::get_event_slot(){
+
+	pending_event_t* ev;
+
+	//Recycle a scratch slot; slots are only allocated until the peak backlog is reached
+	if(!free_event_slots.empty()){
+		ev = free_event_slots.back();
+		free_event_slots.pop_back();
+	}else{
+		ev = new pending_event_t;
+		ev->flow_removed = NULL;
+	}
+
+	return ev;
+}
+
+//pending_mutex must be held; returns true if the loop must be woken up (wake_up_loop())
+bool of_endpoint::push_event(pending_event_t* ev){
+
+	bool was_empty = pending_events.empty();
+
+	pending_events.push_back(ev);
+
+	//Once per batch
+	if(was_empty)
+		notifying++;
+
+	return was_empty;
+}
+
+void of_endpoint::wake_up_loop(){
+
+	notify(rofl::cevent(EVENT_DRIVER_EVENTS_PENDING));
+
+	pthread_mutex_lock(&pending_mutex);
+	if(--notifying == 0 && closing)
+		pthread_cond_broadcast(&loop_cond);
+	pthread_mutex_unlock(&pending_mutex);
+}
+
+rofl_result_t of_endpoint::deliver_packet_in(
+			uint8_t table_id,
+			uint8_t reason,
+			uint32_t in_port,
+			uint32_t buffer_id,
+			uint64_t cookie,
+			uint8_t* pkt_buffer,
+			uint32_t buf_len,
+			uint16_t total_len,
+			packet_matches_t* matches){
+
+	pending_event_t* pkt_in;
+	bool wake_up;
+	size_t len;
+
+	//Endpoints in the main I/O loop are processed in the caller's context (driver thread)
+	if(pthread_equal(loop_tid, system_manager::ciosrv_thread) || pthread_equal(loop_tid, pthread_self()))
+		return process_packet_in(table_id, reason, in_port, buffer_id, cookie, pkt_buffer, buf_len, total_len, matches);
+
+	len = (total_len < buf_len) ? total_len : buf_len;
+
+	pthread_mutex_lock(&pending_mutex);
+
+	if(closing || pending_events.size() >= MAX_PENDING_PKT_INS){
+		pthread_mutex_unlock(&pending_mutex);
+		return ROFL_FAILURE;
+	}
+
+	pkt_in = get_event_slot();
+
+	//Copy; buffers are only valid during the call. The data vector keeps its
+	//capacity across uses (up to MISS_SEND_LEN), so table-miss PKT_INs do not
+	//allocate in steady state
+	pkt_in->table_id = table_id;
+	pkt_in->reason = reason;
+	pkt_in->in_port = in_port;
+	pkt_in->buffer_id = buffer_id;
+	pkt_in->cookie = cookie;
+	pkt_in->total_len = total_len;
+	pkt_in->matches = *matches;
+	if(pkt_buffer && len)
+		pkt_in->data.assign(pkt_buffer, pkt_buffer+len);
+	else
+		pkt_in->data.clear();
+
+	wake_up = push_event(pkt_in);
+
+	pthread_mutex_unlock(&pending_mutex);
+
+	if(wake_up)
+		wake_up_loop();
+
+	return ROFL_SUCCESS;
+}
+
+rofl_result_t of_endpoint::deliver_flow_removed(
+			uint8_t reason,
+			of1x_flow_entry *entry,
+			rofl::openflow::cofmatch const& match){
+
+	pending_event_t* ev;
+	pending_flow_removed_t* fr;
+	uint32_t sec, nsec;
+	bool wake_up;
+
+	//Get duration of the flow mod
+	of1x_stats_flow_get_duration(entry, &sec, &nsec);
+
+	//Endpoints in the main I/O loop are processed in the caller's context
+	if(pthread_equal(loop_tid, system_manager::ciosrv_thread) || pthread_equal(loop_tid, pthread_self())){
+		try{
+			rofl::crofbase::send_flow_removed_message(
+					cauxid(0),
+					match,
+					entry->cookie,
+					entry->priority,
+					reason,
+					entry->table->number,
+					sec,
+					nsec,
+					entry->timer_info.idle_timeout,
+					entry->timer_info.hard_timeout,
+					entry->stats.s.counters.packet_count,
+					entry->stats.s.counters.byte_count);
+		}catch(...){
+			return ROFL_FAILURE;
+		}
+		return ROFL_SUCCESS;
+	}
+
+	//Copy; the entry is only valid during the call
+	fr = new pending_flow_removed_t(match);
+	fr->cookie = entry->cookie;
+	fr->priority = entry->priority;
+	fr->table_id = entry->table->number;
+	fr->duration_sec = sec;
+	fr->duration_nsec = nsec;
+	fr->idle_timeout = entry->timer_info.idle_timeout;
+	fr->hard_timeout = entry->timer_info.hard_timeout;
+	fr->packet_count = entry->stats.s.counters.packet_count;
+	fr->byte_count = entry->stats.s.counters.byte_count;
+
+	pthread_mutex_lock(&pending_mutex);
+
+	if(closing){
+		pthread_mutex_unlock(&pending_mutex);
+		delete fr;
+		return ROFL_FAILURE;
+	}
+
+	//Queued behind the PKT_INs already handed off
+	ev = get_event_slot();
+	ev->reason = reason;
+	ev->flow_removed = fr;
+
+	wake_up = push_event(ev);
+
+	pthread_mutex_unlock(&pending_mutex);
+
+	if(wake_up)
+		wake_up_loop();
+
+	return ROFL_SUCCESS;
+}
+
+void of_endpoint::send_flow_removed(uint8_t reason, pending_flow_removed_t* fr){
+
+	try{
+		rofl::crofbase::send_flow_removed_message(
+				cauxid(0),
+				fr->match,
+				fr->cookie,
+				fr->priority,
+				reason,
+				fr->table_id,
+				fr->duration_sec,
+				fr->duration_nsec,
+				fr->idle_timeout,
+				fr->hard_timeout,
+				fr->packet_count,
+				fr->byte_count);
+	}catch(...){
+		//No controller connected or channel congested; nothing to release
+	}
+}
+
+void of_endpoint::process_pending_events(){
+
+	std::vector<pending_event_t*>::iterator it;
+	pending_event_t* ev;
+
+	//Only the I/O loop thread touches the batch
+	pthread_mutex_lock(&pending_mutex);
+	event_batch.swap(pending_events);
+	pthread_mutex_unlock(&pending_mutex);
+
+	for(it = event_batch.begin(); it != event_batch.end(); ++it){
+		ev = *it;
+
+		if(ev->flow_removed){
+			send_flow_removed(ev->reason, ev->flow_removed);
+			delete ev->flow_removed;
+			ev->flow_removed = NULL;
+			continue;
+		}
+
+		if(process_packet_in(ev->table_id,
+				ev->reason,
+				ev->in_port,
+				ev->buffer_id,
+				ev->cookie,
+				(ev->data.empty())? NULL : &ev->data[0],
+				ev->data.size(),
+				ev->total_len,
+				&ev->matches) != ROFL_SUCCESS)
+			drop_stored_packet(ev->buffer_id, ev->in_port);
+	}
+
+	//Do not let a burst of large PKT_INs (e.g. OUTPUT:CONTROLLER with a big
+	//max_len) pin up to MAX_PENDING_PKT_INS big buffers for good
+	for(it = event_batch.begin(); it != event_batch.end(); ++it){
+		if((*it)->data.capacity() > miss_send_len)
+			std::vector<uint8_t>().swap((*it)->data);
+	}
+
+	//Return the slots
+	pthread_mutex_lock(&pending_mutex);
+	free_event_slots.insert(free_event_slots.end(), event_batch.begin(), event_batch.end());
+	pthread_mutex_unlock(&pending_mutex);
+
+	event_batch.clear();
+}
+
+/*
+* The driver already handed the PKT_IN off (successfully), so it keeps the
+* packet stored until the buffer expires. Release it right away; the driver
+* drops stored packets of PACKET_OUTs without an output action.
+*/
+void of_endpoint::drop_stored_packet(uint32_t buffer_id, uint32_t in_port){
+
+	of1x_action_group_t* action_group;
+
+	if(!sw || !buffer_id || buffer_id == OF1XP_NO_BUFFER)
+		return;
+
+	action_group = of1x_init_action_group(NULL);
+	if(!action_group)
+		return;
+
+	hal_driver_of1x_process_packet_out(sw->dpid, buffer_id, in_port, action_group, NULL, 0);
+
+	of1x_destroy_action_group(action_group);
+}
+
+void of_endpoint::handle_event(rofl::cevent const& ev){
+
+	switch(ev.cmd){
+		case EVENT_DRIVER_EVENTS_PENDING:
+			process_pending_events();
+			break;
+		case EVENT_UNREGISTER:
+			pthread_mutex_lock(&pending_mutex);
+			loop_released = true;
+			pthread_cond_broadcast(&loop_cond);
+			pthread_mutex_unlock(&pending_mutex);
+			break;
+		default:
+			crofbase::handle_event(ev);
+			break;
+	}
+}
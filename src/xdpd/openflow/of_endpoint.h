@@ -22,6 +22,8 @@
 #include <rofl/common/crofbase.h>
 #include <rofl/datapath/hal/hal.h>
 #include <rofl/datapath/pipeline/switch_port.h>
+#include <rofl/datapath/pipeline/common/datapacket.h>
+#include <rofl/datapath/pipeline/openflow/openflow1x/pipeline/of1x_flow_entry.h>
 //#include "openflow_switch.h"
 
 /**
@@ -44,7 +46,12 @@ class openflow_switch;
 * @ingroup cmm_of
 *
 * @description An OpenFlow endpoint is not a single connection endpoint, but rather the agent which
-* manages both ACTIVE and PASSIVE mode connections
+* manages both ACTIVE and PASSIVE mode connections.
+*
+* Endpoints run in the I/O loop thread assigned by the system_manager (see --of-threads).
+* Driver PKT_INs and FLOW_REMOVEDs are handed off to that thread, in order, unless the
+* endpoint runs in the main I/O loop. unregister_from_loop() MUST be called before
+* deleting an endpoint.
 */
 class of_endpoint : public crofbase {
 
@@ -53,9 +60,62 @@ public:
 	of_endpoint(
 			rofl::openflow::cofhello_elem_versionbitmap const& versionbitmap,
 			enum rofl::csocket::socket_type_t socket_type,
-			const rofl::cparams& socket_params);
+			const rofl::cparams& socket_params,
+			pthread_t loop_tid = system_manager_acquire_of_thread());
+
+	virtual ~of_endpoint();
+
+	/**
+	* Stop handing off driver events to the endpoint's I/O loop and wait
+	* until the loop thread is done with the endpoint. Pending events are
+	* dropped and subsequent ones are rejected. Must be called before
+	* deleting the endpoint (from a thread other than the I/O loop's, or
+	* from the loop thread itself outside of an async event).
+	*/
+	void unregister_from_loop(void);
+
+	/*
+	* Driver async events
+	*/
 
-	virtual ~of_endpoint() {};
+	/**
+	* Deliver a PKT_IN coming from the driver. If the endpoint does not run
+	* in the calling thread's I/O loop, the PKT_IN (including the packet
+	* data) is copied into a recycled scratch slot and processed later on by
+	* the endpoint's I/O loop. Otherwise it is encoded in the caller's
+	* context, without intermediate copies; the message (header, match and
+	* payload) is built and written by rofl's channel, which owns the socket.
+	* Safe to be called from any thread.
+	*/
+	rofl_result_t deliver_packet_in(
+			uint8_t table_id,
+			uint8_t reason,
+			uint32_t in_port,
+			uint32_t buffer_id,
+			uint64_t cookie,
+			uint8_t* pkt_buffer,
+			uint32_t buf_len,
+			uint16_t total_len,
+			packet_matches_t* matches);
+
+	virtual rofl_result_t process_packet_in(
+			uint8_t table_id,
+			uint8_t reason,
+			uint32_t in_port,
+			uint32_t buffer_id,
+			uint64_t cookie,
+			uint8_t* pkt_buffer,
+			uint32_t buf_len,
+			uint16_t total_len,
+			packet_matches_t* matches)=0;
+
+	/**
+	* Translate the flow entry being removed (valid during the call only)
+	* and deliver it via deliver_flow_removed()
+	*/
+	virtual rofl_result_t process_flow_removed(
+			uint8_t reason,
+			of1x_flow_entry *removed_flow_entry)=0;
 
 	/*
 	* Port notifications
@@ -75,6 +135,94 @@ protected:
 	rofl::openflow::cofhello_elem_versionbitmap versionbitmap;
 	enum rofl::csocket::socket_type_t socket_type;
 	cparams socket_params;
+
+	//MISS_SEND_LEN last set by the controller (I/O loop thread only)
+	uint16_t miss_send_len;
+
+	/**
+	* Send the FLOW_REMOVED of entry with the (version specific) match
+	* translated. If the endpoint does not run in the calling thread's I/O
+	* loop, the message is queued behind the PKT_INs already handed off and
+	* sent by the endpoint's I/O loop. Safe to be called from any thread.
+	*/
+	rofl_result_t deliver_flow_removed(
+			uint8_t reason,
+			of1x_flow_entry *removed_flow_entry,
+			rofl::openflow::cofmatch const& match);
+
+	//Overloaded from ciosrv
+	virtual void handle_event(rofl::cevent const& ev);
+
+private:
+
+	//Helper; avoids including system_manager.h
+	static pthread_t system_manager_acquire_of_thread(void);
+
+	//FLOW_REMOVED (translated) pending to be sent by the endpoint's I/O loop
+	typedef struct pending_flow_removed{
+		rofl::openflow::cofmatch match;
+		uint64_t cookie;
+		uint16_t priority;
+		uint8_t table_id;
+		uint32_t duration_sec;
+		uint32_t duration_nsec;
+		uint16_t idle_timeout;
+		uint16_t hard_timeout;
+		uint64_t packet_count;
+		uint64_t byte_count;
+
+		pending_flow_removed(rofl::openflow::cofmatch const& match) : match(match){}
+	}pending_flow_removed_t;
+
+	//Driver event pending to be processed by the endpoint's I/O loop; a
+	//PKT_IN, or a FLOW_REMOVED if flow_removed is set
+	typedef struct pending_event{
+		uint8_t table_id;
+		uint8_t reason;
+		uint32_t in_port;
+		uint32_t buffer_id;
+		uint64_t cookie;
+		uint16_t total_len;
+		packet_matches_t matches;
+		std::vector<uint8_t> data;
+		pending_flow_removed_t* flow_removed;
+	}pending_event_t;
+
+	//I/O loop thread running the endpoint
+	pthread_t loop_tid;
+
+	//Events handed off to the I/O loop (in order) and recycled scratch slots (pending_mutex)
+	std::vector<pending_event_t*> pending_events;
+	std::vector<pending_event_t*> free_event_slots;
+	pthread_mutex_t pending_mutex;
+
+	//Unregistration (pending_mutex); number of threads notifying the I/O loop
+	//and whether the loop thread acknowledged it
+	bool closing;
+	unsigned int notifying;
+	bool loop_released;
+	pthread_cond_t loop_cond;
+
+	//Batch being processed (I/O loop thread only)
+	std::vector<pending_event_t*> event_batch;
+
+	//Max PKT_INs pending; the rest are dropped. FLOW_REMOVEDs are not capped
+	//(bounded by the flow entries), since the controller relies on them
+	static const unsigned int MAX_PENDING_PKT_INS=1024;
+
+	//Events
+	static const int EVENT_DRIVER_EVENTS_PENDING=0x78706901;
+	static const int EVENT_UNREGISTER=0x78706902;
+
+	pending_event_t* get_event_slot(void);
+	bool push_event(pending_event_t* ev);
+	void wake_up_loop(void);
+
+	void process_pending_events(void);
+	void send_flow_removed(uint8_t reason, pending_flow_removed_t* fr);
+
+	//Release a packet stored in the driver whose PKT_IN could not be sent
+	void drop_stored_packet(uint32_t buffer_id, uint32_t in_port);
 };
 
 }// namespace rofl
@@ -41,7 +41,9 @@ openflow10_switch::openflow10_switch(uint64_t dpid,
 
 openflow10_switch::~openflow10_switch(){
 
-	//Now safely destroy the endpoint
+	//Wait for the endpoint's I/O loop to be done with it, then
+	//safely destroy the endpoint
+	endpoint->unregister_from_loop();
 	delete endpoint;
 
 	//Destroy forwarding plane state
@@ -59,7 +61,8 @@ rofl_result_t openflow10_switch::process_packet_in(uint8_t table_id,
 					uint16_t total_len,
 					packet_matches_t* matches){
 
-	return ((of10_endpoint*)endpoint)->process_packet_in(table_id,
+	//Handed off to the endpoint's I/O loop (if any)
+	return endpoint->deliver_packet_in(table_id,
 					reason,
 					in_port,
 					buffer_id,
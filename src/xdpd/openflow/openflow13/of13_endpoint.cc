@@ -1,6 +1,7 @@
 #include "of13_endpoint.h"
 
 #include <rofl/datapath/hal/driver.h>
+#include "../../drivers/hal_pktout_ext.h"
 #include <rofl/common/utils/c_logger.h>
 #include "of13_translation_utils.h"
 #include "../../management/system_manager.h"
@@ -94,6 +95,8 @@ of13_endpoint::handle_set_config(
 	if(HAL_FAILURE == hal_driver_of1x_set_pipeline_config(sw->dpid, msg.get_flags(), msg.get_miss_send_len())){
 		throw rofl::eSwitchConfigBadFlags();
 	}
+
+	miss_send_len = msg.get_miss_send_len();
 }
 
 
@@ -1197,7 +1200,10 @@ of13_endpoint::handle_barrier_request(
 		const rofl::cauxid& auxid,
 		rofl::openflow::cofmsg_barrier_request& pack)
 {
-	//Since we are not queuing messages currently
+	//PACKET_OUTs may be processed asynchronously by the driver
+	if(hal_driver_of1x_flush_packet_outs)
+		hal_driver_of1x_flush_packet_outs(sw->dpid);
+
 	ctl.send_barrier_reply(auxid, pack.get_xid());
 }
 
@@ -1215,30 +1221,12 @@ of13_endpoint::process_flow_removed(
 		of1x_flow_entry *entry)
 {
 	try {
-
 		rofl::openflow::cofmatch match(rofl::openflow13::OFP_VERSION);
-		uint32_t sec,nsec;
 
 		of13_translation_utils::of13_map_reverse_flow_entry_matches(entry->matches.head, match);
 
-		//get duration of the flow mod
-		of1x_stats_flow_get_duration(entry, &sec, &nsec);
-
-		rofl::crofbase::send_flow_removed_message(
-				cauxid(0),
-				match,
-				entry->cookie,
-				entry->priority,
-				reason,
-				entry->table->number,
-				sec,
-				nsec,
-				entry->timer_info.idle_timeout,
-				entry->timer_info.hard_timeout,
-				entry->stats.s.counters.packet_count,
-				entry->stats.s.counters.byte_count);
-
-		return ROFL_SUCCESS;
+		//Sent right away or by the endpoint's I/O loop
+		return deliver_flow_removed(reason, entry, match);
 
 	} catch (...) {
 
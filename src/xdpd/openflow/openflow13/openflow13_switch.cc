@@ -35,8 +35,10 @@ openflow13_switch::openflow13_switch(uint64_t dpid,
 
 openflow13_switch::~openflow13_switch(){
 		
-	//Now safely destroy the endpoint
-	delete endpoint;	
+	//Wait for the endpoint's I/O loop to be done with it, then
+	//safely destroy the endpoint
+	endpoint->unregister_from_loop();
+	delete endpoint;
 
 	//Destroy forwarding plane state
 	hal_driver_destroy_switch_by_dpid(dpid);
@@ -53,7 +55,8 @@ rofl_result_t openflow13_switch::process_packet_in(uint8_t table_id,
 					uint16_t total_len,
 					packet_matches_t* matches){
 	
-	return ((of13_endpoint*)endpoint)->process_packet_in(table_id,
+	//Handed off to the endpoint's I/O loop (if any)
+	return endpoint->deliver_packet_in(table_id,
 					reason,
 					in_port,
 					buffer_id,
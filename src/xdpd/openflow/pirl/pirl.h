@@ -68,6 +68,13 @@ public:
 	*/ 
 	rofl_result_t reconfigure(const int new_max_rate);
 
+	/**
+	* Get the configured max_rate (or PIRL_DISABLED)
+	*/
+	inline int get_max_rate() const{
+		return max_rate;
+	}
+
 	/**
 	* Apply PIRL rate limiting. To a certain packet.
 	*
@@ -0,0 +1,197 @@
+/**
+* This is a unit test that must check the proper
+* funcionality of the persistent connections (keep-alive)
+* of the REST plugin HTTP server
+*
+*/
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+#include <cppunit/ui/text/TestRunner.h>
+#include <cppunit/CompilerOutputter.h>
+#include <cppunit/TestCase.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include "xdpd/management/plugins/rest/server/server.hpp"
+#include "xdpd/management/plugins/rest/server/request.hpp"
+#include "xdpd/management/plugins/rest/server/reply.hpp"
+
+using namespace std;
+
+#define KEEPALIVE_TIMEOUT_S 1
+
+static const char REQUEST[] = "GET /info HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+class RestServerTestCase : public CppUnit::TestFixture{
+	CPPUNIT_TEST_SUITE(RestServerTestCase);
+	CPPUNIT_TEST(test_keep_alive);
+	CPPUNIT_TEST(test_idle_timeout);
+	CPPUNIT_TEST(test_read_error);
+	CPPUNIT_TEST_SUITE_END();
+
+	void test_keep_alive(void);
+	void test_idle_timeout(void);
+	void test_read_error(void);
+
+	boost::asio::io_service* io_service;
+	boost::thread* thread;
+	unsigned short port;
+
+	int connect_to_server(void);
+	bool read_reply(int fd);
+	bool is_closed(int fd, unsigned int timeout_ms);
+
+public:
+	void setUp(void);
+	void tearDown(void);
+};
+
+static void handler(const http::server::request& req, http::server::reply& rep){
+	rep.status = http::server::reply::ok;
+	rep.content = "ok";
+	rep.headers.resize(1);
+	rep.headers[0].name = "Content-Length";
+	rep.headers[0].value = "2";
+}
+
+void RestServerTestCase::setUp(){
+	//Avoid collisions with other instances of the test
+	port = 20000 + getpid()%10000;
+
+	io_service = new boost::asio::io_service();
+	http::server::server(*io_service, "127.0.0.1", boost::lexical_cast<std::string>(port), handler, KEEPALIVE_TIMEOUT_S)();
+	thread = new boost::thread(boost::bind(&boost::asio::io_service::run, io_service));
+}
+
+void RestServerTestCase::tearDown(){
+	io_service->stop();
+	thread->join();
+	delete thread;
+
+	//Destroys the pending handlers (acceptor and connections)
+	delete io_service;
+}
+
+int RestServerTestCase::connect_to_server(){
+	int fd;
+	struct sockaddr_in addr;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	CPPUNIT_ASSERT(fd >= 0);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+	CPPUNIT_ASSERT(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+
+	return fd;
+}
+
+//Read a full reply (body is "ok")
+bool RestServerTestCase::read_reply(int fd){
+	char buf[1024];
+	std::string rx;
+	ssize_t len;
+	struct timeval tv = {2, 0};
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	while(rx.find("\r\n\r\nok") == std::string::npos){
+		len = recv(fd, buf, sizeof(buf), 0);
+		if(len <= 0)
+			return false;
+		rx.append(buf, len);
+	}
+
+	return rx.find("HTTP/1.1 200") == 0 && rx.find("Connection: keep-alive") != std::string::npos;
+}
+
+//Whether the server closes the connection within timeout_ms
+bool RestServerTestCase::is_closed(int fd, unsigned int timeout_ms){
+	char buf[16];
+	struct timeval tv = {(time_t)(timeout_ms/1000), (suseconds_t)((timeout_ms%1000)*1000)};
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	return recv(fd, buf, sizeof(buf), 0) == 0;
+}
+
+/* Tests */
+void RestServerTestCase::test_keep_alive(){
+	unsigned int i;
+	int fd = connect_to_server();
+
+	//Several requests over the same connection, one of them pipelined
+	for(i=0; i<3; ++i){
+		CPPUNIT_ASSERT(send(fd, REQUEST, strlen(REQUEST), 0) == (ssize_t)strlen(REQUEST));
+		CPPUNIT_ASSERT(read_reply(fd));
+	}
+
+	std::string pipelined = std::string(REQUEST) + REQUEST;
+	CPPUNIT_ASSERT(send(fd, pipelined.c_str(), pipelined.size(), 0) == (ssize_t)pipelined.size());
+	CPPUNIT_ASSERT(read_reply(fd));
+	CPPUNIT_ASSERT(read_reply(fd));
+
+	close(fd);
+}
+
+void RestServerTestCase::test_idle_timeout(){
+	int fd = connect_to_server();
+
+	CPPUNIT_ASSERT(send(fd, REQUEST, strlen(REQUEST), 0) == (ssize_t)strlen(REQUEST));
+	CPPUNIT_ASSERT(read_reply(fd));
+
+	//Idle connections are closed by the server
+	CPPUNIT_ASSERT(is_closed(fd, (KEEPALIVE_TIMEOUT_S+2)*1000));
+
+	close(fd);
+}
+
+void RestServerTestCase::test_read_error(){
+	int fd, fd2;
+
+	//The client goes away in the middle of a request; the server must tear
+	//down the connection right away (before the idle timeout)
+	fd = connect_to_server();
+	CPPUNIT_ASSERT(send(fd, REQUEST, 10, 0) == 10);
+	shutdown(fd, SHUT_WR);
+	CPPUNIT_ASSERT(is_closed(fd, KEEPALIVE_TIMEOUT_S*1000/2));
+	close(fd);
+
+	//The idle timer of the torn down connection must not fire; other
+	//connections keep being served
+	fd2 = connect_to_server();
+	CPPUNIT_ASSERT(send(fd2, REQUEST, strlen(REQUEST), 0) == (ssize_t)strlen(REQUEST));
+	CPPUNIT_ASSERT(read_reply(fd2));
+	usleep(KEEPALIVE_TIMEOUT_S*1000*1000/2);
+	CPPUNIT_ASSERT(send(fd2, REQUEST, strlen(REQUEST), 0) == (ssize_t)strlen(REQUEST));
+	CPPUNIT_ASSERT(read_reply(fd2));
+
+	close(fd2);
+}
+
+/*
+* Test MAIN
+*/
+int main( int argc, char* argv[] )
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(RestServerTestCase::suite()); // Add the top suite to the test runner
+	runner.setOutputter(
+			new CppUnit::CompilerOutputter(&runner.result(), std::cerr));
+
+	// Run the test and don't wait a key if post mortem mode
+	bool wasSucessful = runner.run();
+	return wasSucessful ? 0 : 1;
+}